@@ -923,6 +923,14 @@ default_addressable_memory_unit_size (struct gdbarch *gdbarch)
   return 1;
 }
 
+/* Default method for gdbarch_displaced_step_buffer_length.  */
+
+ULONGEST
+default_displaced_step_buffer_length (struct gdbarch *gdbarch)
+{
+  return gdbarch_max_insn_length (gdbarch);
+}
+
 void
 default_guess_tracepoint_registers (struct gdbarch *gdbarch,
 				    struct regcache *regcache,
@@ -959,7 +959,8 @@ arm_linux_cleanup_svc (struct gdbarch *gdbarch,
 
   within_scratch = (apparent_pc >= dsc->scratch_base
 		    && apparent_pc < (dsc->scratch_base
-				      + DISPLACED_MODIFIED_INSNS * 4 + 4));
+				      + gdbarch_displaced_step_buffer_length
+					  (gdbarch)));
 
   if (debug_displaced)
     {
@@ -7610,6 +7610,16 @@ arm_process_displaced_insn (struct gdbarch *gdbarch, CORE_ADDR from,
 		    _("arm_process_displaced_insn: Instruction decode error"));
 }
 
+/* Implement the displaced_step_buffer_length gdbarch method.
+   arm_displaced_init_closure writes up to DISPLACED_MODIFIED_INSNS
+   instructions, followed by a breakpoint.  */
+
+static ULONGEST
+arm_displaced_step_buffer_length (struct gdbarch *gdbarch)
+{
+  return DISPLACED_MODIFIED_INSNS * 4 + 4;
+}
+
 /* Actually set up the scratch space for a displaced instruction.  */
 
 void
@@ -9354,6 +9364,8 @@ arm_gdbarch_init (struct gdbarch_info info, struct gdbarch_list *arches)
      of additional scratch space.  This setting isn't used for anything beside
      displaced stepping at present.  */
   set_gdbarch_max_insn_length (gdbarch, 4 * DISPLACED_MODIFIED_INSNS);
+  set_gdbarch_displaced_step_buffer_length (gdbarch,
+					    arm_displaced_step_buffer_length);
 
   /* This should be low enough for everything.  */
   tdep->lowest_pc = 0x20;
@@ -22,6 +22,9 @@
 #include "defs.h"
 #include "gdb_obstack.h"
 #include "bcache.h"
+#if CXX_STD_THREAD
+#include <mutex>
+#endif
 
 /* The type used to hold a single bcache string.  The user data is
    stored in d.data.  Since it can be any type, it needs to have the
@@ -31,15 +34,12 @@
 
 struct bstring
 {
-  /* Hash chain.  */
-  struct bstring *next;
+  /* The hash value of the data.  It is compared before the data
+     itself when looking strings up, and saves hashing the data again
+     when the string is moved to a larger table.  */
+  unsigned int hash;
   /* Assume the data length is no more than 64k.  */
   unsigned short length;
-  /* The half hash hack.  This contains the upper 16 bits of the hash
-     value and is used as a pre-check when comparing two strings and
-     avoids the need to do length or memcmp calls.  It proves to be
-     roughly 100% effective.  */
-  unsigned short half_hash;
 
   union
   {
@@ -49,22 +49,39 @@ struct bstring
   d;
 };
 
+/* A hash table of bstrings, using open addressing with linear
+   probing.  */
 
-/* The structure for a bcache itself.  The bcache is initialized, in
-   bcache_xmalloc(), by filling it with zeros and then setting the
-   corresponding obstack's malloc() and free() methods.  */
+struct bcache_table
+{
+  /* The table has 1 << LOG2_SIZE slots.  */
+  unsigned int log2_size;
+
+  /* The slots; NULL for an empty slot.  This table is allocated using
+     malloc, so when we grow the table we can return the old table to
+     the system.  */
+  struct bstring **slots;
+};
+
+/* The structure for a bcache itself.  The bcache is value-initialized,
+   in bcache_xmalloc(), so that everything but the lock starts out
+   zero.  */
 
 struct bcache
 {
   /* All the bstrings are allocated here.  */
   struct obstack cache;
 
-  /* How many hash buckets we're using.  */
-  unsigned int num_buckets;
-  
-  /* Hash buckets.  This table is allocated using malloc, so when we
-     grow the table we can return the old table to the system.  */
-  struct bstring **bucket;
+  /* The hash table the strings are added to.  */
+  struct bcache_table table;
+
+  /* When the table is grown, the strings are not all moved to the new
+     table at once; instead, each addition to the bcache moves a few
+     of them.  Until they have all been moved, this is the previous
+     table, which is searched after TABLE.  Strings of OLD_TABLE below
+     slot MOVE_POSITION are also in TABLE.  */
+  struct bcache_table old_table;
+  unsigned int move_position;
 
   /* Statistics.  */
   unsigned long unique_count;	/* number of unique strings */
@@ -72,28 +89,31 @@ struct bcache
   long unique_size;	/* size of unique strings, in bytes */
   long total_size;      /* total number of bytes cached, including dups */
   long structure_size;	/* total size of bcache, including infrastructure */
-  /* Number of times that the hash table is expanded and hence
-     re-built, and the corresponding number of times that a string is
-     [re]hashed as part of entering it into the expanded table.  The
-     total number of hashes can be computed by adding TOTAL_COUNT to
-     expand_hash_count.  */
+  /* Number of times that the hash table is grown, and the number of
+     strings moved to a larger table as a result.  Since the hash
+     values are kept, moving a string does not hash it again.  */
   unsigned long expand_count;
-  unsigned long expand_hash_count;
-  /* Number of times that the half-hash compare hit (compare the upper
-     16 bits of hash values) hit, but the corresponding combined
-     length/data compare missed.  */
-  unsigned long half_hash_miss_count;
+  unsigned long move_count;
+  /* Number of times that the hash values compared equal, but the
+     corresponding length/data compare missed.  */
+  unsigned long hash_miss_count;
 
   /* Hash function to be used for this bcache object.  */
   unsigned long (*hash_function)(const void *addr, int length);
 
   /* Compare function to be used for this bcache object.  */
   int (*compare_function)(const void *, const void *, int length);
+
+#if CXX_STD_THREAD
+  /* Strings may be added to the bcache by several threads at once;
+     this serializes them.  */
+  std::mutex lock;
+#endif
 };
 
 /* The old hash function was stolen from SDBM. This is what DB 3.0
    uses now, and is better than the old one.  */
-
+
 unsigned long
 hash(const void *addr, int length)
 {
@@ -116,83 +136,143 @@ hash_continue (const void *addr, int length, unsigned long h)
     }
   return (h);
 }
-
+
 /* Growing the bcache's hash table.  */
 
-/* If the average chain length grows beyond this, then we want to
-   resize our hash table.  */
-#define CHAIN_LENGTH_THRESHOLD (5)
+/* The initial number of slots of the hash table, as a power of 2.  */
+#define INITIAL_LOG2_SIZE (10)
+
+/* The table is grown when more than this fraction of its slots, in
+   quarters, are used.  */
+#define MAX_LOAD_QUARTERS (3)
+
+/* The number of slots of the old table whose strings are moved to the
+   new one by each addition to the bcache.  The old table has half the
+   size of the new one, so this must be more than 4 / MAX_LOAD_QUARTERS
+   for every string to have been moved by the time the new table needs
+   to grow in turn.  */
+#define MOVE_STEP (8)
+
+/* Return the slot of TABLE where the search for a string whose hash
+   value is HASH starts.  The hash functions are not expected to mix
+   their low bits well, so use Fibonacci hashing to pick the slot
+   from all of them.  */
+
+static unsigned int
+home_slot (const struct bcache_table *table, unsigned int hash)
+{
+  return (hash * 2654435769u) >> (32 - table->log2_size);
+}
+
+/* Return the slot of TABLE following SLOT, wrapping around.  */
+
+static unsigned int
+next_slot (const struct bcache_table *table, unsigned int slot)
+{
+  return (slot + 1) & ((1u << table->log2_size) - 1);
+}
+
+/* Search TABLE for the LENGTH bytes at ADDR, whose hash value is
+   HASH.  Return the slot holding them if found, else the empty slot
+   where the search stopped.  TABLE must not be full.  */
+
+static struct bstring **
+lookup_slot (struct bcache *bcache, struct bcache_table *table,
+	     const void *addr, int length, unsigned int hash)
+{
+  unsigned int slot;
+
+  for (slot = home_slot (table, hash);
+       table->slots[slot] != NULL;
+       slot = next_slot (table, slot))
+    {
+      struct bstring *s = table->slots[slot];
+
+      if (s->hash == hash)
+	{
+	  if (s->length == length
+	      && bcache->compare_function (&s->d.data, addr, length))
+	    break;
+	  else
+	    bcache->hash_miss_count++;
+	}
+    }
+
+  return &table->slots[slot];
+}
+
+/* Add S, a string known not to be in it, to TABLE.  */
 
 static void
-expand_hash_table (struct bcache *bcache)
+insert_string (struct bcache_table *table, struct bstring *s)
 {
-  /* A table of good hash table sizes.  Whenever we grow, we pick the
-     next larger size from this table.  sizes[i] is close to 1 << (i+10),
-     so we roughly double the table size each time.  After we fall off 
-     the end of this table, we just double.  Don't laugh --- there have
-     been executables sighted with a gigabyte of debug info.  */
-  static unsigned long sizes[] = { 
-    1021, 2053, 4099, 8191, 16381, 32771,
-    65537, 131071, 262144, 524287, 1048573, 2097143,
-    4194301, 8388617, 16777213, 33554467, 67108859, 134217757,
-    268435459, 536870923, 1073741827, 2147483659UL
-  };
-  unsigned int new_num_buckets;
-  struct bstring **new_buckets;
-  unsigned int i;
-
-  /* Count the stats.  Every unique item needs to be re-hashed and
-     re-entered.  */
-  bcache->expand_count++;
-  bcache->expand_hash_count += bcache->unique_count;
-
-  /* Find the next size.  */
-  new_num_buckets = bcache->num_buckets * 2;
-  for (i = 0; i < (sizeof (sizes) / sizeof (sizes[0])); i++)
-    if (sizes[i] > bcache->num_buckets)
-      {
-	new_num_buckets = sizes[i];
-	break;
-      }
+  unsigned int slot;
 
-  /* Allocate the new table.  */
-  {
-    size_t new_size = new_num_buckets * sizeof (new_buckets[0]);
+  for (slot = home_slot (table, s->hash);
+       table->slots[slot] != NULL;
+       slot = next_slot (table, slot))
+    ;
 
-    new_buckets = (struct bstring **) xmalloc (new_size);
-    memset (new_buckets, 0, new_size);
+  table->slots[slot] = s;
+}
 
-    bcache->structure_size -= (bcache->num_buckets
-			       * sizeof (bcache->bucket[0]));
-    bcache->structure_size += new_size;
-  }
+/* Move the strings of up to COUNT slots of BCACHE's old table to its
+   current table, and free the old table once it is empty.  */
 
-  /* Rehash all existing strings.  */
-  for (i = 0; i < bcache->num_buckets; i++)
+static void
+move_strings (struct bcache *bcache, unsigned int count)
+{
+  unsigned int old_size = 1u << bcache->old_table.log2_size;
+
+  for (; count > 0 && bcache->move_position < old_size; count--)
     {
-      struct bstring *s, *next;
+      struct bstring *s = bcache->old_table.slots[bcache->move_position++];
 
-      for (s = bcache->bucket[i]; s; s = next)
+      if (s != NULL)
 	{
-	  struct bstring **new_bucket;
-	  next = s->next;
-
-	  new_bucket = &new_buckets[(bcache->hash_function (&s->d.data,
-							    s->length)
-				     % new_num_buckets)];
-	  s->next = *new_bucket;
-	  *new_bucket = s;
+	  insert_string (&bcache->table, s);
+	  bcache->move_count++;
 	}
     }
 
-  /* Plug in the new table.  */
-  if (bcache->bucket)
-    xfree (bcache->bucket);
-  bcache->bucket = new_buckets;
-  bcache->num_buckets = new_num_buckets;
+  if (bcache->move_position == old_size)
+    {
+      xfree (bcache->old_table.slots);
+      bcache->old_table.slots = NULL;
+      bcache->structure_size -= old_size * sizeof (struct bstring *);
+    }
 }
 
-
+/* Start using a table twice as large as BCACHE's current one, or
+   allocate the first table.  */
+
+static void
+expand_hash_table (struct bcache *bcache)
+{
+  unsigned int log2_size;
+  size_t new_size;
+
+  /* Only one table can be being emptied at a time.  */
+  if (bcache->old_table.slots != NULL)
+    move_strings (bcache, UINT_MAX);
+
+  if (bcache->table.slots != NULL)
+    {
+      bcache->expand_count++;
+      bcache->old_table = bcache->table;
+      bcache->move_position = 0;
+      log2_size = bcache->table.log2_size + 1;
+    }
+  else
+    log2_size = INITIAL_LOG2_SIZE;
+
+  new_size = ((size_t) 1 << log2_size) * sizeof (struct bstring *);
+  bcache->table.log2_size = log2_size;
+  bcache->table.slots = (struct bstring **) xzalloc (new_size);
+  bcache->structure_size += new_size;
+}
+
+
 /* Looking up things in the bcache.  */
 
 /* The number of bytes needed to allocate a struct bstring whose data
@@ -218,51 +298,60 @@ const void *
 bcache_full (const void *addr, int length, struct bcache *bcache, int *added)
 {
   unsigned long full_hash;
-  unsigned short half_hash;
-  int hash_index;
-  struct bstring *s;
+  unsigned int hash;
+  struct bstring **slot;
 
   if (added)
     *added = 0;
 
-  /* Lazily initialize the obstack.  This can save quite a bit of
-     memory in some cases.  */
+  /* Hash outside of the lock; this is the only part of the work that
+     depends on the length of the string when it is already in the
+     cache.  */
+  full_hash = bcache->hash_function (addr, length);
+  hash = full_hash ^ (full_hash >> 16 >> 16);
+
+#if CXX_STD_THREAD
+  std::lock_guard<std::mutex> guard (bcache->lock);
+#endif
+
+  /* Lazily initialize the obstack and the hash table.  This can save
+     quite a bit of memory in some cases.  */
   if (bcache->total_count == 0)
     {
       /* We could use obstack_specify_allocation here instead, but
 	 gdb_obstack.h specifies the allocation/deallocation
 	 functions.  */
       obstack_init (&bcache->cache);
+      expand_hash_table (bcache);
     }
 
-  /* If our average chain length is too high, expand the hash table.  */
-  if (bcache->unique_count >= bcache->num_buckets * CHAIN_LENGTH_THRESHOLD)
-    expand_hash_table (bcache);
-
   bcache->total_count++;
   bcache->total_size += length;
 
-  full_hash = bcache->hash_function (addr, length);
+  /* Search the hash table for a string identical to the caller's, and
+     then the table being emptied, if any.  */
+  slot = lookup_slot (bcache, &bcache->table, addr, length, hash);
+  if (*slot != NULL)
+    return &(*slot)->d.data;
+
+  if (bcache->old_table.slots != NULL)
+    {
+      struct bstring **old_slot
+	= lookup_slot (bcache, &bcache->old_table, addr, length, hash);
 
-  half_hash = (full_hash >> 16);
-  hash_index = full_hash % bcache->num_buckets;
+      if (*old_slot != NULL)
+	return &(*old_slot)->d.data;
+    }
 
-  /* Search the hash bucket for a string identical to the caller's.
-     As a short-circuit first compare the upper part of each hash
-     values.  */
-  for (s = bcache->bucket[hash_index]; s; s = s->next)
+  /* The user's string isn't in the cache.  If the table is getting
+     too full, grow it first.  */
+  if ((bcache->unique_count + 1) * 4
+      > (MAX_LOAD_QUARTERS << bcache->table.log2_size))
     {
-      if (s->half_hash == half_hash)
-	{
-	  if (s->length == length
-	      && bcache->compare_function (&s->d.data, addr, length))
-	    return &s->d.data;
-	  else
-	    bcache->half_hash_miss_count++;
-	}
+      expand_hash_table (bcache);
+      slot = lookup_slot (bcache, &bcache->table, addr, length, hash);
     }
 
-  /* The user's string isn't in the list.  Insert it after *ps.  */
   {
     struct bstring *newobj
       = (struct bstring *) obstack_alloc (&bcache->cache,
@@ -270,21 +359,23 @@ bcache_full (const void *addr, int length, struct bcache *bcache, int *added)
 
     memcpy (&newobj->d.data, addr, length);
     newobj->length = length;
-    newobj->next = bcache->bucket[hash_index];
-    newobj->half_hash = half_hash;
-    bcache->bucket[hash_index] = newobj;
+    newobj->hash = hash;
+    *slot = newobj;
 
     bcache->unique_count++;
     bcache->unique_size += length;
     bcache->structure_size += BSTRING_SIZE (length);
 
+    if (bcache->old_table.slots != NULL)
+      move_strings (bcache, MOVE_STEP);
+
     if (added)
       *added = 1;
 
     return &newobj->d.data;
   }
 }
-
+
 
 /* Compare the byte string at ADDR1 of lenght LENGHT to the
    string at ADDR2.  Return 1 if they are equal.  */
@@ -309,7 +400,7 @@ bcache_xmalloc (unsigned long (*hash_function)(const void *, int length),
 					int length))
 {
   /* Allocate the bcache pre-zeroed.  */
-  struct bcache *b = XCNEW (struct bcache);
+  struct bcache *b = new struct bcache ();
 
   if (hash_function)
     b->hash_function = hash_function;
@@ -332,8 +423,9 @@ bcache_xfree (struct bcache *bcache)
   /* Only free the obstack if we actually initialized it.  */
   if (bcache->total_count > 0)
     obstack_free (&bcache->cache, 0);
-  xfree (bcache->bucket);
-  xfree (bcache);
+  xfree (bcache->table.slots);
+  xfree (bcache->old_table.slots);
+  delete bcache;
 }
 
 
@@ -358,59 +450,74 @@ print_percentage (int portion, int total)
 void
 print_bcache_statistics (struct bcache *c, const char *type)
 {
-  int occupied_buckets;
-  int max_chain_length;
-  int median_chain_length;
+  unsigned int num_slots;
+  int occupied_slots;
+  int max_probe_length;
+  int median_probe_length;
+  unsigned long total_probe_length;
   int max_entry_size;
   int median_entry_size;
 
-  /* Count the number of occupied buckets, tally the various string
-     lengths, and measure chain lengths.  */
+  /* Tally the various string lengths, and measure how far from the
+     slot where their search starts strings are.  Strings not moved to
+     the current table yet are only counted for their length.  */
   {
-    unsigned int b;
-    int *chain_length = XCNEWVEC (int, c->num_buckets + 1);
+    unsigned int slot;
+    int *probe_length = XCNEWVEC (int, c->unique_count + 1);
     int *entry_size = XCNEWVEC (int, c->unique_count + 1);
     int stringi = 0;
 
-    occupied_buckets = 0;
+    num_slots = c->table.slots != NULL ? 1u << c->table.log2_size : 0;
+    occupied_slots = 0;
+    total_probe_length = 0;
 
-    for (b = 0; b < c->num_buckets; b++)
+    for (slot = 0; slot < num_slots; slot++)
       {
-	struct bstring *s = c->bucket[b];
+	struct bstring *s = c->table.slots[slot];
 
-	chain_length[b] = 0;
-
-	if (s)
+	if (s != NULL)
 	  {
-	    occupied_buckets++;
-	    
-	    while (s)
-	      {
-		gdb_assert (b < c->num_buckets);
-		chain_length[b]++;
-		gdb_assert (stringi < c->unique_count);
-		entry_size[stringi++] = s->length;
-		s = s->next;
-	      }
+	    unsigned int home = home_slot (&c->table, s->hash);
+
+	    gdb_assert (stringi < c->unique_count);
+	    probe_length[occupied_slots]
+	      = ((slot - home) & (num_slots - 1)) + 1;
+	    total_probe_length += probe_length[occupied_slots];
+	    occupied_slots++;
+	    entry_size[stringi++] = s->length;
 	  }
       }
 
-    /* To compute the median, we need the set of chain lengths
+    if (c->old_table.slots != NULL)
+      for (slot = c->move_position;
+	   slot < 1u << c->old_table.log2_size;
+	   slot++)
+	{
+	  struct bstring *s = c->old_table.slots[slot];
+
+	  if (s != NULL)
+	    {
+	      gdb_assert (stringi < c->unique_count);
+	      entry_size[stringi++] = s->length;
+	    }
+	}
+
+    /* To compute the median, we need the set of probe lengths
        sorted.  */
-    qsort (chain_length, c->num_buckets, sizeof (chain_length[0]),
+    qsort (probe_length, occupied_slots, sizeof (probe_length[0]),
 	   compare_positive_ints);
     qsort (entry_size, c->unique_count, sizeof (entry_size[0]),
 	   compare_positive_ints);
 
-    if (c->num_buckets > 0)
+    if (occupied_slots > 0)
       {
-	max_chain_length = chain_length[c->num_buckets - 1];
-	median_chain_length = chain_length[c->num_buckets / 2];
+	max_probe_length = probe_length[occupied_slots - 1];
+	median_probe_length = probe_length[occupied_slots / 2];
       }
     else
       {
-	max_chain_length = 0;
-	median_chain_length = 0;
+	max_probe_length = 0;
+	median_probe_length = 0;
       }
     if (c->unique_count > 0)
       {
@@ -423,7 +530,7 @@ print_bcache_statistics (struct bcache *c, const char *type)
 	median_entry_size = 0;
       }
 
-    xfree (chain_length);
+    xfree (probe_length);
     xfree (entry_size);
   }
 
@@ -459,26 +566,29 @@ Total memory used by bcache, including overhead: %ld\n"),
   print_percentage (c->total_size - c->structure_size, c->total_size);
   printf_filtered ("\n");
 
-  printf_filtered (_("    Hash table size:           %3d\n"), 
-		   c->num_buckets);
+  printf_filtered (_("    Hash table size:           %3u\n"), num_slots);
   printf_filtered (_("    Hash table expands:        %lu\n"),
 		   c->expand_count);
   printf_filtered (_("    Hash table hashes:         %lu\n"),
-		   c->total_count + c->expand_hash_count);
-  printf_filtered (_("    Half hash misses:          %lu\n"),
-		   c->half_hash_miss_count);
+		   c->total_count);
+  printf_filtered (_("    Strings moved on expands:  %lu\n"),
+		   c->move_count);
+  printf_filtered (_("    Strings not moved yet:     %lu\n"),
+		   c->unique_count - occupied_slots);
+  printf_filtered (_("    Hash misses:               %lu\n"),
+		   c->hash_miss_count);
   printf_filtered (_("    Hash table population:     "));
-  print_percentage (occupied_buckets, c->num_buckets);
-  printf_filtered (_("    Median hash chain length:  %3d\n"),
-		   median_chain_length);
-  printf_filtered (_("    Average hash chain length: "));
-  if (c->num_buckets > 0)
-    printf_filtered ("%3lu\n", c->unique_count / c->num_buckets);
+  print_percentage (occupied_slots, num_slots);
+  printf_filtered (_("    Median probe length:       %3d\n"),
+		   median_probe_length);
+  printf_filtered (_("    Average probe length:      "));
+  if (occupied_slots > 0)
+    printf_filtered ("%3lu\n", total_probe_length / occupied_slots);
   else
-    /* i18n: "Average hash chain length: (not applicable)".  */
+    /* i18n: "Average probe length: (not applicable)".  */
     printf_filtered (_("(not applicable)\n"));
-  printf_filtered (_("    Maximum hash chain length: %3d\n"), 
-		   max_chain_length);
+  printf_filtered (_("    Maximum probe length:      %3d\n"),
+		   max_probe_length);
   printf_filtered ("\n");
 }
 
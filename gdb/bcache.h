@@ -62,78 +62,33 @@
    sharing its space with future duplicates.
 
 
-   Size of bcache VS hashtab:
-
-   For bcache, the most critical cost is size (or more exactly the
-   overhead added by the bcache).  It turns out that the bcache is
-   remarkably efficient.
-
-   Assuming a 32-bit system (the hash table slots are 4 bytes),
-   ignoring alignment, and limit strings to 255 bytes (1 byte length)
-   we get ...
-
-   bcache: This uses a separate linked list to track the hash chain.
-   The numbers show roughly 100% occupancy of the hash table and an
-   average chain length of 4.  Spreading the slot cost over the 4
-   chain elements:
-
-   4 (slot) / 4 (chain length) + 1 (length) + 4 (chain) = 6 bytes
-
-   hashtab: This uses a more traditional re-hash algorithm where the
-   chain is maintained within the hash table.  The table occupancy is
-   kept below 75% but we'll assume its perfect:
-
-   4 (slot) x 4/3 (occupancy) +  1 (length) = 6 1/3 bytes
-
-   So a perfect hashtab has just slightly larger than an average
-   bcache.
-
-   It turns out that an average hashtab is far worse.  Two things
-   hurt:
-
-   - Hashtab's occupancy is more like 50% (it ranges between 38% and
-   75%) giving a per slot cost of 4x2 vs 4x4/3.
-
-   - the string structure needs to be aligned to 8 bytes which for
-   hashtab wastes 7 bytes, while for bcache wastes only 3.
-
-   This gives:
-
-   hashtab: 4 x 2 + 1 + 7 = 16 bytes
-
-   bcache 4 / 4 + 1 + 4 + 3 = 9 bytes
-
-   The numbers of GDB debugging GDB support this.  ~40% vs ~70% overhead.
-
-
-   Speed of bcache VS hashtab (the half hash hack):
-
-   While hashtab has a typical chain length of 1, bcache has a chain
-   length of round 4.  This means that the bcache will require
-   something like double the number of compares after that initial
-   hash.  In both cases the comparison takes the form:
-
-   a.length == b.length && memcmp (a.data, b.data, a.length) == 0
-
-   That is lengths are checked before doing the memcmp.
-
-   For GDB debugging GDB, it turned out that all lengths were 24 bytes
-   (no C++ so only psymbols were cached) and hence, all compares
-   required a call to memcmp.  As a hack, two bytes of padding
-   (mentioned above) are used to store the upper 16 bits of the
-   string's hash value and then that is used in the comparison vis:
-
-   a.half_hash == b.half_hash && a.length == b.length && memcmp
-   (a.data, b.data, a.length)
-
-   The numbers from GDB debugging GDB show this to be a remarkable
-   100% effective (only necessary length and memcmp tests being
-   performed).
-
-   Mind you, looking at the wall clock, the same GDB debugging GDB
-   showed only marginal speed up (0.780 vs 0.773s).  Seems GDB is too
-   busy doing something else :-(
-  
+   Layout of the bcache:
+
+   Each string is copied onto an obstack, behind a small header
+   holding its length and its full (32-bit) hash value.  The strings
+   are found through an open-addressed hash table of pointers to
+   those headers, probed linearly from a slot picked by Fibonacci
+   hashing.  The table is at most 3/4 full, so on a 64-bit host each
+   string costs between 10 2/3 and 21 1/3 bytes of table on top of
+   its 8-byte header; for GDB debugging GDB the total overhead ends
+   up somewhat higher than with the old chained table (~53% vs ~44%),
+   but the obstack itself shrinks by the 8-byte chain pointer each
+   string used to carry.
+
+   Comparing the stored hash before the length and the memcmp means
+   that a probe only calls memcmp on a genuine match almost all the
+   time.  It also means that growing the table never needs to rehash
+   a string.  Growth is incremental: a table twice as large is
+   allocated, and every later insertion moves a few strings from the
+   old table into the new one, so no single insertion pays for
+   copying the whole table.  Lookups search the new table first, then
+   whatever is left of the old one.
+
+   Several threads may call bcache concurrently (for instance while
+   reading symbols in parallel).  The hash is computed outside of the
+   bcache's lock; only the probe and the insertion itself are
+   serialized.  Strings are never moved or freed until the bcache is,
+   so a pointer returned by bcache remains valid without locking.
 */
 
 
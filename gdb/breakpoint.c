@@ -540,6 +540,11 @@ static struct bp_location **bp_locations;
 
 static unsigned bp_locations_count;
 
+/* The generation of the current contents of BP_LOCATIONS.  Bumped by
+   each update_global_location_list.  Never zero.  */
+
+static unsigned int bp_locations_generation = 1;
+
 /* Maximum alignment offset between bp_target_info.PLACED_ADDRESS and
    ADDRESS for the current elements of BP_LOCATIONS which get a valid
    result from bp_location_has_shadow.  You can use it for roughly
@@ -6709,11 +6714,21 @@ info_watchpoints_command (const char *args, int from_tty)
     }
 }
 
+/* Number of breakpoints breakpoint_re_set_objfiles didn't need to
+   re-set.  Shown by "maint info breakpoints".  */
+
+static unsigned int breakpoint_re_sets_skipped;
+
 static void
 maintenance_info_breakpoints (const char *args, int from_tty)
 {
   breakpoint_1 (args, 1, NULL);
 
+  if (args == NULL || *args == '\0')
+    printf_filtered (_("Breakpoint re-sets skipped on shared library "
+		       "load: %u\n"),
+		     breakpoint_re_sets_skipped);
+
   default_collect_info ();
 }
 
@@ -11691,6 +11706,15 @@ bp_locations_compare (const void *ap, const void *bp)
   return (a > b) - (a < b);
 }
 
+/* Return true if A sorts before B in the bp_locations array.  Wrapper
+   of bp_locations_compare for the std algorithms.  */
+
+static bool
+bp_location_is_less_than (const bp_location *a, const bp_location *b)
+{
+  return bp_locations_compare (&a, &b) < 0;
+}
+
 /* Set bp_locations_placed_address_before_address_max and
    bp_locations_shadow_len_after_address_max according to the current
    content of the bp_locations array.  */
@@ -11894,17 +11918,56 @@ update_global_location_list (enum ugll_insert_mode insert_mode)
   bp_locations = NULL;
   bp_locations_count = 0;
 
+  /* Rather than sorting all the locations from scratch, which is
+     what dominates this function once there are thousands of them,
+     keep the locations that were already in the array in their
+     order, and only sort and merge in the new ones.  Locations not
+     yet in the array are recognized by their zero generation.  */
+  std::vector<bp_location *> new_locations;
+
+  if (++bp_locations_generation == 0)
+    bp_locations_generation = 1;
+
   ALL_BREAKPOINTS (b)
     for (loc = b->loc; loc; loc = loc->next)
-      bp_locations_count++;
+      {
+	if (loc->global_list_generation == 0)
+	  new_locations.push_back (loc);
+	loc->global_list_generation = bp_locations_generation;
+	bp_locations_count++;
+      }
 
   bp_locations = XNEWVEC (struct bp_location *, bp_locations_count);
   locp = bp_locations;
-  ALL_BREAKPOINTS (b)
-    for (loc = b->loc; loc; loc = loc->next)
-      *locp++ = loc;
-  qsort (bp_locations, bp_locations_count, sizeof (*bp_locations),
-	 bp_locations_compare);
+
+  /* The locations that remain in the array are normally still
+     sorted, but the sort keys of a location can change in place (e.g.
+     its address, when an ifunc gets resolved).  Resort everything if
+     that happened.  */
+  bool still_sorted = true;
+
+  for (old_locp = old_locations.get ();
+       old_locp < old_locations.get () + old_locations_count;
+       old_locp++)
+    if ((*old_locp)->global_list_generation == bp_locations_generation)
+      {
+	if (locp > bp_locations
+	    && bp_location_is_less_than (*old_locp, locp[-1]))
+	  still_sorted = false;
+	*locp++ = *old_locp;
+      }
+
+  std::sort (new_locations.begin (), new_locations.end (),
+	     bp_location_is_less_than);
+  std::copy (new_locations.begin (), new_locations.end (), locp);
+
+  if (still_sorted)
+    std::inplace_merge (bp_locations, locp,
+			bp_locations + bp_locations_count,
+			bp_location_is_less_than);
+  else
+    std::sort (bp_locations, bp_locations + bp_locations_count,
+	       bp_location_is_less_than);
 
   bp_locations_target_extensions_update ();
 
@@ -12054,6 +12117,8 @@ update_global_location_list (enum ugll_insert_mode insert_mode)
 
       if (!found_object)
 	{
+	  old_loc->global_list_generation = 0;
+
 	  if (removed && target_is_non_stop_p ()
 	      && need_moribund_for_location_type (old_loc))
 	    {
@@ -13959,11 +14024,51 @@ breakpoint_re_set_one (breakpoint *b)
   b->ops->re_set (b);
 }
 
-/* Re-set breakpoint locations for the current program space.
-   Locations bound to other program spaces are left untouched.  */
+/* Return true if B needs to be re-set after the symbols of OBJFILES
+   were read in.  */
 
-void
-breakpoint_re_set (void)
+static bool
+breakpoint_re_set_needed_p (struct breakpoint *b,
+			    const std::vector<objfile *> &objfiles)
+{
+  struct bp_location *loc;
+
+  /* Only ordinary breakpoints, dprintfs and tracepoints can be left
+     alone: the locations of those only depend on what their location
+     spec resolves to.  */
+  if (b->ops->re_set != bkpt_re_set
+      && b->ops->re_set != dprintf_re_set
+      && b->ops->re_set != tracepoint_re_set)
+    return true;
+
+  if (b->location == NULL || b->location_range_end != NULL)
+    return true;
+
+  /* A condition that failed to parse might now parse.  */
+  if (b->condition_not_parsed)
+    return true;
+  if (b->cond_string != NULL)
+    for (loc = b->loc; loc != NULL; loc = loc->next)
+      if (loc->cond == NULL)
+	return true;
+
+  /* Look the names up the way re-setting B would.  */
+  set_language (b->language);
+
+  for (objfile *objfile : objfiles)
+    if (linespec_location_may_match_objfile (b->location.get (), objfile))
+      return true;
+
+  return false;
+}
+
+/* Re-set the breakpoints for the current program space, or, if
+   OBJFILES is not NULL, only those that may have locations in one of
+   OBJFILES.  Locations bound to other program spaces are left
+   untouched.  */
+
+static void
+breakpoint_re_set_1 (const std::vector<objfile *> *objfiles)
 {
   struct breakpoint *b, *b_tmp;
 
@@ -13979,6 +14084,12 @@ breakpoint_re_set (void)
 
     ALL_BREAKPOINTS_SAFE (b, b_tmp)
       {
+	if (objfiles != NULL && !breakpoint_re_set_needed_p (b, *objfiles))
+	  {
+	    breakpoint_re_sets_skipped++;
+	    continue;
+	  }
+
 	TRY
 	  {
 	    breakpoint_re_set_one (b);
@@ -14003,6 +14114,22 @@ breakpoint_re_set (void)
   /* Now we can insert.  */
   update_global_location_list (UGLL_MAY_INSERT);
 }
+
+/* See breakpoint.h.  */
+
+void
+breakpoint_re_set (void)
+{
+  breakpoint_re_set_1 (NULL);
+}
+
+/* See breakpoint.h.  */
+
+void
+breakpoint_re_set_objfiles (const std::vector<objfile *> &objfiles)
+{
+  breakpoint_re_set_1 (&objfiles);
+}
 
 /* Reset the thread number of this breakpoint:
 
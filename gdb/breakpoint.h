@@ -402,6 +402,12 @@ public:
      should be downloaded and so that `tfind N' always works.  */
   bool duplicate = false;
 
+  /* The generation of the bp_locations array this location was last
+     found in by update_global_location_list, or zero if this location
+     is not in the array.  Used to tell which locations are new, so
+     that only those need to be sorted into the array.  */
+  unsigned int global_list_generation = 0;
+
   /* If we someday support real thread-specific breakpoints, then
      the breakpoint location will need a thread identifier.  */
 
@@ -1221,6 +1227,12 @@ extern void update_breakpoint_locations
 
 extern void breakpoint_re_set (void);
 
+/* Like breakpoint_re_set, but only re-set the breakpoints that may
+   have locations in OBJFILES, whose symbols were just read in.  */
+
+extern void breakpoint_re_set_objfiles
+  (const std::vector<struct objfile *> &objfiles);
+
 extern void breakpoint_re_set_thread (struct breakpoint *);
 
 extern void delete_breakpoint (struct breakpoint *);
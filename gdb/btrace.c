@@ -65,6 +65,216 @@ static void btrace_add_pc (struct thread_info *tp);
 
 #define DEBUG_FTRACE(msg, args...) DEBUG ("[ftrace] " msg, ##args)
 
+/* Bits of the first byte of a packed instruction.  The remaining bits
+   hold the instruction's flags.  */
+
+#define BTRACE_PACKED_ICLASS_MASK 0x3
+#define BTRACE_PACKED_PC 0x4
+#define BTRACE_PACKED_FLAGS_SHIFT 3
+
+/* Append VAL to BUF as a signed LEB128 number.  */
+
+static void
+btrace_pack_sleb128 (gdb::byte_vector &buf, LONGEST val)
+{
+  for (;;)
+    {
+      gdb_byte byte = val & 0x7f;
+
+      val >>= 7;
+      if ((val == 0 && (byte & 0x40) == 0)
+	  || (val == -1 && (byte & 0x40) != 0))
+	{
+	  buf.push_back (byte);
+	  return;
+	}
+      buf.push_back (byte | 0x80);
+    }
+}
+
+/* Read a signed LEB128 number at *PTR, and advance *PTR past it.  */
+
+static LONGEST
+btrace_unpack_sleb128 (const gdb_byte **ptr)
+{
+  ULONGEST result = 0;
+  unsigned int shift = 0;
+  gdb_byte byte;
+
+  do
+    {
+      byte = *(*ptr)++;
+      result |= ((ULONGEST) (byte & 0x7f)) << shift;
+      shift += 7;
+    }
+  while ((byte & 0x80) != 0);
+
+  if (shift < 8 * sizeof (result) && (byte & 0x40) != 0)
+    result |= -(((ULONGEST) 1) << shift);
+
+  return (LONGEST) result;
+}
+
+/* See btrace.h.  */
+
+const btrace_insn &
+btrace_insn_store::operator[] (unsigned int index) const
+{
+  unsigned int number = index / BTRACE_INSN_CHUNK_SIZE;
+
+  if (number == m_chunks.size ())
+    return m_tail[index % BTRACE_INSN_CHUNK_SIZE];
+
+  gdb_assert (number < m_chunks.size ());
+  return unpack (number)[index % BTRACE_INSN_CHUNK_SIZE];
+}
+
+/* See btrace.h.  */
+
+void
+btrace_insn_store::push_back (const btrace_insn &insn)
+{
+  m_tail.push_back (insn);
+  if (m_tail.size () < BTRACE_INSN_CHUNK_SIZE)
+    return;
+
+  /* Pack the tail.  Each instruction's address is recorded relative to
+     the end of the previous one.  */
+  gdb::byte_vector chunk;
+  CORE_ADDR next_pc = 0;
+
+  chunk.reserve (2 * BTRACE_INSN_CHUNK_SIZE);
+  for (const btrace_insn &tail_insn : m_tail)
+    {
+      unsigned int flags = tail_insn.flags;
+      gdb_byte byte;
+
+      gdb_assert ((flags >> (8 - BTRACE_PACKED_FLAGS_SHIFT)) == 0);
+      byte = tail_insn.iclass | (flags << BTRACE_PACKED_FLAGS_SHIFT);
+      if (tail_insn.pc != next_pc)
+	byte |= BTRACE_PACKED_PC;
+
+      chunk.push_back (byte);
+      chunk.push_back (tail_insn.size);
+      if (tail_insn.pc != next_pc)
+	btrace_pack_sleb128 (chunk, (LONGEST) (tail_insn.pc - next_pc));
+
+      next_pc = tail_insn.pc + tail_insn.size;
+    }
+
+  chunk.shrink_to_fit ();
+  m_chunks.push_back (std::move (chunk));
+  m_tail.clear ();
+}
+
+/* See btrace.h.  */
+
+void
+btrace_insn_store::pop_back ()
+{
+  gdb_assert (!empty ());
+
+  /* Unpack the last chunk into the tail if the tail is empty.  */
+  if (m_tail.empty ())
+    {
+      unsigned int number = m_chunks.size () - 1;
+
+      m_tail = unpack (number);
+      uncache (number);
+      m_chunks.pop_back ();
+    }
+
+  m_tail.pop_back ();
+}
+
+/* See btrace.h.  */
+
+void
+btrace_insn_store::clear ()
+{
+  m_chunks.clear ();
+  m_tail.clear ();
+
+  for (cache_entry &entry : m_cache)
+    {
+      entry.number = UINT_MAX;
+      entry.insns.clear ();
+    }
+}
+
+/* See btrace.h.  */
+
+size_t
+btrace_insn_store::memory_used () const
+{
+  size_t used = m_tail.capacity () * sizeof (btrace_insn);
+
+  for (const gdb::byte_vector &chunk : m_chunks)
+    used += chunk.capacity ();
+
+  return used;
+}
+
+/* See btrace.h.  */
+
+const std::vector<btrace_insn> &
+btrace_insn_store::unpack (unsigned int number) const
+{
+  cache_entry *victim = &m_cache[0];
+
+  ++m_clock;
+  for (cache_entry &entry : m_cache)
+    {
+      if (entry.number == number)
+	{
+	  entry.last_use = m_clock;
+	  return entry.insns;
+	}
+
+      if (entry.last_use < victim->last_use)
+	victim = &entry;
+    }
+
+  const gdb::byte_vector &chunk = m_chunks[number];
+  const gdb_byte *ptr = chunk.data ();
+  CORE_ADDR next_pc = 0;
+
+  victim->number = number;
+  victim->last_use = m_clock;
+  victim->insns.resize (BTRACE_INSN_CHUNK_SIZE);
+  for (btrace_insn &insn : victim->insns)
+    {
+      gdb_byte byte = *ptr++;
+
+      insn.iclass = ((enum btrace_insn_class)
+		     (byte & BTRACE_PACKED_ICLASS_MASK));
+      insn.flags = ((enum btrace_insn_flag)
+		    (byte >> BTRACE_PACKED_FLAGS_SHIFT));
+      insn.size = *ptr++;
+      insn.pc = next_pc;
+      if ((byte & BTRACE_PACKED_PC) != 0)
+	insn.pc += btrace_unpack_sleb128 (&ptr);
+
+      next_pc = insn.pc + insn.size;
+    }
+
+  gdb_assert (ptr == chunk.data () + chunk.size ());
+  return victim->insns;
+}
+
+/* See btrace.h.  */
+
+void
+btrace_insn_store::uncache (unsigned int number)
+{
+  for (cache_entry &entry : m_cache)
+    if (entry.number == number)
+      {
+	entry.number = UINT_MAX;
+	entry.insns.clear ();
+      }
+}
+
 /* Return the function name of a recorded function segment for printing.
    This function never returns NULL.  */
 
@@ -131,7 +341,7 @@ ftrace_debug (const struct btrace_function *bfun, const char *prefix)
   level = bfun->level;
 
   ibegin = bfun->insn_offset;
-  iend = ibegin + bfun->insn.size ();
+  iend = ibegin + bfun->ninsn;
 
   DEBUG_FTRACE ("%s: fun = %s, file = %s, level = %d, insn = [%u; %u)",
 		prefix, fun, file, level, ibegin, iend);
@@ -149,7 +359,7 @@ ftrace_call_num_insn (const struct btrace_function* bfun)
   if (bfun->errcode != 0)
     return 1;
 
-  return bfun->insn.size ();
+  return bfun->ninsn;
 }
 
 /* Return the function segment with the given NUMBER or NULL if no such segment
@@ -253,6 +463,7 @@ ftrace_new_function (struct btrace_thread_info *btinfo,
     }
 
   btinfo->functions.emplace_back (mfun, fun, number, insn_offset, level);
+  btinfo->functions.back ().insn_begin = btinfo->insns.size ();
   return &btinfo->functions.back ();
 }
 
@@ -394,7 +605,8 @@ ftrace_find_call (struct btrace_thread_info *btinfo,
       if (bfun->errcode != 0)
 	continue;
 
-      btrace_insn &last = bfun->insn.back ();
+      const btrace_insn &last
+	= btrace_function_insn (btinfo, bfun, bfun->ninsn - 1);
 
       if (last.iclass == BTRACE_INSN_CALL)
 	break;
@@ -526,7 +738,7 @@ ftrace_new_gap (struct btrace_thread_info *btinfo, int errcode,
     {
       /* We hijack the previous function segment if it was empty.  */
       bfun = &btinfo->functions.back ();
-      if (bfun->errcode != 0 || !bfun->insn.empty ())
+      if (bfun->errcode != 0 || bfun->ninsn != 0)
 	bfun = ftrace_new_function (btinfo, NULL, NULL);
     }
 
@@ -572,9 +784,9 @@ ftrace_update_function (struct btrace_thread_info *btinfo, CORE_ADDR pc)
   /* Check the last instruction, if we have one.
      We do this check first, since it allows us to fill in the call stack
      links in addition to the normal flow links.  */
-  btrace_insn *last = NULL;
-  if (!bfun->insn.empty ())
-    last = &bfun->insn.back ();
+  const btrace_insn *last = NULL;
+  if (bfun->ninsn != 0)
+    last = &btrace_function_insn (btinfo, bfun, bfun->ninsn - 1);
 
   if (last != NULL)
     {
@@ -642,12 +854,17 @@ ftrace_update_function (struct btrace_thread_info *btinfo, CORE_ADDR pc)
   return bfun;
 }
 
-/* Add the instruction at PC to BFUN's instructions.  */
+/* Add the instruction at PC to BFUN's instructions.  BFUN must be the last
+   function segment in BTINFO.  */
 
 static void
-ftrace_update_insns (struct btrace_function *bfun, const btrace_insn &insn)
+ftrace_update_insns (struct btrace_thread_info *btinfo,
+		     struct btrace_function *bfun, const btrace_insn &insn)
 {
-  bfun->insn.push_back (insn);
+  gdb_assert (bfun->insn_begin + bfun->ninsn == btinfo->insns.size ());
+
+  btinfo->insns.push_back (insn);
+  bfun->ninsn += 1;
 
   if (record_debug > 1)
     ftrace_debug (bfun, "update insn");
@@ -743,7 +960,7 @@ ftrace_compute_global_level_offset (struct btrace_thread_info *btinfo)
      really part of the trace.  If it contains just this one instruction, we
      ignore the segment.  */
   struct btrace_function *last = &btinfo->functions.back();
-  if (last->insn.size () != 1)
+  if (last->ninsn != 1)
     level = std::min (level, last->level);
 
   DEBUG_FTRACE ("setting global level offset: %d", -level);
@@ -1100,7 +1317,7 @@ btrace_compute_ftrace_bts (struct thread_info *tp,
 	  insn.iclass = ftrace_classify_insn (gdbarch, pc);
 	  insn.flags = 0;
 
-	  ftrace_update_insns (bfun, insn);
+	  ftrace_update_insns (btinfo, bfun, insn);
 
 	  /* We're done once we pushed the instruction at the end.  */
 	  if (block->end == pc)
@@ -1325,7 +1542,7 @@ ftrace_add_pt (struct btrace_thread_info *btinfo,
 	  /* Maintain the function level offset.  */
 	  *plevel = std::min (*plevel, bfun->level);
 
-	  ftrace_update_insns (bfun, pt_btrace_insn (insn));
+	  ftrace_update_insns (btinfo, bfun, pt_btrace_insn (insn));
 	}
 
       if (status == -pte_eos)
@@ -1686,7 +1903,7 @@ btrace_stitch_bts (struct btrace_data_bts *btrace, struct thread_info *tp)
   /* If the existing trace ends with a gap, we just glue the traces
      together.  We need to drop the last (i.e. chronologically first) block
      of the new trace,  though, since we can't fill in the start address.*/
-  if (last_bfun->insn.empty ())
+  if (last_bfun->ninsn == 0)
     {
       VEC_pop (btrace_block_s, btrace->blocks);
       return 0;
@@ -1696,7 +1913,7 @@ btrace_stitch_bts (struct btrace_data_bts *btrace, struct thread_info *tp)
      chronologically first block in the new trace is the last block in
      the new trace's block vector.  */
   first_new_block = VEC_last (btrace_block_s, btrace->blocks);
-  const btrace_insn &last_insn = last_bfun->insn.back ();
+  const btrace_insn &last_insn = btinfo->insns.back ();
 
   /* If the current PC at the end of the block is the same as in our current
      trace, there are two explanations:
@@ -1736,7 +1953,8 @@ btrace_stitch_bts (struct btrace_data_bts *btrace, struct thread_info *tp)
   DEBUG ("pruning insn at %s for stitching",
 	 ftrace_print_insn_addr (&last_insn));
 
-  last_bfun->insn.pop_back ();
+  btinfo->insns.pop_back ();
+  last_bfun->ninsn -= 1;
 
   /* The instructions vector may become empty temporarily if this has
      been the only instruction in this function segment.
@@ -1747,7 +1965,7 @@ btrace_stitch_bts (struct btrace_data_bts *btrace, struct thread_info *tp)
      of just that one instruction.  If we remove it, we might turn the now
      empty btrace function segment into a gap.  But we don't want gaps at
      the beginning.  To avoid this, we remove the entire old trace.  */
-  if (last_bfun->number == 1 && last_bfun->insn.empty ())
+  if (last_bfun->number == 1 && last_bfun->ninsn == 0)
     btrace_clear (tp);
 
   return 0;
@@ -1974,6 +2192,7 @@ btrace_clear (struct thread_info *tp)
   btinfo = &tp->btrace;
 
   btinfo->functions.clear ();
+  btinfo->insns.clear ();
   btinfo->ngaps = 0;
 
   /* Must clear the maint data before - it depends on BTINFO->DATA.  */
@@ -2313,6 +2532,17 @@ parse_xml_btrace_conf (struct btrace_config *conf, const char *xml)
 
 /* See btrace.h.  */
 
+const struct btrace_insn &
+btrace_function_insn (const struct btrace_thread_info *btinfo,
+		      const struct btrace_function *bfun, unsigned int index)
+{
+  gdb_assert (index < bfun->ninsn);
+
+  return btinfo->insns[bfun->insn_begin + index];
+}
+
+/* See btrace.h.  */
+
 const struct btrace_insn *
 btrace_insn_get (const struct btrace_insn_iterator *it)
 {
@@ -2327,11 +2557,11 @@ btrace_insn_get (const struct btrace_insn_iterator *it)
     return NULL;
 
   /* The index is within the bounds of this function's instruction vector.  */
-  end = bfun->insn.size ();
+  end = bfun->ninsn;
   gdb_assert (0 < end);
   gdb_assert (index < end);
 
-  return &bfun->insn[index];
+  return &btrace_function_insn (it->btinfo, bfun, index);
 }
 
 /* See btrace.h.  */
@@ -2377,7 +2607,7 @@ btrace_insn_end (struct btrace_insn_iterator *it,
     error (_("No trace."));
 
   bfun = &btinfo->functions.back ();
-  length = bfun->insn.size ();
+  length = bfun->ninsn;
 
   /* The last function may either be a gap or it contains the current
      instruction, which is one past the end of the execution trace; ignore
@@ -2406,7 +2636,7 @@ btrace_insn_next (struct btrace_insn_iterator *it, unsigned int stride)
     {
       unsigned int end, space, adv;
 
-      end = bfun->insn.size ();
+      end = bfun->ninsn;
 
       /* An empty function segment represents a gap in the trace.  We count
 	 it as one instruction.  */
@@ -2499,7 +2729,7 @@ btrace_insn_prev (struct btrace_insn_iterator *it, unsigned int stride)
 
 	  /* We point to one after the last instruction in the new function.  */
 	  bfun = prev;
-	  index = bfun->insn.size ();
+	  index = bfun->ninsn;
 
 	  /* An empty function segment represents a gap in the trace.  We count
 	     it as one instruction.  */
@@ -3466,6 +3696,10 @@ maint_info_btrace_cmd (const char *args, int from_tty)
       break;
 #endif /* defined (HAVE_LIBIPT)  */
     }
+
+  printf_unfiltered (_("Number of instructions: %u (%s bytes).\n"),
+		     btinfo->insns.size (),
+		     pulongest (btinfo->insns.memory_used ()));
 }
 
 /* The "maint show btrace pt skip-pad" show value function. */
@@ -29,6 +29,7 @@
 #include "btrace-common.h"
 #include "target/waitstatus.h" /* For enum target_stop_reason.  */
 #include "common/enum-flags.h"
+#include "common/byte-vector.h"
 
 #if defined (HAVE_LIBIPT)
 #  include <intel-pt.h>
@@ -81,6 +82,98 @@ struct btrace_insn
   btrace_insn_flags flags;
 };
 
+/* The number of instructions in a packed chunk of a btrace_insn_store.  */
+#define BTRACE_INSN_CHUNK_SIZE 4096
+
+/* The number of unpacked chunks a btrace_insn_store keeps around.  */
+#define BTRACE_INSN_CACHE_SIZE 4
+
+/* The instructions of a branch trace, in control-flow order.
+
+   Instructions are appended to an unpacked tail, which is packed into a
+   chunk whenever it holds BTRACE_INSN_CHUNK_SIZE instructions.  In a
+   packed chunk, an instruction takes two bytes if it directly follows
+   its predecessor in memory, plus the distance between their addresses
+   otherwise.  Packed chunks are unpacked on demand into a small cache,
+   so the memory used by a trace is mostly that of the packed chunks.
+
+   This only changes how instructions are stored.  btrace_compute_ftrace
+   still decodes the whole trace and pushes every instruction, since the
+   levels and links of the function segments depend on all of it.  */
+
+class btrace_insn_store
+{
+public:
+  /* Return the number of instructions.  */
+  unsigned int size () const
+  {
+    return m_chunks.size () * BTRACE_INSN_CHUNK_SIZE + m_tail.size ();
+  }
+
+  /* Return true if there are no instructions.  */
+  bool empty () const
+  {
+    return m_chunks.empty () && m_tail.empty ();
+  }
+
+  /* Return the instruction at INDEX.  The reference remains valid until
+     the store is modified or instructions from BTRACE_INSN_CACHE_SIZE
+     other chunks are accessed.  */
+  const btrace_insn &operator[] (unsigned int index) const;
+
+  /* Return the last instruction.  */
+  const btrace_insn &back () const
+  {
+    return (*this)[size () - 1];
+  }
+
+  /* Append INSN.  */
+  void push_back (const btrace_insn &insn);
+
+  /* Remove the last instruction.  */
+  void pop_back ();
+
+  /* Remove all instructions.  */
+  void clear ();
+
+  /* Return the number of bytes used for the instructions, not counting
+     the cache.  */
+  size_t memory_used () const;
+
+private:
+  /* Return chunk NUMBER, unpacking it into the cache if needed.  */
+  const std::vector<btrace_insn> &unpack (unsigned int number) const;
+
+  /* Drop chunk NUMBER from the cache.  */
+  void uncache (unsigned int number);
+
+  /* The packed chunks.  */
+  std::vector<gdb::byte_vector> m_chunks;
+
+  /* The instructions following the packed chunks.  */
+  std::vector<btrace_insn> m_tail;
+
+  /* An unpacked chunk.  */
+  struct cache_entry
+  {
+    /* The number of the chunk, or UINT_MAX if the entry is unused.  */
+    unsigned int number = UINT_MAX;
+
+    /* The value of M_CLOCK when the entry was last used.  */
+    unsigned int last_use = 0;
+
+    /* The instructions of the chunk.  */
+    std::vector<btrace_insn> insns;
+  };
+
+  /* The unpacked chunks.  */
+  mutable cache_entry m_cache[BTRACE_INSN_CACHE_SIZE];
+
+  /* A counter of accesses to packed chunks, to find the least recently
+     used cache entry.  */
+  mutable unsigned int m_clock = 0;
+};
+
 /* Flags for btrace function segments.  */
 enum btrace_function_flag
 {
@@ -154,18 +247,20 @@ struct btrace_function
      the record.  */
   unsigned int up = 0;
 
-  /* The instructions in this function segment.
-     The instruction vector will be empty if the function segment
-     represents a decode error.  */
-  std::vector<btrace_insn> insn;
+  /* The instructions in this function segment are the NINSN instructions
+     starting at index INSN_BEGIN in the thread's instruction store.
+     NINSN will be zero if the function segment represents a decode
+     error.  */
+  unsigned int insn_begin = 0;
+  unsigned int ninsn = 0;
 
   /* The error code of a decode error that led to a gap.
-     Must be zero unless INSN is empty; non-zero otherwise.  */
+     Must be zero unless NINSN is zero; non-zero otherwise.  */
   int errcode = 0;
 
   /* The instruction number offset for the first instruction in this
      function segment.
-     If INSN is empty this is the insn_offset of the succeding function
+     If NINSN is zero this is the insn_offset of the succeding function
      segment in control-flow order.  */
   unsigned int insn_offset;
 
@@ -333,6 +428,10 @@ struct btrace_thread_info
      function segment i will be at index (i - 1).  */
   std::vector<btrace_function> functions;
 
+  /* The decoded instructions of all function segments in execution flow
+     order.  Gaps have no instructions.  */
+  btrace_insn_store insns;
+
   /* The function level offset.  When added to each function's LEVEL,
      this normalizes the function levels such that the smallest level
      becomes zero.  */
@@ -400,9 +499,19 @@ extern void parse_xml_btrace (struct btrace_data *data, const char *xml);
 /* Parse a branch trace configuration xml document XML into CONF.  */
 extern void parse_xml_btrace_conf (struct btrace_config *conf, const char *xml);
 
+/* Return the instruction at INDEX in the function segment BFUN of
+   BTINFO.  The reference remains valid as long as described for
+   btrace_insn_store::operator[].  */
+extern const struct btrace_insn &
+  btrace_function_insn (const struct btrace_thread_info *btinfo,
+			const struct btrace_function *bfun,
+			unsigned int index);
+
 /* Dereference a branch trace instruction iterator.  Return a pointer to the
    instruction the iterator points to.
-   May return NULL if the iterator points to a gap in the trace.  */
+   May return NULL if the iterator points to a gap in the trace.  The
+   pointer remains valid as long as described for
+   btrace_insn_store::operator[].  */
 extern const struct btrace_insn *
   btrace_insn_get (const struct btrace_insn_iterator *);
 
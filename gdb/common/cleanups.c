@@ -59,8 +59,8 @@ static const struct cleanup sentinel_cleanup = { 0, 0, 0, 0 };
 #define SENTINEL_CLEANUP ((struct cleanup *) &sentinel_cleanup)
 
 /* Chain of cleanup actions established with make_cleanup,
-   to be executed if an error happens.  */
-static struct cleanup *cleanup_chain = SENTINEL_CLEANUP;
+   to be executed if an error happens.  Each thread has its own.  */
+static thread_local struct cleanup *cleanup_chain = SENTINEL_CLEANUP;
 
 /* Chain of cleanup actions established with make_final_cleanup,
    to be executed when gdb exits.  */
@@ -218,9 +218,10 @@ exceptions_state_mc_action_iter_1 (void)
 #if GDB_XCPT != GDB_XCPT_SJMP
 
 /* How many nested TRY blocks we have.  See exception_messages and
-   throw_it.  */
+   throw_it.  This is per thread, like the cleanup chain, so that
+   worker threads can throw and catch errors of their own.  */
 
-static int try_scope_depth;
+static thread_local int try_scope_depth;
 
 /* Called on entry to a TRY scope.  */
 
@@ -328,10 +329,10 @@ throw_exception (struct gdb_exception exception)
    This is indexed by the size of the current_catcher list.
    It is a dynamically allocated array so that we don't care how deeply
    GDB nests its TRY_CATCHs.  */
-static char **exception_messages;
+static thread_local char **exception_messages;
 
 /* The number of currently allocated entries in exception_messages.  */
-static int exception_messages_size;
+static thread_local int exception_messages_size;
 
 static void ATTRIBUTE_NORETURN ATTRIBUTE_PRINTF (3, 0)
 throw_it (enum return_reason reason, enum errors error, const char *fmt,
@@ -0,0 +1,162 @@
+/* Thread pool
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "common-defs.h"
+#include "thread-pool.h"
+
+#include <signal.h>
+
+namespace gdb
+{
+
+/* The global thread pool.  */
+
+thread_pool *thread_pool::g_thread_pool = new thread_pool ();
+
+thread_pool::~thread_pool ()
+{
+  /* Because this is a singleton, we don't need to clean up.  The
+     threads are detached so that they won't prevent process exit.  */
+}
+
+#if CXX_STD_THREAD
+
+/* See thread-pool.h.  */
+
+void
+thread_pool::set_thread_count (size_t num_threads)
+{
+  std::lock_guard<std::mutex> guard (m_tasks_mutex);
+
+  /* If the new size is smaller, terminate the threads that are no
+     longer wanted.  An empty task tells a worker thread to exit.
+     Growing the pool is left to post_task.  */
+  if (num_threads < m_started_threads)
+    {
+      for (size_t i = num_threads; i < m_started_threads; ++i)
+	m_tasks.emplace ();
+      m_tasks_cv.notify_all ();
+      m_started_threads = num_threads;
+    }
+
+  m_thread_count = num_threads;
+}
+
+/* See thread-pool.h.  */
+
+void
+thread_pool::start_threads ()
+{
+  if (m_started_threads < m_thread_count)
+    {
+#ifdef HAVE_SIGACTION
+      /* Worker threads must never handle signals -- SIGINT, SIGCHLD
+	 and friends are all handled by the main thread's event loop.
+	 New threads inherit the creating thread's signal mask, so
+	 block everything while creating them.  SIGSEGV is left
+	 alone, so that tasks can catch faults in the demangler; see
+	 gdb_demangle_parallel.  */
+      sigset_t all_signals, old_signals;
+
+      sigfillset (&all_signals);
+      sigdelset (&all_signals, SIGSEGV);
+      pthread_sigmask (SIG_BLOCK, &all_signals, &old_signals);
+#endif
+
+      for (; m_started_threads < m_thread_count; ++m_started_threads)
+	{
+	  std::thread thread (&thread_pool::thread_function, this);
+	  thread.detach ();
+	}
+
+#ifdef HAVE_SIGACTION
+      pthread_sigmask (SIG_SETMASK, &old_signals, NULL);
+#endif
+    }
+}
+
+/* See thread-pool.h.  */
+
+std::future<void>
+thread_pool::post_task (std::function<void ()> func)
+{
+  std::packaged_task<void ()> t (func);
+  std::future<void> f = t.get_future ();
+
+  if (m_thread_count == 0)
+    {
+      /* Just execute it now.  */
+      t ();
+    }
+  else
+    {
+      std::lock_guard<std::mutex> guard (m_tasks_mutex);
+      start_threads ();
+      m_tasks.emplace (std::move (t));
+      m_tasks_cv.notify_one ();
+    }
+  return f;
+}
+
+/* See thread-pool.h.  */
+
+void
+thread_pool::thread_function ()
+{
+  while (true)
+    {
+      std::packaged_task<void ()> t;
+
+      {
+	/* We want to hold the lock while examining the task list, but
+	   not while invoking the task function.  */
+	std::unique_lock<std::mutex> guard (m_tasks_mutex);
+	while (m_tasks.empty ())
+	  m_tasks_cv.wait (guard);
+	t = std::move (m_tasks.front ());
+	m_tasks.pop ();
+      }
+
+      if (!t.valid ())
+	return;
+      t ();
+    }
+}
+
+#else /* CXX_STD_THREAD */
+
+/* See thread-pool.h.  */
+
+void
+thread_pool::set_thread_count (size_t num_threads)
+{
+  /* Without std::thread every task runs on the main thread.  */
+}
+
+/* See thread-pool.h.  */
+
+void
+thread_pool::post_task (std::function<void ()> func)
+{
+  func ();
+}
+
+#endif /* CXX_STD_THREAD */
+
+}
@@ -0,0 +1,113 @@
+/* Thread pool
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef COMMON_THREAD_POOL_H
+#define COMMON_THREAD_POOL_H
+
+#include <queue>
+#include <functional>
+#if CXX_STD_THREAD
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#endif
+
+namespace gdb
+{
+
+/* A thread pool.
+
+   There is a single global thread pool, see g_thread_pool.  Tasks
+   posted to the pool are run on worker threads, in the order they
+   were posted.
+
+   Worker threads have their own cleanup chain and exception state,
+   so a task may use TRY/CATCH and cleanups, but no exception may
+   escape it.  Tasks must not print, and must record their complaints
+   with scoped_defer_complaints: the output streams and the complaint
+   counters belong to the main thread.  A task should only compute a
+   result that the main thread then installs.  */
+
+class thread_pool
+{
+public:
+
+  /* The sole global thread pool.  */
+  static thread_pool *g_thread_pool;
+
+  ~thread_pool ();
+
+  DISABLE_COPY_AND_ASSIGN (thread_pool);
+
+  /* Set the thread count of this thread pool.  By default, no threads
+     are created -- the thread count must be set first.  The threads
+     themselves are only started when the first task is posted, so
+     that a GDB that never needs them does not pay for them.  Setting
+     the count to zero stops all the worker threads.  */
+  void set_thread_count (size_t num_threads);
+
+  /* Return the number of threads tasks are spread over.  */
+  size_t thread_count () const
+  {
+    return m_thread_count;
+  }
+
+  /* Post a task to the thread pool and return a future that can be
+     used to wait for its completion.  If the pool has no threads,
+     the task is run immediately, on the calling thread.  */
+#if CXX_STD_THREAD
+  std::future<void> post_task (std::function<void ()> func);
+#else
+  void post_task (std::function<void ()> func);
+#endif
+
+private:
+
+  thread_pool () = default;
+
+#if CXX_STD_THREAD
+  /* The callback for each worker thread.  */
+  void thread_function ();
+
+  /* Start worker threads until there are m_thread_count of them.
+     Called with m_tasks_mutex held.  */
+  void start_threads ();
+
+  /* The tasks that have not been processed yet.  An empty task is
+     used to tell a worker thread to exit.  */
+  std::queue<std::packaged_task<void ()>> m_tasks;
+
+  /* A condition variable and mutex that are used for communication
+     between the main thread and the worker threads.  */
+  std::condition_variable m_tasks_cv;
+  std::mutex m_tasks_mutex;
+
+  /* The number of worker threads actually running.  This lags behind
+     m_thread_count until a task is posted.  */
+  size_t m_started_threads = 0;
+#endif
+
+  /* The current thread count.  */
+  size_t m_thread_count = 0;
+};
+
+}
+
+#endif /* COMMON_THREAD_POOL_H */
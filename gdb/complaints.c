@@ -150,49 +150,64 @@ find_complaint (struct complaints *complaints, const char *file,
 
 int stop_whining = 0;
 
-/* Print a complaint, and link the complaint block into a chain for
-   later handling.  */
+/* Where the current thread records its complaints, if it defers
+   them.  See scoped_defer_complaints.  */
 
-static void ATTRIBUTE_PRINTF (4, 0)
-vcomplaint (struct complaints **c, const char *file, 
-	    int line, const char *fmt,
-	    va_list args)
+static thread_local deferred_complaints *current_deferred_complaints;
+
+/* Call deprecated_warning_hook, which takes a va_list.  */
+
+static void ATTRIBUTE_PRINTF (1, 2)
+call_warning_hook (const char *fmt, ...)
+{
+  va_list args;
+
+  va_start (args, fmt);
+  (*deprecated_warning_hook) (fmt, args);
+  va_end (args);
+}
+
+/* Count a complaint, linking its complaint block into a chain for
+   later handling.  Return the block if the complaint should be
+   printed, NULL otherwise.  */
+
+static struct complain *
+count_complaint (struct complaints *complaints, const char *file,
+		 int line, const char *fmt)
 {
-  struct complaints *complaints = get_complaints (c);
   struct complain *complaint = find_complaint (complaints, file, 
 					       line, fmt);
-  enum complaint_series series;
-
-  gdb_assert (complaints != NULL);
 
   complaint->counter++;
   if (complaint->counter > stop_whining)
-    return;
+    return NULL;
+  return complaint;
+}
+
+/* Print COMPLAINT, whose formatted text is MSG.  */
+
+static void
+print_complaint (struct complaints *complaints, struct complain *complaint,
+		 const std::string &msg)
+{
+  enum complaint_series series;
 
   if (info_verbose)
     series = SUBSEQUENT_MESSAGE;
   else
     series = complaints->series;
 
-  /* Pass 'fmt' instead of 'complaint->fmt' to printf-like callees
-     from here on, to avoid "format string is not a string literal"
-     warnings.  'fmt' is this function's printf-format parameter, so
-     the compiler can assume the passed in argument is a literal
-     string somewhere up the call chain.  */
-  gdb_assert (complaint->fmt == fmt);
-
   if (complaint->file != NULL)
-    internal_vwarning (complaint->file, complaint->line, fmt, args);
+    internal_warning (complaint->file, complaint->line, "%s", msg.c_str ());
   else if (deprecated_warning_hook)
-    (*deprecated_warning_hook) (fmt, args);
+    call_warning_hook ("%s", msg.c_str ());
   else
     {
       if (complaints->explanation == NULL)
 	/* A [v]warning() call always appends a newline.  */
-	vwarning (fmt, args);
+	warning ("%s", msg.c_str ());
       else
 	{
-	  std::string msg = string_vprintf (fmt, args);
 	  wrap_here ("");
 	  if (series != SUBSEQUENT_MESSAGE)
 	    begin_line ();
@@ -235,6 +250,28 @@ vcomplaint (struct complaints **c, const char *file,
   gdb_flush (gdb_stderr);
 }
 
+/* Print a complaint, and link the complaint block into a chain for
+   later handling.  */
+
+static void ATTRIBUTE_PRINTF (4, 0)
+vcomplaint (struct complaints **c, const char *file, 
+	    int line, const char *fmt,
+	    va_list args)
+{
+  if (current_deferred_complaints != NULL)
+    {
+      current_deferred_complaints->add (c, file, line, fmt,
+					string_vprintf (fmt, args));
+      return;
+    }
+
+  struct complaints *complaints = get_complaints (c);
+  struct complain *complaint = count_complaint (complaints, file, line, fmt);
+
+  if (complaint != NULL)
+    print_complaint (complaints, complaint, string_vprintf (fmt, args));
+}
+
 void
 complaint_internal (struct complaints **complaints, const char *fmt, ...)
 {
@@ -255,6 +292,40 @@ internal_complaint (struct complaints **complaints, const char *file,
   va_end (args);
 }
 
+/* See complaints.h.  */
+
+void
+deferred_complaints::issue ()
+{
+  std::vector<entry> entries = std::move (m_entries);
+
+  m_entries.clear ();
+  for (const entry &e : entries)
+    {
+      struct complaints *complaints = get_complaints (e.complaints);
+      struct complain *complaint = count_complaint (complaints, e.file,
+						    e.line, e.fmt);
+
+      if (complaint != NULL)
+	print_complaint (complaints, complaint, e.message);
+    }
+}
+
+/* See complaints.h.  */
+
+scoped_defer_complaints::scoped_defer_complaints (deferred_complaints *into)
+  : m_saved (current_deferred_complaints)
+{
+  current_deferred_complaints = into;
+}
+
+/* See complaints.h.  */
+
+scoped_defer_complaints::~scoped_defer_complaints ()
+{
+  current_deferred_complaints = m_saved;
+}
+
 /* Clear out / initialize all complaint counters that have ever been
    incremented.  If LESS_VERBOSE is 1, be less verbose about
    successive complaints, since the messages are appearing all
@@ -63,5 +63,54 @@ extern void internal_complaint (struct complaints **complaints,
 extern void clear_complaints (struct complaints **complaints,
 			      int less_verbose, int noisy);
 
+/* Complaints recorded, rather than issued, while a
+   scoped_defer_complaints was in effect.  */
+
+class deferred_complaints
+{
+public:
+  /* Issue the recorded complaints, in the order they were made, and
+     forget them.  */
+  void issue ();
+
+  /* Record a complaint.  The arguments are those of vcomplaint, with
+     MESSAGE being FMT already formatted.  */
+  void add (struct complaints **complaints, const char *file, int line,
+	    const char *fmt, std::string &&message)
+  {
+    m_entries.push_back ({complaints, file, line, fmt, std::move (message)});
+  }
+
+private:
+  struct entry
+  {
+    struct complaints **complaints;
+    const char *file;
+    int line;
+    const char *fmt;
+    std::string message;
+  };
+
+  std::vector<entry> m_entries;
+};
+
+/* While an object of this type is alive, complaints made by the
+   thread that created it are recorded in a deferred_complaints
+   instead of being issued.  This lets a worker thread complain
+   without touching the complaint counters and the output streams,
+   which belong to the main thread.  */
+
+class scoped_defer_complaints
+{
+public:
+  explicit scoped_defer_complaints (deferred_complaints *into);
+  ~scoped_defer_complaints ();
+
+private:
+  deferred_complaints *m_saved;
+
+  DISABLE_COPY_AND_ASSIGN (scoped_defer_complaints);
+};
+
 
 #endif /* !defined (COMPLAINTS_H) */
@@ -38,14 +38,16 @@
 
 /* Bison does not make it easy to create a parser without global
    state, unfortunately.  Here are all the global variables used
-   in this parser.  */
+   in this parser.  They are thread-local, and the parser is pure, so
+   that several threads can parse names at once.  */
 
 /* LEXPTR is the current pointer into our lex buffer.  PREV_LEXPTR
    is the start of the last token lexed, only used for diagnostics.
    ERROR_LEXPTR is the first place an error occurred.  GLOBAL_ERRMSG
    is the first error message encountered.  */
 
-static const char *lexptr, *prev_lexptr, *error_lexptr, *global_errmsg;
+static thread_local const char *lexptr, *prev_lexptr, *error_lexptr;
+static thread_local const char *global_errmsg;
 
 /* The components built by the parser are allocated ahead of time,
    and cached in this structure.  */
@@ -58,7 +60,7 @@ struct demangle_info {
   struct demangle_component comps[ALLOC_CHUNK];
 };
 
-static struct demangle_info *demangle_info;
+static thread_local struct demangle_info *demangle_info;
 
 static struct demangle_component *
 d_grab (void)
@@ -85,7 +87,7 @@ d_grab (void)
 /* The parse tree created by the parser is stored here after a successful
    parse.  */
 
-static struct demangle_component *global_result;
+static thread_local struct demangle_component *global_result;
 
 /* Prototypes for helper functions used when constructing the parse
    tree.  */
@@ -172,7 +174,6 @@ static struct demangle_component *d_binary (const char *,
 #define yyvsp	cpname_yyvsp
 
 int yyparse (void);
-static int yylex (void);
 static void yyerror (const char *);
 
 /* Enable yydebug for the stand-alone parser.  */
@@ -249,6 +250,8 @@ make_name (const char *name, int len)
 
 %}
 
+%define api.pure
+
 %union
   {
     struct demangle_component *comp;
@@ -269,6 +272,11 @@ make_name (const char *name, int len)
     const char *opname;
   }
 
+%{
+/* YYSTYPE gets defined by %union.  */
+static int yylex (YYSTYPE *);
+%}
+
 %type <comp> exp exp1 type start start_opt oper colon_name
 %type <comp> unqualified_name colon_ext_name
 %type <comp> templ template_arg
@@ -1341,10 +1349,10 @@ symbol_end (const char *lexptr)
 
 /* Take care of parsing a number (anything that starts with a digit).
    The number starts at P and contains LEN characters.  Store the result in
-   YYLVAL.  */
+   LVALP.  */
 
 static int
-parse_number (const char *p, int len, int parsed_float)
+parse_number (const char *p, int len, int parsed_float, YYSTYPE *lvalp)
 {
   int unsigned_p = 0;
 
@@ -1394,7 +1402,7 @@ parse_number (const char *p, int len, int parsed_float)
 	return ERROR;
 
       name = make_name (p, len);
-      yylval.comp = fill_comp (literal_type, type, name);
+      lvalp->comp = fill_comp (literal_type, type, name);
 
       return FLOAT;
     }
@@ -1443,7 +1451,7 @@ parse_number (const char *p, int len, int parsed_float)
      type = signed_type;
 
    name = make_name (p, len);
-   yylval.comp = fill_comp (literal_type, type, name);
+   lvalp->comp = fill_comp (literal_type, type, name);
 
    return INT;
 }
@@ -1548,7 +1556,7 @@ cp_parse_escape (const char **string_ptr)
   if (strncmp (tokstart, string, sizeof (string) - 1) == 0)	\
     {								\
       lexptr = tokstart + sizeof (string) - 1;			\
-      yylval.lval = comp;					\
+      lvalp->lval = comp;					\
       return DEMANGLER_SPECIAL;					\
     }
 
@@ -1556,7 +1564,7 @@ cp_parse_escape (const char **string_ptr)
   if (lexptr[1] == string[1])				\
     {							\
       lexptr += 2;					\
-      yylval.opname = string;				\
+      lvalp->opname = string;				\
       return token;					\
     }      
 
@@ -1564,14 +1572,15 @@ cp_parse_escape (const char **string_ptr)
   if (lexptr[1] == string[1] && lexptr[2] == string[2])	\
     {							\
       lexptr += 3;					\
-      yylval.opname = string;				\
+      lvalp->opname = string;				\
       return token;					\
     }      
 
-/* Read one token, getting characters through LEXPTR.  */
+/* Read one token, getting characters through LEXPTR, and store its
+   value in LVALP.  */
 
 static int
-yylex (void)
+yylex (YYSTYPE *lvalp)
 {
   int c;
   int namelen;
@@ -1617,7 +1626,7 @@ yylex (void)
 	 presumably the same one that appears in manglings - the decimal
 	 representation.  But if that isn't in our input then we have to
 	 allocate memory for it somewhere.  */
-      yylval.comp = fill_comp (DEMANGLE_COMPONENT_LITERAL,
+      lvalp->comp = fill_comp (DEMANGLE_COMPONENT_LITERAL,
 				 make_builtin_type ("char"),
 				 make_name (tokstart, lexptr - tokstart));
 
@@ -1627,7 +1636,7 @@ yylex (void)
       if (strncmp (tokstart, "(anonymous namespace)", 21) == 0)
 	{
 	  lexptr += 21;
-	  yylval.comp = make_name ("(anonymous namespace)",
+	  lvalp->comp = make_name ("(anonymous namespace)",
 				     sizeof "(anonymous namespace)" - 1);
 	  return NAME;
 	}
@@ -1726,7 +1735,7 @@ yylex (void)
 	    else if (! ISALNUM (*p))
 	      break;
 	  }
-	toktype = parse_number (tokstart, p - tokstart, got_dot|got_e);
+	toktype = parse_number (tokstart, p - tokstart, got_dot|got_e, lvalp);
         if (toktype == ERROR)
 	  {
 	    char *err_copy = (char *) alloca (p - tokstart + 1);
@@ -1879,10 +1888,10 @@ yylex (void)
 	{
 	  const char *p;
 	  lexptr = tokstart + 29;
-	  yylval.lval = DEMANGLE_COMPONENT_GLOBAL_CONSTRUCTORS;
+	  lvalp->lval = DEMANGLE_COMPONENT_GLOBAL_CONSTRUCTORS;
 	  /* Find the end of the symbol.  */
 	  p = symbol_end (lexptr);
-	  yylval.comp = make_name (lexptr, p - lexptr);
+	  lvalp->comp = make_name (lexptr, p - lexptr);
 	  lexptr = p;
 	  return DEMANGLER_SPECIAL;
 	}
@@ -1890,10 +1899,10 @@ yylex (void)
 	{
 	  const char *p;
 	  lexptr = tokstart + 28;
-	  yylval.lval = DEMANGLE_COMPONENT_GLOBAL_DESTRUCTORS;
+	  lvalp->lval = DEMANGLE_COMPONENT_GLOBAL_DESTRUCTORS;
 	  /* Find the end of the symbol.  */
 	  p = symbol_end (lexptr);
-	  yylval.comp = make_name (lexptr, p - lexptr);
+	  lvalp->comp = make_name (lexptr, p - lexptr);
 	  lexptr = p;
 	  return DEMANGLER_SPECIAL;
 	}
@@ -1951,7 +1960,7 @@ yylex (void)
       break;
     }
 
-  yylval.comp = make_name (tokstart, namelen);
+  lvalp->comp = make_name (tokstart, namelen);
   return NAME;
 }
 
@@ -2059,7 +2068,7 @@ cp_merge_demangle_parse_infos (struct demangle_parse_info *dest,
 struct std::unique_ptr<demangle_parse_info>
 cp_demangled_name_to_comp (const char *demangled_name, const char **errmsg)
 {
-  static char errbuf[60];
+  static thread_local char errbuf[60];
 
   prev_lexptr = lexptr = demangled_name;
   error_lexptr = NULL;
@@ -37,6 +37,7 @@
 #include "gdb_setjmp.h"
 #include "safe-ctype.h"
 #include "selftest.h"
+#include "common/parallel-for.h"
 
 #define d_left(dc) (dc)->u.s_binary.left
 #define d_right(dc) (dc)->u.s_binary.right
@@ -1486,9 +1487,20 @@ cp_lookup_rtti_type (const char *name, struct block *block)
 
 static int catch_demangler_crashes = 1;
 
-/* Stack context and environment for demangler crash recovery.  */
+/* Stack context and environment for demangler crash recovery.  Each
+   thread that demangles has its own.  */
 
-static SIGJMP_BUF gdb_demangle_jmp_buf;
+static thread_local SIGJMP_BUF gdb_demangle_jmp_buf;
+
+/* Nonzero while the current thread is inside the demangler and
+   GDB_DEMANGLE_JMP_BUF is valid.  */
+
+static thread_local int gdb_demangle_jmp_buf_valid;
+
+/* Nonzero if the current thread is demangling on behalf of
+   gdb_demangle_parallel.  */
+
+static thread_local int gdb_demangle_in_worker;
 
 /* If nonzero, attempt to dump core from the signal handler.  */
 
@@ -1499,7 +1511,20 @@ static int gdb_demangle_attempt_core_dump = 1;
 static void
 gdb_demangle_signal_handler (int signo)
 {
-  if (gdb_demangle_attempt_core_dump)
+  /* While gdb_demangle_parallel is running, the handler is installed
+     for the whole process.  If the fault did not happen inside the
+     demangler, restore the default action and return; the faulting
+     instruction is then re-executed and GDB crashes as it normally
+     would.  */
+  if (!gdb_demangle_jmp_buf_valid)
+    {
+      signal (signo, SIG_DFL);
+      return;
+    }
+
+  /* Leave dumping core to the main thread, which demangles the
+     offending name again and reports the crash.  */
+  if (gdb_demangle_attempt_core_dump && !gdb_demangle_in_worker)
     {
       if (fork () == 0)
 	dump_core ();
@@ -1552,6 +1577,7 @@ gdb_demangle (const char *name, int options)
 #endif
 
       crash_signal = SIGSETJMP (gdb_demangle_jmp_buf);
+      gdb_demangle_jmp_buf_valid = crash_signal == 0;
     }
 #endif
 
@@ -1561,6 +1587,8 @@ gdb_demangle (const char *name, int options)
 #ifdef HAVE_WORKING_FORK
   if (catch_demangler_crashes)
     {
+      gdb_demangle_jmp_buf_valid = 0;
+
 #if defined (HAVE_SIGACTION) && defined (SA_RESTART)
       sigaction (SIGSEGV, &old_sa, NULL);
 #else
@@ -1606,6 +1634,116 @@ gdb_demangle (const char *name, int options)
   return result;
 }
 
+#ifdef HAVE_WORKING_FORK
+
+/* Demangle NAME with OPTIONS on a worker thread of
+   gdb_demangle_parallel.  If the demangler crashes, set *CRASHED and
+   return NULL.  */
+
+static char *
+gdb_demangle_no_report (const char *name, int options, char *crashed)
+{
+  int crash_signal = SIGSETJMP (gdb_demangle_jmp_buf);
+
+  if (crash_signal != 0)
+    {
+      gdb_demangle_jmp_buf_valid = 0;
+      *crashed = 1;
+      return NULL;
+    }
+
+  gdb_demangle_jmp_buf_valid = 1;
+  char *result = bfd_demangle (NULL, name, options);
+  gdb_demangle_jmp_buf_valid = 0;
+
+  return result;
+}
+
+#endif
+
+/* See cp-support.h.  */
+
+std::vector<gdb::unique_xmalloc_ptr<char>>
+gdb_demangle_parallel (const std::vector<const char *> &names, int options)
+{
+  std::vector<gdb::unique_xmalloc_ptr<char>> result (names.size ());
+  /* Not std::vector<bool>, whose elements can't be written
+     concurrently.  */
+  std::vector<char> crashed (names.size ());
+
+#ifdef HAVE_WORKING_FORK
+  /* Install the crash handler once for the whole batch; installing
+     and restoring it per name, as gdb_demangle does, would race
+     between threads.  */
+  int catch_crashes = catch_demangler_crashes;
+#if defined (HAVE_SIGACTION) && defined (SA_RESTART)
+  struct sigaction sa, old_sa;
+#else
+  sighandler_t ofunc;
+#endif
+
+  if (catch_crashes)
+    {
+#if defined (HAVE_SIGACTION) && defined (SA_RESTART)
+      sa.sa_handler = gdb_demangle_signal_handler;
+      sigemptyset (&sa.sa_mask);
+#ifdef HAVE_SIGALTSTACK
+      sa.sa_flags = SA_ONSTACK;
+#else
+      sa.sa_flags = 0;
+#endif
+      sigaction (SIGSEGV, &sa, &old_sa);
+#else
+      ofunc = signal (SIGSEGV, gdb_demangle_signal_handler);
+#endif
+    }
+#endif
+
+  gdb::parallel_for_each
+    (names.begin (), names.end (),
+     [&] (std::vector<const char *>::const_iterator iter,
+	  std::vector<const char *>::const_iterator last)
+     {
+#ifdef HAVE_WORKING_FORK
+       gdb_demangle_in_worker = 1;
+#endif
+       for (; iter != last; ++iter)
+	 {
+	   size_t i = iter - names.begin ();
+
+#ifdef HAVE_WORKING_FORK
+	   if (catch_crashes)
+	     result[i].reset (gdb_demangle_no_report (*iter, options,
+						      &crashed[i]));
+	   else
+#endif
+	     result[i].reset (bfd_demangle (NULL, *iter, options));
+	 }
+#ifdef HAVE_WORKING_FORK
+       gdb_demangle_in_worker = 0;
+#endif
+     });
+
+#ifdef HAVE_WORKING_FORK
+  if (catch_crashes)
+    {
+#if defined (HAVE_SIGACTION) && defined (SA_RESTART)
+      sigaction (SIGSEGV, &old_sa, NULL);
+#else
+      signal (SIGSEGV, ofunc);
+#endif
+    }
+#endif
+
+  /* Demangle the names that crashed the demangler once more, on this
+     thread, so that the crash is reported as usual.  */
+  for (size_t i = 0; i < names.size (); ++i)
+    if (crashed[i])
+      result[i].reset (gdb_demangle (names[i], options));
+
+  return result;
+}
+
 /* See cp-support.h.  */
 
 int
@@ -186,6 +186,15 @@ extern struct cmd_list_element *maint_cplus_cmd_list;
 
 char *gdb_demangle (const char *name, int options);
 
+/* Demangle each of NAMES with OPTIONS, using the worker threads if
+   any are available.  Returns a vector parallel to NAMES whose
+   elements are NULL for the names that could not be demangled.
+   Crashes in the demangler are caught and reported as with
+   gdb_demangle.  Must be called from the main thread.  */
+
+extern std::vector<gdb::unique_xmalloc_ptr<char>> gdb_demangle_parallel
+  (const std::vector<const char *> &names, int options);
+
 /* Like gdb_demangle, but suitable for use as la_sniff_from_mangled_name.  */
 
 int gdb_sniff_from_mangled_name (const char *mangled, char **demangled);
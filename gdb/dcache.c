@@ -24,6 +24,8 @@
 #include "target-dcache.h"
 #include "inferior.h"
 #include "splay-tree.h"
+#include "common/byte-vector.h"
+#include <algorithm>
 
 /* Commands with a prefix of `{set,show} dcache'.  */
 static struct cmd_list_element *dcache_set_list = NULL;
@@ -54,12 +56,21 @@ static struct cmd_list_element *dcache_show_list = NULL;
    as data is written to the cache, it is also immediately written to
    the target.  Therefore, cache lines are never "dirty".  Whether a given
    line is valid or not depends on where it is stored in the dcache_struct;
-   there is no per-block valid flag.  */
+   there is no per-block valid flag.
+
+   Over a high-latency link the cost of a miss is dominated by the round
+   trip, not by the amount of data transferred.  So each miss reads, in a
+   single target request, all the adjacent lines the access needs that
+   are not cached yet.  The cache also watches the addresses of
+   consecutive misses; once they follow a sequential or small-stride
+   pattern, it reads that many more lines ahead along the pattern,
+   doubling the distance with each correct prediction up to
+   "set dcache prefetch" lines.  */
 
 /* NOTE: Interaction of dcache and memory region attributes
 
    As there is no requirement that memory region attributes be aligned
-   to or be a multiple of the dcache page size, dcache_read_line() and
+   to or be a multiple of the dcache page size, dcache_read_range() and
    dcache_write_line() must break up the page by memory region.  If a
    chunk does not have the cache attribute set, an invalid memory type
    is set, etc., then the chunk is skipped.  Those chunks are handled
@@ -82,6 +93,19 @@ static unsigned dcache_size = DCACHE_DEFAULT_SIZE;
 #define DCACHE_DEFAULT_LINE_SIZE 64
 static unsigned dcache_line_size = DCACHE_DEFAULT_LINE_SIZE;
 
+/* The maximum number of lines read ahead of a miss when the accesses
+   follow a pattern.  Zero disables prefetching.  */
+#define DCACHE_DEFAULT_PREFETCH 16
+static unsigned dcache_prefetch = DCACHE_DEFAULT_PREFETCH;
+
+/* The largest distance between misses, in lines, still considered a
+   stride worth prefetching along.  */
+#define DCACHE_MAX_STRIDE 4
+
+/* The number of correct predictions after which the prefetch distance
+   stops growing.  */
+#define DCACHE_MAX_CONFIDENCE 16
+
 /* Each cache block holds LINE_SIZE bytes of data
    starting at a multiple-of-LINE_SIZE address.  */
 
@@ -97,6 +121,7 @@ struct dcache_block
 
   CORE_ADDR addr;		/* address of data */
   int refs;			/* # hits */
+  int prefetched;		/* read ahead, and not accessed yet */
   gdb_byte data[1];		/* line_size bytes at given address */
 };
 
@@ -115,14 +140,31 @@ struct dcache_struct
 
   /* The ptid of last inferior to use cache or null_ptid.  */
   ptid_t ptid;
+
+  /* The access pattern.  LAST_MISS is the address of the line of the
+     last miss, if HAVE_MISS, STRIDE the distance in lines between the
+     last misses (zero if unknown), EXPECT the line predicted to miss
+     next, and CONFIDENCE the number of consecutive misses on
+     EXPECT.  */
+  int have_miss;
+  CORE_ADDR last_miss;
+  LONGEST stride;
+  CORE_ADDR expect;
+  int confidence;
+
+  /* Statistics for "info dcache".  These are kept across
+     invalidations.  */
+  ULONGEST hits;
+  ULONGEST misses;
+  ULONGEST target_reads;
+  ULONGEST prefetched;
+  ULONGEST prefetch_hits;
 };
 
 typedef void (block_func) (struct dcache_block *block, void *param);
 
 static struct dcache_block *dcache_hit (DCACHE *dcache, CORE_ADDR addr);
 
-static int dcache_read_line (DCACHE *dcache, struct dcache_block *db);
-
 static struct dcache_block *dcache_alloc (DCACHE *dcache, CORE_ADDR addr);
 
 static int dcache_enabled_p = 0; /* OBSOLETE */
@@ -248,6 +290,8 @@ dcache_invalidate (DCACHE *dcache)
   dcache->oldest = NULL;
   dcache->size = 0;
   dcache->ptid = null_ptid;
+  dcache->have_miss = 0;
+  dcache->confidence = 0;
 
   if (dcache->line_size != dcache_line_size)
     {
@@ -295,24 +339,17 @@ dcache_hit (DCACHE *dcache, CORE_ADDR addr)
   return db;
 }
 
-/* Fill a cache line from target memory.
-   The result is 1 for success, 0 if the (entire) cache line
+/* Read LEN bytes of target memory at MEMADDR into MYADDR, to fill
+   cache lines.  The result is 1 for success, 0 if the (entire) range
    wasn't readable.  */
 
 static int
-dcache_read_line (DCACHE *dcache, struct dcache_block *db)
+dcache_read_range (CORE_ADDR memaddr, gdb_byte *myaddr, ULONGEST len)
 {
-  CORE_ADDR memaddr;
-  gdb_byte *myaddr;
-  int len;
+  ULONGEST reg_len;
   int res;
-  int reg_len;
   struct mem_region *region;
 
-  len = dcache->line_size;
-  memaddr = db->addr;
-  myaddr  = db->data;
-
   while (len > 0)
     {
       /* Don't overrun if this block is right at the end of the region.  */
@@ -375,6 +412,7 @@ dcache_alloc (DCACHE *dcache, CORE_ADDR addr)
 
   db->addr = MASK (dcache, addr);
   db->refs = 0;
+  db->prefetched = 0;
 
   /* Put DB at the end of the list, it's the newest.  */
   append_block (&dcache->oldest, db);
@@ -385,28 +423,246 @@ dcache_alloc (DCACHE *dcache, CORE_ADDR addr)
   return db;
 }
 
-/* Using the data cache DCACHE, store in *PTR the contents of the byte at
-   address ADDR in the remote machine.  
+/* Return true if the line at address LINE is in DCACHE.  Unlike
+   dcache_hit, this does not count as a reference to the line.  */
+
+static int
+dcache_line_cached_p (DCACHE *dcache, CORE_ADDR line)
+{
+  return splay_tree_lookup (dcache->tree, (splay_tree_key) line) != NULL;
+}
+
+/* Record a miss on the line at address LINE in the access pattern of
+   DCACHE.  */
 
-   Returns 1 for success, 0 for error.  */
+static void
+dcache_note_miss (DCACHE *dcache, CORE_ADDR line)
+{
+  if (dcache->have_miss && line == dcache->expect)
+    {
+      /* A stride of zero means the miss was expected right after the
+	 lines last read, i.e. a sequential access.  */
+      if (dcache->stride == 0)
+	dcache->stride = 1;
+      if (dcache->confidence < DCACHE_MAX_CONFIDENCE)
+	dcache->confidence++;
+    }
+  else
+    {
+      LONGEST delta = 0;
+
+      if (dcache->have_miss)
+	delta = ((LONGEST) (line - dcache->last_miss)
+		 / (LONGEST) dcache->line_size);
+      if (delta < -DCACHE_MAX_STRIDE || delta > DCACHE_MAX_STRIDE)
+	delta = 0;
+
+      dcache->stride = delta;
+      dcache->confidence = 0;
+    }
+
+  dcache->have_miss = 1;
+  dcache->last_miss = line;
+}
+
+/* Subroutine of dcache_fill.  When the access pattern of DCACHE has
+   a stride of more than one line, read into BUF only the lines of the
+   span dcache_fill chose that are needed: the WANTED lines of the
+   access following LINE, and the lines on the stride, in a single
+   multi-region read.  The span goes from BEFORE lines before LINE to
+   AFTER lines after it.  Clear the elements of READ_P for the lines
+   that were not read.  Return 1 on success, or 0 if the span should
+   be read in one piece instead, e.g. because the target can't read
+   several regions at once.  */
 
 static int
-dcache_peek_byte (DCACHE *dcache, CORE_ADDR addr, gdb_byte *ptr)
+dcache_read_strided (DCACHE *dcache, CORE_ADDR line, ULONGEST before,
+		     ULONGEST after, ULONGEST wanted, gdb_byte *buf,
+		     std::vector<bool> &read_p)
 {
-  struct dcache_block *db = dcache_hit (dcache, addr);
+  CORE_ADDR line_size = dcache->line_size;
+  ULONGEST stride = dcache->stride > 0 ? dcache->stride : -dcache->stride;
+  ULONGEST n_needed = std::min (wanted, after) + 1;
+  std::vector<memory_read_request> requests;
+  std::vector<ULONGEST> indexes;
+  ULONGEST i;
+  int handled;
 
-  if (!db)
+  if (stride < 2 || before + after + 1 == n_needed
+      || lookup_mem_region (line)->attrib.mode == MEM_WO)
+    return 0;
+
+  /* The lines of the access come first.  */
+  requests.push_back ({ line, n_needed * line_size,
+			buf + before * line_size, 0 });
+  indexes.push_back (before);
+  for (i = 0; i < read_p.size (); i++)
     {
-      db = dcache_alloc (dcache, addr);
+      ULONGEST distance = i < before ? before - i : i - before;
 
-      if (!dcache_read_line (dcache, db))
-         return 0;
+      if (i >= before && i < before + n_needed)
+	continue;
+      if (distance % stride == 0)
+	{
+	  requests.push_back ({ line + (i - before) * line_size, line_size,
+				buf + i * line_size, 0 });
+	  indexes.push_back (i);
+	}
     }
 
-  *ptr = db->data[XFORM (dcache, addr)];
+  handled = target_read_raw_memory_multiple (requests.data (),
+					     requests.size ());
+  if (handled == 0)
+    return 0;
+  dcache->target_reads++;
+  if (requests[0].xfered != requests[0].len)
+    return 0;
+
+  std::fill (read_p.begin (), read_p.end (), false);
+  for (i = before; i < before + n_needed; i++)
+    read_p[i] = true;
+  for (i = 1; i < handled; i++)
+    if (requests[i].xfered == line_size)
+      read_p[indexes[i]] = true;
+
   return 1;
 }
 
+/* Fill the cache line containing ADDR, which must not be cached yet,
+   from target memory, and return its block, or NULL if the line
+   wasn't readable.  END is the end of the access ADDR is part of.
+
+   The lines of the access following ADDR's that are not cached, and
+   the lines the access pattern predicts will be needed next, are read
+   along with ADDR's line in a single target request.  *FILL_END is set
+   to the end of the lines of the access that were read.  */
+
+static struct dcache_block *
+dcache_fill (DCACHE *dcache, CORE_ADDR addr, CORE_ADDR end,
+	     CORE_ADDR *fill_end)
+{
+  CORE_ADDR line_size = dcache->line_size;
+  CORE_ADDR line = MASK (dcache, addr);
+  struct mem_region *region = lookup_mem_region (line);
+  ULONGEST max_lines = dcache_size;
+  ULONGEST wanted, before = 0, after, n_lines, i;
+  struct dcache_block *result = NULL;
+
+  dcache_note_miss (dcache, line);
+
+  /* The number of lines after LINE the access itself needs.  */
+  wanted = (MASK (dcache, end - 1) - line) / line_size;
+  after = wanted;
+
+  if (dcache->confidence > 0 && dcache->stride != 0 && dcache_prefetch > 0)
+    {
+      ULONGEST budget = std::min<ULONGEST> (dcache_prefetch,
+					    (ULONGEST) 1 << dcache->confidence);
+      ULONGEST stride = (dcache->stride > 0
+			 ? dcache->stride : -dcache->stride);
+      ULONGEST distance = budget / stride * stride;
+
+      if (dcache->stride > 0)
+	after = std::max (after, distance);
+      else
+	before = distance;
+    }
+
+  /* Only read lines that are not cached yet, and that are in the same
+     memory region as LINE.  Stop at the end of the address space, and
+     when the cache would not be able to hold all the lines.  */
+  for (i = 1; i <= after && i < max_lines; i++)
+    {
+      CORE_ADDR next = line + i * line_size;
+
+      if (next < line
+	  || (region->hi != 0 && next >= region->hi)
+	  || dcache_line_cached_p (dcache, next))
+	break;
+    }
+  after = i - 1;
+  for (i = 1; i <= before && after + i < max_lines; i++)
+    {
+      CORE_ADDR prev = line - i * line_size;
+
+      if (prev > line
+	  || prev < region->lo
+	  || dcache_line_cached_p (dcache, prev))
+	break;
+    }
+  before = i - 1;
+
+  n_lines = before + 1 + after;
+  gdb::byte_vector buf (n_lines * line_size);
+  std::vector<bool> read_p (n_lines, true);
+
+  if (!dcache_read_strided (dcache, line, before, after, wanted,
+			    buf.data (), read_p))
+    {
+      dcache->target_reads++;
+      if (!dcache_read_range (line - before * line_size, buf.data (),
+			      n_lines * line_size))
+	{
+	  if (n_lines == 1)
+	    return NULL;
+
+	  /* Some of the other lines may not be readable.  Retry with
+	     just the line that was asked for, and stop predicting.  */
+	  dcache->confidence = 0;
+	  dcache->target_reads++;
+	  before = after = 0;
+	  n_lines = 1;
+	  if (!dcache_read_range (line, buf.data (), line_size))
+	    return NULL;
+	}
+    }
+
+  for (i = 0; i < n_lines; i++)
+    {
+      CORE_ADDR line_addr = line + (i - before) * line_size;
+      struct dcache_block *db;
+
+      if (!read_p[i])
+	continue;
+
+      db = dcache_alloc (dcache, line_addr);
+
+      memcpy (db->data, buf.data () + i * line_size, line_size);
+      if (i < before || i > before + wanted)
+	{
+	  db->prefetched = 1;
+	  dcache->prefetched++;
+	}
+      else
+	dcache->misses++;
+
+      if (line_addr == line)
+	result = db;
+    }
+
+  *fill_end = line + (std::min (wanted, after) + 1) * line_size;
+
+  /* Predict where the next miss will be: right after the lines just
+     read for a sequential access, or the next multiple of the stride
+     outside of them otherwise.  */
+  if (dcache->stride > 0)
+    {
+      ULONGEST stride = dcache->stride;
+
+      dcache->expect = line + (after / stride + 1) * stride * line_size;
+    }
+  else if (dcache->stride < 0)
+    {
+      ULONGEST stride = -dcache->stride;
+
+      dcache->expect = line - (before / stride + 1) * stride * line_size;
+    }
+  else
+    dcache->expect = line + (after + 1) * line_size;
+
+  return result;
+}
+
 /* Write the byte at PTR into ADDR in the data cache.
 
    The caller should have written the data through to target memory
@@ -452,6 +708,13 @@ dcache_init (void)
   dcache->size = 0;
   dcache->line_size = dcache_line_size;
   dcache->ptid = null_ptid;
+  dcache->have_miss = 0;
+  dcache->confidence = 0;
+  dcache->hits = 0;
+  dcache->misses = 0;
+  dcache->target_reads = 0;
+  dcache->prefetched = 0;
+  dcache->prefetch_hits = 0;
 
   return dcache;
 }
@@ -467,7 +730,8 @@ dcache_read_memory_partial (struct target_ops *ops, DCACHE *dcache,
 			    CORE_ADDR memaddr, gdb_byte *myaddr,
 			    ULONGEST len, ULONGEST *xfered_len)
 {
-  ULONGEST i;
+  ULONGEST i = 0;
+  CORE_ADDR fill_end = memaddr;
 
   /* If this is a different inferior from what we've recorded,
      flush the cache.  */
@@ -478,15 +742,36 @@ dcache_read_memory_partial (struct target_ops *ops, DCACHE *dcache,
       dcache->ptid = inferior_ptid;
     }
 
-  for (i = 0; i < len; i++)
+  while (i < len)
     {
-      if (!dcache_peek_byte (dcache, memaddr + i, myaddr + i))
+      CORE_ADDR addr = memaddr + i;
+      struct dcache_block *db = dcache_hit (dcache, addr);
+      ULONGEST offset = XFORM (dcache, addr);
+      ULONGEST chunk = std::min<ULONGEST> (len - i,
+					   dcache->line_size - offset);
+
+      if (db == NULL)
 	{
-	  /* That failed.  Discard its cache line so we don't have a
-	     partially read line.  */
-	  dcache_invalidate_line (dcache, memaddr + i);
-	  break;
+	  /* A line that can't be read is not cached at all, so there
+	     is nothing to discard.  */
+	  db = dcache_fill (dcache, addr, memaddr + len, &fill_end);
+	  if (db == NULL)
+	    break;
 	}
+      else if (addr >= fill_end)
+	{
+	  /* Lines read along with an earlier line of this access were
+	     counted as misses already.  */
+	  dcache->hits++;
+	  if (db->prefetched)
+	    {
+	      db->prefetched = 0;
+	      dcache->prefetch_hits++;
+	    }
+	}
+
+      memcpy (myaddr + i, db->data + offset, chunk);
+      i += chunk;
     }
 
   if (i == 0)
@@ -635,6 +920,13 @@ dcache_info_1 (DCACHE *dcache, const char *exp)
     }
 
   printf_filtered (_("Cache state: %d active lines, %d hits\n"), i, refcount);
+  printf_filtered (_("Cache statistics: %s hits, %s misses, "
+		     "%s target reads\n"),
+		   pulongest (dcache->hits), pulongest (dcache->misses),
+		   pulongest (dcache->target_reads));
+  printf_filtered (_("Prefetching: %s lines prefetched, %s used\n"),
+		   pulongest (dcache->prefetched),
+		   pulongest (dcache->prefetch_hits));
 }
 
 static void
@@ -701,9 +993,9 @@ exists only for compatibility reasons."),
   add_info ("dcache", info_dcache_command,
 	    _("\
 Print information on the dcache performance.\n\
-With no arguments, this command prints the cache configuration and a\n\
-summary of each line in the cache.  Use \"info dcache <lineno> to dump\"\n\
-the contents of a given line."));
+With no arguments, this command prints the cache configuration, a\n\
+summary of each line in the cache, and hit, miss and prefetch statistics.\n\
+Use \"info dcache <lineno>\" to dump the contents of a given line."));
 
   add_prefix_cmd ("dcache", class_obscure, set_dcache_command, _("\
 Use this command to set number of lines in dcache and line-size."),
@@ -728,4 +1020,14 @@ Show number of dcache lines."),
 			     set_dcache_size,
 			     NULL,
 			     &dcache_set_list, &dcache_show_list);
+  add_setshow_zuinteger_cmd ("prefetch", class_obscure,
+			     &dcache_prefetch, _("\
+Set the maximum number of dcache lines to read ahead."), _("\
+Show the maximum number of dcache lines to read ahead."), _("\
+When the dcache misses follow a sequential or strided pattern, up to\n\
+this many lines are read ahead of a miss along the pattern, in the same\n\
+target request.  Zero disables prefetching."),
+			     NULL,
+			     NULL,
+			     &dcache_set_list, &dcache_show_list);
 }
@@ -38,6 +38,9 @@
 #include "ax.h"
 #include "dwarf2loc.h"
 #include "dwarf2-frame-tailcall.h"
+#include "gdb_bfd.h"
+#include "observer.h"
+#include <algorithm>
 #if GDB_SELF_TEST
 #include "selftest.h"
 #include "selftest-arch.h"
@@ -97,11 +100,9 @@ struct dwarf2_cie
   unsigned char segment_size;
 };
 
-struct dwarf2_cie_table
-{
-  int num_entries;
-  struct dwarf2_cie **entries;
-};
+/* A table of CIEs, sorted by CIE_POINTER.  */
+
+typedef std::vector<dwarf2_cie *> dwarf2_cie_table;
 
 /* Frame Description Entry (FDE).  */
 
@@ -125,10 +126,45 @@ struct dwarf2_fde
   unsigned char eh_frame_p;
 };
 
+/* The FDEs decoded while reading a frame section.  */
+
+typedef std::vector<dwarf2_fde *> dwarf2_fde_vector;
+
+/* The binary search table of an .eh_frame_hdr section, which the linker
+   builds to map addresses to the FDEs of the .eh_frame section.  */
+
+struct dwarf2_eh_frame_hdr
+{
+  /* The .eh_frame section.  */
+  struct comp_unit *unit;
+
+  /* The address of the .eh_frame_hdr section.  The table entries are
+     relative to it.  */
+  CORE_ADDR vma;
+
+  /* The table: FDE_COUNT pairs of signed 4-byte values, the initial
+     location of an FDE and the address of the FDE, sorted by initial
+     location.  */
+  const gdb_byte *table;
+  unsigned int fde_count;
+
+  /* The CIEs decoded so far.  */
+  dwarf2_cie_table cie_table;
+
+  /* The FDEs decoded so far, indexed like TABLE.  Empty until the first
+     FDE is decoded.  */
+  std::vector<dwarf2_fde *> fdes;
+};
+
 struct dwarf2_fde_table
 {
   int num_entries;
   struct dwarf2_fde **entries;
+
+  /* If not NULL, the FDEs are looked up in the .eh_frame_hdr search
+     table and decoded when they are first needed, and the table above
+     is empty.  */
+  struct dwarf2_eh_frame_hdr *eh_frame_hdr;
 };
 
 /* A minimal decoding of DWARF2 compilation units.  We only decode
@@ -293,9 +329,13 @@ class dwarf_expr_executor : public dwarf_expr_context
   }
 };
 
+/* Evaluate the expression of LEN bytes at EXP, from the frame
+   information of OBJFILE, in THIS_FRAME.  */
+
 static CORE_ADDR
 execute_stack_op (const gdb_byte *exp, ULONGEST len, int addr_size,
-		  CORE_ADDR offset, struct frame_info *this_frame,
+		  CORE_ADDR offset, struct objfile *objfile,
+		  struct frame_info *this_frame,
 		  CORE_ADDR initial, int initial_in_stack_memory)
 {
   CORE_ADDR result;
@@ -303,6 +343,7 @@ execute_stack_op (const gdb_byte *exp, ULONGEST len, int addr_size,
   dwarf_expr_executor ctx;
   scoped_value_mark free_values;
 
+  ctx.objfile = objfile;
   ctx.this_frame = this_frame;
   ctx.gdbarch = get_frame_arch (this_frame);
   ctx.addr_size = addr_size;
@@ -916,6 +957,127 @@ dwarf2_fetch_cfa_info (struct gdbarch *gdbarch, CORE_ADDR pc,
     }
 }
 
+
+/* A row of the CFI table: the register rules and the CFA rule that
+   result from running the CIE and FDE instructions up to a PC.  Rows
+   only depend on the debug information, so frames of different threads
+   stopped at the same PC can share them.  */
+
+struct dwarf2_frame_row
+{
+  /* The key.  FDE is NULL if the slot is empty.  */
+  struct gdbarch *gdbarch;
+  struct dwarf2_fde *fde;
+  CORE_ADDR pc;
+
+  /* Whether the entry PC of the function was known, and its value.
+     The rules at the entry PC give ENTRY_CFA_SP_OFFSET below.  */
+  int entry_pc_p;
+  CORE_ADDR entry_pc;
+
+  /* The rules, indexed by DWARF register number.  */
+  std::vector<struct dwarf2_frame_state_reg> reg;
+
+  LONGEST cfa_offset;
+  ULONGEST cfa_reg;
+  enum cfa_how_kind cfa_how;
+  const gdb_byte *cfa_exp;
+
+  bool armcc_cfa_offsets_reversed;
+
+  LONGEST entry_cfa_sp_offset;
+  int entry_cfa_sp_offset_p;
+};
+
+/* Number of slots in the row cache.  */
+
+#define DWARF2_FRAME_ROW_CACHE_SIZE 4096
+
+/* The row cache.  It is direct-mapped, so a new row simply replaces
+   whatever row hashes to the same slot.  Rows point into the frame
+   information of objfiles, so the cache is emptied whenever objfiles
+   are added or removed.  */
+
+static std::vector<struct dwarf2_frame_row> dwarf2_frame_row_cache;
+
+/* Number of occupied slots in the row cache.  */
+
+static unsigned int dwarf2_frame_row_cache_count;
+
+/* Return the row cache slot for PC in FDE.  */
+
+static struct dwarf2_frame_row *
+dwarf2_frame_row_slot (struct dwarf2_fde *fde, CORE_ADDR pc)
+{
+  hashval_t hash;
+
+  if (dwarf2_frame_row_cache.empty ())
+    dwarf2_frame_row_cache.resize (DWARF2_FRAME_ROW_CACHE_SIZE);
+
+  hash = htab_hash_pointer (fde);
+  hash = iterative_hash_object (pc, hash);
+  return &dwarf2_frame_row_cache[hash % DWARF2_FRAME_ROW_CACHE_SIZE];
+}
+
+/* Look up the row for PC in FDE of GDBARCH, whose function starts at
+   ENTRY_PC if ENTRY_PC_P is non-zero.  Return NULL if it isn't
+   cached.  */
+
+static const struct dwarf2_frame_row *
+dwarf2_frame_row_lookup (struct gdbarch *gdbarch, struct dwarf2_fde *fde,
+			 CORE_ADDR pc, int entry_pc_p, CORE_ADDR entry_pc)
+{
+  struct dwarf2_frame_row *row = dwarf2_frame_row_slot (fde, pc);
+
+  if (row->fde != fde
+      || row->pc != pc
+      || row->gdbarch != gdbarch
+      || row->entry_pc_p != entry_pc_p
+      || (entry_pc_p && row->entry_pc != entry_pc))
+    return NULL;
+
+  return row;
+}
+
+/* Empty the row cache.  */
+
+static void
+dwarf2_frame_row_cache_clear ()
+{
+  if (dwarf2_frame_row_cache_count == 0)
+    return;
+
+  for (struct dwarf2_frame_row &row : dwarf2_frame_row_cache)
+    {
+      row.fde = NULL;
+      row.reg.clear ();
+    }
+  dwarf2_frame_row_cache_count = 0;
+}
+
+/* The 'free_objfile' observer of the row cache.  */
+
+static void
+dwarf2_frame_row_cache_objfile_observer (struct objfile *objfile)
+{
+  dwarf2_frame_row_cache_clear ();
+}
+
+/* The 'new_objfile' observer of the row cache.  Code registered
+   through the JIT interface gets FDEs of its own, and does not change
+   the rows already computed for other FDEs, so a JIT objfile leaves
+   the cache alone; a JIT registering one function after the other
+   would otherwise keep it empty.  */
+
+static void
+dwarf2_frame_row_cache_new_objfile (struct objfile *objfile)
+{
+  if (objfile != NULL && (objfile->flags & OBJF_JIT) != 0)
+    return;
+
+  dwarf2_frame_row_cache_clear ();
+}
+
 
 struct dwarf2_frame_cache
 {
@@ -942,6 +1104,9 @@ struct dwarf2_frame_cache
   /* The .text offset.  */
   CORE_ADDR text_offset;
 
+  /* The objfile holding the FDE.  */
+  struct objfile *objfile;
+
   /* True if we already checked whether this frame is the bottom frame
      of a virtual tail call frame chain.  */
   int checked_tailcall_bottom;
@@ -960,6 +1125,55 @@ struct dwarf2_frame_cache
   int entry_cfa_sp_offset_p;
 };
 
+/* Record the rules of FS, computed for PC in FDE of GDBARCH, and the
+   entry CFA offset found in CACHE in the row cache.  */
+
+static void
+dwarf2_frame_row_store (struct gdbarch *gdbarch, struct dwarf2_fde *fde,
+			CORE_ADDR pc, int entry_pc_p, CORE_ADDR entry_pc,
+			const struct dwarf2_frame_state *fs,
+			const struct dwarf2_frame_cache *cache)
+{
+  struct dwarf2_frame_row *row = dwarf2_frame_row_slot (fde, pc);
+
+  if (row->fde == NULL)
+    dwarf2_frame_row_cache_count++;
+
+  row->gdbarch = gdbarch;
+  row->fde = fde;
+  row->pc = pc;
+  row->entry_pc_p = entry_pc_p;
+  row->entry_pc = entry_pc_p ? entry_pc : 0;
+  row->reg.assign (fs->regs.reg, fs->regs.reg + fs->regs.num_regs);
+  row->cfa_offset = fs->regs.cfa_offset;
+  row->cfa_reg = fs->regs.cfa_reg;
+  row->cfa_how = fs->regs.cfa_how;
+  row->cfa_exp = fs->regs.cfa_exp;
+  row->armcc_cfa_offsets_reversed = fs->armcc_cfa_offsets_reversed;
+  row->entry_cfa_sp_offset = cache->entry_cfa_sp_offset;
+  row->entry_cfa_sp_offset_p = cache->entry_cfa_sp_offset_p;
+}
+
+/* Set the rules of FS and the entry CFA offset of CACHE from ROW.  */
+
+static void
+dwarf2_frame_row_restore (const struct dwarf2_frame_row *row,
+			  struct dwarf2_frame_state *fs,
+			  struct dwarf2_frame_cache *cache)
+{
+  fs->regs.alloc_regs (row->reg.size ());
+  if (!row->reg.empty ())
+    memcpy (fs->regs.reg, row->reg.data (),
+	    row->reg.size () * sizeof (struct dwarf2_frame_state_reg));
+  fs->regs.cfa_offset = row->cfa_offset;
+  fs->regs.cfa_reg = row->cfa_reg;
+  fs->regs.cfa_how = row->cfa_how;
+  fs->regs.cfa_exp = row->cfa_exp;
+  fs->armcc_cfa_offsets_reversed = row->armcc_cfa_offsets_reversed;
+  cache->entry_cfa_sp_offset = row->entry_cfa_sp_offset;
+  cache->entry_cfa_sp_offset_p = row->entry_cfa_sp_offset_p;
+}
+
 static struct dwarf2_frame_cache *
 dwarf2_frame_cache (struct frame_info *this_frame, void **this_cache)
 {
@@ -968,8 +1182,10 @@ dwarf2_frame_cache (struct frame_info *this_frame, void **this_cache)
 		       + gdbarch_num_pseudo_regs (gdbarch);
   struct dwarf2_frame_cache *cache;
   struct dwarf2_fde *fde;
-  CORE_ADDR entry_pc;
+  CORE_ADDR entry_pc = 0;
+  int entry_pc_p;
   const gdb_byte *instr;
+  const struct dwarf2_frame_row *row;
 
   if (*this_cache)
     return (struct dwarf2_frame_cache *) *this_cache;
@@ -1004,38 +1220,51 @@ dwarf2_frame_cache (struct frame_info *this_frame, void **this_cache)
   struct dwarf2_frame_state fs (pc1, fde->cie);
 
   cache->addr_size = fde->cie->addr_size;
+  cache->objfile = fde->cie->unit->objfile;
 
-  /* Check for "quirks" - known bugs in producers.  */
-  dwarf2_frame_find_quirks (&fs, fde);
+  CORE_ADDR pc = get_frame_address_in_block (this_frame);
+  entry_pc_p = get_frame_func_if_available (this_frame, &entry_pc);
 
-  /* First decode all the insns in the CIE.  */
-  execute_cfa_program (fde, fde->cie->initial_instructions,
-		       fde->cie->end, gdbarch,
-		       get_frame_address_in_block (this_frame), &fs);
+  /* Frames of many threads are often stopped at the same PC, so reuse
+     the rules computed for an earlier frame if possible.  */
+  row = dwarf2_frame_row_lookup (gdbarch, fde, pc, entry_pc_p, entry_pc);
+  if (row != NULL)
+    dwarf2_frame_row_restore (row, &fs, cache);
+  else
+    {
+      /* Check for "quirks" - known bugs in producers.  */
+      dwarf2_frame_find_quirks (&fs, fde);
 
-  /* Save the initialized register set.  */
-  fs.initial = fs.regs;
+      /* First decode all the insns in the CIE.  */
+      execute_cfa_program (fde, fde->cie->initial_instructions,
+			   fde->cie->end, gdbarch, pc, &fs);
 
-  if (get_frame_func_if_available (this_frame, &entry_pc))
-    {
-      /* Decode the insns in the FDE up to the entry PC.  */
-      instr = execute_cfa_program (fde, fde->instructions, fde->end, gdbarch,
-				   entry_pc, &fs);
+      /* Save the initialized register set.  */
+      fs.initial = fs.regs;
 
-      if (fs.regs.cfa_how == CFA_REG_OFFSET
-	  && (dwarf_reg_to_regnum (gdbarch, fs.regs.cfa_reg)
-	      == gdbarch_sp_regnum (gdbarch)))
+      if (entry_pc_p)
 	{
-	  cache->entry_cfa_sp_offset = fs.regs.cfa_offset;
-	  cache->entry_cfa_sp_offset_p = 1;
+	  /* Decode the insns in the FDE up to the entry PC.  */
+	  instr = execute_cfa_program (fde, fde->instructions, fde->end,
+				       gdbarch, entry_pc, &fs);
+
+	  if (fs.regs.cfa_how == CFA_REG_OFFSET
+	      && (dwarf_reg_to_regnum (gdbarch, fs.regs.cfa_reg)
+		  == gdbarch_sp_regnum (gdbarch)))
+	    {
+	      cache->entry_cfa_sp_offset = fs.regs.cfa_offset;
+	      cache->entry_cfa_sp_offset_p = 1;
+	    }
 	}
-    }
-  else
-    instr = fde->instructions;
+      else
+	instr = fde->instructions;
 
-  /* Then decode the insns in the FDE up to our target PC.  */
-  execute_cfa_program (fde, instr, fde->end, gdbarch,
-		       get_frame_address_in_block (this_frame), &fs);
+      /* Then decode the insns in the FDE up to our target PC.  */
+      execute_cfa_program (fde, instr, fde->end, gdbarch, pc, &fs);
+
+      dwarf2_frame_row_store (gdbarch, fde, pc, entry_pc_p, entry_pc,
+			      &fs, cache);
+    }
 
   TRY
     {
@@ -1054,6 +1283,7 @@ dwarf2_frame_cache (struct frame_info *this_frame, void **this_cache)
 	  cache->cfa =
 	    execute_stack_op (fs.regs.cfa_exp, fs.regs.cfa_exp_len,
 			      cache->addr_size, cache->text_offset,
+			      cache->objfile,
 			      this_frame, 0, 0);
 	  break;
 
@@ -1261,6 +1491,7 @@ dwarf2_frame_prev_register (struct frame_info *this_frame, void **this_cache,
       addr = execute_stack_op (cache->reg[regnum].loc.exp.start,
 			       cache->reg[regnum].loc.exp.len,
 			       cache->addr_size, cache->text_offset,
+			       cache->objfile,
 			       this_frame, cache->cfa, 1);
       return frame_unwind_got_memory (this_frame, regnum, addr);
 
@@ -1272,6 +1503,7 @@ dwarf2_frame_prev_register (struct frame_info *this_frame, void **this_cache,
       addr = execute_stack_op (cache->reg[regnum].loc.exp.start,
 			       cache->reg[regnum].loc.exp.len,
 			       cache->addr_size, cache->text_offset,
+			       cache->objfile,
 			       this_frame, cache->cfa, 1);
       return frame_unwind_got_constant (this_frame, regnum, addr);
 
@@ -1623,53 +1855,35 @@ read_encoded_value (struct comp_unit *unit, gdb_byte encoding,
 }
 
 
-static int
-bsearch_cie_cmp (const void *key, const void *element)
+static bool
+cie_pointer_less (const struct dwarf2_cie *cie, ULONGEST cie_pointer)
 {
-  ULONGEST cie_pointer = *(ULONGEST *) key;
-  struct dwarf2_cie *cie = *(struct dwarf2_cie **) element;
-
-  if (cie_pointer == cie->cie_pointer)
-    return 0;
-
-  return (cie_pointer < cie->cie_pointer) ? -1 : 1;
+  return cie->cie_pointer < cie_pointer;
 }
 
 /* Find CIE with the given CIE_POINTER in CIE_TABLE.  */
 static struct dwarf2_cie *
-find_cie (struct dwarf2_cie_table *cie_table, ULONGEST cie_pointer)
+find_cie (const dwarf2_cie_table *cie_table, ULONGEST cie_pointer)
 {
-  struct dwarf2_cie **p_cie;
+  auto it = std::lower_bound (cie_table->begin (), cie_table->end (),
+			      cie_pointer, cie_pointer_less);
 
-  /* The C standard (ISO/IEC 9899:TC2) requires the BASE argument to
-     bsearch be non-NULL.  */
-  if (cie_table->entries == NULL)
-    {
-      gdb_assert (cie_table->num_entries == 0);
-      return NULL;
-    }
-
-  p_cie = ((struct dwarf2_cie **)
-	   bsearch (&cie_pointer, cie_table->entries, cie_table->num_entries,
-		    sizeof (cie_table->entries[0]), bsearch_cie_cmp));
-  if (p_cie != NULL)
-    return *p_cie;
+  if (it != cie_table->end () && (*it)->cie_pointer == cie_pointer)
+    return *it;
   return NULL;
 }
 
-/* Add a pointer to new CIE to the CIE_TABLE, allocating space for it.  */
+/* Add a pointer to new CIE to the CIE_TABLE.  CIEs are usually read in
+   section order, but CIEs found through .eh_frame_hdr are not.  */
 static void
-add_cie (struct dwarf2_cie_table *cie_table, struct dwarf2_cie *cie)
+add_cie (dwarf2_cie_table *cie_table, struct dwarf2_cie *cie)
 {
-  const int n = cie_table->num_entries;
-
-  gdb_assert (n < 1
-              || cie_table->entries[n - 1]->cie_pointer < cie->cie_pointer);
+  auto it = std::lower_bound (cie_table->begin (), cie_table->end (),
+			      cie->cie_pointer, cie_pointer_less);
 
-  cie_table->entries
-    = XRESIZEVEC (struct dwarf2_cie *, cie_table->entries, n + 1);
-  cie_table->entries[n] = cie;
-  cie_table->num_entries = n + 1;
+  gdb_assert (it == cie_table->end ()
+	      || (*it)->cie_pointer != cie->cie_pointer);
+  cie_table->insert (it, cie);
 }
 
 static int
@@ -1685,6 +1899,68 @@ bsearch_fde_cmp (const void *key, const void *element)
   return 1;
 }
 
+static struct dwarf2_fde *eh_frame_hdr_find_fde
+  (struct dwarf2_eh_frame_hdr *hdr, CORE_ADDR seek_pc);
+
+/* Find the FDE for SEEK_PC, an address relative to OBJFILE's text
+   offset, in OBJFILE's frame information.  */
+
+static struct dwarf2_fde *
+dwarf2_frame_find_objfile_fde (struct objfile *objfile, CORE_ADDR seek_pc)
+{
+  struct dwarf2_fde_table *fde_table;
+  struct dwarf2_fde **p_fde;
+
+  fde_table = ((struct dwarf2_fde_table *)
+	       objfile_data (objfile, dwarf2_frame_objfile_data));
+  if (fde_table == NULL)
+    {
+      dwarf2_build_frame_info (objfile);
+      fde_table = ((struct dwarf2_fde_table *)
+		   objfile_data (objfile, dwarf2_frame_objfile_data));
+    }
+  gdb_assert (fde_table != NULL);
+
+  if (fde_table->eh_frame_hdr != NULL)
+    return eh_frame_hdr_find_fde (fde_table->eh_frame_hdr, seek_pc);
+
+  if (fde_table->num_entries == 0)
+    return NULL;
+
+  if (seek_pc < fde_table->entries[0]->initial_location)
+    return NULL;
+
+  p_fde = ((struct dwarf2_fde **)
+	   bsearch (&seek_pc, fde_table->entries, fde_table->num_entries,
+		    sizeof (fde_table->entries[0]), bsearch_fde_cmp));
+  if (p_fde != NULL)
+    return *p_fde;
+  return NULL;
+}
+
+/* Find the FDE for *PC in OBJFILE.  Return a pointer to the FDE, and
+   store the inital location associated with it into *PC.  */
+
+static struct dwarf2_fde *
+dwarf2_frame_find_fde_1 (struct objfile *objfile, CORE_ADDR *pc,
+			 CORE_ADDR *out_offset)
+{
+  struct dwarf2_fde *fde;
+  CORE_ADDR offset;
+
+  gdb_assert (objfile->section_offsets);
+  offset = ANOFFSET (objfile->section_offsets, SECT_OFF_TEXT (objfile));
+
+  fde = dwarf2_frame_find_objfile_fde (objfile, *pc - offset);
+  if (fde == NULL)
+    return NULL;
+
+  *pc = fde->initial_location + offset;
+  if (out_offset)
+    *out_offset = offset;
+  return fde;
+}
+
 /* Find the FDE for *PC.  Return a pointer to the FDE, and store the
    inital location associated with it into *PC.  */
 
@@ -1692,61 +1968,50 @@ static struct dwarf2_fde *
 dwarf2_frame_find_fde (CORE_ADDR *pc, CORE_ADDR *out_offset)
 {
   struct objfile *objfile;
+  struct obj_section *osect;
+  struct dwarf2_fde *fde;
 
-  ALL_OBJFILES (objfile)
+  /* Only look at the objfile that contains *PC, and at its separate
+     debug objfiles, if there is such an objfile.  The program space's
+     section map finds it without going through all objfiles.  */
+  osect = find_pc_section (*pc);
+  if (osect != NULL)
     {
-      struct dwarf2_fde_table *fde_table;
-      struct dwarf2_fde **p_fde;
-      CORE_ADDR offset;
-      CORE_ADDR seek_pc;
+      struct objfile *parent = osect->objfile;
 
-      fde_table = ((struct dwarf2_fde_table *)
-		   objfile_data (objfile, dwarf2_frame_objfile_data));
-      if (fde_table == NULL)
+      if (parent->separate_debug_objfile_backlink != NULL)
+	parent = parent->separate_debug_objfile_backlink;
+
+      for (objfile = parent;
+	   objfile != NULL;
+	   objfile = objfile_separate_debug_iterate (parent, objfile))
 	{
-	  dwarf2_build_frame_info (objfile);
-	  fde_table = ((struct dwarf2_fde_table *)
-		       objfile_data (objfile, dwarf2_frame_objfile_data));
+	  fde = dwarf2_frame_find_fde_1 (objfile, pc, out_offset);
+	  if (fde != NULL)
+	    return fde;
 	}
-      gdb_assert (fde_table != NULL);
-
-      if (fde_table->num_entries == 0)
-	continue;
 
-      gdb_assert (objfile->section_offsets);
-      offset = ANOFFSET (objfile->section_offsets, SECT_OFF_TEXT (objfile));
-
-      gdb_assert (fde_table->num_entries > 0);
-      if (*pc < offset + fde_table->entries[0]->initial_location)
-        continue;
+      return NULL;
+    }
 
-      seek_pc = *pc - offset;
-      p_fde = ((struct dwarf2_fde **)
-	       bsearch (&seek_pc, fde_table->entries, fde_table->num_entries,
-                        sizeof (fde_table->entries[0]), bsearch_fde_cmp));
-      if (p_fde != NULL)
-        {
-          *pc = (*p_fde)->initial_location + offset;
-	  if (out_offset)
-	    *out_offset = offset;
-          return *p_fde;
-        }
+  ALL_OBJFILES (objfile)
+    {
+      fde = dwarf2_frame_find_fde_1 (objfile, pc, out_offset);
+      if (fde != NULL)
+	return fde;
     }
   return NULL;
 }
 
-/* Add a pointer to new FDE to the FDE_TABLE, allocating space for it.  */
+/* Add a pointer to new FDE to FDE_VEC.  */
 static void
-add_fde (struct dwarf2_fde_table *fde_table, struct dwarf2_fde *fde)
+add_fde (dwarf2_fde_vector *fde_vec, struct dwarf2_fde *fde)
 {
   if (fde->address_range == 0)
     /* Discard useless FDEs.  */
     return;
 
-  fde_table->num_entries += 1;
-  fde_table->entries = XRESIZEVEC (struct dwarf2_fde *, fde_table->entries,
-				   fde_table->num_entries);
-  fde_table->entries[fde_table->num_entries - 1] = fde;
+  fde_vec->push_back (fde);
 }
 
 #define DW64_CIE_ID 0xffffffffffffffffULL
@@ -1764,8 +2029,8 @@ enum eh_frame_type
 static const gdb_byte *decode_frame_entry (struct comp_unit *unit,
 					   const gdb_byte *start,
 					   int eh_frame_p,
-					   struct dwarf2_cie_table *cie_table,
-					   struct dwarf2_fde_table *fde_table,
+					   dwarf2_cie_table *cie_table,
+					   dwarf2_fde_vector *fde_vec,
 					   enum eh_frame_type entry_type);
 
 /* Decode the next CIE or FDE, entry_type specifies the expected type.
@@ -1774,9 +2039,9 @@ static const gdb_byte *decode_frame_entry (struct comp_unit *unit,
 static const gdb_byte *
 decode_frame_entry_1 (struct comp_unit *unit, const gdb_byte *start,
 		      int eh_frame_p,
-                      struct dwarf2_cie_table *cie_table,
-                      struct dwarf2_fde_table *fde_table,
-                      enum eh_frame_type entry_type)
+		      dwarf2_cie_table *cie_table,
+		      dwarf2_fde_vector *fde_vec,
+		      enum eh_frame_type entry_type)
 {
   struct gdbarch *gdbarch = get_objfile_arch (unit->objfile);
   const gdb_byte *buf, *end;
@@ -2024,7 +2289,7 @@ decode_frame_entry_1 (struct comp_unit *unit, const gdb_byte *start,
       if (fde->cie == NULL)
 	{
 	  decode_frame_entry (unit, unit->dwarf_frame_buffer + cie_pointer,
-			      eh_frame_p, cie_table, fde_table,
+			      eh_frame_p, cie_table, fde_vec,
 			      EH_CIE_TYPE_ID);
 	  fde->cie = find_cie (cie_table, cie_pointer);
 	}
@@ -2064,7 +2329,7 @@ decode_frame_entry_1 (struct comp_unit *unit, const gdb_byte *start,
 
       fde->eh_frame_p = eh_frame_p;
 
-      add_fde (fde_table, fde);
+      add_fde (fde_vec, fde);
     }
 
   return end;
@@ -2076,9 +2341,9 @@ decode_frame_entry_1 (struct comp_unit *unit, const gdb_byte *start,
 static const gdb_byte *
 decode_frame_entry (struct comp_unit *unit, const gdb_byte *start,
 		    int eh_frame_p,
-                    struct dwarf2_cie_table *cie_table,
-                    struct dwarf2_fde_table *fde_table,
-                    enum eh_frame_type entry_type)
+		    dwarf2_cie_table *cie_table,
+		    dwarf2_fde_vector *fde_vec,
+		    enum eh_frame_type entry_type)
 {
   enum { NONE, ALIGN4, ALIGN8, FAIL } workaround = NONE;
   const gdb_byte *ret;
@@ -2087,7 +2352,7 @@ decode_frame_entry (struct comp_unit *unit, const gdb_byte *start,
   while (1)
     {
       ret = decode_frame_entry_1 (unit, start, eh_frame_p,
-				  cie_table, fde_table, entry_type);
+				  cie_table, fde_vec, entry_type);
       if (ret != NULL)
 	break;
 
@@ -2189,20 +2454,215 @@ qsort_fde_cmp (const void *a, const void *b)
   return (aa->initial_location < bb->initial_location) ? -1 : 1;
 }
 
+/* Return true if ENCODING is a pointer encoding that read_encoded_value
+   can read from an .eh_frame_hdr section.  */
+
+static bool
+eh_frame_hdr_encoding_ok (gdb_byte encoding)
+{
+  switch (encoding & 0x70)
+    {
+    case DW_EH_PE_absptr:
+    case DW_EH_PE_pcrel:
+    case DW_EH_PE_datarel:
+      break;
+    default:
+      return false;
+    }
+
+  switch (encoding & 0x0f)
+    {
+    case DW_EH_PE_absptr:
+    case DW_EH_PE_udata2:
+    case DW_EH_PE_udata4:
+    case DW_EH_PE_udata8:
+    case DW_EH_PE_sdata2:
+    case DW_EH_PE_sdata4:
+    case DW_EH_PE_sdata8:
+      return true;
+    default:
+      return false;
+    }
+}
+
+/* Read the .eh_frame_hdr section of OBJFILE, whose .eh_frame section is
+   described by UNIT.  Return its search table, or NULL if OBJFILE has no
+   .eh_frame_hdr section or GDB can't use it.  */
+
+static struct dwarf2_eh_frame_hdr *
+read_eh_frame_hdr (struct objfile *objfile, struct comp_unit *unit)
+{
+  struct gdbarch *gdbarch = get_objfile_arch (objfile);
+  int ptr_size = gdbarch_ptr_bit (gdbarch) / TARGET_CHAR_BIT;
+  struct comp_unit hdr_unit;
+  asection *sect;
+  bfd_size_type size;
+  const gdb_byte *buf = NULL, *end;
+  gdb_byte eh_frame_ptr_enc, fde_count_enc, table_enc;
+  unsigned int bytes_read;
+  CORE_ADDR eh_frame_addr;
+  ULONGEST fde_count;
+
+  sect = bfd_get_section_by_name (objfile->obfd, ".eh_frame_hdr");
+  if (sect == NULL
+      || (bfd_get_section_flags (objfile->obfd, sect) & SEC_HAS_CONTENTS) == 0
+      || bfd_get_section_size (sect) < 4)
+    return NULL;
+
+  TRY
+    {
+      buf = gdb_bfd_map_section (sect, &size);
+    }
+  CATCH (e, RETURN_MASK_ERROR)
+    {
+      return NULL;
+    }
+  END_CATCH
+  end = buf + size;
+
+  /* The header is a version number and the encodings of the pointer to
+     .eh_frame, of the number of FDEs and of the table entries.  The
+     table is only usable with the encoding all linkers use for it.  */
+  eh_frame_ptr_enc = buf[1];
+  fde_count_enc = buf[2];
+  table_enc = buf[3];
+  if (buf[0] != 1
+      || !eh_frame_hdr_encoding_ok (eh_frame_ptr_enc)
+      || !eh_frame_hdr_encoding_ok (fde_count_enc)
+      || table_enc != (DW_EH_PE_datarel | DW_EH_PE_sdata4))
+    return NULL;
+
+  /* Datarel values are relative to the start of the section.  */
+  hdr_unit.abfd = objfile->obfd;
+  hdr_unit.objfile = objfile;
+  hdr_unit.dwarf_frame_buffer = buf;
+  hdr_unit.dwarf_frame_size = size;
+  hdr_unit.dwarf_frame_section = sect;
+  hdr_unit.dbase = bfd_get_section_vma (objfile->obfd, sect);
+  hdr_unit.tbase = 0;
+
+  /* Each encoded value takes at most 8 bytes.  */
+  if (size < 4 + 2 * 8)
+    return NULL;
+  buf += 4;
+  eh_frame_addr = read_encoded_value (&hdr_unit, eh_frame_ptr_enc, ptr_size,
+				      buf, &bytes_read, 0);
+  buf += bytes_read;
+  fde_count = read_encoded_value (&hdr_unit, fde_count_enc, ptr_size,
+				  buf, &bytes_read, 0);
+  buf += bytes_read;
+
+  /* The table must describe the .eh_frame section we read.  */
+  if (eh_frame_addr != bfd_get_section_vma (unit->abfd,
+					    unit->dwarf_frame_section)
+      || fde_count == 0
+      || fde_count > (ULONGEST) (end - buf) / 8)
+    return NULL;
+
+  struct dwarf2_eh_frame_hdr *hdr = new struct dwarf2_eh_frame_hdr;
+
+  hdr->unit = unit;
+  hdr->vma = hdr_unit.dbase;
+  hdr->table = buf;
+  hdr->fde_count = fde_count;
+
+  return hdr;
+}
+
+/* Return the initial location of entry I in HDR's search table.  */
+
+static CORE_ADDR
+eh_frame_hdr_location (struct dwarf2_eh_frame_hdr *hdr, unsigned int i)
+{
+  struct gdbarch *gdbarch = get_objfile_arch (hdr->unit->objfile);
+  CORE_ADDR addr;
+
+  addr = hdr->vma + bfd_get_signed_32 (hdr->unit->abfd, hdr->table + 8 * i);
+  return gdbarch_adjust_dwarf2_addr (gdbarch, addr);
+}
+
+/* Find the FDE for SEEK_PC, an address relative to the objfile's text
+   offset, in the .eh_frame section described by HDR.  Decode the FDE and
+   its CIE if this wasn't done before.  */
+
+static struct dwarf2_fde *
+eh_frame_hdr_find_fde (struct dwarf2_eh_frame_hdr *hdr, CORE_ADDR seek_pc)
+{
+  struct comp_unit *unit = hdr->unit;
+  struct dwarf2_fde *fde;
+  unsigned int low, high;
+
+  /* Find the last entry whose initial location is not above SEEK_PC.  */
+  low = 0;
+  high = hdr->fde_count;
+  while (low < high)
+    {
+      unsigned int mid = low + (high - low) / 2;
+
+      if (eh_frame_hdr_location (hdr, mid) <= seek_pc)
+	low = mid + 1;
+      else
+	high = mid;
+    }
+  if (low == 0)
+    return NULL;
+
+  if (hdr->fdes.empty ())
+    hdr->fdes.resize (hdr->fde_count);
+
+  fde = hdr->fdes[low - 1];
+  if (fde == NULL)
+    {
+      CORE_ADDR fde_addr;
+      ULONGEST offset;
+      dwarf2_fde_vector fde_vec;
+
+      fde_addr = (hdr->vma
+		  + bfd_get_signed_32 (unit->abfd,
+				       hdr->table + 8 * (low - 1) + 4));
+      offset = (fde_addr
+		- bfd_get_section_vma (unit->abfd, unit->dwarf_frame_section));
+      if (offset >= unit->dwarf_frame_size)
+	return NULL;
+
+      TRY
+	{
+	  decode_frame_entry (unit, unit->dwarf_frame_buffer + offset, 1,
+			      &hdr->cie_table, &fde_vec, EH_FDE_TYPE_ID);
+	}
+      CATCH (e, RETURN_MASK_ERROR)
+	{
+	  complaint (&symfile_complaints,
+		     _("Invalid FDE in %s:%s: %s"),
+		     unit->dwarf_frame_section->owner->filename,
+		     unit->dwarf_frame_section->name, e.message);
+	}
+      END_CATCH
+
+      if (fde_vec.empty ())
+	return NULL;
+
+      fde = fde_vec[0];
+      hdr->fdes[low - 1] = fde;
+    }
+
+  if (seek_pc >= fde->initial_location
+      && seek_pc < fde->initial_location + fde->address_range)
+    return fde;
+  return NULL;
+}
+
 void
 dwarf2_build_frame_info (struct objfile *objfile)
 {
   struct comp_unit *unit;
   const gdb_byte *frame_ptr;
-  struct dwarf2_cie_table cie_table;
-  struct dwarf2_fde_table fde_table;
+  dwarf2_cie_table cie_table;
+  dwarf2_fde_vector fde_vec;
   struct dwarf2_fde_table *fde_table2;
-
-  cie_table.num_entries = 0;
-  cie_table.entries = NULL;
-
-  fde_table.num_entries = 0;
-  fde_table.entries = NULL;
+  asection *debug_frame_section;
+  const gdb_byte *debug_frame_buffer;
+  bfd_size_type debug_frame_size;
 
   /* Build a minimal decoding of the DWARF2 compilation unit.  */
   unit = (struct comp_unit *) obstack_alloc (&objfile->objfile_obstack,
@@ -2212,6 +2672,15 @@ dwarf2_build_frame_info (struct objfile *objfile)
   unit->dbase = 0;
   unit->tbase = 0;
 
+  fde_table2 = XOBNEW (&objfile->objfile_obstack, struct dwarf2_fde_table);
+  fde_table2->entries = NULL;
+  fde_table2->num_entries = 0;
+  fde_table2->eh_frame_hdr = NULL;
+
+  dwarf2_get_section_info (objfile, DWARF2_DEBUG_FRAME,
+			   &debug_frame_section, &debug_frame_buffer,
+			   &debug_frame_size);
+
   if (objfile->separate_debug_objfile_backlink == NULL)
     {
       /* Do not read .eh_frame from separate file as they must be also
@@ -2238,12 +2707,27 @@ dwarf2_build_frame_info (struct objfile *objfile)
           if (txt)
             unit->tbase = txt->vma;
 
+	  /* If the linker built a search table for .eh_frame, use it to
+	     decode only the FDEs that are needed.  FDEs from .debug_frame
+	     take precedence over those from .eh_frame, so this can only
+	     be done if there is no .debug_frame.  */
+	  if (debug_frame_size == 0)
+	    {
+	      fde_table2->eh_frame_hdr = read_eh_frame_hdr (objfile, unit);
+	      if (fde_table2->eh_frame_hdr != NULL)
+		{
+		  set_objfile_data (objfile, dwarf2_frame_objfile_data,
+				    fde_table2);
+		  return;
+		}
+	    }
+
 	  TRY
 	    {
 	      frame_ptr = unit->dwarf_frame_buffer;
 	      while (frame_ptr < unit->dwarf_frame_buffer + unit->dwarf_frame_size)
 		frame_ptr = decode_frame_entry (unit, frame_ptr, 1,
-						&cie_table, &fde_table,
+						&cie_table, &fde_vec,
 						EH_CIE_OR_FDE_TYPE_ID);
 	    }
 
@@ -2252,40 +2736,29 @@ dwarf2_build_frame_info (struct objfile *objfile)
 	      warning (_("skipping .eh_frame info of %s: %s"),
 		       objfile_name (objfile), e.message);
 
-	      if (fde_table.num_entries != 0)
-		{
-                  xfree (fde_table.entries);
-		  fde_table.entries = NULL;
-		  fde_table.num_entries = 0;
-		}
+	      fde_vec.clear ();
 	      /* The cie_table is discarded by the next if.  */
 	    }
 	  END_CATCH
 
-          if (cie_table.num_entries != 0)
-            {
-              /* Reinit cie_table: debug_frame has different CIEs.  */
-              xfree (cie_table.entries);
-              cie_table.num_entries = 0;
-              cie_table.entries = NULL;
-            }
+          /* Reinit cie_table: debug_frame has different CIEs.  */
+          cie_table.clear ();
         }
     }
 
-  dwarf2_get_section_info (objfile, DWARF2_DEBUG_FRAME,
-                           &unit->dwarf_frame_section,
-                           &unit->dwarf_frame_buffer,
-                           &unit->dwarf_frame_size);
+  unit->dwarf_frame_section = debug_frame_section;
+  unit->dwarf_frame_buffer = debug_frame_buffer;
+  unit->dwarf_frame_size = debug_frame_size;
   if (unit->dwarf_frame_size)
     {
-      int num_old_fde_entries = fde_table.num_entries;
+      size_t num_old_fde_entries = fde_vec.size ();
 
       TRY
 	{
 	  frame_ptr = unit->dwarf_frame_buffer;
 	  while (frame_ptr < unit->dwarf_frame_buffer + unit->dwarf_frame_size)
 	    frame_ptr = decode_frame_entry (unit, frame_ptr, 0,
-					    &cie_table, &fde_table,
+					    &cie_table, &fde_vec,
 					    EH_CIE_OR_FDE_TYPE_ID);
 	}
       CATCH (e, RETURN_MASK_ERROR)
@@ -2293,52 +2766,20 @@ dwarf2_build_frame_info (struct objfile *objfile)
 	  warning (_("skipping .debug_frame info of %s: %s"),
 		   objfile_name (objfile), e.message);
 
-	  if (fde_table.num_entries != 0)
-	    {
-	      fde_table.num_entries = num_old_fde_entries;
-	      if (num_old_fde_entries == 0)
-		{
-		  xfree (fde_table.entries);
-		  fde_table.entries = NULL;
-		}
-	      else
-		{
-		  fde_table.entries
-		    = XRESIZEVEC (struct dwarf2_fde *, fde_table.entries,
-				  fde_table.num_entries);
-		}
-	    }
-	  fde_table.num_entries = num_old_fde_entries;
-	  /* The cie_table is discarded by the next if.  */
+	  fde_vec.resize (num_old_fde_entries);
 	}
       END_CATCH
     }
 
-  /* Discard the cie_table, it is no longer needed.  */
-  if (cie_table.num_entries != 0)
-    {
-      xfree (cie_table.entries);
-      cie_table.entries = NULL;   /* Paranoia.  */
-      cie_table.num_entries = 0;  /* Paranoia.  */
-    }
-
-  /* Copy fde_table to obstack: it is needed at runtime.  */
-  fde_table2 = XOBNEW (&objfile->objfile_obstack, struct dwarf2_fde_table);
-
-  if (fde_table.num_entries == 0)
-    {
-      fde_table2->entries = NULL;
-      fde_table2->num_entries = 0;
-    }
-  else
+  /* Copy the FDEs to the obstack: they are needed at runtime.  */
+  if (!fde_vec.empty ())
     {
       struct dwarf2_fde *fde_prev = NULL;
       struct dwarf2_fde *first_non_zero_fde = NULL;
-      int i;
 
       /* Prepare FDE table for lookups.  */
-      qsort (fde_table.entries, fde_table.num_entries,
-             sizeof (fde_table.entries[0]), qsort_fde_cmp);
+      qsort (fde_vec.data (), fde_vec.size (), sizeof (fde_vec[0]),
+	     qsort_fde_cmp);
 
       /* Check for leftovers from --gc-sections.  The GNU linker sets
 	 the relevant symbols to zero, but doesn't zero the FDE *end*
@@ -2352,10 +2793,8 @@ dwarf2_build_frame_info (struct objfile *objfile)
 	 Start by finding the first FDE with non-zero start.  Below
 	 we'll discard all FDEs that start at zero and overlap this
 	 one.  */
-      for (i = 0; i < fde_table.num_entries; i++)
+      for (struct dwarf2_fde *fde : fde_vec)
 	{
-	  struct dwarf2_fde *fde = fde_table.entries[i];
-
 	  if (fde->initial_location != 0)
 	    {
 	      first_non_zero_fde = fde;
@@ -2366,11 +2805,8 @@ dwarf2_build_frame_info (struct objfile *objfile)
       /* Since we'll be doing bsearch, squeeze out identical (except
 	 for eh_frame_p) fde entries so bsearch result is predictable.
 	 Also discard leftovers from --gc-sections.  */
-      fde_table2->num_entries = 0;
-      for (i = 0; i < fde_table.num_entries; i++)
+      for (struct dwarf2_fde *fde : fde_vec)
 	{
-	  struct dwarf2_fde *fde = fde_table.entries[i];
-
 	  if (fde->initial_location == 0
 	      && first_non_zero_fde != NULL
 	      && (first_non_zero_fde->initial_location
@@ -2381,29 +2817,126 @@ dwarf2_build_frame_info (struct objfile *objfile)
 	      && fde_prev->initial_location == fde->initial_location)
 	    continue;
 
-	  obstack_grow (&objfile->objfile_obstack, &fde_table.entries[i],
-			sizeof (fde_table.entries[0]));
+	  obstack_grow (&objfile->objfile_obstack, &fde, sizeof (fde));
 	  ++fde_table2->num_entries;
 	  fde_prev = fde;
 	}
       fde_table2->entries
 	= (struct dwarf2_fde **) obstack_finish (&objfile->objfile_obstack);
-
-      /* Discard the original fde_table.  */
-      xfree (fde_table.entries);
     }
 
   set_objfile_data (objfile, dwarf2_frame_objfile_data, fde_table2);
 }
 
+/* Free the .eh_frame_hdr search table of OBJFILE, if it has one.  */
+
+static void
+dwarf2_frame_objfile_data_cleanup (struct objfile *objfile, void *arg)
+{
+  struct dwarf2_fde_table *fde_table = (struct dwarf2_fde_table *) arg;
+
+  delete fde_table->eh_frame_hdr;
+}
+
+#if GDB_SELF_TEST
+
+namespace selftests {
+
+/* Unit test of the row cache.  */
+
+static void
+dwarf2_frame_row_cache_test ()
+{
+  struct dwarf2_fde fde;
+  struct dwarf2_cie cie;
+  struct dwarf2_frame_cache cache;
+
+  memset (&fde, 0, sizeof fde);
+  memset (&cie, 0, sizeof cie);
+  memset (&cache, 0, sizeof cache);
+  fde.cie = &cie;
+
+  dwarf2_frame_state fs (0x1000, fde.cie);
+
+  fs.regs.alloc_regs (3);
+  fs.regs.reg[2].how = DWARF2_FRAME_REG_SAVED_OFFSET;
+  fs.regs.reg[2].loc.offset = -8;
+  fs.regs.cfa_how = CFA_REG_OFFSET;
+  fs.regs.cfa_reg = 1;
+  fs.regs.cfa_offset = 16;
+  cache.entry_cfa_sp_offset = 8;
+  cache.entry_cfa_sp_offset_p = 1;
+
+  dwarf2_frame_row_cache_clear ();
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1000)
+	      == NULL);
+
+  dwarf2_frame_row_store (NULL, &fde, 0x1010, 1, 0x1000, &fs, &cache);
+
+  /* The key must match exactly.  */
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1011, 1, 0x1000)
+	      == NULL);
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 0, 0) == NULL);
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1004)
+	      == NULL);
+
+  const struct dwarf2_frame_row *row
+    = dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1000);
+  SELF_CHECK (row != NULL);
+
+  dwarf2_frame_state fs2 (0x1000, fde.cie);
+  struct dwarf2_frame_cache cache2;
+
+  memset (&cache2, 0, sizeof cache2);
+  dwarf2_frame_row_restore (row, &fs2, &cache2);
+
+  SELF_CHECK (fs2.regs.num_regs == 3);
+  SELF_CHECK (fs2.regs.reg[2].how == DWARF2_FRAME_REG_SAVED_OFFSET);
+  SELF_CHECK (fs2.regs.reg[2].loc.offset == -8);
+  SELF_CHECK (fs2.regs.cfa_how == CFA_REG_OFFSET);
+  SELF_CHECK (fs2.regs.cfa_reg == 1);
+  SELF_CHECK (fs2.regs.cfa_offset == 16);
+  SELF_CHECK (cache2.entry_cfa_sp_offset_p == 1);
+  SELF_CHECK (cache2.entry_cfa_sp_offset == 8);
+
+  /* Code registered through the JIT interface does not empty the
+     cache...  */
+  struct objfile *jit_objfile
+    = new struct objfile (NULL, "<< JIT compiled code >>",
+			  OBJF_NOT_FILENAME | OBJF_JIT);
+  dwarf2_frame_row_cache_new_objfile (jit_objfile);
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1000)
+	      != NULL);
+
+  /* ... but loading or unloading other objfiles does.  */
+  delete jit_objfile;
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1000)
+	      == NULL);
+
+  dwarf2_frame_row_store (NULL, &fde, 0x1010, 1, 0x1000, &fs, &cache);
+  dwarf2_frame_row_cache_new_objfile (NULL);
+  SELF_CHECK (dwarf2_frame_row_lookup (NULL, &fde, 0x1010, 1, 0x1000)
+	      == NULL);
+}
+
+} // namespace selftests
+#endif /* GDB_SELF_TEST */
+
 void
 _initialize_dwarf2_frame (void)
 {
   dwarf2_frame_data = gdbarch_data_register_pre_init (dwarf2_frame_init);
-  dwarf2_frame_objfile_data = register_objfile_data ();
+  dwarf2_frame_objfile_data
+    = register_objfile_data_with_cleanup (NULL,
+					  dwarf2_frame_objfile_data_cleanup);
+
+  observer_attach_new_objfile (dwarf2_frame_row_cache_new_objfile);
+  observer_attach_free_objfile (dwarf2_frame_row_cache_objfile_observer);
 
 #if GDB_SELF_TEST
   selftests::register_test_foreach_arch ("execute_cfa_program",
 					 selftests::execute_cfa_program_test);
+  selftests::register_test ("dwarf2_frame_row_cache",
+			    selftests::dwarf2_frame_row_cache_test);
 #endif
 }
@@ -28,6 +28,13 @@
 #include "dwarf2expr.h"
 #include "dwarf2loc.h"
 #include "common/underlying.h"
+#include "objfiles.h"
+#include "common/byte-vector.h"
+#include <map>
+#include <unordered_map>
+#if GDB_SELF_TEST
+#include "selftest.h"
+#endif
 
 /* Cookie for gdbarch data.  */
 
@@ -97,7 +104,8 @@ dwarf_expr_context::dwarf_expr_context ()
   location (DWARF_VALUE_MEMORY),
   len (0),
   data (NULL),
-  initialized (0)
+  initialized (0),
+  objfile (NULL)
 {
 }
 
@@ -291,14 +299,28 @@ dwarf_expr_context::add_piece (ULONGEST size, ULONGEST offset)
     }
 }
 
+static std::shared_ptr<const struct dwarf_expr_program> dwarf_get_program
+  (const struct dwarf_expr_context *ctx, const gdb_byte *addr, size_t len);
+
 /* Evaluate the expression at ADDR (LEN bytes long).  */
 
 void
 dwarf_expr_context::eval (const gdb_byte *addr, size_t len)
+{
+  std::shared_ptr<const dwarf_expr_program> program
+    = dwarf_get_program (this, addr, len);
+
+  eval_program (program.get ());
+}
+
+/* Evaluate the decoded expression PROGRAM.  */
+
+void
+dwarf_expr_context::eval_program (const struct dwarf_expr_program *program)
 {
   int old_recursion_depth = this->recursion_depth;
 
-  execute_stack_op (addr, addr + len);
+  execute_stack_op (program);
 
   /* RECURSION_DEPTH becomes invalid if an exception was thrown here.  */
 
@@ -539,12 +561,775 @@ dwarf_block_to_sp_offset (struct gdbarch *gdbarch, const gdb_byte *buf,
   return 1;
 }
 
+/* The kinds of decoded expressions that DW_OP_fbreg can evaluate
+   without running them, when they describe a frame base.  */
+
+enum dwarf_expr_program_kind
+{
+  /* Any other expression.  */
+  DWARF_EXPR_GENERIC,
+
+  /* A single DW_OP_call_frame_cfa.  */
+  DWARF_EXPR_CFA,
+
+  /* A single DW_OP_breg* or DW_OP_bregx: a register plus a constant.  */
+  DWARF_EXPR_BREG,
+
+  /* A single DW_OP_reg* or DW_OP_regx.  */
+  DWARF_EXPR_REG
+};
+
+/* An operation of a decoded DWARF expression, with its operands
+   already read.  dwarf_decode_insn maps operations that behave the same
+   to a single one; e.g. all of DW_OP_lit*, DW_OP_const* and DW_OP_consts
+   become DW_OP_constu.  An operation that could not be decoded becomes
+   DW_OP_hi_user, which the evaluator decodes again to report the
+   error.  */
+
+struct dwarf_expr_insn
+{
+  enum dwarf_location_atom op;
+
+  /* The operands.  Their meaning depends on OP.  */
+  ULONGEST u;
+  ULONGEST u2;
+  LONGEST s;
+  const gdb_byte *data;
+
+  /* The bytes of the operation in the expression.  */
+  const gdb_byte *start;
+  const gdb_byte *end;
+
+  /* The index of the operation following this one, and the index of
+     the target of DW_OP_skip and DW_OP_bra.  The end of the expression
+     has the index INSNS.size () of the program.  */
+  unsigned int next;
+  unsigned int target;
+};
+
+/* A DWARF expression decoded by dwarf_decode_program.  Decoding depends
+   on the expression and on the address size, DW_FORM_ref_addr size and
+   byte order of the context evaluating it.  */
+
+struct dwarf_expr_program
+{
+  const gdb_byte *start;
+  const gdb_byte *end;
+  int addr_size;
+  int ref_addr_size;
+  enum bfd_endian byte_order;
+
+  /* A copy of the expression.  Some callers evaluate expressions copied
+     to temporary buffers, so a cached program is only used if the bytes
+     at START are still the same.  */
+  gdb::byte_vector bytes;
+
+  enum dwarf_expr_program_kind kind;
+
+  /* The operations, sorted by their position in the expression.  The
+     first one is the start of the expression.  Operations only
+     reachable as branch targets that start in the middle of other
+     operations have their own entries.  */
+  std::vector<dwarf_expr_insn> insns;
+};
+
+/* Throw an error unless the N bytes at OP_PTR are before OP_END.  */
+
+static void
+dwarf_expr_require_bytes (const gdb_byte *op_ptr, const gdb_byte *op_end,
+			  size_t n)
+{
+  if (op_ptr > op_end || (size_t) (op_end - op_ptr) < n)
+    error (_("DWARF expression error: ran off end of buffer reading "
+	     "operand"));
+}
+
+/* Decode the operation at OP_PTR of PROGRAM into INSN.  Throw an error
+   if it is invalid; evaluating it would throw the same error.  Only
+   INSN's OP, operands and START and END are set.  */
+
+static void
+dwarf_decode_insn (const struct dwarf_expr_program *program,
+		   const gdb_byte *op_ptr, struct dwarf_expr_insn *insn)
+{
+  const gdb_byte *op_end = program->end;
+  enum bfd_endian byte_order = program->byte_order;
+  enum dwarf_location_atom op = (enum dwarf_location_atom) *op_ptr;
+  uint64_t uoffset, reg;
+  int64_t offset;
+
+  insn->op = op;
+  insn->u = 0;
+  insn->u2 = 0;
+  insn->s = 0;
+  insn->data = NULL;
+  insn->start = op_ptr++;
+
+  switch (op)
+    {
+    case DW_OP_lit0:
+    case DW_OP_lit1:
+    case DW_OP_lit2:
+    case DW_OP_lit3:
+    case DW_OP_lit4:
+    case DW_OP_lit5:
+    case DW_OP_lit6:
+    case DW_OP_lit7:
+    case DW_OP_lit8:
+    case DW_OP_lit9:
+    case DW_OP_lit10:
+    case DW_OP_lit11:
+    case DW_OP_lit12:
+    case DW_OP_lit13:
+    case DW_OP_lit14:
+    case DW_OP_lit15:
+    case DW_OP_lit16:
+    case DW_OP_lit17:
+    case DW_OP_lit18:
+    case DW_OP_lit19:
+    case DW_OP_lit20:
+    case DW_OP_lit21:
+    case DW_OP_lit22:
+    case DW_OP_lit23:
+    case DW_OP_lit24:
+    case DW_OP_lit25:
+    case DW_OP_lit26:
+    case DW_OP_lit27:
+    case DW_OP_lit28:
+    case DW_OP_lit29:
+    case DW_OP_lit30:
+    case DW_OP_lit31:
+      insn->op = DW_OP_constu;
+      insn->u = op - DW_OP_lit0;
+      break;
+
+    case DW_OP_addr:
+      dwarf_expr_require_bytes (op_ptr, op_end, program->addr_size);
+      insn->u = extract_unsigned_integer (op_ptr, program->addr_size,
+					  byte_order);
+      op_ptr += program->addr_size;
+      /* Some versions of GCC emit DW_OP_addr before
+	 DW_OP_GNU_push_tls_address.  In this case the value is an
+	 index, not an address, and U2 is zero.  We don't support things
+	 like branching between the address and the TLS op.  */
+      insn->u2 = op_ptr >= op_end || *op_ptr != DW_OP_GNU_push_tls_address;
+      break;
+
+    case DW_OP_GNU_addr_index:
+    case DW_OP_GNU_const_index:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u = uoffset;
+      break;
+
+    case DW_OP_const1u:
+    case DW_OP_const1s:
+    case DW_OP_const2u:
+    case DW_OP_const2s:
+    case DW_OP_const4u:
+    case DW_OP_const4s:
+    case DW_OP_const8u:
+    case DW_OP_const8s:
+      {
+	int size;
+	bool signed_p;
+
+	switch (op)
+	  {
+	  case DW_OP_const1u: size = 1; signed_p = false; break;
+	  case DW_OP_const1s: size = 1; signed_p = true; break;
+	  case DW_OP_const2u: size = 2; signed_p = false; break;
+	  case DW_OP_const2s: size = 2; signed_p = true; break;
+	  case DW_OP_const4u: size = 4; signed_p = false; break;
+	  case DW_OP_const4s: size = 4; signed_p = true; break;
+	  case DW_OP_const8u: size = 8; signed_p = false; break;
+	  default: size = 8; signed_p = true; break;
+	  }
+
+	dwarf_expr_require_bytes (op_ptr, op_end, size);
+	if (signed_p)
+	  insn->u = extract_signed_integer (op_ptr, size, byte_order);
+	else
+	  insn->u = extract_unsigned_integer (op_ptr, size, byte_order);
+	op_ptr += size;
+	insn->op = DW_OP_constu;
+      }
+      break;
+    case DW_OP_constu:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u = uoffset;
+      break;
+    case DW_OP_consts:
+      op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
+      insn->op = DW_OP_constu;
+      insn->u = offset;
+      break;
+
+    /* The DW_OP_reg operations are required to occur alone in
+       location expressions.  */
+    case DW_OP_reg0:
+    case DW_OP_reg1:
+    case DW_OP_reg2:
+    case DW_OP_reg3:
+    case DW_OP_reg4:
+    case DW_OP_reg5:
+    case DW_OP_reg6:
+    case DW_OP_reg7:
+    case DW_OP_reg8:
+    case DW_OP_reg9:
+    case DW_OP_reg10:
+    case DW_OP_reg11:
+    case DW_OP_reg12:
+    case DW_OP_reg13:
+    case DW_OP_reg14:
+    case DW_OP_reg15:
+    case DW_OP_reg16:
+    case DW_OP_reg17:
+    case DW_OP_reg18:
+    case DW_OP_reg19:
+    case DW_OP_reg20:
+    case DW_OP_reg21:
+    case DW_OP_reg22:
+    case DW_OP_reg23:
+    case DW_OP_reg24:
+    case DW_OP_reg25:
+    case DW_OP_reg26:
+    case DW_OP_reg27:
+    case DW_OP_reg28:
+    case DW_OP_reg29:
+    case DW_OP_reg30:
+    case DW_OP_reg31:
+      dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_reg");
+      insn->op = DW_OP_regx;
+      insn->u = op - DW_OP_reg0;
+      break;
+
+    case DW_OP_regx:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
+      dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_regx");
+      insn->u = reg;
+      break;
+
+    case DW_OP_implicit_value:
+      {
+	uint64_t len;
+
+	op_ptr = safe_read_uleb128 (op_ptr, op_end, &len);
+	if (len > (uint64_t) (op_end - op_ptr))
+	  error (_("DW_OP_implicit_value: too few bytes available."));
+	insn->u = len;
+	insn->data = op_ptr;
+	op_ptr += len;
+	dwarf_expr_require_composition (op_ptr, op_end,
+					"DW_OP_implicit_value");
+      }
+      break;
+
+    case DW_OP_stack_value:
+      dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_stack_value");
+      break;
+
+    case DW_OP_implicit_pointer:
+    case DW_OP_GNU_implicit_pointer:
+      {
+	int64_t len;
+
+	if (program->ref_addr_size == -1)
+	  error (_("DWARF-2 expression error: DW_OP_implicit_pointer "
+		   "is not allowed in frame context"));
+
+	/* The referred-to DIE of sect_offset kind.  */
+	dwarf_expr_require_bytes (op_ptr, op_end, program->ref_addr_size);
+	insn->u = extract_unsigned_integer (op_ptr, program->ref_addr_size,
+					    byte_order);
+	op_ptr += program->ref_addr_size;
+
+	/* The byte offset into the data.  */
+	op_ptr = safe_read_sleb128 (op_ptr, op_end, &len);
+	insn->op = DW_OP_implicit_pointer;
+	insn->s = len;
+
+	dwarf_expr_require_composition (op_ptr, op_end,
+					"DW_OP_implicit_pointer");
+      }
+      break;
+
+    case DW_OP_breg0:
+    case DW_OP_breg1:
+    case DW_OP_breg2:
+    case DW_OP_breg3:
+    case DW_OP_breg4:
+    case DW_OP_breg5:
+    case DW_OP_breg6:
+    case DW_OP_breg7:
+    case DW_OP_breg8:
+    case DW_OP_breg9:
+    case DW_OP_breg10:
+    case DW_OP_breg11:
+    case DW_OP_breg12:
+    case DW_OP_breg13:
+    case DW_OP_breg14:
+    case DW_OP_breg15:
+    case DW_OP_breg16:
+    case DW_OP_breg17:
+    case DW_OP_breg18:
+    case DW_OP_breg19:
+    case DW_OP_breg20:
+    case DW_OP_breg21:
+    case DW_OP_breg22:
+    case DW_OP_breg23:
+    case DW_OP_breg24:
+    case DW_OP_breg25:
+    case DW_OP_breg26:
+    case DW_OP_breg27:
+    case DW_OP_breg28:
+    case DW_OP_breg29:
+    case DW_OP_breg30:
+    case DW_OP_breg31:
+      op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
+      insn->op = DW_OP_bregx;
+      insn->u = op - DW_OP_breg0;
+      insn->s = offset;
+      break;
+    case DW_OP_bregx:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
+      op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
+      insn->u = reg;
+      insn->s = offset;
+      break;
+    case DW_OP_fbreg:
+      op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
+      insn->s = offset;
+      break;
+
+    case DW_OP_pick:
+      dwarf_expr_require_bytes (op_ptr, op_end, 1);
+      insn->u = *op_ptr++;
+      break;
+
+    case DW_OP_deref:
+      insn->op = DW_OP_deref_size;
+      insn->u = program->addr_size;
+      break;
+    case DW_OP_deref_size:
+      dwarf_expr_require_bytes (op_ptr, op_end, 1);
+      insn->u = *op_ptr++;
+      break;
+    case DW_OP_deref_type:
+    case DW_OP_GNU_deref_type:
+      dwarf_expr_require_bytes (op_ptr, op_end, 1);
+      insn->op = DW_OP_deref_type;
+      insn->u = *op_ptr++;
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u2 = uoffset;
+      break;
+
+    case DW_OP_plus_uconst:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
+      insn->u = reg;
+      break;
+
+    case DW_OP_dup:
+    case DW_OP_drop:
+    case DW_OP_swap:
+    case DW_OP_over:
+    case DW_OP_rot:
+    case DW_OP_abs:
+    case DW_OP_neg:
+    case DW_OP_not:
+    case DW_OP_and:
+    case DW_OP_div:
+    case DW_OP_minus:
+    case DW_OP_mod:
+    case DW_OP_mul:
+    case DW_OP_or:
+    case DW_OP_plus:
+    case DW_OP_shl:
+    case DW_OP_shr:
+    case DW_OP_shra:
+    case DW_OP_xor:
+    case DW_OP_le:
+    case DW_OP_ge:
+    case DW_OP_eq:
+    case DW_OP_lt:
+    case DW_OP_gt:
+    case DW_OP_ne:
+    case DW_OP_call_frame_cfa:
+    case DW_OP_nop:
+    case DW_OP_push_object_address:
+      break;
+
+    case DW_OP_GNU_push_tls_address:
+    case DW_OP_form_tls_address:
+      insn->op = DW_OP_form_tls_address;
+      break;
+
+    case DW_OP_skip:
+    case DW_OP_bra:
+      dwarf_expr_require_bytes (op_ptr, op_end, 2);
+      insn->s = extract_signed_integer (op_ptr, 2, byte_order);
+      op_ptr += 2;
+      if (insn->s < program->start - op_ptr)
+	error (_("DWARF expression error: branch target out of range"));
+      break;
+
+    case DW_OP_piece:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u = uoffset;
+      break;
+
+    case DW_OP_bit_piece:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u = uoffset;
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->u2 = uoffset;
+      break;
+
+    case DW_OP_GNU_uninit:
+      if (op_ptr != op_end)
+	error (_("DWARF-2 expression error: DW_OP_GNU_uninit must always "
+	       "be the very last op."));
+      break;
+
+    case DW_OP_call2:
+    case DW_OP_call4:
+      {
+	int size = op == DW_OP_call2 ? 2 : 4;
+
+	dwarf_expr_require_bytes (op_ptr, op_end, size);
+	insn->op = DW_OP_call4;
+	insn->u = extract_unsigned_integer (op_ptr, size, byte_order);
+	op_ptr += size;
+      }
+      break;
+
+    case DW_OP_entry_value:
+    case DW_OP_GNU_entry_value:
+      {
+	uint64_t len;
+	CORE_ADDR deref_size;
+	int dwarf_reg;
+
+	op_ptr = safe_read_uleb128 (op_ptr, op_end, &len);
+	if (len > (uint64_t) (op_end - op_ptr))
+	  error (_("DW_OP_entry_value: too few bytes available."));
+
+	/* U is the DWARF register and S the size to dereference, or -1
+	   to use the register's value.  */
+	insn->op = DW_OP_entry_value;
+	dwarf_reg = dwarf_block_to_dwarf_reg (op_ptr, op_ptr + len);
+	if (dwarf_reg != -1)
+	  {
+	    insn->u = dwarf_reg;
+	    insn->s = -1;
+	    op_ptr += len;
+	    break;
+	  }
+
+	dwarf_reg = dwarf_block_to_dwarf_reg_deref (op_ptr, op_ptr + len,
+						    &deref_size);
+	if (dwarf_reg != -1)
+	  {
+	    if (deref_size == -1)
+	      deref_size = program->addr_size;
+	    insn->u = dwarf_reg;
+	    insn->s = deref_size;
+	    op_ptr += len;
+	    break;
+	  }
+
+	error (_("DWARF-2 expression error: DW_OP_entry_value is "
+		 "supported only for single DW_OP_reg* "
+		 "or for DW_OP_breg*(0)+DW_OP_deref*"));
+      }
+
+    case DW_OP_GNU_parameter_ref:
+      dwarf_expr_require_bytes (op_ptr, op_end, 4);
+      insn->u = extract_unsigned_integer (op_ptr, 4, byte_order);
+      op_ptr += 4;
+      break;
+
+    case DW_OP_const_type:
+    case DW_OP_GNU_const_type:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      dwarf_expr_require_bytes (op_ptr, op_end, 1);
+      insn->op = DW_OP_const_type;
+      insn->u = uoffset;
+      insn->u2 = *op_ptr++;
+      dwarf_expr_require_bytes (op_ptr, op_end, insn->u2);
+      insn->data = op_ptr;
+      op_ptr += insn->u2;
+      break;
+
+    case DW_OP_regval_type:
+    case DW_OP_GNU_regval_type:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      insn->op = DW_OP_regval_type;
+      insn->u = reg;
+      insn->u2 = uoffset;
+      break;
+
+    case DW_OP_convert:
+    case DW_OP_GNU_convert:
+    case DW_OP_reinterpret:
+    case DW_OP_GNU_reinterpret:
+      op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
+      if (op == DW_OP_GNU_convert)
+	insn->op = DW_OP_convert;
+      else if (op == DW_OP_GNU_reinterpret)
+	insn->op = DW_OP_reinterpret;
+      insn->u = uoffset;
+      break;
+
+    default:
+      error (_("Unhandled dwarf expression opcode 0x%x"), op);
+    }
+
+  insn->end = op_ptr;
+}
+
+/* Decode the expression of LEN bytes at ADDR, for a context with
+   ADDR_SIZE, REF_ADDR_SIZE and BYTE_ORDER.  Operations are decoded
+   starting at ADDR and at each branch target.  */
+
+static std::unique_ptr<dwarf_expr_program>
+dwarf_decode_program (const gdb_byte *addr, size_t len, int addr_size,
+		      int ref_addr_size, enum bfd_endian byte_order)
+{
+  std::unique_ptr<dwarf_expr_program> program (new dwarf_expr_program);
+  std::map<const gdb_byte *, dwarf_expr_insn> decoded;
+  std::vector<const gdb_byte *> todo;
+
+  program->start = addr;
+  program->end = addr + len;
+  program->addr_size = addr_size;
+  program->ref_addr_size = ref_addr_size;
+  program->byte_order = byte_order;
+  program->bytes.assign (addr, addr + len);
+  program->kind = DWARF_EXPR_GENERIC;
+
+  todo.push_back (addr);
+  while (!todo.empty ())
+    {
+      const gdb_byte *op_ptr = todo.back ();
+
+      todo.pop_back ();
+      while (op_ptr < program->end
+	     && decoded.find (op_ptr) == decoded.end ())
+	{
+	  dwarf_expr_insn &insn = decoded[op_ptr];
+	  bool valid = true;
+
+	  TRY
+	    {
+	      dwarf_decode_insn (program.get (), op_ptr, &insn);
+	    }
+	  CATCH (ex, RETURN_MASK_ERROR)
+	    {
+	      /* Report the error if the operation is evaluated.  */
+	      insn.op = DW_OP_hi_user;
+	      insn.start = op_ptr;
+	      insn.end = program->end;
+	      valid = false;
+	    }
+	  END_CATCH
+
+	  if (!valid)
+	    break;
+	  if (insn.op == DW_OP_skip || insn.op == DW_OP_bra)
+	    todo.push_back (insn.end + insn.s);
+	  if (insn.op == DW_OP_skip)
+	    break;
+	  op_ptr = insn.end;
+	}
+    }
+
+  /* Flatten the operations, and resolve their successors to
+     indexes.  */
+  std::map<const gdb_byte *, unsigned int> index;
+  unsigned int n = decoded.size ();
+
+  program->insns.reserve (n);
+  for (auto &entry : decoded)
+    {
+      index[entry.first] = program->insns.size ();
+      program->insns.push_back (entry.second);
+    }
+
+  auto find_index = [&] (const gdb_byte *op_ptr)
+    {
+      if (op_ptr >= program->end)
+	return n;
+      auto it = index.find (op_ptr);
+      return it != index.end () ? it->second : n;
+    };
+
+  for (dwarf_expr_insn &insn : program->insns)
+    {
+      insn.next = find_index (insn.end);
+      if (insn.op == DW_OP_skip || insn.op == DW_OP_bra)
+	insn.target = find_index (insn.end + insn.s);
+      else
+	insn.target = n;
+    }
+
+  if (n == 1)
+    {
+      switch (program->insns[0].op)
+	{
+	case DW_OP_call_frame_cfa:
+	  program->kind = DWARF_EXPR_CFA;
+	  break;
+	case DW_OP_bregx:
+	  program->kind = DWARF_EXPR_BREG;
+	  break;
+	case DW_OP_regx:
+	  program->kind = DWARF_EXPR_REG;
+	  break;
+	default:
+	  break;
+	}
+    }
+
+  return program;
+}
+
+/* The key of a decoded expression in dwarf_expr_program_cache.  */
+
+struct dwarf_expr_program_key
+{
+  const gdb_byte *addr;
+  size_t len;
+  int addr_size;
+  int ref_addr_size;
+  enum bfd_endian byte_order;
+
+  bool operator== (const dwarf_expr_program_key &other) const
+  {
+    return (addr == other.addr
+	    && len == other.len
+	    && addr_size == other.addr_size
+	    && ref_addr_size == other.ref_addr_size
+	    && byte_order == other.byte_order);
+  }
+};
+
+struct dwarf_expr_program_key_hash
+{
+  size_t operator() (const dwarf_expr_program_key &key) const
+  {
+    hashval_t hash = htab_hash_pointer (key.addr);
+
+    hash = iterative_hash_object (key.len, hash);
+    return iterative_hash_object (key.addr_size, hash);
+  }
+};
+
+/* The decoded expressions of an objfile.  */
+
+typedef std::unordered_map<dwarf_expr_program_key,
+			   std::shared_ptr<const dwarf_expr_program>,
+			   dwarf_expr_program_key_hash>
+  dwarf_expr_program_cache;
+
+/* Objfile data key for the decoded expressions.  */
+
+static const struct objfile_data *dwarf_expr_program_cache_key;
+
+/* Free the decoded expressions of OBJFILE.  */
+
+static void
+dwarf_expr_program_cache_free (struct objfile *objfile, void *arg)
+{
+  delete (dwarf_expr_program_cache *) arg;
+}
+
+/* Return the decoded form of the expression of LEN bytes at ADDR, for
+   evaluation in CTX.  If CTX->objfile is not NULL, the decoded form is
+   kept with it, so that the expression is only decoded the first time
+   it is evaluated.  The caller must hold on to the returned program
+   while evaluating it.  */
+
+static std::shared_ptr<const struct dwarf_expr_program>
+dwarf_get_program (const struct dwarf_expr_context *ctx,
+		   const gdb_byte *addr, size_t len)
+{
+  enum bfd_endian byte_order = gdbarch_byte_order (ctx->gdbarch);
+
+  if (ctx->objfile == NULL)
+    return dwarf_decode_program (addr, len, ctx->addr_size,
+				 ctx->ref_addr_size, byte_order);
+
+  dwarf_expr_program_cache *cache
+    = ((dwarf_expr_program_cache *)
+       objfile_data (ctx->objfile, dwarf_expr_program_cache_key));
+  if (cache == NULL)
+    {
+      cache = new dwarf_expr_program_cache;
+      set_objfile_data (ctx->objfile, dwarf_expr_program_cache_key, cache);
+    }
+
+  dwarf_expr_program_key key = { addr, len, ctx->addr_size,
+				 ctx->ref_addr_size, byte_order };
+  std::shared_ptr<const dwarf_expr_program> &program = (*cache)[key];
+
+  /* The bytes at ADDR may have changed since PROGRAM was decoded, if
+     they were freed and ADDR reused.  An evaluation still running the
+     old program holds its own reference to it, so it can be replaced
+     here.  */
+  if (program == NULL
+      || (len != 0 && memcmp (program->bytes.data (), addr, len) != 0))
+    program = dwarf_decode_program (addr, len, ctx->addr_size,
+				    ctx->ref_addr_size, byte_order);
+  return program;
+}
+
+/* If PROGRAM, the frame base of DW_OP_fbreg, is a register, a register
+   plus a constant or the CFA, store its value in *BASE and return true.
+   This avoids evaluating the most common frame bases as expressions.  */
+
+bool
+dwarf_expr_context::simple_frame_base (const struct dwarf_expr_program *program,
+				       CORE_ADDR *base)
+{
+  ULONGEST value;
+
+  switch (program->kind)
+    {
+    case DWARF_EXPR_REG:
+      *base = this->read_addr_from_reg (program->insns[0].u);
+      return true;
+
+    case DWARF_EXPR_CFA:
+    case DWARF_EXPR_BREG:
+      /* The value is pushed on the stack and read back as an address.
+	 Leave it to fetch_address if the architecture must convert
+	 it.  */
+      if (gdbarch_integer_to_address_p (this->gdbarch))
+	return false;
+
+      if (program->kind == DWARF_EXPR_CFA)
+	value = this->get_frame_cfa ();
+      else
+	value = (this->read_addr_from_reg (program->insns[0].u)
+		 + program->insns[0].s);
+
+      /* Truncate it to the address size, like value_from_ulongest.  */
+      if (this->addr_size < sizeof (ULONGEST))
+	value &= ((ULONGEST) 1 << (8 * this->addr_size)) - 1;
+      *base = value;
+      return true;
+
+    default:
+      return false;
+    }
+}
+
 /* The engine for the expression evaluator.  Using the context in this
-   object, evaluate the expression between OP_PTR and OP_END.  */
+   object, evaluate the decoded expression PROGRAM.  */
 
 void
-dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
-				      const gdb_byte *op_end)
+dwarf_expr_context::execute_stack_op (const struct dwarf_expr_program *program)
 {
   enum bfd_endian byte_order = gdbarch_byte_order (this->gdbarch);
   /* Old-style "untyped" DWARF values need special treatment in a
@@ -555,6 +1340,8 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
      different (in the `==' sense) from any base type coming from the
      CU.  */
   struct type *address_type = this->address_type ();
+  const std::vector<dwarf_expr_insn> &insns = program->insns;
+  unsigned int i = 0;
 
   this->location = DWARF_VALUE_MEMORY;
   this->initialized = 1;  /* Default is initialized.  */
@@ -564,9 +1351,10 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	   this->recursion_depth);
   this->recursion_depth++;
 
-  while (op_ptr < op_end)
+  while (i < insns.size ())
     {
-      enum dwarf_location_atom op = (enum dwarf_location_atom) *op_ptr++;
+      const struct dwarf_expr_insn &insn = insns[i];
+      enum dwarf_location_atom op = insn.op;
       ULONGEST result;
       /* Assume the value is not in stack memory.
 	 Code that knows otherwise sets this to true.
@@ -575,305 +1363,107 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	 This is just an optimization, so it's always ok to punt
 	 and leave this as false.  */
       bool in_stack_memory = false;
-      uint64_t uoffset, reg;
-      int64_t offset;
       struct value *result_val = NULL;
 
       /* The DWARF expression might have a bug causing an infinite
 	 loop.  In that case, quitting is the only way out.  */
       QUIT;
 
+      i = insn.next;
+
       switch (op)
 	{
-	case DW_OP_lit0:
-	case DW_OP_lit1:
-	case DW_OP_lit2:
-	case DW_OP_lit3:
-	case DW_OP_lit4:
-	case DW_OP_lit5:
-	case DW_OP_lit6:
-	case DW_OP_lit7:
-	case DW_OP_lit8:
-	case DW_OP_lit9:
-	case DW_OP_lit10:
-	case DW_OP_lit11:
-	case DW_OP_lit12:
-	case DW_OP_lit13:
-	case DW_OP_lit14:
-	case DW_OP_lit15:
-	case DW_OP_lit16:
-	case DW_OP_lit17:
-	case DW_OP_lit18:
-	case DW_OP_lit19:
-	case DW_OP_lit20:
-	case DW_OP_lit21:
-	case DW_OP_lit22:
-	case DW_OP_lit23:
-	case DW_OP_lit24:
-	case DW_OP_lit25:
-	case DW_OP_lit26:
-	case DW_OP_lit27:
-	case DW_OP_lit28:
-	case DW_OP_lit29:
-	case DW_OP_lit30:
-	case DW_OP_lit31:
-	  result = op - DW_OP_lit0;
-	  result_val = value_from_ulongest (address_type, result);
-	  break;
-
 	case DW_OP_addr:
-	  result = extract_unsigned_integer (op_ptr,
-					     this->addr_size, byte_order);
-	  op_ptr += this->addr_size;
-	  /* Some versions of GCC emit DW_OP_addr before
-	     DW_OP_GNU_push_tls_address.  In this case the value is an
-	     index, not an address.  We don't support things like
-	     branching between the address and the TLS op.  */
-	  if (op_ptr >= op_end || *op_ptr != DW_OP_GNU_push_tls_address)
+	  result = insn.u;
+	  if (insn.u2)
 	    result += this->offset;
 	  result_val = value_from_ulongest (address_type, result);
 	  break;
 
 	case DW_OP_GNU_addr_index:
-	  op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	  result = this->get_addr_index (uoffset);
+	  result = this->get_addr_index (insn.u);
 	  result += this->offset;
 	  result_val = value_from_ulongest (address_type, result);
 	  break;
 	case DW_OP_GNU_const_index:
-	  op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	  result = this->get_addr_index (uoffset);
+	  result = this->get_addr_index (insn.u);
 	  result_val = value_from_ulongest (address_type, result);
 	  break;
 
-	case DW_OP_const1u:
-	  result = extract_unsigned_integer (op_ptr, 1, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 1;
-	  break;
-	case DW_OP_const1s:
-	  result = extract_signed_integer (op_ptr, 1, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 1;
-	  break;
-	case DW_OP_const2u:
-	  result = extract_unsigned_integer (op_ptr, 2, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 2;
-	  break;
-	case DW_OP_const2s:
-	  result = extract_signed_integer (op_ptr, 2, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 2;
-	  break;
-	case DW_OP_const4u:
-	  result = extract_unsigned_integer (op_ptr, 4, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 4;
-	  break;
-	case DW_OP_const4s:
-	  result = extract_signed_integer (op_ptr, 4, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 4;
-	  break;
-	case DW_OP_const8u:
-	  result = extract_unsigned_integer (op_ptr, 8, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 8;
-	  break;
-	case DW_OP_const8s:
-	  result = extract_signed_integer (op_ptr, 8, byte_order);
-	  result_val = value_from_ulongest (address_type, result);
-	  op_ptr += 8;
-	  break;
 	case DW_OP_constu:
-	  op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	  result = uoffset;
-	  result_val = value_from_ulongest (address_type, result);
-	  break;
-	case DW_OP_consts:
-	  op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
-	  result = offset;
-	  result_val = value_from_ulongest (address_type, result);
-	  break;
-
-	/* The DW_OP_reg operations are required to occur alone in
-	   location expressions.  */
-	case DW_OP_reg0:
-	case DW_OP_reg1:
-	case DW_OP_reg2:
-	case DW_OP_reg3:
-	case DW_OP_reg4:
-	case DW_OP_reg5:
-	case DW_OP_reg6:
-	case DW_OP_reg7:
-	case DW_OP_reg8:
-	case DW_OP_reg9:
-	case DW_OP_reg10:
-	case DW_OP_reg11:
-	case DW_OP_reg12:
-	case DW_OP_reg13:
-	case DW_OP_reg14:
-	case DW_OP_reg15:
-	case DW_OP_reg16:
-	case DW_OP_reg17:
-	case DW_OP_reg18:
-	case DW_OP_reg19:
-	case DW_OP_reg20:
-	case DW_OP_reg21:
-	case DW_OP_reg22:
-	case DW_OP_reg23:
-	case DW_OP_reg24:
-	case DW_OP_reg25:
-	case DW_OP_reg26:
-	case DW_OP_reg27:
-	case DW_OP_reg28:
-	case DW_OP_reg29:
-	case DW_OP_reg30:
-	case DW_OP_reg31:
-	  dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_reg");
-
-	  result = op - DW_OP_reg0;
-	  result_val = value_from_ulongest (address_type, result);
-	  this->location = DWARF_VALUE_REGISTER;
+	  result_val = value_from_ulongest (address_type, insn.u);
 	  break;
 
 	case DW_OP_regx:
-	  op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
-	  dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_regx");
-
-	  result = reg;
-	  result_val = value_from_ulongest (address_type, result);
+	  result_val = value_from_ulongest (address_type, insn.u);
 	  this->location = DWARF_VALUE_REGISTER;
 	  break;
 
 	case DW_OP_implicit_value:
-	  {
-	    uint64_t len;
-
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &len);
-	    if (op_ptr + len > op_end)
-	      error (_("DW_OP_implicit_value: too few bytes available."));
-	    this->len = len;
-	    this->data = op_ptr;
-	    this->location = DWARF_VALUE_LITERAL;
-	    op_ptr += len;
-	    dwarf_expr_require_composition (op_ptr, op_end,
-					    "DW_OP_implicit_value");
-	  }
+	  this->len = insn.u;
+	  this->data = insn.data;
+	  this->location = DWARF_VALUE_LITERAL;
 	  goto no_push;
 
 	case DW_OP_stack_value:
 	  this->location = DWARF_VALUE_STACK;
-	  dwarf_expr_require_composition (op_ptr, op_end, "DW_OP_stack_value");
 	  goto no_push;
 
 	case DW_OP_implicit_pointer:
-	case DW_OP_GNU_implicit_pointer:
-	  {
-	    int64_t len;
-
-	    if (this->ref_addr_size == -1)
-	      error (_("DWARF-2 expression error: DW_OP_implicit_pointer "
-		       "is not allowed in frame context"));
+	  /* The referred-to DIE of sect_offset kind.  */
+	  this->len = insn.u;
 
-	    /* The referred-to DIE of sect_offset kind.  */
-	    this->len = extract_unsigned_integer (op_ptr, this->ref_addr_size,
-						 byte_order);
-	    op_ptr += this->ref_addr_size;
-
-	    /* The byte offset into the data.  */
-	    op_ptr = safe_read_sleb128 (op_ptr, op_end, &len);
-	    result = (ULONGEST) len;
-	    result_val = value_from_ulongest (address_type, result);
+	  /* The byte offset into the data.  */
+	  result = (ULONGEST) insn.s;
+	  result_val = value_from_ulongest (address_type, result);
 
-	    this->location = DWARF_VALUE_IMPLICIT_POINTER;
-	    dwarf_expr_require_composition (op_ptr, op_end,
-					    "DW_OP_implicit_pointer");
-	  }
+	  this->location = DWARF_VALUE_IMPLICIT_POINTER;
 	  break;
 
-	case DW_OP_breg0:
-	case DW_OP_breg1:
-	case DW_OP_breg2:
-	case DW_OP_breg3:
-	case DW_OP_breg4:
-	case DW_OP_breg5:
-	case DW_OP_breg6:
-	case DW_OP_breg7:
-	case DW_OP_breg8:
-	case DW_OP_breg9:
-	case DW_OP_breg10:
-	case DW_OP_breg11:
-	case DW_OP_breg12:
-	case DW_OP_breg13:
-	case DW_OP_breg14:
-	case DW_OP_breg15:
-	case DW_OP_breg16:
-	case DW_OP_breg17:
-	case DW_OP_breg18:
-	case DW_OP_breg19:
-	case DW_OP_breg20:
-	case DW_OP_breg21:
-	case DW_OP_breg22:
-	case DW_OP_breg23:
-	case DW_OP_breg24:
-	case DW_OP_breg25:
-	case DW_OP_breg26:
-	case DW_OP_breg27:
-	case DW_OP_breg28:
-	case DW_OP_breg29:
-	case DW_OP_breg30:
-	case DW_OP_breg31:
-	  {
-	    op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
-	    result = this->read_addr_from_reg (op - DW_OP_breg0);
-	    result += offset;
-	    result_val = value_from_ulongest (address_type, result);
-	  }
-	  break;
 	case DW_OP_bregx:
-	  {
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
-	    op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
-	    result = this->read_addr_from_reg (reg);
-	    result += offset;
-	    result_val = value_from_ulongest (address_type, result);
-	  }
+	  result = this->read_addr_from_reg (insn.u);
+	  result += insn.s;
+	  result_val = value_from_ulongest (address_type, result);
 	  break;
 	case DW_OP_fbreg:
 	  {
 	    const gdb_byte *datastart;
 	    size_t datalen;
-
-	    op_ptr = safe_read_sleb128 (op_ptr, op_end, &offset);
-
-	    /* Rather than create a whole new context, we simply
-	       backup the current stack locally and install a new empty stack,
-	       then reset it afterwards, effectively erasing whatever the
-	       recursive call put there.  */
-	    std::vector<dwarf_stack_value> saved_stack = std::move (stack);
-	    stack.clear ();
+	    std::shared_ptr<const dwarf_expr_program> base_program;
 
 	    /* FIXME: cagney/2003-03-26: This code should be using
                get_frame_base_address(), and then implement a dwarf2
                specific this_base method.  */
 	    this->get_frame_base (&datastart, &datalen);
-	    eval (datastart, datalen);
-	    if (this->location == DWARF_VALUE_MEMORY)
-	      result = fetch_address (0);
-	    else if (this->location == DWARF_VALUE_REGISTER)
-	      result = this->read_addr_from_reg (value_as_long (fetch (0)));
-	    else
-	      error (_("Not implemented: computing frame "
-		       "base using explicit value operator"));
-	    result = result + offset;
+	    base_program = dwarf_get_program (this, datastart, datalen);
+
+	    if (!simple_frame_base (base_program.get (), &result))
+	      {
+		/* Rather than create a whole new context, we simply
+		   backup the current stack locally and install a new
+		   empty stack, then reset it afterwards, effectively
+		   erasing whatever the recursive call put there.  */
+		std::vector<dwarf_stack_value> saved_stack
+		  = std::move (stack);
+		stack.clear ();
+
+		eval_program (base_program.get ());
+		if (this->location == DWARF_VALUE_MEMORY)
+		  result = fetch_address (0);
+		else if (this->location == DWARF_VALUE_REGISTER)
+		  result
+		    = this->read_addr_from_reg (value_as_long (fetch (0)));
+		else
+		  error (_("Not implemented: computing frame "
+			   "base using explicit value operator"));
+
+		/* Restore the content of the original stack.  */
+		stack = std::move (saved_stack);
+	      }
+	    result = result + insn.s;
 	    result_val = value_from_ulongest (address_type, result);
 	    in_stack_memory = true;
 
-	    /* Restore the content of the original stack.  */
-	    stack = std::move (saved_stack);
-
 	    this->location = DWARF_VALUE_MEMORY;
 	  }
 	  break;
@@ -888,9 +1478,8 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  goto no_push;
 
 	case DW_OP_pick:
-	  offset = *op_ptr++;
-	  result_val = fetch (offset);
-	  in_stack_memory = fetch_in_stack_memory (offset);
+	  result_val = fetch (insn.u);
+	  in_stack_memory = fetch_in_stack_memory (insn.u);
 	  break;
 	  
 	case DW_OP_swap:
@@ -925,22 +1514,19 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	    goto no_push;
 	  }
 
-	case DW_OP_deref:
 	case DW_OP_deref_size:
 	case DW_OP_deref_type:
-	case DW_OP_GNU_deref_type:
 	  {
-	    int addr_size = (op == DW_OP_deref ? this->addr_size : *op_ptr++);
+	    int addr_size = insn.u;
 	    gdb_byte *buf = (gdb_byte *) alloca (addr_size);
 	    CORE_ADDR addr = fetch_address (0);
 	    struct type *type;
 
 	    pop ();
 
-	    if (op == DW_OP_deref_type || op == DW_OP_GNU_deref_type)
+	    if (op == DW_OP_deref_type)
 	      {
-		op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-		cu_offset type_die_cu_off = (cu_offset) uoffset;
+		cu_offset type_die_cu_off = (cu_offset) insn.u2;
 		type = get_base_type (type_die_cu_off, 0);
 	      }
 	    else
@@ -990,8 +1576,7 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	      case DW_OP_plus_uconst:
 		dwarf_require_integral (value_type (result_val));
 		result = value_as_long (result_val);
-		op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
-		result += reg;
+		result += insn.u;
 		result_val = value_from_ulongest (address_type, result);
 		break;
 	      }
@@ -1160,7 +1745,6 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  in_stack_memory = true;
 	  break;
 
-	case DW_OP_GNU_push_tls_address:
 	case DW_OP_form_tls_address:
 	  /* Variable is at a constant offset in the thread-local
 	  storage block into the objfile for the current thread and
@@ -1177,21 +1761,17 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  break;
 
 	case DW_OP_skip:
-	  offset = extract_signed_integer (op_ptr, 2, byte_order);
-	  op_ptr += 2;
-	  op_ptr += offset;
+	  i = insn.target;
 	  goto no_push;
 
 	case DW_OP_bra:
 	  {
 	    struct value *val;
 
-	    offset = extract_signed_integer (op_ptr, 2, byte_order);
-	    op_ptr += 2;
 	    val = fetch (0);
 	    dwarf_require_integral (value_type (val));
 	    if (value_as_long (val) != 0)
-	      op_ptr += offset;
+	      i = insn.target;
 	    pop ();
 	  }
 	  goto no_push;
@@ -1200,12 +1780,13 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  goto no_push;
 
         case DW_OP_piece:
+        case DW_OP_bit_piece:
           {
-            uint64_t size;
-
             /* Record the piece.  */
-            op_ptr = safe_read_uleb128 (op_ptr, op_end, &size);
-	    add_piece (8 * size, 0);
+	    if (op == DW_OP_piece)
+	      add_piece (8 * insn.u, 0);
+	    else
+	      add_piece (insn.u, insn.u2);
 
             /* Pop off the address/regnum, and reset the location
 	       type.  */
@@ -1216,96 +1797,29 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
           }
           goto no_push;
 
-	case DW_OP_bit_piece:
-	  {
-	    uint64_t size, offset;
-
-            /* Record the piece.  */
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &size);
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &offset);
-	    add_piece (size, offset);
-
-            /* Pop off the address/regnum, and reset the location
-	       type.  */
-	    if (this->location != DWARF_VALUE_LITERAL
-		&& this->location != DWARF_VALUE_OPTIMIZED_OUT)
-	      pop ();
-            this->location = DWARF_VALUE_MEMORY;
-	  }
-	  goto no_push;
-
 	case DW_OP_GNU_uninit:
-	  if (op_ptr != op_end)
-	    error (_("DWARF-2 expression error: DW_OP_GNU_uninit must always "
-		   "be the very last op."));
-
 	  this->initialized = 0;
 	  goto no_push;
 
-	case DW_OP_call2:
-	  {
-	    cu_offset cu_off
-	      = (cu_offset) extract_unsigned_integer (op_ptr, 2, byte_order);
-	    op_ptr += 2;
-	    this->dwarf_call (cu_off);
-	  }
-	  goto no_push;
-
 	case DW_OP_call4:
-	  {
-	    cu_offset cu_off
-	      = (cu_offset) extract_unsigned_integer (op_ptr, 4, byte_order);
-	    op_ptr += 4;
-	    this->dwarf_call (cu_off);
-	  }
+	  this->dwarf_call ((cu_offset) insn.u);
 	  goto no_push;
 	
 	case DW_OP_entry_value:
-	case DW_OP_GNU_entry_value:
 	  {
-	    uint64_t len;
-	    CORE_ADDR deref_size;
 	    union call_site_parameter_u kind_u;
 
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &len);
-	    if (op_ptr + len > op_end)
-	      error (_("DW_OP_entry_value: too few bytes available."));
-
-	    kind_u.dwarf_reg = dwarf_block_to_dwarf_reg (op_ptr, op_ptr + len);
-	    if (kind_u.dwarf_reg != -1)
-	      {
-		op_ptr += len;
-		this->push_dwarf_reg_entry_value (CALL_SITE_PARAMETER_DWARF_REG,
-						  kind_u,
-						  -1 /* deref_size */);
-		goto no_push;
-	      }
-
-	    kind_u.dwarf_reg = dwarf_block_to_dwarf_reg_deref (op_ptr,
-							       op_ptr + len,
-							       &deref_size);
-	    if (kind_u.dwarf_reg != -1)
-	      {
-		if (deref_size == -1)
-		  deref_size = this->addr_size;
-		op_ptr += len;
-		this->push_dwarf_reg_entry_value (CALL_SITE_PARAMETER_DWARF_REG,
-						  kind_u, deref_size);
-		goto no_push;
-	      }
-
-	    error (_("DWARF-2 expression error: DW_OP_entry_value is "
-		     "supported only for single DW_OP_reg* "
-		     "or for DW_OP_breg*(0)+DW_OP_deref*"));
+	    kind_u.dwarf_reg = insn.u;
+	    this->push_dwarf_reg_entry_value (CALL_SITE_PARAMETER_DWARF_REG,
+					      kind_u, insn.s);
 	  }
+	  goto no_push;
 
 	case DW_OP_GNU_parameter_ref:
 	  {
 	    union call_site_parameter_u kind_u;
 
-	    kind_u.param_cu_off
-	      = (cu_offset) extract_unsigned_integer (op_ptr, 4, byte_order);
-	    op_ptr += 4;
+	    kind_u.param_cu_off = (cu_offset) insn.u;
 	    this->push_dwarf_reg_entry_value (CALL_SITE_PARAMETER_PARAM_OFFSET,
 					      kind_u,
 					      -1 /* deref_size */);
@@ -1313,48 +1827,29 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  goto no_push;
 
 	case DW_OP_const_type:
-	case DW_OP_GNU_const_type:
 	  {
-	    int n;
-	    const gdb_byte *data;
 	    struct type *type;
 
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	    cu_offset type_die_cu_off = (cu_offset) uoffset;
-
-	    n = *op_ptr++;
-	    data = op_ptr;
-	    op_ptr += n;
-
-	    type = get_base_type (type_die_cu_off, n);
-	    result_val = value_from_contents (type, data);
+	    type = get_base_type ((cu_offset) insn.u, insn.u2);
+	    result_val = value_from_contents (type, insn.data);
 	  }
 	  break;
 
 	case DW_OP_regval_type:
-	case DW_OP_GNU_regval_type:
 	  {
 	    struct type *type;
 
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &reg);
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	    cu_offset type_die_cu_off = (cu_offset) uoffset;
-
-	    type = get_base_type (type_die_cu_off, 0);
-	    result_val = this->get_reg_value (type, reg);
+	    type = get_base_type ((cu_offset) insn.u2, 0);
+	    result_val = this->get_reg_value (type, insn.u);
 	  }
 	  break;
 
 	case DW_OP_convert:
-	case DW_OP_GNU_convert:
 	case DW_OP_reinterpret:
-	case DW_OP_GNU_reinterpret:
 	  {
+	    cu_offset type_die_cu_off = (cu_offset) insn.u;
 	    struct type *type;
 
-	    op_ptr = safe_read_uleb128 (op_ptr, op_end, &uoffset);
-	    cu_offset type_die_cu_off = (cu_offset) uoffset;
-
 	    if (to_underlying (type_die_cu_off) == 0)
 	      type = address_type;
 	    else
@@ -1363,7 +1858,7 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	    result_val = fetch (0);
 	    pop ();
 
-	    if (op == DW_OP_convert || op == DW_OP_GNU_convert)
+	    if (op == DW_OP_convert)
 	      result_val = value_cast (type, result_val);
 	    else if (type == value_type (result_val))
 	      {
@@ -1386,7 +1881,15 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
 	  break;
 
 	default:
-	  error (_("Unhandled dwarf expression opcode 0x%x"), op);
+	  {
+	    struct dwarf_expr_insn bad;
+
+	    /* The operation could not be decoded.  Decode it again to
+	       report why.  */
+	    dwarf_decode_insn (program, insn.start, &bad);
+	    internal_error (__FILE__, __LINE__,
+			    _("Unexpected dwarf expression opcode 0x%x"), op);
+	  }
 	}
 
       /* Most things push a result value.  */
@@ -1406,9 +1909,85 @@ dwarf_expr_context::execute_stack_op (const gdb_byte *op_ptr,
   gdb_assert (this->recursion_depth >= 0);
 }
 
+#if GDB_SELF_TEST
+
+namespace selftests {
+
+/* Unit test of dwarf_decode_program.  */
+
+static void
+dwarf_decode_program_test ()
+{
+  /* A single DW_OP_fbreg is decoded with its operand.  */
+  static const gdb_byte fbreg[] = { DW_OP_fbreg, 0x70 };
+  std::unique_ptr<dwarf_expr_program> program
+    = dwarf_decode_program (fbreg, sizeof (fbreg), 8, 8, BFD_ENDIAN_LITTLE);
+
+  SELF_CHECK (program->kind == DWARF_EXPR_GENERIC);
+  SELF_CHECK (program->insns.size () == 1);
+  SELF_CHECK (program->insns[0].op == DW_OP_fbreg);
+  SELF_CHECK (program->insns[0].s == -16);
+  SELF_CHECK (program->insns[0].next == 1);
+
+  /* Frame bases that DW_OP_fbreg evaluates directly.  */
+  static const gdb_byte cfa[] = { DW_OP_call_frame_cfa };
+  program = dwarf_decode_program (cfa, sizeof (cfa), 8, 8,
+				  BFD_ENDIAN_LITTLE);
+  SELF_CHECK (program->kind == DWARF_EXPR_CFA);
+
+  static const gdb_byte breg[] = { DW_OP_breg6, 0x10 };
+  program = dwarf_decode_program (breg, sizeof (breg), 8, 8,
+				  BFD_ENDIAN_LITTLE);
+  SELF_CHECK (program->kind == DWARF_EXPR_BREG);
+  SELF_CHECK (program->insns[0].op == DW_OP_bregx);
+  SELF_CHECK (program->insns[0].u == 6);
+  SELF_CHECK (program->insns[0].s == 16);
+
+  /* DW_OP_skip jumps into the operand of DW_OP_const1u, which then
+     decodes as DW_OP_lit1.  The bytes after the skip are invalid, but
+     are never evaluated.  */
+  static const gdb_byte branch[] =
+    {
+      DW_OP_const1u, DW_OP_lit1,	/* 0: const1u 0x31 */
+      DW_OP_skip, 0xfc, 0xff,		/* 2: skip -4 */
+      0xff				/* 5: invalid */
+    };
+  program = dwarf_decode_program (branch, sizeof (branch), 8, 8,
+				  BFD_ENDIAN_LITTLE);
+  SELF_CHECK (program->insns.size () == 3);
+  SELF_CHECK (program->insns[0].op == DW_OP_constu);
+  SELF_CHECK (program->insns[0].u == DW_OP_lit1);
+  SELF_CHECK (program->insns[0].next == 2);
+  SELF_CHECK (program->insns[1].start == branch + 1);
+  SELF_CHECK (program->insns[1].op == DW_OP_constu);
+  SELF_CHECK (program->insns[1].u == 1);
+  SELF_CHECK (program->insns[1].next == 2);
+  SELF_CHECK (program->insns[2].op == DW_OP_skip);
+  SELF_CHECK (program->insns[2].target == 1);
+
+  /* Invalid operations are only reported when they are evaluated.  */
+  static const gdb_byte invalid[] = { DW_OP_lit0, 0xff };
+  program = dwarf_decode_program (invalid, sizeof (invalid), 8, 8,
+				  BFD_ENDIAN_LITTLE);
+  SELF_CHECK (program->insns.size () == 2);
+  SELF_CHECK (program->insns[1].op == DW_OP_hi_user);
+  SELF_CHECK (program->insns[1].next == 2);
+}
+
+} // namespace selftests
+#endif /* GDB_SELF_TEST */
+
 void
 _initialize_dwarf2expr (void)
 {
   dwarf_arch_cookie
     = gdbarch_data_register_post_init (dwarf_gdbarch_types_init);
+  dwarf_expr_program_cache_key
+    = register_objfile_data_with_cleanup (NULL,
+					  dwarf_expr_program_cache_free);
+
+#if GDB_SELF_TEST
+  selftests::register_test ("dwarf_decode_program",
+			    selftests::dwarf_decode_program_test);
+#endif
 }
@@ -113,6 +113,8 @@ struct dwarf_stack_value
   bool in_stack_memory;
 };
 
+struct dwarf_expr_program;
+
 /* The expression evaluator works with a dwarf_expr_context, describing
    its current state and its callbacks.  */
 struct dwarf_expr_context
@@ -184,6 +186,11 @@ struct dwarf_expr_context
      two cases need to be handled separately.)  */
   std::vector<dwarf_expr_piece> pieces;
 
+  /* If not NULL, the expressions evaluated come from the debug
+     information of this objfile, and their decoded form is kept with
+     it.  */
+  struct objfile *objfile;
+
   /* Return the value of register number REGNUM (a DWARF register number),
      read as an address.  */
   virtual CORE_ADDR read_addr_from_reg (int regnum) = 0;
@@ -252,7 +259,10 @@ private:
   void push (struct value *value, bool in_stack_memory);
   bool stack_empty_p () const;
   void add_piece (ULONGEST size, ULONGEST offset);
-  void execute_stack_op (const gdb_byte *op_ptr, const gdb_byte *op_end);
+  void eval_program (const struct dwarf_expr_program *program);
+  void execute_stack_op (const struct dwarf_expr_program *program);
+  bool simple_frame_base (const struct dwarf_expr_program *program,
+			  CORE_ADDR *base);
   void pop ();
 };
 
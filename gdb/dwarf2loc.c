@@ -53,7 +53,8 @@ static struct value *dwarf2_evaluate_loc_desc_full (struct type *type,
 						    size_t size,
 						    struct dwarf2_per_cu_data *per_cu,
 						    struct type *subobj_type,
-						    LONGEST subobj_byte_offset);
+						    LONGEST subobj_byte_offset,
+						    bool temporary);
 
 static struct call_site_parameter *dwarf_expr_reg_to_entry_parameter
     (struct frame_info *frame,
@@ -652,9 +653,10 @@ class dwarf_evaluate_loc_desc : public dwarf_expr_context
     scoped_restore save_obj_addr = make_scoped_restore (&this->obj_address,
 							(CORE_ADDR) 0);
 
+    scoped_restore save_objfile = make_scoped_restore (&this->objfile);
+    this->objfile = dwarf2_per_cu_objfile (per_cu);
     scoped_restore save_arch = make_scoped_restore (&this->gdbarch);
-    this->gdbarch
-      = get_objfile_arch (dwarf2_per_cu_objfile (per_cu));
+    this->gdbarch = get_objfile_arch (this->objfile);
     scoped_restore save_addr_size = make_scoped_restore (&this->addr_size);
     this->addr_size = dwarf2_per_cu_addr_size (per_cu);
     scoped_restore save_offset = make_scoped_restore (&this->offset);
@@ -1337,7 +1339,8 @@ dwarf_entry_parameter_to_value (struct call_site_parameter *parameter,
   memcpy (data, data_src, size);
   data[size] = DW_OP_stack_value;
 
-  return dwarf2_evaluate_loc_desc (type, caller_frame, data, size + 1, per_cu);
+  return dwarf2_evaluate_loc_desc_full (type, caller_frame, data, size + 1,
+					per_cu, NULL, 0, true);
 }
 
 /* VALUE must be of type lval_computed with entry_data_value_funcs.  Perform
@@ -2162,7 +2165,7 @@ indirect_synthetic_pointer (sect_offset die, LONGEST byte_offset,
     return dwarf2_evaluate_loc_desc_full (orig_type, frame, baton.data,
 					  baton.size, baton.per_cu,
 					  TYPE_TARGET_TYPE (type),
-					  byte_offset);
+					  byte_offset, false);
   else
     return fetch_const_value_from_synthetic_pointer (die, byte_offset, per_cu,
 						     type);
@@ -2320,14 +2323,17 @@ static const struct lval_funcs pieced_value_funcs = {
    SIZE, to find the current location of variable of TYPE in the
    context of FRAME.  If SUBOBJ_TYPE is non-NULL, return instead the
    location of the subobject of type SUBOBJ_TYPE at byte offset
-   SUBOBJ_BYTE_OFFSET within the variable of type TYPE.  */
+   SUBOBJ_BYTE_OFFSET within the variable of type TYPE.  TEMPORARY is
+   true if DATA is a temporary buffer rather than part of PER_CU's
+   debug information; its decoded form is then not kept.  */
 
 static struct value *
 dwarf2_evaluate_loc_desc_full (struct type *type, struct frame_info *frame,
 			       const gdb_byte *data, size_t size,
 			       struct dwarf2_per_cu_data *per_cu,
 			       struct type *subobj_type,
-			       LONGEST subobj_byte_offset)
+			       LONGEST subobj_byte_offset,
+			       bool temporary)
 {
   struct value *retval;
   struct objfile *objfile = dwarf2_per_cu_objfile (per_cu);
@@ -2350,6 +2356,7 @@ dwarf2_evaluate_loc_desc_full (struct type *type, struct frame_info *frame,
 
   scoped_value_mark free_values;
 
+  ctx.objfile = temporary ? NULL : objfile;
   ctx.gdbarch = get_objfile_arch (objfile);
   ctx.addr_size = dwarf2_per_cu_addr_size (per_cu);
   ctx.ref_addr_size = dwarf2_per_cu_ref_addr_size (per_cu);
@@ -2541,7 +2548,7 @@ dwarf2_evaluate_loc_desc (struct type *type, struct frame_info *frame,
 			  struct dwarf2_per_cu_data *per_cu)
 {
   return dwarf2_evaluate_loc_desc_full (type, frame, data, size, per_cu,
-					NULL, 0);
+					NULL, 0, false);
 }
 
 /* Evaluates a dwarf expression and stores the result in VAL, expecting
@@ -2569,6 +2576,7 @@ dwarf2_locexpr_baton_eval (const struct dwarf2_locexpr_baton *dlbaton,
 
   objfile = dwarf2_per_cu_objfile (dlbaton->per_cu);
 
+  ctx.objfile = objfile;
   ctx.gdbarch = get_objfile_arch (objfile);
   ctx.addr_size = dwarf2_per_cu_addr_size (dlbaton->per_cu);
   ctx.ref_addr_size = dwarf2_per_cu_ref_addr_size (dlbaton->per_cu);
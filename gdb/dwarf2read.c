@@ -68,12 +68,14 @@
 #include "source.h"
 #include "filestuff.h"
 #include "build-id.h"
+#include "index-cache.h"
 #include "namespace.h"
 #include "common/gdb_unlinker.h"
 #include "common/function-view.h"
 #include "common/gdb_optional.h"
 #include "common/underlying.h"
 #include "common/byte-vector.h"
+#include "common/parallel-for.h"
 #include "filename-seen-cache.h"
 #include "producer.h"
 #include <fcntl.h>
@@ -393,6 +395,10 @@ public:
   /* The mapped index, or NULL if .gdb_index is missing or not being used.  */
   mapped_index *index_table = NULL;
 
+  /* If the index was read from the index cache, this holds its
+     contents; INDEX_TABLE points into it.  */
+  std::unique_ptr<index_cache_resource> index_cache_res;
+
   /* When using index_table, this keeps track of all quick_file_names entries.
      TUs typically share line table entries with a CU, so we maintain a
      separate table of all line table entries to support the sharing.
@@ -606,6 +612,12 @@ struct dwarf2_cu
   /* Full DIEs if read in.  */
   struct die_info *dies;
 
+  /* The C++ linkage names of DIES, demangled ahead of time by
+     demangle_queued_linkage_names; a hash table of
+     struct demangled_linkage_name.  NULL if that was not done for
+     this CU.  */
+  htab_t demangled_names;
+
   /* A set of pointers to dwarf2_per_cu_data objects for compilation
      units referenced by this one.  Only set during full symbol processing;
      partial symbol tables do not have dependencies.  */
@@ -655,6 +667,10 @@ struct dwarf2_cu
      whether the DW_AT_ranges attribute came from the skeleton or DWO.  */
   ULONGEST ranges_base;
 
+  /* Non-NULL while the partial DIEs of this CU are read ahead by a
+     worker thread; see preloaded_comp_unit.  */
+  struct preloaded_comp_unit *preload;
+
   /* Mark used when releasing cached dies.  */
   unsigned int mark : 1;
 
@@ -1333,6 +1349,11 @@ struct partial_die_info
     /* Flag set if spec_offset uses DW_FORM_GNU_ref_alt.  */
     unsigned int spec_is_dwz : 1;
 
+    /* Flag set if NAME was canonicalized while the CU was read ahead,
+       and so still lives on the comp_unit_obstack instead of the
+       objfile's storage obstack.  */
+    unsigned int name_on_cu_obstack : 1;
+
     /* The name of this DIE.  Normally the value of DW_AT_name, but
        sometimes a default name for unnamed DIEs.  */
     const char *name;
@@ -1375,6 +1396,74 @@ struct partial_die_info
     struct partial_die_info *die_parent, *die_child, *die_sibling;
   };
 
+/* A partial symbol that load_partial_dies would have added directly,
+   recorded while the CU was read ahead.  */
+
+struct deferred_partial_symbol
+{
+  /* The name, and whether it lives on the comp_unit_obstack.  */
+  const char *name;
+  bool name_on_cu_obstack;
+
+  enum address_class aclass;
+  bool global;
+};
+
+/* A compilation unit whose partial DIEs dwarf2_build_psymtabs_hard
+   reads ahead, on a worker thread, before building its psymtab.
+
+   The CU header and top-level DIE are read on the main thread.  A
+   worker thread then runs load_partial_dies, which only allocates from
+   the CU's own comp_unit_obstack.  Whatever load_partial_dies would
+   otherwise do to objfile-wide state -- copying canonicalized names to
+   the objfile, adding the partial symbols of the DIEs it does not keep,
+   and issuing complaints -- is recorded here instead, and replayed by
+   finish_preloaded_partial_dies when the main thread builds the CU's
+   psymtab.  The CUs are still processed in order, so the psymtabs come
+   out the same whatever the number of threads.  */
+
+struct preloaded_comp_unit
+{
+  preloaded_comp_unit () = default;
+  ~preloaded_comp_unit ();
+
+  DISABLE_COPY_AND_ASSIGN (preloaded_comp_unit);
+
+  /* The CU.  It is owned by this object, and not linked to its
+     per_cu, until the main thread takes it.  NULL if the CU is not
+     read ahead.  */
+  struct dwarf2_cu *cu = nullptr;
+
+  /* What init_cutu_and_read_dies passed to the die_reader_func.  */
+  struct die_reader_specs reader;
+  const gdb_byte *info_ptr = nullptr;
+  struct die_info *comp_unit_die = nullptr;
+
+  /* The value of per_cu->load_all_dies when the DIEs were read.  */
+  bool load_all = false;
+
+  /* Set once load_partial_dies has returned or thrown.  */
+  bool loaded = false;
+
+  /* What load_partial_dies returned.  */
+  struct partial_die_info *first_die = nullptr;
+
+  /* If load_partial_dies threw an exception, what it was, to be
+     rethrown on the main thread.  */
+  bool failed = false;
+  enum return_reason reason = RETURN_ERROR;
+  enum errors error = GDB_NO_ERROR;
+  std::string message;
+
+  /* The symbols load_partial_dies added, in order.  */
+  std::vector<deferred_partial_symbol> psymbols;
+
+  /* The complaints issued while reading the top-level DIE, and while
+     loading the partial DIEs.  */
+  deferred_complaints header_complaints;
+  deferred_complaints load_complaints;
+};
+
 /* This data structure holds the information of an abbrev.  */
 struct abbrev_info
   {
@@ -1656,6 +1745,9 @@ static void dwarf2_free_abbrev_table (void *);
 
 static unsigned int peek_abbrev_code (bfd *, const gdb_byte *);
 
+static struct partial_die_info *finish_preloaded_partial_dies
+  (struct dwarf2_cu *, struct preloaded_comp_unit *);
+
 static struct partial_die_info *load_partial_dies
   (const struct die_reader_specs *, const gdb_byte *, int);
 
@@ -3319,32 +3411,22 @@ find_slot_in_mapped_hash (struct mapped_index *index, const char *name,
    Returns 1 if all went well, 0 otherwise.  */
 
 static int
-read_index_from_section (struct objfile *objfile,
-			 const char *filename,
-			 int deprecated_ok,
-			 struct dwarf2_section_info *section,
-			 struct mapped_index *map,
-			 const gdb_byte **cu_list,
-			 offset_type *cu_list_elements,
-			 const gdb_byte **types_list,
-			 offset_type *types_list_elements)
+read_index_from_buffer (struct objfile *objfile,
+			const char *filename,
+			int deprecated_ok,
+			gdb::array_view<const gdb_byte> buffer,
+			struct mapped_index *map,
+			const gdb_byte **cu_list,
+			offset_type *cu_list_elements,
+			const gdb_byte **types_list,
+			offset_type *types_list_elements)
 {
   const gdb_byte *addr;
   offset_type version;
   offset_type *metadata;
   int i;
 
-  if (dwarf2_section_empty_p (section))
-    return 0;
-
-  /* Older elfutils strip versions could keep the section in the main
-     executable while splitting it for the separate debug info file.  */
-  if ((get_section_flags (section) & SEC_HAS_CONTENTS) == 0)
-    return 0;
-
-  dwarf2_read_section (objfile, section);
-
-  addr = section->buffer;
+  addr = buffer.data ();
   /* Version check.  */
   version = MAYBE_SWAP (*(offset_type *) addr);
   /* Versions earlier than 3 emitted every copy of a psymbol.  This
@@ -3398,7 +3480,7 @@ to use the section anyway."),
     return 0;
 
   map->version = version;
-  map->total_size = section->size;
+  map->total_size = buffer.size ();
 
   metadata = (offset_type *) (addr + sizeof (offset_type));
 
@@ -3430,6 +3512,63 @@ to use the section anyway."),
   return 1;
 }
 
+/* Like read_index_from_buffer, but read the index from SECTION, the
+   .gdb_index section of OBJFILE or of its .dwz file.  */
+
+static int
+read_index_from_section (struct objfile *objfile,
+			 const char *filename,
+			 int deprecated_ok,
+			 struct dwarf2_section_info *section,
+			 struct mapped_index *map,
+			 const gdb_byte **cu_list,
+			 offset_type *cu_list_elements,
+			 const gdb_byte **types_list,
+			 offset_type *types_list_elements)
+{
+  if (dwarf2_section_empty_p (section))
+    return 0;
+
+  /* Older elfutils strip versions could keep the section in the main
+     executable while splitting it for the separate debug info file.  */
+  if ((get_section_flags (section) & SEC_HAS_CONTENTS) == 0)
+    return 0;
+
+  dwarf2_read_section (objfile, section);
+
+  gdb::array_view<const gdb_byte> buffer (section->buffer, section->size);
+  return read_index_from_buffer (objfile, filename, deprecated_ok, buffer,
+				 map, cu_list, cu_list_elements,
+				 types_list, types_list_elements);
+}
+
+/* Like read_index_from_buffer, but look for the index of OBJFILE in
+   the index cache.  */
+
+static int
+read_index_from_cache (struct objfile *objfile,
+		       struct mapped_index *map,
+		       const gdb_byte **cu_list,
+		       offset_type *cu_list_elements,
+		       const gdb_byte **types_list,
+		       offset_type *types_list_elements)
+{
+  const bfd_build_id *build_id = build_id_bfd_get (objfile->obfd);
+  if (build_id == NULL)
+    return 0;
+
+  gdb::array_view<const gdb_byte> buffer
+    = global_index_cache.lookup_gdb_index (build_id,
+					   &dwarf2_per_objfile->index_cache_res);
+  if (buffer.empty ())
+    return 0;
+
+  return read_index_from_buffer (objfile, objfile_name (objfile),
+				 use_deprecated_index_sections, buffer,
+				 map, cu_list, cu_list_elements,
+				 types_list, types_list_elements);
+}
+
 
 /* Read the index file.  If everything went ok, initialize the "quick"
    elements of all the CUs and return 1.  Otherwise, return 0.  */
@@ -3442,11 +3581,32 @@ dwarf2_read_index (struct objfile *objfile)
   offset_type cu_list_elements, types_list_elements, dwz_list_elements = 0;
   struct dwz_file *dwz;
 
-  if (!read_index_from_section (objfile, objfile_name (objfile),
-				use_deprecated_index_sections,
-				&dwarf2_per_objfile->gdb_index, &local_map,
-				&cu_list, &cu_list_elements,
-				&types_list, &types_list_elements))
+  if (!dwarf2_section_empty_p (&dwarf2_per_objfile->gdb_index))
+    {
+      if (!read_index_from_section (objfile, objfile_name (objfile),
+				    use_deprecated_index_sections,
+				    &dwarf2_per_objfile->gdb_index,
+				    &local_map, &cu_list, &cu_list_elements,
+				    &types_list, &types_list_elements))
+	return 0;
+    }
+  /* Indices of objfiles using a .dwz file would have to come with an
+     index for the .dwz file as well, which the cache does not
+     handle.  */
+  else if (global_index_cache.enabled ()
+	   && dwarf2_get_dwz_file () == NULL)
+    {
+      if (!read_index_from_cache (objfile, &local_map,
+				  &cu_list, &cu_list_elements,
+				  &types_list, &types_list_elements))
+	{
+	  global_index_cache.miss ();
+	  return 0;
+	}
+
+      global_index_cache.hit ();
+    }
+  else
     return 0;
 
   /* Don't use the index if it's empty.  */
@@ -5336,6 +5496,11 @@ dwarf2_build_psymtabs (struct objfile *objfile)
       psymtab_discarder psymtabs (objfile);
       dwarf2_build_psymtabs_hard (objfile);
       psymtabs.keep ();
+
+      /* Save an index for next time, if the index cache is enabled;
+	 see dwarf2_read_index.  */
+      if (dwarf2_get_dwz_file () == NULL)
+	global_index_cache.store (objfile);
     }
   CATCH (except, RETURN_MASK_ERROR)
     {
@@ -6734,8 +6899,12 @@ init_cutu_and_read_dies (struct dwarf2_per_cu_data *this_cu,
 	  discard_cleanups (free_cu_cleanup);
 
 	  /* We can only discard free_cu_cleanup and all subsequent cleanups.
-	     So we have to manually free the abbrev table.  */
-	  dwarf2_free_abbrev_table (cu);
+	     So we have to manually free the abbrev table, unless it is
+	     the caller's.  */
+	  if (abbrev_table != NULL && cu->abbrev_table == abbrev_table)
+	    cu->abbrev_table = NULL;
+	  else
+	    dwarf2_free_abbrev_table (cu);
 
 	  /* Link this CU into read_in_chain.  */
 	  this_cu->cu->read_in_chain = dwarf2_per_objfile->read_in_chain;
@@ -7033,6 +7202,11 @@ struct process_psymtab_comp_unit_data
      language.  */
 
   enum language pretend_language;
+
+  /* If the CU's partial DIEs were read ahead, the result.  The CU was
+     already prepared then.  */
+
+  struct preloaded_comp_unit *preloaded;
 };
 
 /* die_reader_func for process_psymtab_comp_unit.  */
@@ -7061,7 +7235,8 @@ process_psymtab_comp_unit_reader (const struct die_reader_specs *reader,
 
   gdb_assert (! per_cu->is_debug_types);
 
-  prepare_one_comp_unit (cu, comp_unit_die, info->pretend_language);
+  if (info->preloaded == NULL)
+    prepare_one_comp_unit (cu, comp_unit_die, info->pretend_language);
 
   cu->list_in_scope = &file_symbols;
 
@@ -7104,7 +7279,10 @@ process_psymtab_comp_unit_reader (const struct die_reader_specs *reader,
       lowpc = ((CORE_ADDR) -1);
       highpc = ((CORE_ADDR) 0);
 
-      first_die = load_partial_dies (reader, info_ptr, 1);
+      if (info->preloaded != NULL)
+	first_die = finish_preloaded_partial_dies (cu, info->preloaded);
+      else
+	first_die = load_partial_dies (reader, info_ptr, 1);
 
       scan_partial_symbols (first_die, &lowpc, &highpc,
 			    cu_bounds_kind <= PC_BOUNDS_INVALID, cu);
@@ -7167,12 +7345,15 @@ process_psymtab_comp_unit_reader (const struct die_reader_specs *reader,
 }
 
 /* Subroutine of dwarf2_build_psymtabs_hard to simplify it.
-   Process compilation unit THIS_CU for a psymtab.  */
+   Process compilation unit THIS_CU for a psymtab.
+   ABBREV_TABLE, if non-NULL, is the already read abbrev table of
+   THIS_CU; the caller keeps ownership of it.  */
 
 static void
 process_psymtab_comp_unit (struct dwarf2_per_cu_data *this_cu,
 			   int want_partial_unit,
-			   enum language pretend_language)
+			   enum language pretend_language,
+			   struct abbrev_table *abbrev_table)
 {
   /* If this compilation unit was already read in, free the
      cached copy in order to read it in again.	This is
@@ -7190,7 +7371,8 @@ process_psymtab_comp_unit (struct dwarf2_per_cu_data *this_cu,
       process_psymtab_comp_unit_data info;
       info.want_partial_unit = want_partial_unit;
       info.pretend_language = pretend_language;
-      init_cutu_and_read_dies (this_cu, NULL, 0, 0,
+      info.preloaded = NULL;
+      init_cutu_and_read_dies (this_cu, abbrev_table, 0, 0,
 			       process_psymtab_comp_unit_reader, &info);
     }
 
@@ -7536,6 +7718,389 @@ set_partial_user (struct objfile *objfile)
     }
 }
 
+/* The maximum number of compilation units dwarf2_build_psymtabs_hard
+   reads ahead, and the .debug_info size at which it stops adding units
+   to a batch.  These bound the memory used by units whose psymtab has
+   not been built yet.  */
+#define PSYMTAB_READ_AHEAD_CUS 256
+#define PSYMTAB_READ_AHEAD_BYTES (64 * 1024 * 1024)
+
+preloaded_comp_unit::~preloaded_comp_unit ()
+{
+  /* The CU is not linked to its per_cu, so free_heap_comp_unit cannot
+     be used.  */
+  if (cu != NULL)
+    {
+      obstack_free (&cu->comp_unit_obstack, NULL);
+      xfree (cu);
+    }
+}
+
+/* A batch of compilation units, read ahead using the worker threads.
+   The abbrev tables of all the units are read, and, if there is more
+   than one thread, so are the partial DIEs of most of them; see
+   preloaded_comp_unit.  Everything is freed when this object is
+   destroyed.  */
+
+struct comp_unit_batch
+{
+  comp_unit_batch () = default;
+
+  ~comp_unit_batch ()
+  {
+    clear ();
+  }
+
+  DISABLE_COPY_AND_ASSIGN (comp_unit_batch);
+
+  /* Read ahead the compilation units starting with the one with index
+     BEGIN.  Return the index of the first unit not in the batch.  */
+  int read (int begin);
+
+  /* Return the abbrev table of the compilation unit with index I, or
+     NULL if it was not read ahead.  */
+  struct abbrev_table *abbrev_table (int i) const
+  {
+    return tables[i - first];
+  }
+
+  /* Return the read ahead partial DIEs of the compilation unit with
+     index I, or NULL if it must be processed the usual way.  */
+  struct preloaded_comp_unit *preloaded (int i);
+
+  /* Free everything.  */
+  void clear ()
+  {
+    units.reset ();
+    for (struct abbrev_table *table : tables)
+      if (table != NULL)
+	abbrev_table_free (table);
+    tables.clear ();
+  }
+
+  /* The index of the first compilation unit of the batch.  */
+  int first = 0;
+
+  /* The abbrev tables, indexed by compilation unit index minus FIRST.  */
+  std::vector<struct abbrev_table *> tables;
+
+  /* Likewise for the read ahead partial DIEs, if any.  */
+  std::unique_ptr<preloaded_comp_unit[]> units;
+
+private:
+  void read_abbrev_tables (int end);
+  void preload (int end);
+};
+
+int
+comp_unit_batch::read (int begin)
+{
+  int end = begin;
+  ULONGEST size = 0;
+
+  clear ();
+  first = begin;
+
+  while (end < dwarf2_per_objfile->n_comp_units
+	 && end - begin < PSYMTAB_READ_AHEAD_CUS
+	 && size < PSYMTAB_READ_AHEAD_BYTES)
+    size += dw2_get_cutu (end++)->length;
+
+  read_abbrev_tables (end);
+  if (gdb::thread_pool::g_thread_pool->thread_count () >= 2)
+    preload (end);
+
+  return end;
+}
+
+void
+comp_unit_batch::read_abbrev_tables (int end)
+{
+  struct objfile *objfile = dwarf2_per_objfile->objfile;
+
+  /* An abbrev table to read, and where to store it.  */
+  struct read_request
+  {
+    struct dwarf2_section_info *section;
+    sect_offset sect_off;
+    struct abbrev_table **result;
+  };
+  std::vector<read_request> requests;
+
+  tables.resize (end - first);
+
+  /* Find the tables on this thread: this may need to read in sections
+     or open the dwz file, which cannot be done by the workers.  Type
+     units, and units whose header does not point into the abbrev
+     section, are left for init_cutu_and_read_dies to deal with.  */
+  for (int i = first; i < end; ++i)
+    {
+      struct dwarf2_per_cu_data *per_cu = dw2_get_cutu (i);
+      struct dwarf2_section_info *abbrev_section;
+      sect_offset abbrev_offset;
+
+      if (per_cu->is_debug_types)
+	continue;
+
+      abbrev_section = get_abbrev_section_for_cu (per_cu);
+      dwarf2_read_section (objfile, abbrev_section);
+      abbrev_offset = read_abbrev_offset (per_cu->section, per_cu->sect_off);
+      if (to_underlying (abbrev_offset) >= abbrev_section->size)
+	continue;
+
+      requests.push_back ({abbrev_section, abbrev_offset,
+			   &tables[i - first]});
+    }
+
+  /* Parsing a table only reads the already mapped section and
+     allocates from the table's own obstack, so it is safe to do it in
+     parallel.  */
+  gdb::parallel_for_each (requests.begin (), requests.end (),
+			  [] (std::vector<read_request>::iterator iter,
+			      std::vector<read_request>::iterator last)
+    {
+      for (; iter != last; ++iter)
+	*iter->result = abbrev_table_read_table (iter->section,
+						 iter->sect_off);
+    });
+}
+
+/* Return true if the compilation units using ABBREVS should not be
+   read ahead: either they may be DWO skeletons, whose DWO file would
+   be looked up, and possibly warned about, twice; or they may refer to
+   strings in a dwz file, and finding out whether there is one needs
+   BFD, which the worker threads cannot use.  */
+
+static bool
+abbrev_table_prevents_preload (const struct abbrev_table *abbrevs)
+{
+  for (int i = 0; i < ABBREV_HASH_SIZE; ++i)
+    for (const struct abbrev_info *abbrev = abbrevs->abbrevs[i];
+	 abbrev != NULL;
+	 abbrev = abbrev->next)
+      for (unsigned int j = 0; j < abbrev->num_attrs; ++j)
+	{
+	  const struct attr_abbrev *attr = &abbrev->attrs[j];
+
+	  if (attr->name == DW_AT_GNU_dwo_name)
+	    return true;
+	  if ((attr->form == DW_FORM_GNU_strp_alt
+	       || attr->form == DW_FORM_indirect)
+	      && dwarf2_per_objfile->dwz_file == NULL)
+	    return true;
+	}
+
+  return false;
+}
+
+/* die_reader_func for comp_unit_batch::preload.  DATA is the
+   preloaded_comp_unit; on return its CU field is set if the unit's
+   partial DIEs are to be read ahead.  */
+
+static void
+preload_comp_unit_reader (const struct die_reader_specs *reader,
+			  const gdb_byte *info_ptr,
+			  struct die_info *comp_unit_die,
+			  int has_children,
+			  void *data)
+{
+  struct dwarf2_cu *cu = reader->cu;
+  struct preloaded_comp_unit *pcu = (struct preloaded_comp_unit *) data;
+
+  /* Partial units are skipped by dwarf2_build_psymtabs_hard, and units
+     without children have nothing to read ahead.  */
+  if (comp_unit_die->tag == DW_TAG_partial_unit
+      || cu->dwo_unit != NULL
+      || !has_children)
+    return;
+
+  /* Use the same pretend language as dwarf2_build_psymtabs_hard.  */
+  prepare_one_comp_unit (cu, comp_unit_die, language_minimal);
+
+  pcu->reader = *reader;
+  pcu->info_ptr = info_ptr;
+  pcu->comp_unit_die = comp_unit_die;
+  pcu->cu = cu;
+}
+
+void
+comp_unit_batch::preload (int end)
+{
+  struct objfile *objfile = dwarf2_per_objfile->objfile;
+  std::vector<preloaded_comp_unit *> todo;
+
+  units.reset (new preloaded_comp_unit[end - first]);
+
+  /* Read in the sections that attributes of partial DIEs may refer
+     to; the worker threads must find them mapped.  If that fails, let
+     the serial reader report it.  */
+  TRY
+    {
+      dwarf2_read_section (objfile, &dwarf2_per_objfile->str);
+      dwarf2_read_section (objfile, &dwarf2_per_objfile->line_str);
+      dwarf2_read_section (objfile, &dwarf2_per_objfile->addr);
+      if (dwarf2_per_objfile->dwz_file != NULL)
+	dwarf2_read_section (objfile, &dwarf2_per_objfile->dwz_file->str);
+    }
+  CATCH (ex, RETURN_MASK_ERROR)
+    {
+      return;
+    }
+  END_CATCH
+
+  /* Read the header and top-level DIE of each unit on this thread, as
+     that may open DWO files or otherwise use BFD.  The complaints are
+     kept until the unit's psymtab is built, so that they still come
+     out in order.  */
+  for (int i = first; i < end; ++i)
+    {
+      struct dwarf2_per_cu_data *per_cu = dw2_get_cutu (i);
+      struct preloaded_comp_unit *pcu = &units[i - first];
+      struct abbrev_table *table = tables[i - first];
+
+      if (table == NULL || abbrev_table_prevents_preload (table))
+	continue;
+
+      /* A unit read in for an earlier unit's psymtab stays cached
+	 until this unit is processed; read a new CU next to it.  */
+      struct dwarf2_cu *cached_cu = per_cu->cu;
+      per_cu->cu = NULL;
+
+      TRY
+	{
+	  scoped_defer_complaints defer (&pcu->header_complaints);
+
+	  init_cutu_and_read_dies (per_cu, table, 0, 1,
+				   preload_comp_unit_reader, pcu);
+	}
+      CATCH (ex, RETURN_MASK_ERROR)
+	{
+	  /* The CU was freed; process_psymtab_comp_unit will report
+	     the error.  */
+	  pcu->cu = NULL;
+	}
+      END_CATCH
+
+      /* init_cutu_and_read_dies linked the kept CU into the
+	 read_in_chain; unlink it, and free it unless it is read
+	 ahead.  */
+      if (per_cu->cu != NULL)
+	{
+	  struct dwarf2_cu *cu = per_cu->cu;
+
+	  gdb_assert (dwarf2_per_objfile->read_in_chain == per_cu);
+	  dwarf2_per_objfile->read_in_chain = cu->read_in_chain;
+	  cu->read_in_chain = NULL;
+
+	  if (pcu->cu == NULL)
+	    {
+	      obstack_free (&cu->comp_unit_obstack, NULL);
+	      xfree (cu);
+	    }
+	}
+      per_cu->cu = cached_cu;
+
+      if (pcu->cu != NULL)
+	{
+	  pcu->cu->abbrev_table = table;
+	  pcu->load_all = per_cu->load_all_dies;
+	  todo.push_back (pcu);
+	}
+    }
+
+  /* Now read the partial DIEs in parallel.  Units vary a lot in size,
+     so spread them over the threads even if there are only a few.  */
+  gdb::parallel_for_each (todo.begin (), todo.end (),
+			  [] (std::vector<preloaded_comp_unit *>::iterator iter,
+			      std::vector<preloaded_comp_unit *>::iterator last)
+    {
+      for (; iter != last; ++iter)
+	{
+	  struct preloaded_comp_unit *pcu = *iter;
+	  scoped_defer_complaints defer (&pcu->load_complaints);
+
+	  pcu->cu->preload = pcu;
+	  TRY
+	    {
+	      pcu->first_die = load_partial_dies (&pcu->reader,
+						  pcu->info_ptr, 1);
+	    }
+	  CATCH (ex, RETURN_MASK_ALL)
+	    {
+	      pcu->failed = true;
+	      pcu->reason = ex.reason;
+	      pcu->error = ex.error;
+	      pcu->message = ex.message != NULL ? ex.message : "";
+	    }
+	  END_CATCH
+	  pcu->cu->preload = NULL;
+	  pcu->loaded = true;
+	}
+    }, 1);
+}
+
+struct preloaded_comp_unit *
+comp_unit_batch::preloaded (int i)
+{
+  struct preloaded_comp_unit *pcu;
+
+  if (units == NULL)
+    return NULL;
+
+  pcu = &units[i - first];
+  if (pcu->cu == NULL)
+    return NULL;
+
+  /* If the unit was not loaded, or was loaded with the wrong setting
+     of load_all_dies because an earlier unit needed all of its DIEs,
+     read it again.  */
+  if (!pcu->loaded || pcu->load_all != dw2_get_cutu (i)->load_all_dies)
+    {
+      obstack_free (&pcu->cu->comp_unit_obstack, NULL);
+      xfree (pcu->cu);
+      pcu->cu = NULL;
+      return NULL;
+    }
+
+  return pcu;
+}
+
+/* Subroutine of dwarf2_build_psymtabs_hard.  Build the psymtab of
+   PER_CU, whose partial DIEs were read ahead as described by PCU.  This
+   is process_psymtab_comp_unit, picking up where the read ahead
+   stopped.  */
+
+static void
+process_preloaded_comp_unit (struct dwarf2_per_cu_data *per_cu,
+			     struct preloaded_comp_unit *pcu)
+{
+  struct dwarf2_cu *cu = pcu->cu;
+  struct cleanup *free_cu_cleanup;
+  process_psymtab_comp_unit_data info;
+
+  /* See process_psymtab_comp_unit.  */
+  if (per_cu->cu != NULL)
+    free_one_cached_comp_unit (per_cu);
+
+  /* Take the CU over, as init_cutu_and_read_dies would have made it.  */
+  pcu->cu = NULL;
+  per_cu->cu = cu;
+  free_cu_cleanup = make_cleanup (free_heap_comp_unit, cu);
+
+  pcu->header_complaints.issue ();
+
+  info.want_partial_unit = 0;
+  info.pretend_language = language_minimal;
+  info.preloaded = pcu;
+  process_psymtab_comp_unit_reader (&pcu->reader, pcu->info_ptr,
+				    pcu->comp_unit_die, 1, &info);
+
+  do_cleanups (free_cu_cleanup);
+
+  /* Age out any secondary CUs.  */
+  age_cached_comp_units ();
+}
+
 /* Build the partial symbol table by doing a quick pass through the
    .debug_info and .debug_abbrev sections.  */
 
@@ -7571,12 +8136,27 @@ dwarf2_build_psymtabs_hard (struct objfile *objfile)
     = make_scoped_restore (&objfile->psymtabs_addrmap,
 			   addrmap_create_mutable (&temp_obstack));
 
+  /* Read the compilation units ahead in batches, using the worker
+     threads, but build the psymtabs on this thread, in order.  */
+  comp_unit_batch batch;
+  int batch_end = 0;
+
   for (i = 0; i < dwarf2_per_objfile->n_comp_units; ++i)
     {
       struct dwarf2_per_cu_data *per_cu = dw2_get_cutu (i);
+      struct preloaded_comp_unit *pcu;
 
-      process_psymtab_comp_unit (per_cu, 0, language_minimal);
+      if (i == batch_end)
+	batch_end = batch.read (i);
+
+      pcu = batch.preloaded (i);
+      if (pcu != NULL)
+	process_preloaded_comp_unit (per_cu, pcu);
+      else
+	process_psymtab_comp_unit (per_cu, 0, language_minimal,
+				   batch.abbrev_table (i));
     }
+  batch.clear ();
 
   /* This has to wait until we read the CUs, we need the list of DWOs.  */
   process_skeletonless_type_units (objfile);
@@ -7825,7 +8405,7 @@ scan_partial_symbols (struct partial_die_info *first_die, CORE_ADDR *lowpc,
 
 		/* Go read the partial unit, if needed.  */
 		if (per_cu->v.psymtab == NULL)
-		  process_psymtab_comp_unit (per_cu, 1, cu->language);
+		  process_psymtab_comp_unit (per_cu, 1, cu->language, NULL);
 
 		VEC_safe_push (dwarf2_per_cu_ptr,
 			       cu->per_cu->imported_symtabs, per_cu);
@@ -8636,6 +9216,160 @@ maybe_queue_comp_unit (struct dwarf2_cu *dependent_cu,
   return 1;
 }
 
+/* An entry in dwarf2_cu::demangled_names.  */
+
+struct demangled_linkage_name
+{
+  /* The linkage name as found in the DIE.  Entries are keyed by this
+     pointer, not by the string contents.  */
+  const char *mangled;
+
+  /* MANGLED demangled the way dwarf2_physname does it, or NULL if it
+     could not be demangled.  */
+  const char *demangled;
+};
+
+/* Hash function for dwarf2_cu::demangled_names.  */
+
+static hashval_t
+demangled_linkage_name_hash (const void *item)
+{
+  const struct demangled_linkage_name *entry
+    = (const struct demangled_linkage_name *) item;
+
+  return htab_hash_pointer (entry->mangled);
+}
+
+/* Equality function for dwarf2_cu::demangled_names.  */
+
+static int
+demangled_linkage_name_eq (const void *item_lhs, const void *item_rhs)
+{
+  const struct demangled_linkage_name *lhs
+    = (const struct demangled_linkage_name *) item_lhs;
+  const struct demangled_linkage_name *rhs
+    = (const struct demangled_linkage_name *) item_rhs;
+
+  return lhs->mangled == rhs->mangled;
+}
+
+/* Add to CU->demangled_names an entry for each linkage name of DIE,
+   its siblings and their children that is not there yet, and append
+   the new entries to ENTRIES.  Only the DIEs' own attributes are
+   looked at: following DW_AT_specification could load other CUs.  */
+
+static void
+collect_linkage_names (struct die_info *die, struct dwarf2_cu *cu,
+		       std::vector<demangled_linkage_name *> *entries)
+{
+  for (; die != NULL; die = die->sibling)
+    {
+      for (unsigned int i = 0; i < die->num_attrs; ++i)
+	{
+	  struct attribute *attr = &die->attrs[i];
+	  struct demangled_linkage_name key, *entry;
+	  void **slot;
+
+	  if (attr->name != DW_AT_linkage_name
+	      && attr->name != DW_AT_MIPS_linkage_name)
+	    continue;
+	  if (attr->form != DW_FORM_strp && attr->form != DW_FORM_line_strp
+	      && attr->form != DW_FORM_string
+	      && attr->form != DW_FORM_GNU_str_index
+	      && attr->form != DW_FORM_GNU_strp_alt)
+	    continue;
+	  if (DW_STRING (attr) == NULL)
+	    continue;
+
+	  key.mangled = DW_STRING (attr);
+	  slot = htab_find_slot (cu->demangled_names, &key, INSERT);
+	  if (*slot != NULL)
+	    continue;
+
+	  entry = XOBNEW (&cu->comp_unit_obstack,
+			  struct demangled_linkage_name);
+	  entry->mangled = key.mangled;
+	  entry->demangled = NULL;
+	  *slot = entry;
+	  entries->push_back (entry);
+	}
+
+      collect_linkage_names (die->child, cu, entries);
+    }
+}
+
+/* Demangle the linkage names of the C++ CUs in the queue, starting at
+   ITEM, that are about to be expanded and have not been seen here
+   before.  The work is spread over the worker threads; the results
+   are stored in each CU's demangled_names table, where
+   dwarf2_physname looks for them.  */
+
+static void
+demangle_queued_linkage_names (struct dwarf2_queue_item *item)
+{
+  /* Not worth it if there are no threads to share the work with.  */
+  if (gdb::thread_pool::g_thread_pool->thread_count () < 2)
+    return;
+
+  std::vector<demangled_linkage_name *> entries;
+  /* Each CU whose names were collected, and the index in ENTRIES
+     just past its last entry.  */
+  std::vector<std::pair<struct dwarf2_cu *, size_t>> cu_ends;
+
+  for (; item != NULL; item = item->next)
+    {
+      struct dwarf2_per_cu_data *per_cu = item->per_cu;
+      struct dwarf2_cu *cu = per_cu->cu;
+
+      /* Same test as in process_queue.  */
+      if (!(dwarf2_per_objfile->using_index
+	    ? !per_cu->v.quick->compunit_symtab
+	    : (per_cu->v.psymtab && !per_cu->v.psymtab->readin))
+	  || cu == NULL
+	  || cu->language != language_cplus
+	  || cu->demangled_names != NULL)
+	continue;
+
+      cu->demangled_names
+	= htab_create_alloc_ex (cu->header.length / 64,
+				demangled_linkage_name_hash,
+				demangled_linkage_name_eq,
+				NULL,
+				&cu->comp_unit_obstack,
+				hashtab_obstack_allocate,
+				dummy_obstack_deallocate);
+      collect_linkage_names (cu->dies, cu, &entries);
+      cu_ends.emplace_back (cu, entries.size ());
+    }
+
+  if (entries.empty ())
+    return;
+
+  std::vector<const char *> names;
+  names.reserve (entries.size ());
+  for (demangled_linkage_name *entry : entries)
+    names.push_back (entry->mangled);
+
+  std::vector<gdb::unique_xmalloc_ptr<char>> demangled
+    = gdb_demangle_parallel (names, (DMGL_PARAMS | DMGL_ANSI
+				     | DMGL_RET_DROP));
+
+  /* Copy the results to the obstack of the CU each entry belongs to,
+     so that they go away with the CU's DIEs.  */
+  size_t i = 0;
+  for (const auto &cu_end : cu_ends)
+    {
+      struct dwarf2_cu *cu = cu_end.first;
+
+      for (; i < cu_end.second; ++i)
+	if (demangled[i] != NULL)
+	  entries[i]->demangled
+	    = (const char *) obstack_copy0 (&cu->comp_unit_obstack,
+					    demangled[i].get (),
+					    strlen (demangled[i].get ()));
+    }
+}
+
 /* Process the queue.  */
 
 static void
@@ -8654,6 +9388,13 @@ process_queue (void)
      may load a new CU, adding it to the end of the queue.  */
   for (item = dwarf2_queue; item != NULL; dwarf2_queue = item = next_item)
     {
+      /* Demangle the names of this CU and of every other one queued
+	 so far in one go; CUs queued later are picked up in the
+	 next batch.  */
+      if (item->per_cu->cu != NULL
+	  && item->per_cu->cu->demangled_names == NULL)
+	demangle_queued_linkage_names (item);
+
       if ((dwarf2_per_objfile->using_index
 	   ? !item->per_cu->v.quick->compunit_symtab
 	   : (item->per_cu->v.psymtab && !item->per_cu->v.psymtab->readin))
@@ -9913,9 +10654,26 @@ dwarf2_physname (const char *name, struct die_info *die, struct dwarf2_cu *cu)
 	}
       else
 	{
-	  demangled.reset (gdb_demangle (mangled,
-					 (DMGL_PARAMS | DMGL_ANSI
-					  | DMGL_RET_DROP)));
+	  struct demangled_linkage_name *entry = NULL;
+
+	  if (cu->demangled_names != NULL)
+	    {
+	      struct demangled_linkage_name key;
+
+	      key.mangled = mangled;
+	      entry = ((struct demangled_linkage_name *)
+		       htab_find (cu->demangled_names, &key));
+	    }
+
+	  if (entry != NULL)
+	    {
+	      if (entry->demangled != NULL)
+		demangled.reset (xstrdup (entry->demangled));
+	    }
+	  else
+	    demangled.reset (gdb_demangle (mangled,
+					   (DMGL_PARAMS | DMGL_ANSI
+					    | DMGL_RET_DROP)));
 	}
       if (demangled)
 	canon = demangled.get ();
@@ -16884,6 +17642,88 @@ is_type_tag_for_partial (int tag)
     }
 }
 
+/* Add the VAR_DOMAIN partial symbol of PDI, a DIE that load_partial_dies
+   does not keep.  ACLASS is its address class, and GLOBAL says whether
+   it goes to the global or the static list.  If CU is being read ahead,
+   just record the symbol; finish_preloaded_partial_dies adds it.  */
+
+static void
+add_partial_die_symbol (struct dwarf2_cu *cu, struct partial_die_info *pdi,
+			enum address_class aclass, int global)
+{
+  struct objfile *objfile = cu->objfile;
+
+  if (cu->preload != NULL)
+    {
+      cu->preload->psymbols.push_back ({pdi->name,
+					pdi->name_on_cu_obstack != 0,
+					aclass, global != 0});
+      return;
+    }
+
+  add_psymbol_to_list (pdi->name, strlen (pdi->name), 0,
+		       VAR_DOMAIN, aclass,
+		       global ? &objfile->global_psymbols
+		       : &objfile->static_psymbols,
+		       0, cu->language, objfile);
+}
+
+/* Copy the names of PDI, its siblings and their children that are
+   still on the comp_unit_obstack to STORAGE.  */
+
+static void
+move_partial_die_names (struct obstack *storage,
+			struct partial_die_info *pdi)
+{
+  for (; pdi != NULL; pdi = pdi->die_sibling)
+    {
+      if (pdi->name_on_cu_obstack)
+	{
+	  pdi->name = (const char *) obstack_copy0 (storage, pdi->name,
+						    strlen (pdi->name));
+	  pdi->name_on_cu_obstack = 0;
+	}
+      move_partial_die_names (storage, pdi->die_child);
+    }
+}
+
+/* Do the part of load_partial_dies that was left for the main thread
+   when CU was read ahead: issue the complaints, rethrow the error if
+   there was one, copy the names to the objfile and add the recorded
+   partial symbols.  PCU describes the read ahead.  Return the first
+   partial DIE, like load_partial_dies.  */
+
+static struct partial_die_info *
+finish_preloaded_partial_dies (struct dwarf2_cu *cu,
+			       struct preloaded_comp_unit *pcu)
+{
+  struct objfile *objfile = cu->objfile;
+  struct obstack *storage = &objfile->per_bfd->storage_obstack;
+
+  pcu->load_complaints.issue ();
+  if (pcu->failed && pcu->reason == RETURN_QUIT)
+    throw_quit ("%s", pcu->message.c_str ());
+  else if (pcu->failed)
+    throw_error (pcu->error, "%s", pcu->message.c_str ());
+
+  move_partial_die_names (storage, pcu->first_die);
+
+  for (const deferred_partial_symbol &psym : pcu->psymbols)
+    {
+      const char *name = psym.name;
+
+      if (psym.name_on_cu_obstack)
+	name = (const char *) obstack_copy0 (storage, name, strlen (name));
+      add_psymbol_to_list (name, strlen (name), 0,
+			   VAR_DOMAIN, psym.aclass,
+			   psym.global ? &objfile->global_psymbols
+			   : &objfile->static_psymbols,
+			   0, cu->language, objfile);
+    }
+
+  return pcu->first_die;
+}
+
 /* Load all DIEs that are interesting for partial symbols into memory.  */
 
 static struct partial_die_info *
@@ -17017,10 +17857,7 @@ load_partial_dies (const struct die_reader_specs *reader,
 	      || part_die->tag == DW_TAG_subrange_type))
 	{
 	  if (building_psymtab && part_die->name != NULL)
-	    add_psymbol_to_list (part_die->name, strlen (part_die->name), 0,
-				 VAR_DOMAIN, LOC_TYPEDEF,
-				 &objfile->static_psymbols,
-				 0, cu->language, objfile);
+	    add_partial_die_symbol (cu, part_die, LOC_TYPEDEF, 0);
 	  info_ptr = locate_pdi_sibling (reader, part_die, info_ptr);
 	  continue;
 	}
@@ -17053,12 +17890,8 @@ load_partial_dies (const struct die_reader_specs *reader,
 	    complaint (&symfile_complaints,
 		       _("malformed enumerator DIE ignored"));
 	  else if (building_psymtab)
-	    add_psymbol_to_list (part_die->name, strlen (part_die->name), 0,
-				 VAR_DOMAIN, LOC_CONST,
-				 cu->language == language_cplus
-				 ? &objfile->global_psymbols
-				 : &objfile->static_psymbols,
-				 0, cu->language, objfile);
+	    add_partial_die_symbol (cu, part_die, LOC_CONST,
+				    cu->language == language_cplus);
 
 	  info_ptr = locate_pdi_sibling (reader, part_die, info_ptr);
 	  continue;
@@ -17211,9 +18044,20 @@ read_partial_die (const struct die_reader_specs *reader,
 	      part_die->name = DW_STRING (&attr);
 	      break;
 	    default:
-	      part_die->name
-		= dwarf2_canonicalize_name (DW_STRING (&attr), cu,
-					    &objfile->per_bfd->storage_obstack);
+	      if (cu->preload != NULL)
+		{
+		  /* The storage obstack belongs to the main thread; the
+		     name is moved there by finish_preloaded_partial_dies.  */
+		  part_die->name
+		    = dwarf2_canonicalize_name (DW_STRING (&attr), cu,
+						&cu->comp_unit_obstack);
+		  part_die->name_on_cu_obstack
+		    = part_die->name != DW_STRING (&attr);
+		}
+	      else
+		part_die->name
+		  = dwarf2_canonicalize_name (DW_STRING (&attr), cu,
+					      &objfile->per_bfd->storage_obstack);
 	      break;
 	    }
 	  break;
@@ -17223,7 +18067,10 @@ read_partial_die (const struct die_reader_specs *reader,
 	     assume they will be the same, and we only store the last
 	     one we see.  */
 	  if (cu->language == language_ada)
-	    part_die->name = DW_STRING (&attr);
+	    {
+	      part_die->name = DW_STRING (&attr);
+	      part_die->name_on_cu_obstack = 0;
+	    }
 	  part_die->linkage_name = DW_STRING (&attr);
 	  break;
 	case DW_AT_low_pc:
@@ -24717,10 +25564,12 @@ recursively_write_psymbols (struct objfile *objfile,
 		  1);
 }
 
-/* Create an index file for OBJFILE in the directory DIR.  */
+/* Create an index file for OBJFILE in the directory DIR, named
+   BASENAME with INDEX_SUFFIX appended.  */
 
 static void
-write_psymtabs_to_index (struct objfile *objfile, const char *dir)
+write_psymtabs_to_index (struct objfile *objfile, const char *dir,
+			 const char *basename)
 {
   if (dwarf2_per_objfile->using_index)
     error (_("Cannot use an index to create the index"));
@@ -24735,8 +25584,8 @@ write_psymtabs_to_index (struct objfile *objfile, const char *dir)
   if (stat (objfile_name (objfile), &st) < 0)
     perror_with_name (objfile_name (objfile));
 
-  std::string filename (std::string (dir) + SLASH_STRING
-			+ lbasename (objfile_name (objfile)) + INDEX_SUFFIX);
+  std::string filename (std::string (dir) + SLASH_STRING + basename
+			+ INDEX_SUFFIX);
 
   FILE *out_file = gdb_fopen_cloexec (filename.c_str (), "wb").release ();
   if (!out_file)
@@ -24870,6 +25719,20 @@ write_psymtabs_to_index (struct objfile *objfile, const char *dir)
   unlink_file.keep ();
 }
 
+/* See symfile.h.  */
+
+void
+dwarf2_write_index (struct objfile *objfile, const char *dir,
+		    const char *basename)
+{
+  dwarf2_per_objfile
+    = (struct dwarf2_per_objfile *) objfile_data (objfile,
+						  dwarf2_objfile_data_key);
+  gdb_assert (dwarf2_per_objfile != NULL);
+
+  write_psymtabs_to_index (objfile, dir, basename);
+}
+
 /* Implementation of the `save gdb-index' command.
    
    Note that the file format used by this command is documented in the
@@ -24899,7 +25762,8 @@ save_gdb_index_command (const char *arg, int from_tty)
 
 	TRY
 	  {
-	    write_psymtabs_to_index (objfile, arg);
+	    write_psymtabs_to_index (objfile, arg,
+				     lbasename (objfile_name (objfile)));
 	  }
 	CATCH (except, RETURN_MASK_ERROR)
 	  {
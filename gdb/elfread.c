@@ -1033,6 +1033,10 @@ elf_read_minimal_symbols (struct objfile *objfile, int symfile_flags,
 
   minimal_symbol_reader reader (objfile);
 
+  /* Nothing else is named until the minimal symbols are installed,
+     so they can be demangled in parallel.  */
+  reader.batch_names ();
+
   /* Allocate struct to keep track of the symfile.  */
   dbx = XCNEW (struct dbx_symfile_info);
   set_objfile_data (objfile, dbx_objfile_data_key, dbx);
@@ -33,6 +33,8 @@
 #include "target.h"
 #include "gdb/fileio.h"
 #include "inferior.h"
+#include "build-id.h"
+#include "index-cache.h"
 
 /* An object of this type is stored in the section's user data when
    mapping a section.  */
@@ -47,6 +49,8 @@ struct gdb_bfd_section_data
   void *data;
   /* If the data was mmapped, this is the map address.  */
   void *map_addr;
+  /* If the data comes from the index cache, this holds it.  */
+  index_cache_resource *cache_res;
 };
 
 /* A hash table holding every BFD that gdb knows about.  This is not
@@ -484,6 +488,12 @@ free_one_bfd_section (bfd *abfd, asection *sectp, void *ignore)
 
   if (sect != NULL && sect->data != NULL)
     {
+      if (sect->cache_res != NULL)
+	{
+	  delete sect->cache_res;
+	  return;
+	}
+
 #ifdef HAVE_MMAP
       if (sect->map_addr != NULL)
 	{
@@ -639,6 +649,38 @@ get_section_descriptor (asection *section)
   return result;
 }
 
+/* Try to fill in DESCRIPTOR with the decompressed contents of the
+   compressed section SECTP, taken from the index cache.  Return true
+   on success.  */
+
+static bool
+map_section_from_cache (asection *sectp,
+			struct gdb_bfd_section_data *descriptor)
+{
+  bfd *abfd = sectp->owner;
+
+  if (!global_index_cache.enabled ())
+    return false;
+
+  const struct bfd_build_id *build_id = build_id_bfd_get (abfd);
+  if (build_id == NULL)
+    return false;
+
+  std::unique_ptr<index_cache_resource> resource;
+  gdb::array_view<const gdb_byte> contents
+    = global_index_cache.lookup_section (build_id,
+					 bfd_get_section_name (abfd, sectp),
+					 bfd_get_section_size (sectp),
+					 &resource);
+  if (contents.empty ())
+    return false;
+
+  descriptor->size = contents.size ();
+  descriptor->data = (void *) contents.data ();
+  descriptor->cache_res = resource.release ();
+  return true;
+}
+
 /* See gdb_bfd.h.  */
 
 const gdb_byte *
@@ -694,6 +736,12 @@ gdb_bfd_map_section (asection *sectp, bfd_size_type *size)
     }
 #endif /* HAVE_MMAP */
 
+  /* Compressed sections may already have been decompressed into the
+     index cache, by this GDB or another one.  */
+  if (bfd_is_section_compressed (abfd, sectp)
+      && map_section_from_cache (sectp, descriptor))
+    goto done;
+
   /* Handle compressed sections, or ordinary uncompressed sections in
      the no-mmap case.  */
 
@@ -707,6 +755,25 @@ gdb_bfd_map_section (asection *sectp, bfd_size_type *size)
 	   bfd_get_filename (abfd));
   descriptor->data = data;
 
+  /* If the index cache is enabled, save the decompressed contents
+     there and use the file-backed copy, which unlike DATA can be
+     shared with other GDBs and evicted under memory pressure.  */
+  if (bfd_is_section_compressed (abfd, sectp))
+    {
+      const struct bfd_build_id *build_id = build_id_bfd_get (abfd);
+
+      if (build_id != NULL && global_index_cache.enabled ())
+	{
+	  gdb::array_view<const gdb_byte> contents (data, descriptor->size);
+
+	  global_index_cache.store_section (build_id,
+					    bfd_get_section_name (abfd, sectp),
+					    contents);
+	  if (map_section_from_cache (sectp, descriptor))
+	    xfree (data);
+	}
+    }
+
  done:
   gdb_assert (descriptor->data != NULL);
   *size = descriptor->size;
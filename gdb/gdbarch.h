@@ -978,8 +978,8 @@ extern void set_gdbarch_max_insn_length (struct gdbarch *gdbarch, ULONGEST max_i
    see the comments in infrun.c.
   
    The TO area is only guaranteed to have space for
-   gdbarch_max_insn_length (arch) bytes, so this function must not
-   write more bytes than that to that area.
+   gdbarch_displaced_step_buffer_length (arch) bytes, so this function
+   must not write more bytes than that to that area.
   
    If you do not provide this function, GDB assumes that the
    architecture does not support displaced stepping.
@@ -1043,6 +1043,17 @@ typedef CORE_ADDR (gdbarch_displaced_step_location_ftype) (struct gdbarch *gdbar
 extern CORE_ADDR gdbarch_displaced_step_location (struct gdbarch *gdbarch);
 extern void set_gdbarch_displaced_step_location (struct gdbarch *gdbarch, gdbarch_displaced_step_location_ftype *displaced_step_location);
 
+/* Return the size in bytes of the area that
+   gdbarch_displaced_step_copy_insn may write at its TO address.  GDB
+   reserves that much space for each displaced stepping buffer, and
+   saves and restores its original contents.  The default is
+   gdbarch_max_insn_length, for architectures that only copy the
+   instruction itself. */
+
+typedef ULONGEST (gdbarch_displaced_step_buffer_length_ftype) (struct gdbarch *gdbarch);
+extern ULONGEST gdbarch_displaced_step_buffer_length (struct gdbarch *gdbarch);
+extern void set_gdbarch_displaced_step_buffer_length (struct gdbarch *gdbarch, gdbarch_displaced_step_buffer_length_ftype *displaced_step_buffer_length);
+
 /* Relocate an instruction to execute at a different address.  OLDLOC
    is the address in the inferior memory where the instruction to
    relocate is currently at.  On input, TO points to the destination
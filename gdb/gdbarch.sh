@@ -787,8 +787,8 @@ V;ULONGEST;max_insn_length;;;0;0
 # see the comments in infrun.c.
 #
 # The TO area is only guaranteed to have space for
-# gdbarch_max_insn_length (arch) bytes, so this function must not
-# write more bytes than that to that area.
+# gdbarch_displaced_step_buffer_length (arch) bytes, so this function
+# must not write more bytes than that to that area.
 #
 # If you do not provide this function, GDB assumes that the
 # architecture does not support displaced stepping.
@@ -836,6 +836,14 @@ M;void;displaced_step_fixup;struct displaced_step_closure *closure, CORE_ADDR fr
 # see the comments in infrun.c.
 m;CORE_ADDR;displaced_step_location;void;;;NULL;;(! gdbarch->displaced_step_location) != (! gdbarch->displaced_step_copy_insn)
 
+# Return the size in bytes of the area that
+# gdbarch_displaced_step_copy_insn may write at its TO address.  GDB
+# reserves that much space for each displaced stepping buffer, and
+# saves and restores its original contents.  The default is
+# gdbarch_max_insn_length, for architectures that only copy the
+# instruction itself.
+m;ULONGEST;displaced_step_buffer_length;void;;;default_displaced_step_buffer_length;;0
+
 # Relocate an instruction to execute at a different address.  OLDLOC
 # is the address in the inferior memory where the instruction to
 # relocate is currently at.  On input, TO points to the destination
@@ -21,10 +21,16 @@
 #include "server.h"
 #include "gdbthread.h"
 #include "dll.h"
+#include <unordered_map>
 
 std::list<process_info *> all_processes;
 std::list<thread_info *> all_threads;
 
+/* Index of ALL_THREADS by thread id, so that looking up or removing a
+   thread doesn't need to walk the list.  */
+static std::unordered_map<ptid_t, std::list<thread_info *>::iterator,
+			  hash_ptid> all_threads_index;
+
 struct thread_info *current_thread;
 
 /* The current working directory used to start the inferior.  */
@@ -40,6 +46,8 @@ add_thread (ptid_t thread_id, void *target_data)
   new_thread->last_status.kind = TARGET_WAITKIND_IGNORE;
 
   all_threads.push_back (new_thread);
+  gdb_assert (all_threads_index.find (thread_id) == all_threads_index.end ());
+  all_threads_index[thread_id] = std::prev (all_threads.end ());
 
   if (current_thread == NULL)
     current_thread = new_thread;
@@ -63,9 +71,12 @@ get_first_thread (void)
 struct thread_info *
 find_thread_ptid (ptid_t ptid)
 {
-  return find_thread ([&] (thread_info *thread) {
-    return thread->id == ptid;
-  });
+  auto it = all_threads_index.find (ptid);
+
+  if (it == all_threads_index.end ())
+    return NULL;
+
+  return *it->second;
 }
 
 /* Find a thread associated with the given PROCESS, or NULL if no
@@ -101,7 +112,10 @@ remove_thread (struct thread_info *thread)
     target_disable_btrace (thread->btrace);
 
   discard_queued_stop_replies (ptid_of (thread));
-  all_threads.remove (thread);
+  auto it = all_threads_index.find (thread->id);
+  gdb_assert (it != all_threads_index.end () && *it->second == thread);
+  all_threads.erase (it->second);
+  all_threads_index.erase (it);
   free_one_thread (thread);
   if (current_thread == thread)
     current_thread = NULL;
@@ -130,6 +144,7 @@ clear_inferiors (void)
 {
   for_each_thread (free_one_thread);
   all_threads.clear ();
+  all_threads_index.clear ();
 
   clear_dlls ();
 
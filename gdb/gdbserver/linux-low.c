@@ -43,6 +43,7 @@
 #include <sys/stat.h>
 #include <sys/vfs.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 #include "filestuff.h"
 #include "tracepoint.h"
 #include "hostio.h"
@@ -50,6 +51,7 @@
 #include "common-inferior.h"
 #include "nat/fork-inferior.h"
 #include "environ.h"
+#include <unordered_map>
 #ifndef ELFMAG0
 /* Don't include <linux/elf.h> here.  If it got included by gdb_proc_service.h
    then ELFMAG0 will have been defined.  If it didn't get included by
@@ -405,6 +407,10 @@ linux_pid_exe_is_elf_64_file (int pid, unsigned int *machine)
   return elf_64_file_p (file, machine);
 }
 
+/* Index of the known LWPs by LWP id, for find_lwp_pid.  LWP ids are
+   unique system-wide, so there's no need to key by process too.  */
+static std::unordered_map<long, struct lwp_info *> lwp_index;
+
 static void
 delete_lwp (struct lwp_info *lwp)
 {
@@ -413,6 +419,7 @@ delete_lwp (struct lwp_info *lwp)
   if (debug_threads)
     debug_printf ("deleting %ld\n", lwpid_of (thr));
 
+  lwp_index.erase (lwpid_of (thr));
   remove_thread (thr);
 
   if (the_low_target.delete_thread != NULL)
@@ -891,6 +898,13 @@ save_stop_reason (struct lwp_info *lwp)
 			target_pid_to_str (ptid_of (thr)));
 	}
 
+      /* A breakpoint jump pad traps once its breakpoint's conditions
+	 are true, with all registers restored.  Report the stop at
+	 the breakpoint's address, as if it had trapped there.  */
+      CORE_ADDR bp_addr = breakpoint_from_jump_pad_trap (sw_breakpoint_pc);
+      if (bp_addr != 0)
+	sw_breakpoint_pc = bp_addr;
+
       /* Back up the PC if necessary.  */
       if (pc != sw_breakpoint_pc)
 	{
@@ -951,6 +965,7 @@ add_lwp (ptid_t ptid)
     the_low_target.new_thread (lwp);
 
   lwp->thread = add_thread (ptid, lwp);
+  lwp_index[ptid.lwp ()] = lwp;
 
   return lwp;
 }
@@ -1811,16 +1826,13 @@ status_pending_p_callback (thread_info *thread, ptid_t ptid)
 struct lwp_info *
 find_lwp_pid (ptid_t ptid)
 {
-  thread_info *thread = find_thread ([&] (thread_info *thread)
-    {
-      int lwp = ptid.lwp () != 0 ? ptid.lwp () : ptid.pid ();
-      return thread->id.lwp () == lwp;
-    });
+  long lwp = ptid.lwp () != 0 ? ptid.lwp () : ptid.pid ();
+  auto it = lwp_index.find (lwp);
 
-  if (thread == NULL)
+  if (it == lwp_index.end ())
     return NULL;
 
-  return get_thread_lwp (thread);
+  return it->second;
 }
 
 /* Return the number of known LWPs in the tgid given by PID.  */
@@ -2788,6 +2800,11 @@ linux_wait_for_event_filtered (ptid_t wait_ptid, ptid_t filter_ptid,
 	  return 0;
 	}
 
+      /* The in-process agent may have filled its trace ring while
+	 we weren't running the event loop.  Drain it before blocking;
+	 the agent raises SIGIO when it needs us to do it again.  */
+      drain_trace_ring ();
+
       /* Block until we get an event reported with SIGCHLD.  */
       if (debug_threads)
 	debug_printf ("sigsuspend'ing\n");
@@ -5728,6 +5745,59 @@ linux_store_registers (struct regcache *regcache, int regno)
 }
 
 
+#ifdef __NR_process_vm_readv
+
+/* Whether process_vm_readv and process_vm_writev can be used.  Cleared
+   the first time they fail because the kernel lacks them, or because
+   they are not allowed, e.g. by a seccomp filter.  */
+static int linux_process_vm_usable = 1;
+
+/* The maximum number of iovecs passed to process_vm_readv at once.  */
+#define LINUX_PROCESS_VM_IOVECS 64
+
+/* Copy memory between gdbserver and the process of thread PID, with
+   process_vm_writev if WRITE is non-zero, process_vm_readv
+   otherwise.  LOCAL and REMOTE are arrays of COUNT iovecs.  Return
+   the number of bytes copied, which stops short at the first remote
+   address that isn't accessible, or -1 on error.  */
+
+static ssize_t
+linux_process_vm_xfer (int pid, const struct iovec *local,
+		       const struct iovec *remote, unsigned long count,
+		       int write)
+{
+  ssize_t ret;
+
+  ret = syscall (write ? __NR_process_vm_writev : __NR_process_vm_readv,
+		 pid, local, count, remote, count, 0);
+  if (ret < 0 && (errno == ENOSYS || errno == EPERM))
+    {
+      if (debug_threads)
+	debug_printf ("process_vm_%sv unusable: %s\n",
+		      write ? "write" : "read", strerror (errno));
+      linux_process_vm_usable = 0;
+    }
+  return ret;
+}
+
+/* Like linux_process_vm_xfer, for a single region of LEN bytes at
+   MEMADDR in the inferior and MYADDR in gdbserver.  */
+
+static ssize_t
+linux_process_vm_xfer_1 (int pid, CORE_ADDR memaddr, void *myaddr,
+			 int len, int write)
+{
+  struct iovec local, remote;
+
+  local.iov_base = myaddr;
+  local.iov_len = len;
+  remote.iov_base = (void *) (uintptr_t) memaddr;
+  remote.iov_len = len;
+  return linux_process_vm_xfer (pid, &local, &remote, 1, write);
+}
+
+#endif
+
 /* Copy LEN bytes from inferior's memory starting at MEMADDR
    to debugger memory starting at MYADDR.  */
 
@@ -5743,6 +5813,26 @@ linux_read_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len)
   int ret;
   int fd;
 
+#ifdef __NR_process_vm_readv
+  /* Try a single process_vm_readv call first.  It fails on pages the
+     inferior itself can't read, which ptrace can.  */
+  if (linux_process_vm_usable && len > 0)
+    {
+      ssize_t bytes = linux_process_vm_xfer_1 (pid, memaddr, myaddr, len, 0);
+
+      if (bytes == len)
+	return 0;
+
+      /* Some data was read, we'll try to get the rest another way.  */
+      if (bytes > 0)
+	{
+	  memaddr += bytes;
+	  myaddr += bytes;
+	  len -= bytes;
+	}
+    }
+#endif
+
   /* Try using /proc.  Don't bother for one word.  */
   if (len >= 3 * sizeof (long))
     {
@@ -5816,6 +5906,68 @@ linux_read_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len)
   return ret;
 }
 
+/* Implementation of the read_memory_multiple target_ops method.  Read
+   as many regions as possible with each process_vm_readv call, and
+   fall back to linux_read_memory for the regions it can't read.  */
+
+static void
+linux_read_memory_multiple (struct memory_read_request *requests, int count)
+{
+  int i = 0;
+
+#ifdef __NR_process_vm_readv
+  int pid = lwpid_of (current_thread);
+
+  while (linux_process_vm_usable && i < count)
+    {
+      struct iovec local[LINUX_PROCESS_VM_IOVECS];
+      struct iovec remote[LINUX_PROCESS_VM_IOVECS];
+      int n = std::min (count - i, LINUX_PROCESS_VM_IOVECS);
+      int end = i + n;
+      ssize_t bytes;
+      int j;
+
+      for (j = 0; j < n; j++)
+	{
+	  local[j].iov_base = requests[i + j].buf;
+	  local[j].iov_len = requests[i + j].len;
+	  remote[j].iov_base = (void *) (uintptr_t) requests[i + j].addr;
+	  remote[j].iov_len = requests[i + j].len;
+	}
+
+      bytes = linux_process_vm_xfer (pid, local, remote, n, 0);
+      if (bytes < 0)
+	break;
+
+      /* The transfer stops at the first region that isn't readable
+	 in full.  Read that one the slow way, and go on with the
+	 following ones.  */
+      for (; i < end && bytes >= requests[i].len; i++)
+	{
+	  requests[i].xfered = requests[i].len;
+	  bytes -= requests[i].len;
+	}
+      if (i < end)
+	{
+	  struct memory_read_request *req = &requests[i];
+
+	  req->xfered
+	    = linux_read_memory (req->addr, req->buf, req->len) == 0
+	      ? req->len : 0;
+	  i++;
+	}
+    }
+#endif
+
+  for (; i < count; i++)
+    {
+      struct memory_read_request *req = &requests[i];
+
+      req->xfered = (linux_read_memory (req->addr, req->buf, req->len) == 0
+		     ? req->len : 0);
+    }
+}
+
 /* Copy LEN bytes of data from debugger memory at MYADDR to inferior's
    memory at MEMADDR.  On failure (cannot write to the inferior)
    returns the value of errno.  Always succeeds if LEN is zero.  */
@@ -5860,6 +6012,30 @@ linux_write_memory (CORE_ADDR memaddr, const unsigned char *myaddr, int len)
 		    str, (long) memaddr, pid);
     }
 
+#ifdef __NR_process_vm_writev
+  /* Try a single process_vm_writev call first.  It fails on pages the
+     inferior itself can't write, such as code when inserting
+     breakpoints; ptrace is used for those.  */
+  if (linux_process_vm_usable)
+    {
+      ssize_t bytes
+	= linux_process_vm_xfer_1 (pid, memaddr, (void *) myaddr, len, 1);
+
+      if (bytes == len)
+	return 0;
+
+      if (bytes > 0)
+	{
+	  memaddr += bytes;
+	  myaddr += bytes;
+	  len -= bytes;
+	  addr = memaddr & -(CORE_ADDR) sizeof (PTRACE_XFER_TYPE);
+	  count = ((((memaddr + len) - addr) + sizeof (PTRACE_XFER_TYPE) - 1)
+		   / sizeof (PTRACE_XFER_TYPE));
+	}
+    }
+#endif
+
   /* Fill start and end extra bytes of buffer with existing memory data.  */
 
   errno = 0;
@@ -6659,6 +6835,80 @@ linux_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
      err);
 }
 
+static int
+linux_install_breakpoint_jump_pad (CORE_ADDR bpoint, CORE_ADDR bpaddr,
+				   CORE_ADDR checker,
+				   CORE_ADDR lockaddr,
+				   ULONGEST orig_size,
+				   CORE_ADDR *jump_entry,
+				   unsigned char *jjump_pad_insn,
+				   ULONGEST *jjump_pad_insn_size,
+				   CORE_ADDR *adjusted_insn_addr,
+				   CORE_ADDR *adjusted_insn_addr_end,
+				   CORE_ADDR *trap_addr,
+				   char *err)
+{
+  if (the_low_target.install_breakpoint_jump_pad == NULL)
+    {
+      strcpy (err, "E.Breakpoint jump pads are not supported.");
+      return 1;
+    }
+
+  return (*the_low_target.install_breakpoint_jump_pad)
+    (bpoint, bpaddr, checker, lockaddr, orig_size, jump_entry,
+     jjump_pad_insn, jjump_pad_insn_size,
+     adjusted_insn_addr, adjusted_insn_addr_end,
+     trap_addr, err);
+}
+
+/* Implementation of the open_inferior_fd target_ops method.  */
+
+static int
+linux_open_inferior_fd (int pid, int fd, int flags)
+{
+  char filename[PATH_MAX];
+
+  xsnprintf (filename, sizeof filename, "/proc/%d/fd/%d", pid, fd);
+  return gdb_open_cloexec (filename, flags, 0);
+}
+
+/* Implementation of the map_inferior_fd target_ops method.  */
+
+static void *
+linux_map_inferior_fd (int pid, int fd, size_t *size)
+{
+  struct stat st;
+  void *addr;
+  int local_fd;
+
+  local_fd = linux_open_inferior_fd (pid, fd, O_RDWR);
+  if (local_fd < 0)
+    return NULL;
+
+  if (fstat (local_fd, &st) != 0 || st.st_size == 0)
+    {
+      close (local_fd);
+      return NULL;
+    }
+
+  addr = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	       local_fd, 0);
+  close (local_fd);
+  if (addr == MAP_FAILED)
+    return NULL;
+
+  *size = st.st_size;
+  return addr;
+}
+
+/* Implementation of the unmap_inferior_fd target_ops method.  */
+
+static void
+linux_unmap_inferior_fd (void *addr, size_t size)
+{
+  munmap (addr, size);
+}
+
 static struct emit_ops *
 linux_emit_ops (void)
 {
@@ -7550,6 +7800,11 @@ static struct target_ops linux_target_ops = {
 #else
   NULL,
 #endif
+  linux_read_memory_multiple,
+  linux_install_breakpoint_jump_pad,
+  linux_open_inferior_fd,
+  linux_map_inferior_fd,
+  linux_unmap_inferior_fd,
 };
 
 #ifdef HAVE_LINUX_REGSETS
@@ -256,6 +256,19 @@ struct linux_target_ops
 
   /* See target.h.  */
   int (*get_ipa_tdesc_idx) (void);
+
+  /* Install a breakpoint jump pad.  See target.h for comments.  */
+  int (*install_breakpoint_jump_pad) (CORE_ADDR bpoint, CORE_ADDR bpaddr,
+				      CORE_ADDR checker,
+				      CORE_ADDR lockaddr,
+				      ULONGEST orig_size,
+				      CORE_ADDR *jump_entry,
+				      unsigned char *jjump_pad_insn,
+				      ULONGEST *jjump_pad_insn_size,
+				      CORE_ADDR *adjusted_insn_addr,
+				      CORE_ADDR *adjusted_insn_addr_end,
+				      CORE_ADDR *trap_addr,
+				      char *err);
 };
 
 extern struct linux_target_ops the_low_target;
@@ -1019,26 +1019,71 @@ push_opcode (unsigned char *buf, const char *op)
 
 #ifdef __x86_64__
 
+/* The number of registers amd64 jump pads save, in GDB's numbering:
+   the general purpose registers, %rip and %eflags.  See get_raw_reg
+   in linux-amd64-ipa.c.  */
+#define AMD64_NUM_JUMP_PAD_REGS 18
+
+/* Write to BUF the instructions restoring the registers saved by an
+   amd64 jump pad, once the collecting_t object is off the stack.
+   Returns the length of the instructions.  */
+
+static int
+amd64_jump_pad_restore_insns (unsigned char *buf)
+{
+  int i = 0;
+
+  buf[i++] = 0x48; /* add $0x8,%rsp */
+  buf[i++] = 0x83;
+  buf[i++] = 0xc4;
+  buf[i++] = 0x08;
+  buf[i++] = 0x9d; /* popfq */
+  buf[i++] = 0x41; buf[i++] = 0x58; /* pop %r8 */
+  buf[i++] = 0x41; buf[i++] = 0x59; /* pop %r9 */
+  buf[i++] = 0x41; buf[i++] = 0x5a; /* pop %r10 */
+  buf[i++] = 0x41; buf[i++] = 0x5b; /* pop %r11 */
+  buf[i++] = 0x41; buf[i++] = 0x5c; /* pop %r12 */
+  buf[i++] = 0x41; buf[i++] = 0x5d; /* pop %r13 */
+  buf[i++] = 0x41; buf[i++] = 0x5e; /* pop %r14 */
+  buf[i++] = 0x41; buf[i++] = 0x5f; /* pop %r15 */
+  buf[i++] = 0x58; /* pop %rax */
+  buf[i++] = 0x5b; /* pop %rbx */
+  buf[i++] = 0x59; /* pop %rcx */
+  buf[i++] = 0x5a; /* pop %rdx */
+  buf[i++] = 0x5e; /* pop %rsi */
+  buf[i++] = 0x5f; /* pop %rdi */
+  buf[i++] = 0x5d; /* pop %rbp */
+  buf[i++] = 0x5c; /* pop %rsp */
+
+  return i;
+}
+
 /* Build a jump pad that saves registers and calls a collection
    function.  Writes a jump instruction to the jump pad to
    JJUMPAD_INSN.  The caller is responsible to write it in at the
-   tracepoint address.  */
+   tracepoint address.
+
+   If TRAP_ADDR is not NULL, the jump pad is for the conditions of a
+   breakpoint.  Since breakpoints may be anywhere, such a jump pad
+   keeps off the red zone below the stack pointer.  If the collection
+   function returns non-zero, the jump pad restores the registers and
+   runs into a breakpoint instruction, whose address is returned in
+   *TRAP_ADDR, instead of the relocated instruction.  */
 
 static int
-amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
-					CORE_ADDR collector,
-					CORE_ADDR lockaddr,
-					ULONGEST orig_size,
-					CORE_ADDR *jump_entry,
-					CORE_ADDR *trampoline,
-					ULONGEST *trampoline_size,
-					unsigned char *jjump_pad_insn,
-					ULONGEST *jjump_pad_insn_size,
-					CORE_ADDR *adjusted_insn_addr,
-					CORE_ADDR *adjusted_insn_addr_end,
-					char *err)
-{
-  unsigned char buf[40];
+amd64_install_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
+			CORE_ADDR collector,
+			CORE_ADDR lockaddr,
+			ULONGEST orig_size,
+			CORE_ADDR *jump_entry,
+			unsigned char *jjump_pad_insn,
+			ULONGEST *jjump_pad_insn_size,
+			CORE_ADDR *adjusted_insn_addr,
+			CORE_ADDR *adjusted_insn_addr_end,
+			CORE_ADDR *trap_addr,
+			char *err)
+{
+  unsigned char buf[64];
   int i, offset;
   int64_t loffset;
 
@@ -1048,6 +1093,8 @@ amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
 
   /* First, do tracepoint data collection.  Save registers.  */
   i = 0;
+  if (trap_addr != NULL)
+    i += push_opcode (&buf[i], "48 8d 64 24 80"); /* lea -0x80(%rsp),%rsp */
   /* Need to ensure stack pointer saved first.  */
   buf[i++] = 0x54; /* push %rsp */
   buf[i++] = 0x55; /* push %rbp */
@@ -1073,6 +1120,16 @@ amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
   buf[i++] = 0x57; /* push %rdi */
   append_insns (&buildaddr, i, buf);
 
+  if (trap_addr != NULL)
+    {
+      /* Save the stack pointer as it was before skipping the red
+	 zone.  The flags are saved already.  */
+      i = 0;
+      i += push_opcode (&buf[i], "48 81 84 24 88 00 00 00 80 00 00 00");
+				/* addq $0x80,0x88(%rsp) */
+      append_insns (&buildaddr, i, buf);
+    }
+
   /* Stack space for the collecting_t object.  */
   i = 0;
   i += push_opcode (&buf[i], "48 83 ec 18");	/* sub $0x18,%rsp */
@@ -1112,16 +1169,25 @@ amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
   append_insns (&buildaddr, i, buf);
 
   /* The collector function being in the shared library, may be
-     >31-bits away off the jump pad.  */
+     >31-bits away off the jump pad.  The stack pointer of the
+     interrupted code may not be 16-byte aligned, as the ABI requires
+     at calls, so align it, keeping its value in %rbx, which the
+     collector preserves, and which we restore from the register
+     block afterwards.  */
   i = 0;
+  i += push_opcode (&buf[i], "48 89 e3");	/* mov %rsp,%rbx */
+  i += push_opcode (&buf[i], "48 83 e4 f0");	/* and $-16,%rsp */
   i += push_opcode (&buf[i], "48 b8");          /* mov $collector,%rax */
   memcpy (buf + i, &collector, 8);
   i += 8;
   i += push_opcode (&buf[i], "ff d0");          /* callq *%rax */
+  i += push_opcode (&buf[i], "48 89 dc");	/* mov %rbx,%rsp */
   append_insns (&buildaddr, i, buf);
 
   /* Clear the spin-lock.  */
   i = 0;
+  if (trap_addr != NULL)
+    i += push_opcode (&buf[i], "89 c2");	/* mov %eax,%edx */
   i += push_opcode (&buf[i], "31 c0");		/* xor %eax,%eax */
   i += push_opcode (&buf[i], "48 a3");		/* mov %rax, lockaddr */
   memcpy (buf + i, &lockaddr, 8);
@@ -1133,35 +1199,38 @@ amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
   i += push_opcode (&buf[i], "48 83 c4 18");	/* add $0x18,%rsp */
   append_insns (&buildaddr, i, buf);
 
+  if (trap_addr != NULL)
+    {
+      unsigned char restore[40];
+      int restore_len = amd64_jump_pad_restore_insns (restore);
+
+      /* Unless the collector returned zero, restore register state
+	 and trap.  */
+      i = 0;
+      i += push_opcode (&buf[i], "85 d2");	/* test %edx,%edx */
+      buf[i++] = 0x74;				/* je <past the trap> */
+      buf[i++] = restore_len + 1;
+      memcpy (buf + i, restore, restore_len);
+      i += restore_len;
+      *trap_addr = buildaddr + i;
+      buf[i++] = 0xcc;				/* int3 */
+      append_insns (&buildaddr, i, buf);
+    }
+
   /* Restore register state.  */
-  i = 0;
-  buf[i++] = 0x48; /* add $0x8,%rsp */
-  buf[i++] = 0x83;
-  buf[i++] = 0xc4;
-  buf[i++] = 0x08;
-  buf[i++] = 0x9d; /* popfq */
-  buf[i++] = 0x41; buf[i++] = 0x58; /* pop %r8 */
-  buf[i++] = 0x41; buf[i++] = 0x59; /* pop %r9 */
-  buf[i++] = 0x41; buf[i++] = 0x5a; /* pop %r10 */
-  buf[i++] = 0x41; buf[i++] = 0x5b; /* pop %r11 */
-  buf[i++] = 0x41; buf[i++] = 0x5c; /* pop %r12 */
-  buf[i++] = 0x41; buf[i++] = 0x5d; /* pop %r13 */
-  buf[i++] = 0x41; buf[i++] = 0x5e; /* pop %r14 */
-  buf[i++] = 0x41; buf[i++] = 0x5f; /* pop %r15 */
-  buf[i++] = 0x58; /* pop %rax */
-  buf[i++] = 0x5b; /* pop %rbx */
-  buf[i++] = 0x59; /* pop %rcx */
-  buf[i++] = 0x5a; /* pop %rdx */
-  buf[i++] = 0x5e; /* pop %rsi */
-  buf[i++] = 0x5f; /* pop %rdi */
-  buf[i++] = 0x5d; /* pop %rbp */
-  buf[i++] = 0x5c; /* pop %rsp */
+  i = amd64_jump_pad_restore_insns (buf);
   append_insns (&buildaddr, i, buf);
 
   /* Now, adjust the original instruction to execute in the jump
      pad.  */
   *adjusted_insn_addr = buildaddr;
-  relocate_instruction (&buildaddr, tpaddr);
+  if (relocate_instruction (&buildaddr, tpaddr) != 0
+      || buildaddr == *adjusted_insn_addr)
+    {
+      sprintf (err, "E.Could not relocate instruction at 0x%s.",
+	       paddress (tpaddr));
+      return 1;
+    }
   *adjusted_insn_addr_end = buildaddr;
 
   /* Finally, write a jump back to the program.  */
@@ -1206,6 +1275,30 @@ amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
   return 0;
 }
 
+/* Build a jump pad that saves registers and calls a collection
+   function.  See amd64_install_jump_pad.  */
+
+static int
+amd64_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
+					CORE_ADDR collector,
+					CORE_ADDR lockaddr,
+					ULONGEST orig_size,
+					CORE_ADDR *jump_entry,
+					CORE_ADDR *trampoline,
+					ULONGEST *trampoline_size,
+					unsigned char *jjump_pad_insn,
+					ULONGEST *jjump_pad_insn_size,
+					CORE_ADDR *adjusted_insn_addr,
+					CORE_ADDR *adjusted_insn_addr_end,
+					char *err)
+{
+  return amd64_install_jump_pad (tpoint, tpaddr, collector, lockaddr,
+				 orig_size, jump_entry,
+				 jjump_pad_insn, jjump_pad_insn_size,
+				 adjusted_insn_addr, adjusted_insn_addr_end,
+				 NULL, err);
+}
+
 #endif /* __x86_64__ */
 
 /* Build a jump pad that saves registers and calls a collection
@@ -1434,6 +1527,32 @@ x86_install_fast_tracepoint_jump_pad (CORE_ADDR tpoint, CORE_ADDR tpaddr,
 						err);
 }
 
+static int
+x86_install_breakpoint_jump_pad (CORE_ADDR bpoint, CORE_ADDR bpaddr,
+				 CORE_ADDR checker,
+				 CORE_ADDR lockaddr,
+				 ULONGEST orig_size,
+				 CORE_ADDR *jump_entry,
+				 unsigned char *jjump_pad_insn,
+				 ULONGEST *jjump_pad_insn_size,
+				 CORE_ADDR *adjusted_insn_addr,
+				 CORE_ADDR *adjusted_insn_addr_end,
+				 CORE_ADDR *trap_addr,
+				 char *err)
+{
+#ifdef __x86_64__
+  if (is_64bit_tdesc ())
+    return amd64_install_jump_pad (bpoint, bpaddr, checker, lockaddr,
+				   orig_size, jump_entry,
+				   jjump_pad_insn, jjump_pad_insn_size,
+				   adjusted_insn_addr, adjusted_insn_addr_end,
+				   trap_addr, err);
+#endif
+
+  strcpy (err, "E.Breakpoint jump pads are only supported on x86-64.");
+  return 1;
+}
+
 /* Return the minimum instruction length for fast tracepoints on x86/x86-64
    architectures.  */
 
@@ -1833,9 +1952,19 @@ amd64_emit_reg (int reg)
   int i;
   CORE_ADDR buildaddr;
 
-  /* Assume raw_regs is still in %rdi.  */
+  /* Rather than reading zero, refuse to compile accesses to registers
+     the jump pads don't save.  */
+  if (reg >= AMD64_NUM_JUMP_PAD_REGS)
+    {
+      emit_error = 1;
+      return;
+    }
+
+  /* Calls to other helpers may have clobbered %rdi; reload raw_regs
+     from where the prologue saved it.  */
   buildaddr = current_insn_ptr;
   i = 0;
+  i += push_opcode (&buf[i], "48 8b 7d f8"); /* mov -0x8(%rbp),%rdi */
   buf[i++] = 0xbe; /* mov $<n>,%esi */
   memcpy (&buf[i], &reg, sizeof (reg));
   i += 4;
@@ -2883,6 +3012,7 @@ struct linux_target_ops the_low_target =
   x86_supports_hardware_single_step,
   x86_get_syscall_trapinfo,
   x86_get_ipa_tdesc_idx,
+  x86_install_breakpoint_jump_pad,
 };
 
 void
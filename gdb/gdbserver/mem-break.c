@@ -21,6 +21,7 @@
 #include "server.h"
 #include "regcache.h"
 #include "ax.h"
+#include "tracepoint.h"
 
 #define MAX_BREAKPOINT_LEN 8
 
@@ -113,6 +114,14 @@ struct raw_breakpoint
      inferior.  Negative if it was, but we've detected that it's now
      gone.  Zero if not inserted.  */
   int inserted;
+
+  /* If non-zero, the length of JUMP_INSN, which is inserted instead
+     of the breakpoint instruction.  See update_breakpoint_jump.  */
+  int jump_size;
+
+  /* A jump to a jump pad that evaluates the conditions of the GDB
+     breakpoint at PC, and only traps if one of them is true.  */
+  unsigned char jump_insn[MAX_BREAKPOINT_LEN];
 };
 
 /* The type of a breakpoint.  */
@@ -216,27 +225,38 @@ struct single_step_breakpoint
   ptid_t ptid;
 };
 
-/* Return the breakpoint size from its kind.  */
+/* Return the breakpoint size from its kind, or the size of its jump
+   if it has one.  */
 
 static int
 bp_size (struct raw_breakpoint *bp)
 {
   int size = 0;
 
+  if (bp->jump_size != 0)
+    return bp->jump_size;
+
   the_target->sw_breakpoint_from_kind (bp->kind, &size);
   return size;
 }
 
-/* Return the breakpoint opcode from its kind.  */
+/* Return the breakpoint opcode from its kind, or its jump if it has
+   one.  */
 
 static const gdb_byte *
 bp_opcode (struct raw_breakpoint *bp)
 {
   int size = 0;
 
+  if (bp->jump_size != 0)
+    return bp->jump_insn;
+
   return the_target->sw_breakpoint_from_kind (bp->kind, &size);
 }
 
+static void set_raw_breakpoint_jump (struct raw_breakpoint *bp,
+				     const unsigned char *insn, int size);
+
 /* See mem-break.h.  */
 
 enum target_hw_bp_type
@@ -446,6 +466,11 @@ set_raw_breakpoint_at (enum raw_bkpt_type type, CORE_ADDR where, int kind,
 	  bp->inserted = -1;
 	  bp = NULL;
 	}
+
+      /* The GDB breakpoint already here only traps when its
+	 conditions are true; this new breakpoint must always trap.  */
+      if (bp != NULL && bp->jump_size != 0)
+	set_raw_breakpoint_jump (bp, NULL, 0);
     }
   else
     bp = find_raw_breakpoint_at (where, type, kind);
@@ -641,6 +666,14 @@ set_fast_tracepoint_jump (CORE_ADDR where,
       return jp;
     }
 
+  /* GDB breakpoints in the way must trap on top of the fast
+     tracepoint jump rather than jump to their own jump pads.  */
+  for (struct raw_breakpoint *bp = proc->raw_breakpoints;
+       bp != NULL; bp = bp->next)
+    if (bp->jump_size != 0
+	&& bp->pc < where + length && where < bp->pc + bp->jump_size)
+      set_raw_breakpoint_jump (bp, NULL, 0);
+
   /* We don't, so create a new object.  Double the length, because the
      flexible array member holds both the jump insn, and the
      shadow.  */
@@ -1632,6 +1665,109 @@ reinsert_raw_breakpoint (struct raw_breakpoint *bp)
 		  paddress (bp->pc), err);
 }
 
+/* Have BP insert the SIZE bytes long jump INSN instead of the
+   breakpoint instruction, or the breakpoint instruction again if SIZE
+   is 0.  If BP is inserted, it is reinserted in the new form; if the
+   jump can't be inserted, BP falls back to the breakpoint
+   instruction.  */
+
+static void
+set_raw_breakpoint_jump (struct raw_breakpoint *bp,
+			 const unsigned char *insn, int size)
+{
+  int was_inserted = bp->inserted > 0;
+
+  if (bp->jump_size == size
+      && (size == 0 || memcmp (bp->jump_insn, insn, size) == 0))
+    return;
+
+  if (was_inserted)
+    {
+      uninsert_raw_breakpoint (bp);
+      if (bp->inserted)
+	return;
+    }
+
+  bp->jump_size = size;
+  if (size != 0)
+    memcpy (bp->jump_insn, insn, size);
+
+  if (was_inserted)
+    {
+      reinsert_raw_breakpoint (bp);
+      if (!bp->inserted && bp->jump_size != 0)
+	{
+	  bp->jump_size = 0;
+	  reinsert_raw_breakpoint (bp);
+	}
+    }
+}
+
+/* Return true if anything else than BP itself is inserted, or would
+   be inserted, in the INSN_LEN bytes at BP's address.  */
+
+static int
+breakpoint_jump_overlaps (struct raw_breakpoint *bp, int insn_len)
+{
+  struct process_info *proc = current_process ();
+  struct fast_tracepoint_jump *jp;
+  struct raw_breakpoint *other;
+
+  for (jp = proc->fast_tracepoint_jumps; jp != NULL; jp = jp->next)
+    if (jp->pc < bp->pc + insn_len && bp->pc < jp->pc + jp->length)
+      return 1;
+
+  for (other = proc->raw_breakpoints; other != NULL; other = other->next)
+    if (other != bp
+	&& (other->raw_type == raw_bkpt_type_sw
+	    || other->raw_type == raw_bkpt_type_hw)
+	&& other->pc >= bp->pc && other->pc < bp->pc + insn_len)
+      return 1;
+
+  return 0;
+}
+
+/* See mem-break.h.  */
+
+void
+update_breakpoint_jump (struct gdb_breakpoint *bp, int insn_len)
+{
+  struct raw_breakpoint *raw = bp->base.raw;
+  const unsigned char *insn = NULL;
+  int size = 0;
+
+  if (prepare_to_access_memory () != 0)
+    return;
+
+  if (bp->base.type == gdb_breakpoint_Z0
+      && raw->raw_type == raw_bkpt_type_sw
+      && raw->refcount == 1
+      && raw->inserted > 0
+      && bp->cond_list != NULL
+      && bp->command_list == NULL
+      && insn_len > 0
+      && !breakpoint_jump_overlaps (raw, insn_len))
+    {
+      std::vector<struct agent_expr *> conds;
+      struct point_cond_list *cl;
+
+      for (cl = bp->cond_list; cl != NULL; cl = cl->next)
+	conds.push_back (cl->cond);
+
+      insn = get_breakpoint_jump_pad (raw->pc, insn_len, conds, &size);
+      if (insn == NULL || size > MAX_BREAKPOINT_LEN)
+	size = 0;
+    }
+
+  if (debug_threads && size != 0)
+    debug_printf ("Evaluating conditions of breakpoint at 0x%s"
+		  " in a jump pad.\n", paddress (raw->pc));
+
+  set_raw_breakpoint_jump (raw, insn, size);
+
+  done_accessing_memory ();
+}
+
 void
 reinsert_breakpoints_at (CORE_ADDR pc)
 {
@@ -2097,6 +2233,10 @@ delete_all_breakpoints (void)
 
   while (proc->breakpoints)
     delete_breakpoint_1 (proc, proc->breakpoints);
+
+  /* The process is going away, or exec'd, so its breakpoint jump pads
+     are gone too.  */
+  free_breakpoint_jump_pads (proc->pid);
 }
 
 /* Clear the "inserted" flag in all breakpoints.  */
@@ -2124,6 +2264,10 @@ free_all_breakpoints (struct process_info *proc)
      current_process from here on.  */
   while (proc->breakpoints)
     delete_breakpoint_1 (proc, proc->breakpoints);
+
+  /* The process is going away, or exec'd, so its breakpoint jump pads
+     are gone too.  */
+  free_breakpoint_jump_pads (proc->pid);
 }
 
 /* Clone an agent expression.  */
@@ -2156,6 +2300,8 @@ clone_one_breakpoint (const struct breakpoint *src, ptid_t ptid)
   dest_raw->kind = src->raw->kind;
   memcpy (dest_raw->old_data, src->raw->old_data, MAX_BREAKPOINT_LEN);
   dest_raw->inserted = src->raw->inserted;
+  dest_raw->jump_size = src->raw->jump_size;
+  memcpy (dest_raw->jump_insn, src->raw->jump_insn, MAX_BREAKPOINT_LEN);
 
   /* Clone the high-level breakpoint.  */
   if (is_gdb_breakpoint (src->type))
@@ -127,6 +127,16 @@ int add_breakpoint_commands (struct gdb_breakpoint *bp, const char **commands,
 
 int any_persistent_commands (void);
 
+/* Have the software breakpoint BP, whose conditions and commands have
+   just been (re)set, jump to a jump pad that evaluates its conditions
+   in the inferior, and only traps if one of them is true, instead of
+   always trapping.  INSN_LEN is the length of the instruction at BP's
+   address, or 0 if unknown.  BP reverts to trapping when that isn't
+   possible, e.g., if the in-process agent isn't loaded or BP has
+   commands.  */
+
+void update_breakpoint_jump (struct gdb_breakpoint *bp, int insn_len);
+
 /* Evaluation condition (if any) at breakpoint BP.  Return 1 if
    true and 0 otherwise.  */
 
@@ -58,6 +58,7 @@ get_thread_regcache (struct thread_info *thread, int fetch)
       fetch_inferior_registers (regcache, -1);
       current_thread = saved_thread;
       regcache->registers_valid = 1;
+      regcache->registers_dirty = 0;
     }
 
   return regcache;
@@ -81,7 +82,7 @@ regcache_invalidate_thread (struct thread_info *thread)
   if (regcache == NULL)
     return;
 
-  if (regcache->registers_valid)
+  if (regcache->registers_valid && regcache->registers_dirty)
     {
       struct thread_info *saved_thread = current_thread;
 
@@ -91,6 +92,7 @@ regcache_invalidate_thread (struct thread_info *thread)
     }
 
   regcache->registers_valid = 0;
+  regcache->registers_dirty = 0;
 }
 
 /* See regcache.h.  */
@@ -150,6 +152,7 @@ init_register_cache (struct regcache *regcache,
     }
 
   regcache->registers_valid = 0;
+  regcache->registers_dirty = 0;
 
   return regcache;
 }
@@ -194,6 +197,7 @@ regcache_cpy (struct regcache *dst, struct regcache *src)
 	    src->tdesc->reg_defs.size ());
 #endif
   dst->registers_valid = src->registers_valid;
+  dst->registers_dirty = 1;
 }
 
 
@@ -237,6 +241,7 @@ registers_from_string (struct regcache *regcache, char *buf)
 	len = tdesc->registers_size * 2;
     }
   hex2bin (buf, registers, len / 2);
+  regcache->registers_dirty = 1;
 }
 
 int
@@ -303,9 +308,15 @@ regcache_register_size (const struct regcache *regcache, int n)
   return register_size (regcache->tdesc, n);
 }
 
+/* Return a pointer to the contents of register N in REGCACHE.  FETCH
+   is zero if the caller is going to write to the register.  */
+
 static unsigned char *
 register_data (struct regcache *regcache, int n, int fetch)
 {
+  if (!fetch)
+    regcache->registers_dirty = 1;
+
   return (regcache->registers
 	  + find_register_by_number (regcache->tdesc, n)->offset / 8);
 }
@@ -362,6 +373,7 @@ supply_regblock (struct regcache *regcache, const void *buf)
       const struct target_desc *tdesc = regcache->tdesc;
 
       memcpy (regcache->registers, buf, tdesc->registers_size);
+      regcache->registers_dirty = 1;
 #ifndef IN_PROCESS_AGENT
       {
 	int i;
@@ -376,6 +388,7 @@ supply_regblock (struct regcache *regcache, const void *buf)
       const struct target_desc *tdesc = regcache->tdesc;
 
       memset (regcache->registers, 0, tdesc->registers_size);
+      regcache->registers_dirty = 1;
 #ifndef IN_PROCESS_AGENT
       {
 	int i;
@@ -39,6 +39,13 @@ struct regcache
      "valid" here is unrelated to whether the registers are available
      in a traceframe.  For that, check REGISTER_STATUS below.  */
   int registers_valid;
+
+  /* Whether the REGISTERS buffer was written to since the registers
+     were fetched from the target.  Registers are only stored back to
+     the target when the cache is invalidated if this is set, to avoid
+     rewriting the whole register set of every thread we looked at
+     each time it is resumed.  */
+  int registers_dirty;
   int registers_owned;
   unsigned char *registers;
 #ifndef IN_PROCESS_AGENT
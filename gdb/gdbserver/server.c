@@ -41,6 +41,7 @@
 #include "environ.h"
 
 #include "common/selftest.h"
+#include "common/byte-vector.h"
 
 #define require_running_or_return(BUF)		\
   if (!target_running ())			\
@@ -1184,6 +1185,98 @@ handle_search_memory (char *own_buf, int packet_len)
   free (pattern);
 }
 
+/* Handle qMultiMemRead packets.  The packet looks like
+   "qMultiMemRead:ADDR,LENGTH;ADDR,LENGTH...".  The reply gives the
+   number of bytes read for each region, separated by commas, then a
+   semicolon and the contents read for all the regions, in hex.  */
+
+static void
+handle_multi_mem_read (char *own_buf)
+{
+  std::vector<memory_read_request> requests;
+  const char *p = own_buf + sizeof ("qMultiMemRead:") - 1;
+  ULONGEST total = 0;
+
+  while (*p != '\0')
+    {
+      ULONGEST addr, len;
+
+      p = unpack_varlen_hex (p, &addr);
+      if (*p != ',')
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+      p = unpack_varlen_hex (p + 1, &len);
+      if (*p == ';')
+	p++;
+      else if (*p != '\0')
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+
+      total += len;
+      if (total >= PBUFSIZ)
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+      requests.push_back ({ addr, (int) len, NULL, 0 });
+    }
+
+  /* Make sure the reply fits, counting up to 16 digits and a
+     separator for each length.  */
+  if (requests.empty ()
+      || total * 2 + requests.size () * 17 >= PBUFSIZ)
+    {
+      write_enn (own_buf);
+      return;
+    }
+
+  gdb::byte_vector data (total);
+  std::string reply;
+  ULONGEST offset = 0;
+
+  for (auto &req : requests)
+    {
+      req.buf = data.data () + offset;
+      offset += req.len;
+    }
+
+  if (current_traceframe >= 0)
+    {
+      for (auto &req : requests)
+	{
+	  int res = gdb_read_memory (req.addr, req.buf, req.len);
+
+	  req.xfered = res < 0 ? 0 : res;
+	}
+    }
+  else if (prepare_to_access_memory () == 0)
+    {
+      if (set_desired_thread ())
+	read_inferior_memory_multiple (requests.data (), requests.size ());
+      done_accessing_memory ();
+    }
+
+  /* Unreadable regions are reported as zero bytes read.  Move the
+     contents of the regions that were read together.  */
+  offset = 0;
+  for (const auto &req : requests)
+    {
+      if (!reply.empty ())
+	reply += ',';
+      reply += phex_nz (req.xfered, sizeof (req.xfered));
+      memmove (data.data () + offset, req.buf, req.xfered);
+      offset += req.xfered;
+    }
+  reply += ';';
+
+  strcpy (own_buf, reply.c_str ());
+  bin2hex (data.data (), own_buf + reply.size (), offset);
+}
+
 /* Handle the "D" packet.  */
 
 static void
@@ -2450,6 +2543,9 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
 	  || target_supports_software_single_step () )
 	{
 	  strcat (own_buf, ";ConditionalBreakpoints+");
+	  if (gdb_supports_qRelocInsn
+	      && target_supports_breakpoint_jump_pads ())
+	    strcat (own_buf, ";BreakpointJumpPads+");
 	}
       strcat (own_buf, ";BreakpointCommands+");
 
@@ -2473,6 +2569,8 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
 
       strcat (own_buf, ";no-resumed+");
 
+      strcat (own_buf, ";qMultiMemRead+");
+
       /* Reinitialize components as needed for the new connection.  */
       hostio_handle_new_gdb_connection ();
       target_handle_new_gdb_connection ();
@@ -2607,6 +2705,13 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
       return;
     }
 
+  if (startswith (own_buf, "qMultiMemRead:"))
+    {
+      require_running_or_return (own_buf);
+      handle_multi_mem_read (own_buf);
+      return;
+    }
+
   if (strcmp (own_buf, "qAttached") == 0
       || startswith (own_buf, "qAttached:"))
     {
@@ -3941,10 +4046,13 @@ main (int argc, char *argv[])
 
 /* Process options coming from Z packets for a breakpoint.  PACKET is
    the packet buffer.  *PACKET is updated to point to the first char
-   after the last processed option.  */
+   after the last processed option.  The length of the instruction at
+   the breakpoint's address, if GDB sent it, is stored in *INSN_LEN,
+   which is left unchanged otherwise.  */
 
 static void
-process_point_options (struct gdb_breakpoint *bp, const char **packet)
+process_point_options (struct gdb_breakpoint *bp, const char **packet,
+		       int *insn_len)
 {
   const char *dataptr = *packet;
   int persist;
@@ -3978,6 +4086,14 @@ process_point_options (struct gdb_breakpoint *bp, const char **packet)
 	  if (add_breakpoint_commands (bp, &dataptr, persist))
 	    dataptr = strchrnul (dataptr, ';');
 	}
+      else if (startswith (dataptr, "ilen:"))
+	{
+	  ULONGEST len;
+
+	  dataptr = unpack_varlen_hex (dataptr + strlen ("ilen:"), &len);
+	  *insn_len = len;
+	  dataptr = strchrnul (dataptr, ';');
+	}
       else
 	{
 	  fprintf (stderr, "Unknown token %c, ignoring.\n",
@@ -4227,7 +4343,13 @@ process_serial_event (void)
 		   instead.  */
 		clear_breakpoint_conditions_and_commands (bp);
 		const char *options = dataptr;
-		process_point_options (bp, &options);
+		int insn_len = 0;
+		process_point_options (bp, &options, &insn_len);
+
+		/* With the conditions known, see whether they can be
+		   evaluated without trapping.  */
+		if (type == Z_PACKET_SW_BP)
+		  update_breakpoint_jump (bp, insn_len);
 	      }
 	  }
 	else
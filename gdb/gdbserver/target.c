@@ -125,6 +125,32 @@ read_inferior_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len)
   return res;
 }
 
+/* See target.h.  */
+
+void
+read_inferior_memory_multiple (struct memory_read_request *requests,
+			       int count)
+{
+  int i;
+
+  if (the_target->read_memory_multiple != NULL)
+    the_target->read_memory_multiple (requests, count);
+  else
+    for (i = 0; i < count; i++)
+      {
+	struct memory_read_request *req = &requests[i];
+
+	if ((*the_target->read_memory) (req->addr, req->buf, req->len) == 0)
+	  req->xfered = req->len;
+	else
+	  req->xfered = 0;
+      }
+
+  for (i = 0; i < count; i++)
+    if (requests[i].xfered != 0)
+      check_mem_read (requests[i].addr, requests[i].buf, requests[i].xfered);
+}
+
 /* See target/target.h.  */
 
 int
@@ -63,6 +63,19 @@ struct thread_resume
   CORE_ADDR step_range_end;	/* Exclusive */
 };
 
+/* A region of memory to read with read_inferior_memory_multiple.  */
+
+struct memory_read_request
+{
+  /* The address and length of the region.  */
+  CORE_ADDR addr;
+  int len;
+  /* Where to store the contents of the region.  */
+  unsigned char *buf;
+  /* Set to LEN if the region was read, or 0 if it couldn't be.  */
+  int xfered;
+};
+
 struct target_ops
 {
   /* Start a new process.
@@ -480,6 +493,47 @@ struct target_ops
      false for failure.  Return pointer to thread handle via HANDLE
      and the handle's length via HANDLE_LEN.  */
   bool (*thread_handle) (ptid_t ptid, gdb_byte **handle, int *handle_len);
+
+  /* Read the COUNT regions of memory described by REQUESTS, setting
+     the XFERED field of each.  This should generally be called
+     through read_inferior_memory_multiple, which handles breakpoint
+     shadowing, and falls back to read_memory if the target leaves
+     this NULL.  */
+  void (*read_memory_multiple) (struct memory_read_request *requests,
+				int count);
+
+  /* Install a jump pad for the conditions of a breakpoint.  Works
+     like install_fast_tracepoint_jump_pad, with BPOINT the address of
+     the conditions object as used by the IPA agent, BPADDR the
+     address of the breakpoint, and CHECKER the function the jump pad
+     calls to evaluate the conditions.  If CHECKER returns non-zero,
+     the jump pad executes a software breakpoint instruction, whose
+     address is returned in TRAP_ADDR, with all registers but the PC
+     restored, instead of the instruction at BPADDR.  */
+  int (*install_breakpoint_jump_pad) (CORE_ADDR bpoint, CORE_ADDR bpaddr,
+				      CORE_ADDR checker,
+				      CORE_ADDR lockaddr,
+				      ULONGEST orig_size,
+				      CORE_ADDR *jump_entry,
+				      unsigned char *jjump_pad_insn,
+				      ULONGEST *jjump_pad_insn_size,
+				      CORE_ADDR *adjusted_insn_addr,
+				      CORE_ADDR *adjusted_insn_addr_end,
+				      CORE_ADDR *trap_addr,
+				      char *err);
+
+  /* Open the file that descriptor FD of process PID refers to, with
+     open FLAGS.  Return the new file descriptor, or -1 on error.  */
+  int (*open_inferior_fd) (int pid, int fd, int flags);
+
+  /* Map the whole file that descriptor FD of process PID refers to
+     in GDBserver's address space, shared with the process, and store
+     its size in *SIZE.  Return the address of the mapping, or NULL on
+     error.  */
+  void *(*map_inferior_fd) (int pid, int fd, size_t *size);
+
+  /* Remove a mapping of SIZE bytes at ADDR made by map_inferior_fd.  */
+  void (*unmap_inferior_fd) (void *addr, size_t size);
 };
 
 extern struct target_ops *the_target;
@@ -563,6 +617,9 @@ int kill_inferior (int);
 #define target_supports_fast_tracepoints()		\
   (the_target->install_fast_tracepoint_jump_pad != NULL)
 
+#define target_supports_breakpoint_jump_pads()		\
+  (the_target->install_breakpoint_jump_pad != NULL)
+
 #define target_get_min_fast_tracepoint_insn_len()	\
   (the_target->get_min_fast_tracepoint_insn_len		\
    ? (*the_target->get_min_fast_tracepoint_insn_len) () : 0)
@@ -612,6 +669,33 @@ int kill_inferior (int);
 						   adjusted_insn_addr_end, \
 						   err)
 
+#define install_breakpoint_jump_pad(bpoint, bpaddr, checker, lockaddr, \
+				    orig_size, jump_entry,		\
+				    jjump_pad_insn,			\
+				    jjump_pad_insn_size,		\
+				    adjusted_insn_addr,			\
+				    adjusted_insn_addr_end,		\
+				    trap_addr, err)			\
+  (*the_target->install_breakpoint_jump_pad) (bpoint, bpaddr, checker,	\
+					      lockaddr, orig_size,	\
+					      jump_entry,		\
+					      jjump_pad_insn,		\
+					      jjump_pad_insn_size,	\
+					      adjusted_insn_addr,	\
+					      adjusted_insn_addr_end,	\
+					      trap_addr, err)
+
+#define target_open_inferior_fd(pid, fd, flags)		\
+  (the_target->open_inferior_fd					\
+   ? (*the_target->open_inferior_fd) (pid, fd, flags) : -1)
+
+#define target_map_inferior_fd(pid, fd, size)			\
+  (the_target->map_inferior_fd					\
+   ? (*the_target->map_inferior_fd) (pid, fd, size) : NULL)
+
+#define target_unmap_inferior_fd(addr, size)		\
+  (*the_target->unmap_inferior_fd) (addr, size)
+
 #define target_emit_ops() \
   (the_target->emit_ops ? (*the_target->emit_ops) () : NULL)
 
@@ -705,6 +789,12 @@ void done_accessing_memory (void);
 
 int read_inferior_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len);
 
+/* Read the COUNT regions of memory described by REQUESTS, setting the
+   XFERED field of each.  */
+
+void read_inferior_memory_multiple (struct memory_read_request *requests,
+				    int count);
+
 int write_inferior_memory (CORE_ADDR memaddr, const unsigned char *myaddr,
 			   int len);
 
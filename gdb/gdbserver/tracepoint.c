@@ -135,6 +135,11 @@ trace_vdebug (const char *fmt, ...)
 # define helper_thread_id IPA_SYM_EXPORTED_NAME (helper_thread_id)
 # define cmd_buf IPA_SYM_EXPORTED_NAME (cmd_buf)
 # define ipa_tdesc_idx IPA_SYM_EXPORTED_NAME (ipa_tdesc_idx)
+# define gdb_check_breakpoint_conditions_ptr \
+  IPA_SYM_EXPORTED_NAME (gdb_check_breakpoint_conditions_ptr)
+# define trace_ring_fd IPA_SYM_EXPORTED_NAME (trace_ring_fd)
+# define trace_ring_notify_fd IPA_SYM_EXPORTED_NAME (trace_ring_notify_fd)
+# define trace_ring_active IPA_SYM_EXPORTED_NAME (trace_ring_active)
 #endif
 
 #ifndef IN_PROCESS_AGENT
@@ -173,6 +178,10 @@ struct ipa_sym_addresses
   CORE_ADDR addr_set_trace_state_variable_value_ptr;
   CORE_ADDR addr_ust_loaded;
   CORE_ADDR addr_ipa_tdesc_idx;
+  CORE_ADDR addr_gdb_check_breakpoint_conditions_ptr;
+  CORE_ADDR addr_trace_ring_fd;
+  CORE_ADDR addr_trace_ring_notify_fd;
+  CORE_ADDR addr_trace_ring_active;
 };
 
 static struct
@@ -210,6 +219,10 @@ static struct
   IPA_SYM(set_trace_state_variable_value_ptr),
   IPA_SYM(ust_loaded),
   IPA_SYM(ipa_tdesc_idx),
+  IPA_SYM(gdb_check_breakpoint_conditions_ptr),
+  IPA_SYM(trace_ring_fd),
+  IPA_SYM(trace_ring_notify_fd),
+  IPA_SYM(trace_ring_active),
 };
 
 static struct ipa_sym_addresses ipa_sym_addrs;
@@ -403,6 +416,13 @@ static int flush_trace_buffer_handler (CORE_ADDR);
 
 static void download_trace_state_variables (void);
 static void upload_fast_traceframes (void);
+static void attach_trace_ring (void);
+static void release_trace_ring (void);
+static int trace_ring_attached (void);
+
+/* Non-zero if we found a corrupt traceframe in the trace ring during
+   this trace run, and stopped using the ring.  */
+static int trace_ring_corrupt;
 
 static int run_inferior_command (char *cmd, int len);
 
@@ -1214,6 +1234,100 @@ IP_AGENT_EXPORT_VAR unsigned int traceframe_read_count;
 
 IP_AGENT_EXPORT_VAR int traceframes_created;
 
+/* The trace ring.
+
+   When the system allows it, the in-process agent collects fast
+   tracepoint traceframes into a ring buffer that lives in a memory
+   file (memfd) mapped by both the agent and GDBserver.  GDBserver can
+   then drain the ring with plain memory copies at any time, without
+   stopping the inferior nor going through the `trace_buffer_ctrl'
+   token dance described above.
+
+   The ring starts with a `struct trace_ring_control' on its own page,
+   followed by SIZE bytes of traceframes.  Traceframes are laid out as
+   in the trace buffers, without the EOB marker.  HEAD and TAIL are
+   byte offsets in an unbounded stream of traceframes, wrapping
+   around at 2^32; the data at offset OFF is at OFF & (SIZE - 1) in
+   the ring, so SIZE must be a power of two.
+
+   The agent is the only producer: it only writes HEAD, and only
+   after the traceframes before it are complete.  Collection is
+   serialized by the jump pads' `collecting' lock, so there is only
+   one agent thread in the producer side at any given time.
+   GDBserver is the only consumer, and only writes TAIL.  The agent
+   maps the data area twice in a row, so that traceframes and blocks
+   are contiguous in its address space even when they wrap around.
+
+   If the ring is full, the agent hits the `flush_trace_buffer'
+   breakpoint, like it does when its regular trace buffer is full.
+   Before that happens, the agent writes a byte to a pipe whose read
+   end GDBserver watches, so that GDBserver drains the ring while the
+   inferior keeps running.  In non-stop mode, GDBserver's event loop
+   handles the pipe.  In all-stop mode, writing to the pipe raises
+   SIGIO in GDBserver, which interrupts the target's wait loop, and
+   the loop drains the ring.  NOTIFY_PENDING avoids writing more than
+   one byte per drain.
+
+   The inferior can write to the ring like the agent can, so
+   GDBserver only reads SIZE and DATA_OFFSET when mapping the ring,
+   keeps its own copy of TAIL, and checks each traceframe before
+   copying it.  If a traceframe is corrupt, GDBserver stops reading
+   the ring, and stops the trace run once the agent waits for room.
+
+   All fields are 32-bit, so the layout is the same for 32-bit agents
+   and 64-bit GDBservers.  */
+
+struct trace_ring_control
+{
+  /* Offset past the last complete traceframe.  Written by the agent.  */
+  uint32_t head;
+
+  /* Offset of the first traceframe GDBserver hasn't consumed yet.
+     Written by GDBserver.  */
+  uint32_t tail;
+
+  /* Size of the data area, a power of two.  */
+  uint32_t size;
+
+  /* Offset of the data area from the start of the memory file.  */
+  uint32_t data_offset;
+
+  /* Non-zero if the agent has notified GDBserver, and GDBserver
+     hasn't drained the ring since.  */
+  uint32_t notify_pending;
+};
+
+/* The size of the trace ring's data area.  */
+#define TRACE_RING_SIZE (4 * 1024 * 1024)
+
+/* The agent notifies GDBserver when the ring is this full.  */
+#define TRACE_RING_NOTIFY_THRESHOLD(SIZE) ((SIZE) / 4)
+
+#ifdef IN_PROCESS_AGENT
+
+/* The file descriptors of the trace ring's memory file and of the
+   read end of the notification pipe, or -1 if the agent couldn't set
+   up a ring.  GDBserver opens them through /proc.  */
+IP_AGENT_EXPORT_VAR int trace_ring_fd = -1;
+IP_AGENT_EXPORT_VAR int trace_ring_notify_fd = -1;
+
+/* Set by GDBserver when starting a trace run, if it managed to map
+   the trace ring.  If clear, the agent uses its trace buffer.  */
+IP_AGENT_EXPORT_VAR int trace_ring_active;
+
+/* The agent's view of the ring.  */
+static struct trace_ring_control *trace_ring_ctrl;
+static unsigned char *trace_ring_data;
+
+/* The write end of the notification pipe.  */
+static int trace_ring_notify_write_fd = -1;
+
+/* Offset past the space allocated so far for the traceframe being
+   collected.  Equal to the ring's HEAD between traceframes.  */
+static uint32_t trace_ring_reserved;
+
+#endif
+
 #ifndef IN_PROCESS_AGENT
 
 /* Read-only regions are address ranges whose contents don't change,
@@ -1507,6 +1621,63 @@ about_to_request_buffer_space (void)
   UNKNOWN_SIDE_EFFECTS();
 }
 
+/* Carve out AMT bytes of the trace ring for the traceframe being
+   collected, returning NULL if tracing stopped or if the traceframe
+   can't fit in the ring.  */
+
+static void *
+trace_ring_alloc (size_t amt)
+{
+  struct trace_ring_control *ctrl = trace_ring_ctrl;
+  unsigned char *rslt;
+
+  if ((size_t) (trace_ring_reserved - ctrl->head) + amt > ctrl->size)
+    {
+      trace_debug ("Traceframe too large for the trace ring");
+      return NULL;
+    }
+
+  /* Wait for GDBserver to make room, if needed.  */
+  while ((size_t) (trace_ring_reserved
+		   - __atomic_load_n (&ctrl->tail, __ATOMIC_ACQUIRE))
+	 + amt > ctrl->size)
+    {
+      flush_trace_buffer ();
+      memory_barrier ();
+      if (!tracing)
+	return NULL;
+    }
+
+  rslt = trace_ring_data + (trace_ring_reserved & (ctrl->size - 1));
+  trace_ring_reserved += amt;
+  return rslt;
+}
+
+/* Publish the traceframe just collected in the trace ring, and wake
+   up GDBserver if the ring is filling up.  */
+
+static void
+trace_ring_commit (void)
+{
+  struct trace_ring_control *ctrl = trace_ring_ctrl;
+  uint32_t used;
+
+  __atomic_store_n (&ctrl->head, trace_ring_reserved, __ATOMIC_RELEASE);
+
+  used = trace_ring_reserved - __atomic_load_n (&ctrl->tail,
+						__ATOMIC_ACQUIRE);
+  if (used >= TRACE_RING_NOTIFY_THRESHOLD (ctrl->size)
+      && trace_ring_notify_write_fd != -1
+      && cmpxchg (&ctrl->notify_pending, 0, 1) == 0)
+    {
+      char c = 0;
+
+      /* If the pipe is full, GDBserver has plenty to read already.  */
+      if (write (trace_ring_notify_write_fd, &c, 1) != 1)
+	trace_debug ("Couldn't notify GDBserver about the trace ring");
+    }
+}
+
 #endif
 
 /* Carve out a piece of the trace buffer, returning NULL in case of
@@ -1531,6 +1702,11 @@ trace_buffer_alloc (size_t amt)
   trace_debug ("Want to allocate %ld+%ld bytes in trace buffer",
 	       (long) amt, (long) sizeof (struct traceframe));
 
+#ifdef IN_PROCESS_AGENT
+  if (trace_ring_active)
+    return trace_ring_alloc (amt);
+#endif
+
   /* Account for the EOB marker.  */
   amt += TRACEFRAME_EOB_MARKER_SIZE;
 
@@ -2187,6 +2363,12 @@ add_traceframe (struct tracepoint *tpoint)
 {
   struct traceframe *tframe;
 
+#ifdef IN_PROCESS_AGENT
+  /* Forget about any traceframe left incomplete.  */
+  if (trace_ring_active)
+    trace_ring_reserved = trace_ring_ctrl->head;
+#endif
+
   tframe
     = (struct traceframe *) trace_buffer_alloc (sizeof (struct traceframe));
 
@@ -2228,7 +2410,13 @@ add_traceframe_block (struct traceframe *tframe,
 static void
 finish_traceframe (struct traceframe *tframe)
 {
-  ++traceframe_write_count;
+#ifdef IN_PROCESS_AGENT
+  /* The write count only accounts for the trace buffer.  */
+  if (trace_ring_active)
+    trace_ring_commit ();
+  else
+#endif
+    ++traceframe_write_count;
   ++traceframes_created;
 }
 
@@ -3135,6 +3323,48 @@ install_fast_tracepoint (struct tracepoint *tpoint, char *errbuf)
 }
 
 
+/* A jump pad evaluating the conditions of a GDB breakpoint in the
+   inferior, so that the breakpoint only traps when one of them is
+   true.  The jump space is never given back, so jump pads are kept
+   around, and reused when a breakpoint with the same conditions is
+   inserted at the same address again, as GDB does every time it
+   resumes the inferior.  They are forgotten when their process goes
+   away or execs, see free_breakpoint_jump_pads.  */
+
+struct breakpoint_jump_pad
+{
+  /* The jump pad, described like a fast tracepoint's, so that threads
+     can be moved out of it the same way.  Only the address, the
+     object in the IPA (the array of compiled conditions) and the jump
+     pad fields are set.  */
+  struct tracepoint tpoint;
+
+  /* The process the jump pad is in.  */
+  int pid;
+
+  /* The instruction relocated to the jump pad.  */
+  std::vector<unsigned char> insn;
+
+  /* The conditions, as agent expression bytecodes, each preceded by
+     its length.  */
+  std::vector<unsigned char> conds;
+
+  /* The address of the trap the jump pad runs into when a condition
+     is true.  Zero if the jump pad couldn't be built, in which case
+     we remember not to try again.  */
+  CORE_ADDR trap;
+
+  /* The jump to the jump pad.  */
+  unsigned char jump_insn[MAX_JUMP_SIZE];
+  ULONGEST jump_insn_size;
+
+  struct breakpoint_jump_pad *next;
+};
+
+/* All the breakpoint jump pads built.  */
+
+static struct breakpoint_jump_pad *breakpoint_jump_pads;
+
 /* Install tracepoint TPOINT, and write reply message in OWN_BUF.  */
 
 static void
@@ -3368,6 +3598,8 @@ cmd_qtstart (char *packet)
 
   if (agent_loaded_p ())
     {
+      attach_trace_ring ();
+
       if (write_inferior_integer (ipa_sym_addrs.addr_tracing, 1))
 	{
 	  internal_error (__FILE__, __LINE__,
@@ -3466,6 +3698,11 @@ stop_tracing (void)
       tracing_stop_tpnum = error_tracepoint->number;
     }
 #ifndef IN_PROCESS_AGENT
+  else if (trace_ring_corrupt)
+    {
+      trace_debug ("Stopping the trace because the trace ring is corrupt");
+      tracing_stop_reason = "terror:corrupt trace ring";
+    }
   else if (!gdb_connected ())
     {
       trace_debug ("Stopping the trace because GDB disconnected");
@@ -3491,6 +3728,10 @@ stop_tracing (void)
 	 because we want to present the full number of created frames
 	 in addition to what fit in the trace buffer.  */
       upload_fast_traceframes ();
+
+      /* Nothing will be added to the trace ring anymore.  */
+      release_trace_ring ();
+      write_inferior_integer (ipa_sym_addrs.addr_trace_ring_active, 0);
     }
 
   if (stop_tracing_bkpt != NULL)
@@ -3650,11 +3891,17 @@ cmd_qtstatus (char *packet)
 
   if (agent_loaded_p ())
     {
-      pause_all (1);
+      /* The trace ring can be drained while the inferior runs.  */
+      if (trace_ring_attached ())
+	upload_fast_traceframes ();
+      else
+	{
+	  pause_all (1);
 
-      upload_fast_traceframes ();
+	  upload_fast_traceframes ();
 
-      unpause_all (1);
+	  unpause_all (1);
+	}
    }
 
   stop_reason_rsp = (char *) tracing_stop_reason;
@@ -3976,6 +4223,9 @@ gdb_agent_about_to_close (int pid)
 
       current_thread = saved_thread;
     }
+
+  /* The jump pads can't be entered once the agent is gone.  */
+  free_breakpoint_jump_pads (pid);
 }
 
 /* Return the minimum instruction size needed for fast tracepoints as a
@@ -4541,6 +4791,11 @@ handle_tracepoint_bkpts (struct thread_info *tinfo, CORE_ADDR stop_pc)
   else if (stop_pc == ipa_sym_addrs.addr_flush_trace_buffer)
     {
       trace_debug ("lib stopped at flush_trace_buffer");
+
+      /* The IPA still collects into the trace ring we stopped
+	 reading, and is waiting for room in it.  */
+      if (trace_ring_corrupt)
+	stop_tracing ();
       return 1;
     }
 
@@ -5480,18 +5735,27 @@ traceframe_read_info (int tfnum, struct buffer *buffer)
   return 0;
 }
 
-/* Return the first fast tracepoint whose jump pad contains PC.  */
+/* Return the first fast tracepoint whose jump pad contains PC.
+   Breakpoint jump pads are described by tracepoints too; only those
+   of the current process are considered.  */
 
 static struct tracepoint *
 fast_tracepoint_from_jump_pad_address (CORE_ADDR pc)
 {
   struct tracepoint *tpoint;
+  struct breakpoint_jump_pad *pad;
+  int pid = pid_of (current_thread);
 
   for (tpoint = tracepoints; tpoint; tpoint = tpoint->next)
     if (tpoint->type == fast_tracepoint)
       if (tpoint->jump_pad <= pc && pc < tpoint->jump_pad_end)
 	return tpoint;
 
+  for (pad = breakpoint_jump_pads; pad != NULL; pad = pad->next)
+    if (pad->pid == pid
+	&& pad->tpoint.jump_pad <= pc && pc < pad->tpoint.jump_pad_end)
+      return &pad->tpoint;
+
   return NULL;
 }
 
@@ -5520,12 +5784,18 @@ static struct tracepoint *
 fast_tracepoint_from_ipa_tpoint_address (CORE_ADDR ipa_tpoint_obj)
 {
   struct tracepoint *tpoint;
+  struct breakpoint_jump_pad *pad;
 
   for (tpoint = tracepoints; tpoint; tpoint = tpoint->next)
     if (tpoint->type == fast_tracepoint)
       if (tpoint->obj_addr_on_target == ipa_tpoint_obj)
 	return tpoint;
 
+  for (pad = breakpoint_jump_pads; pad != NULL; pad = pad->next)
+    if (pad->trap != 0 && pad->pid == pid_of (current_thread)
+	&& pad->tpoint.obj_addr_on_target == ipa_tpoint_obj)
+      return &pad->tpoint;
+
   return NULL;
 }
 
@@ -5637,13 +5907,12 @@ fast_tracepoint_collecting (CORE_ADDR thread_area,
       && stop_pc < ipa_gdb_jump_pad_buffer_end)
     {
       /* We can tell which tracepoint(s) the thread is collecting by
-	 matching the jump pad address back to the tracepoint.  */
+	 matching the jump pad address back to the tracepoint.  The
+	 jump pad buffer also holds compiled conditions, which are
+	 called from the collector, like the rest of it; see below.  */
       tpoint = fast_tracepoint_from_jump_pad_address (stop_pc);
       if (tpoint == NULL)
-	{
-	  warning ("in jump pad, but no matching tpoint?");
-	  return fast_tpoint_collect_result::not_collecting;
-	}
+	trace_debug ("in jump pad buffer, but not in a jump pad");
       else
 	{
 	  trace_debug ("in jump pad of tpoint (%d, %s); jump_pad(%s, %s); "
@@ -5653,13 +5922,13 @@ fast_tracepoint_collecting (CORE_ADDR thread_area,
 		       paddress (tpoint->jump_pad_end),
 		       paddress (tpoint->adjusted_insn_addr),
 		       paddress (tpoint->adjusted_insn_addr_end));
-	}
 
-      /* Definitely in the jump pad.  May or may not need
-	 fast-exit-jump-pad breakpoint.  */
-      if (tpoint->jump_pad <= stop_pc
-	  && stop_pc < tpoint->adjusted_insn_addr)
-	needs_breakpoint =  1;
+	  /* Definitely in the jump pad.  May or may not need
+	     fast-exit-jump-pad breakpoint.  */
+	  if (tpoint->jump_pad <= stop_pc
+	      && stop_pc < tpoint->adjusted_insn_addr)
+	    needs_breakpoint =  1;
+	}
     }
   else if (ipa_gdb_trampoline_buffer <= stop_pc
 	   && stop_pc < ipa_gdb_trampoline_buffer_end)
@@ -5685,7 +5954,8 @@ fast_tracepoint_collecting (CORE_ADDR thread_area,
 	 instruction.  */
       needs_breakpoint = 1;
     }
-  else
+
+  if (tpoint == NULL)
     {
       collecting_t ipa_collecting_obj;
 
@@ -5856,18 +6126,44 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
     }
 }
 
+/* Called from the jump pads of GDB breakpoints whose conditions are
+   evaluated in the inferior, with CONDS the zero-terminated array of
+   the conditions, compiled to native code, and REGS the registers
+   saved by the jump pad.  Returns non-zero if the breakpoint should
+   trap, that is, if any condition is true or fails to evaluate.  */
+
+IP_AGENT_EXPORT_FUNC int
+gdb_check_breakpoint_conditions (const CORE_ADDR *conds,
+				 unsigned char *regs)
+{
+  for (; *conds != 0; conds++)
+    {
+      ULONGEST value = 0;
+
+      if (((condfn) (uintptr_t) *conds) (regs, &value) != expr_eval_no_error
+	  || value != 0)
+	return 1;
+    }
+
+  return 0;
+}
+
 /* These global variables points to the corresponding functions.  This is
    necessary on powerpc64, where asking for function symbol address from gdb
    results in returning the actual code pointer, instead of the descriptor
    pointer.  */
 
 typedef void (*gdb_collect_ptr_type) (struct tracepoint *, unsigned char *);
+typedef int (*gdb_check_breakpoint_conditions_ptr_type) (const CORE_ADDR *,
+							 unsigned char *);
 typedef ULONGEST (*get_raw_reg_ptr_type) (const unsigned char *, int);
 typedef LONGEST (*get_trace_state_variable_value_ptr_type) (int);
 typedef void (*set_trace_state_variable_value_ptr_type) (int, LONGEST);
 
 EXTERN_C_PUSH
 IP_AGENT_EXPORT_VAR gdb_collect_ptr_type gdb_collect_ptr = gdb_collect;
+IP_AGENT_EXPORT_VAR gdb_check_breakpoint_conditions_ptr_type
+  gdb_check_breakpoint_conditions_ptr = gdb_check_breakpoint_conditions;
 IP_AGENT_EXPORT_VAR get_raw_reg_ptr_type get_raw_reg_ptr = get_raw_reg;
 IP_AGENT_EXPORT_VAR get_trace_state_variable_value_ptr_type
   get_trace_state_variable_value_ptr = get_trace_state_variable_value;
@@ -5917,42 +6213,30 @@ get_set_tsv_func_addr (void)
   return res;
 }
 
-static void
-compile_tracepoint_condition (struct tracepoint *tpoint,
-			      CORE_ADDR *jump_entry)
+/* Compile agent expression COND to native code at *JUMP_ENTRY, and
+   update *JUMP_ENTRY to point past the generated code.  Returns the
+   address of the compiled code, or 0 if the compilation failed, in
+   which case *ERR is set to the error code.  */
+
+static CORE_ADDR
+compile_condition (struct agent_expr *cond, CORE_ADDR *jump_entry,
+		   enum eval_result_type *err)
 {
   CORE_ADDR entry_point = *jump_entry;
-  enum eval_result_type err;
-
-  trace_debug ("Starting condition compilation for tracepoint %d\n",
-	       tpoint->number);
 
   /* Initialize the global pointer to the code being built.  */
   current_insn_ptr = *jump_entry;
 
   emit_prologue ();
 
-  err = compile_bytecodes (tpoint->cond);
+  *err = compile_bytecodes (cond);
 
-  if (err == expr_eval_no_error)
-    {
-      emit_epilogue ();
-
-      /* Record the beginning of the compiled code.  */
-      tpoint->compiled_cond = entry_point;
-
-      trace_debug ("Condition compilation for tracepoint %d complete\n",
-		   tpoint->number);
-    }
+  if (*err == expr_eval_no_error)
+    emit_epilogue ();
   else
     {
       /* Leave the unfinished code in situ, but don't point to it.  */
-
-      tpoint->compiled_cond = 0;
-
-      trace_debug ("Condition compilation for tracepoint %d failed, "
-		   "error code %d",
-		   tpoint->number, err);
+      entry_point = 0;
     }
 
   /* Update the code pointer passed in.  Note that we do this even if
@@ -5962,6 +6246,29 @@ compile_tracepoint_condition (struct tracepoint *tpoint,
 
   /* Leave a gap, to aid dump decipherment.  */
   *jump_entry += 16;
+
+  return entry_point;
+}
+
+static void
+compile_tracepoint_condition (struct tracepoint *tpoint,
+			      CORE_ADDR *jump_entry)
+{
+  enum eval_result_type err;
+
+  trace_debug ("Starting condition compilation for tracepoint %d\n",
+	       tpoint->number);
+
+  /* Record the beginning of the compiled code.  */
+  tpoint->compiled_cond = compile_condition (tpoint->cond, jump_entry, &err);
+
+  if (tpoint->compiled_cond != 0)
+    trace_debug ("Condition compilation for tracepoint %d complete\n",
+		 tpoint->number);
+  else
+    trace_debug ("Condition compilation for tracepoint %d failed, "
+		 "error code %d",
+		 tpoint->number, err);
 }
 
 /* The base pointer of the IPA's heap.  This is the only memory the
@@ -6019,6 +6326,177 @@ download_agent_expr (struct agent_expr *expr)
 /* Align V up to N bits.  */
 #define UALIGN(V, N) (((V) + ((N) - 1)) & ~((N) - 1))
 
+/* Build the jump pad PAD, for the conditions CONDS of a breakpoint.
+   Leaves PAD->trap zero on failure.  */
+
+static void
+build_breakpoint_jump_pad (struct breakpoint_jump_pad *pad,
+			   const std::vector<agent_expr *> &conds)
+{
+  CORE_ADDR jentry, jump_entry;
+  CORE_ADDR checker, conds_addr, trap;
+  std::vector<CORE_ADDR> compiled_conds;
+  char errbuf[IPA_BUFSIZ];
+
+  if (read_inferior_data_pointer
+      (ipa_sym_addrs.addr_gdb_check_breakpoint_conditions_ptr, &checker))
+    {
+      trace_debug ("error extracting gdb_check_breakpoint_conditions_ptr");
+      return;
+    }
+
+  /* Nothing refers to the code we write to the jump space until we
+     succeed and claim it, so we just leave it behind on failure.  */
+  jentry = jump_entry = get_jump_space_head ();
+
+  for (agent_expr *cond : conds)
+    {
+      enum eval_result_type err;
+      CORE_ADDR compiled;
+
+      jentry = UALIGN (jentry, 8);
+      compiled = compile_condition (cond, &jentry, &err);
+      if (compiled == 0)
+	{
+	  trace_debug ("Condition compilation for breakpoint at %s failed, "
+		       "error code %d",
+		       paddress (pad->tpoint.address), err);
+	  return;
+	}
+      compiled_conds.push_back (compiled);
+    }
+
+  /* The jump pad passes the zero-terminated array of compiled
+     conditions to the checker.  */
+  compiled_conds.push_back (0);
+  conds_addr = target_malloc (compiled_conds.size () * sizeof (CORE_ADDR));
+  write_inferior_memory (conds_addr,
+			 (unsigned char *) compiled_conds.data (),
+			 compiled_conds.size () * sizeof (CORE_ADDR));
+
+  jentry = UALIGN (jentry, 8);
+  pad->tpoint.jump_pad = jentry;
+
+  errbuf[0] = '\0';
+  if (install_breakpoint_jump_pad (conds_addr, pad->tpoint.address,
+				   checker, ipa_sym_addrs.addr_collecting,
+				   pad->tpoint.orig_size, &jentry,
+				   pad->jump_insn, &pad->jump_insn_size,
+				   &pad->tpoint.adjusted_insn_addr,
+				   &pad->tpoint.adjusted_insn_addr_end,
+				   &trap, errbuf) != 0)
+    {
+      trace_debug ("Failed to build jump pad for breakpoint at %s: %s",
+		   paddress (pad->tpoint.address), errbuf);
+      pad->tpoint.jump_pad = 0;
+      return;
+    }
+
+  pad->tpoint.jump_pad_end = jentry;
+  pad->tpoint.obj_addr_on_target = conds_addr;
+  pad->trap = trap;
+
+  /* Pad to 8-byte alignment.  */
+  jentry = UALIGN (jentry, 8);
+  claim_jump_space (jentry - jump_entry);
+}
+
+/* See tracepoint.h.  */
+
+const unsigned char *
+get_breakpoint_jump_pad (CORE_ADDR address, int insn_len,
+			 const std::vector<agent_expr *> &conds,
+			 int *jump_size)
+{
+  struct breakpoint_jump_pad *pad;
+  int pid = pid_of (current_thread);
+
+  if (conds.empty ()
+      || !agent_loaded_p ()
+      || !target_supports_breakpoint_jump_pads ()
+      || target_emit_ops () == NULL
+      || insn_len < target_get_min_fast_tracepoint_insn_len ())
+    return NULL;
+
+  std::vector<unsigned char> insn (insn_len);
+  if (read_inferior_memory (address, insn.data (), insn_len) != 0)
+    return NULL;
+
+  std::vector<unsigned char> key;
+  for (agent_expr *cond : conds)
+    {
+      const unsigned char *len = (const unsigned char *) &cond->length;
+
+      key.insert (key.end (), len, len + sizeof (cond->length));
+      key.insert (key.end (), cond->bytes, cond->bytes + cond->length);
+    }
+
+  for (pad = breakpoint_jump_pads; pad != NULL; pad = pad->next)
+    if (pad->pid == pid
+	&& pad->tpoint.address == address
+	&& pad->insn == insn
+	&& pad->conds == key)
+      break;
+
+  if (pad == NULL)
+    {
+      pad = new breakpoint_jump_pad ();
+      pad->tpoint.address = address;
+      pad->tpoint.type = fast_tracepoint;
+      pad->tpoint.orig_size = insn_len;
+      pad->pid = pid;
+      pad->insn = std::move (insn);
+      pad->conds = std::move (key);
+
+      build_breakpoint_jump_pad (pad, conds);
+
+      pad->next = breakpoint_jump_pads;
+      breakpoint_jump_pads = pad;
+    }
+
+  if (pad->trap == 0)
+    return NULL;
+
+  *jump_size = pad->jump_insn_size;
+  return pad->jump_insn;
+}
+
+/* See tracepoint.h.  */
+
+void
+free_breakpoint_jump_pads (int pid)
+{
+  struct breakpoint_jump_pad **link = &breakpoint_jump_pads;
+
+  while (*link != NULL)
+    {
+      struct breakpoint_jump_pad *pad = *link;
+
+      if (pad->pid == pid)
+	{
+	  *link = pad->next;
+	  delete pad;
+	}
+      else
+	link = &pad->next;
+    }
+}
+
+/* See tracepoint.h.  */
+
+CORE_ADDR
+breakpoint_from_jump_pad_trap (CORE_ADDR pc)
+{
+  struct breakpoint_jump_pad *pad;
+
+  for (pad = breakpoint_jump_pads; pad != NULL; pad = pad->next)
+    if (pad->trap != 0 && pad->trap == pc
+	&& pad->pid == pid_of (current_thread))
+      return pad->tpoint.address;
+
+  return 0;
+}
+
 /* Sync tracepoint with IPA, but leave maintenance of linked list to caller.  */
 
 static void
@@ -6303,9 +6781,261 @@ download_trace_state_variables (void)
     }
 }
 
-/* Upload complete trace frames out of the IP Agent's trace buffer
-   into GDBserver's trace buffer.  This always uploads either all or
-   no trace frames.  This is the counter part of
+/* GDBserver's mapping of the IPA's trace ring, or NULL if the IPA
+   collects into its trace buffer.  */
+static struct trace_ring_control *trace_ring;
+
+/* The size of the mapping of the trace ring.  */
+static size_t trace_ring_map_size;
+
+/* Our copies of the trace ring's SIZE and DATA_OFFSET, checked when
+   mapping the ring, and of its TAIL.  The inferior can write to the
+   ring, so we don't trust what it holds after that.  */
+static uint32_t trace_ring_size;
+static uint32_t trace_ring_data_offset;
+static uint32_t trace_ring_tail;
+
+/* Our end of the IPA's trace ring notification pipe, or -1.  */
+static int trace_ring_notify_fd = -1;
+
+/* Return true if the IPA collects into the trace ring.  */
+
+static int
+trace_ring_attached (void)
+{
+  return trace_ring != NULL;
+}
+
+/* Forget about the trace ring of the previous trace run, if any.  */
+
+static void
+release_trace_ring (void)
+{
+  if (trace_ring_notify_fd != -1)
+    {
+      delete_file_handler (trace_ring_notify_fd);
+      close (trace_ring_notify_fd);
+      trace_ring_notify_fd = -1;
+    }
+
+  if (trace_ring != NULL)
+    {
+      target_unmap_inferior_fd (trace_ring, trace_ring_map_size);
+      trace_ring = NULL;
+    }
+}
+
+/* Copy LEN bytes at offset OFF of the trace ring to BUF.  LEN must
+   not be larger than the ring.  */
+
+static void
+trace_ring_read (uint32_t off, void *buf, size_t len)
+{
+  const unsigned char *data
+    = (const unsigned char *) trace_ring + trace_ring_data_offset;
+  size_t pos = off & (trace_ring_size - 1);
+  size_t first = std::min (len, (size_t) trace_ring_size - pos);
+
+  gdb_assert (len <= trace_ring_size);
+
+  memcpy (buf, data + pos, first);
+  memcpy ((unsigned char *) buf + first, data, len - first);
+}
+
+/* Stop using the trace ring after finding a corrupt traceframe in
+   it.  The IPA keeps collecting into the ring until it fills up; the
+   trace run is then stopped when the IPA hits flush_trace_buffer.  */
+
+static void
+trace_ring_corrupted (void)
+{
+  warning ("Corrupt traceframe in the trace ring, no longer reading it");
+  trace_ring_corrupt = 1;
+  release_trace_ring ();
+}
+
+/* Move the complete traceframes of the trace ring to GDBserver's
+   trace buffer.  Unlike upload_fast_traceframes, this doesn't need
+   the inferior to be stopped.  */
+
+static void
+upload_trace_ring (void)
+{
+  const uint32_t header_size = offsetof (struct traceframe, data);
+  uint32_t head, tail;
+
+  /* Clear the flag first, so that the IPA notifies us again about
+     traceframes finished after we read HEAD below.  */
+  __atomic_store_n (&trace_ring->notify_pending, 0, __ATOMIC_RELEASE);
+
+  head = __atomic_load_n (&trace_ring->head, __ATOMIC_ACQUIRE);
+  tail = trace_ring_tail;
+
+  if (head - tail > trace_ring_size)
+    {
+      trace_ring_corrupted ();
+      return;
+    }
+
+  if (head != tail)
+    trace_debug ("Uploading %u bytes of the trace ring",
+		 (unsigned int) (head - tail));
+
+  while (tail != head)
+    {
+      struct tracepoint *tpoint;
+      struct traceframe *tframe;
+      struct traceframe ipa_tframe;
+      unsigned char *block;
+
+      if (head - tail < header_size)
+	{
+	  trace_ring_corrupted ();
+	  return;
+	}
+
+      trace_ring_read (tail, &ipa_tframe, header_size);
+
+      /* Only read what the IPA has published.  */
+      tpoint = find_next_tracepoint_by_number (NULL, ipa_tframe.tpnum);
+      if (tpoint == NULL
+	  || ipa_tframe.data_size > head - tail - header_size)
+	{
+	  trace_ring_corrupted ();
+	  return;
+	}
+
+      tframe = add_traceframe (tpoint);
+      if (tframe == NULL)
+	{
+	  trace_buffer_is_full = 1;
+	  trace_debug ("Uploading: trace buffer is full");
+	}
+      else
+	{
+	  block = add_traceframe_block (tframe, tpoint,
+					ipa_tframe.data_size);
+	  if (block != NULL)
+	    trace_ring_read (tail + header_size, block, ipa_tframe.data_size);
+	  finish_traceframe (tframe);
+	}
+
+      tail += header_size + ipa_tframe.data_size;
+      trace_ring_tail = tail;
+
+      /* Hand the space back to the IPA as soon as possible.  */
+      __atomic_store_n (&trace_ring->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+/* Called when the IPA writes to the trace ring notification pipe.  */
+
+static int
+handle_trace_ring_event (int error, gdb_client_data client_data)
+{
+  char buf[16];
+  ssize_t ret;
+
+  do
+    ret = read (trace_ring_notify_fd, buf, sizeof buf);
+  while (ret > 0 || (ret == -1 && errno == EINTR));
+
+  if (trace_ring_attached ())
+    upload_trace_ring ();
+
+  /* The process exited.  Uploading may have closed the pipe
+     already, if the ring was corrupt.  */
+  if ((ret == 0 || error) && trace_ring_notify_fd != -1)
+    {
+      delete_file_handler (trace_ring_notify_fd);
+      close (trace_ring_notify_fd);
+      trace_ring_notify_fd = -1;
+    }
+
+  return 0;
+}
+
+/* See tracepoint.h.  */
+
+void
+drain_trace_ring (void)
+{
+  if (trace_ring_notify_fd != -1)
+    handle_trace_ring_event (0, NULL);
+}
+
+/* Map the IPA's trace ring, and have the IPA use it for this trace
+   run.  If that fails, the IPA collects into its trace buffer.  */
+
+static void
+attach_trace_ring (void)
+{
+  int pid = pid_of (current_thread);
+  int ring_fd, notify_fd;
+  void *addr;
+
+  release_trace_ring ();
+  trace_ring_corrupt = 0;
+
+  if (read_inferior_integer (ipa_sym_addrs.addr_trace_ring_fd, &ring_fd)
+      || read_inferior_integer (ipa_sym_addrs.addr_trace_ring_notify_fd,
+				&notify_fd))
+    return;
+
+  if (ring_fd != -1)
+    {
+      addr = target_map_inferior_fd (pid, ring_fd, &trace_ring_map_size);
+      if (addr != NULL)
+	{
+	  trace_ring = (struct trace_ring_control *) addr;
+	  trace_ring_size = trace_ring->size;
+	  trace_ring_data_offset = trace_ring->data_offset;
+	  if (trace_ring_size == 0
+	      || (trace_ring_size & (trace_ring_size - 1)) != 0
+	      || trace_ring_data_offset < sizeof (struct trace_ring_control)
+	      || trace_ring_data_offset > trace_ring_map_size
+	      || trace_ring_size > trace_ring_map_size - trace_ring_data_offset)
+	    release_trace_ring ();
+	}
+    }
+
+  if (trace_ring != NULL)
+    {
+      trace_ring->head = trace_ring->tail = trace_ring_tail = 0;
+      trace_ring->notify_pending = 0;
+
+      if (notify_fd != -1)
+	{
+	  trace_ring_notify_fd
+	    = target_open_inferior_fd (pid, notify_fd, O_RDONLY | O_NONBLOCK);
+	  if (trace_ring_notify_fd != -1)
+	    {
+	      add_file_handler (trace_ring_notify_fd, handle_trace_ring_event,
+				NULL);
+
+	      /* In all-stop mode, GDBserver doesn't run its event loop
+		 while the inferior runs, but blocks in the target's wait
+		 loop with SIGIO unblocked.  Have the notifications raise
+		 SIGIO, so that the wait loop drains the ring.  The SIGIO
+		 handler ignores interrupts that don't come from the
+		 client.  */
+#if defined (F_SETFL) && defined (FASYNC) && defined (F_SETOWN)
+	      fcntl (trace_ring_notify_fd, F_SETOWN, getpid ());
+	      fcntl (trace_ring_notify_fd, F_SETFL,
+		     fcntl (trace_ring_notify_fd, F_GETFL, 0) | FASYNC);
+#endif
+	    }
+	}
+    }
+
+  trace_debug ("Trace ring %s", trace_ring != NULL ? "mapped" : "unavailable");
+  write_inferior_integer (ipa_sym_addrs.addr_trace_ring_active,
+			  trace_ring != NULL);
+}
+
+/* Upload complete trace frames out of the IP Agent's trace buffer,
+   or trace ring, into GDBserver's trace buffer.  This always uploads
+   either all or no trace frames.  This is the counter part of
    `trace_alloc_trace_buffer'.  See its description of the atomic
    synching mechanism.  */
 
@@ -6324,6 +7054,17 @@ upload_fast_traceframes (void)
   CORE_ADDR ipa_trace_buffer_lo;
   CORE_ADDR ipa_trace_buffer_hi;
 
+  if (trace_ring_attached ())
+    {
+      upload_trace_ring ();
+      return;
+    }
+
+  /* The IPA collects into the trace ring we stopped reading, not
+     into its trace buffer, whose counters we can't trust then.  */
+  if (trace_ring_corrupt)
+    return;
+
   if (read_inferior_uinteger (ipa_sym_addrs.addr_traceframe_read_count,
 			      &ipa_traceframe_read_count_racy))
     {
@@ -7351,6 +8092,81 @@ set_trampoline_buffer_space (CORE_ADDR begin, CORE_ADDR end, char *errmsg)
     strcpy (gdb_trampoline_buffer_error, "no buffer passed");
 }
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1
+#endif
+
+/* Called in the child after a fork.  The child shares the trace ring
+   with its parent, so it must not collect into it.  */
+
+static void
+trace_ring_atfork_child (void)
+{
+  trace_ring_active = 0;
+  trace_ring_fd = -1;
+  trace_ring_notify_fd = -1;
+  trace_ring_notify_write_fd = -1;
+}
+
+/* Set up the trace ring shared with GDBserver, if the system allows
+   it.  See the description of `struct trace_ring_control'.  */
+
+static void
+init_trace_ring (void)
+{
+#ifdef __NR_memfd_create
+  size_t page_size = sysconf (_SC_PAGE_SIZE);
+  size_t size = TRACE_RING_SIZE;
+  int fd, pipe_fds[2];
+  unsigned char *base;
+
+  fd = syscall (__NR_memfd_create, "gdb-trace-ring", MFD_CLOEXEC);
+  if (fd < 0)
+    {
+      trace_debug ("memfd_create failed: %s", strerror (errno));
+      return;
+    }
+
+  if (ftruncate (fd, page_size + size) != 0)
+    {
+      close (fd);
+      return;
+    }
+
+  /* Reserve room for the control page and two copies of the data
+     area, then map the memory file over it.  */
+  base = (unsigned char *) mmap (NULL, page_size + 2 * size, PROT_NONE,
+				 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    {
+      close (fd);
+      return;
+    }
+
+  if (mmap (base, page_size + size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+      || mmap (base + page_size + size, size, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | MAP_FIXED, fd, page_size) == MAP_FAILED
+      || pipe2 (pipe_fds, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+      munmap (base, page_size + 2 * size);
+      close (fd);
+      return;
+    }
+
+  trace_ring_ctrl = (struct trace_ring_control *) base;
+  trace_ring_ctrl->size = size;
+  trace_ring_ctrl->data_offset = page_size;
+  trace_ring_data = base + page_size;
+
+  trace_ring_fd = fd;
+  trace_ring_notify_fd = pipe_fds[0];
+  trace_ring_notify_write_fd = pipe_fds[1];
+
+  pthread_atfork (NULL, NULL, trace_ring_atfork_child);
+#endif
+}
+
 static void __attribute__ ((constructor))
 initialize_tracepoint_ftlib (void)
 {
@@ -7446,6 +8262,8 @@ initialize_tracepoint (void)
 
   strcpy (gdb_trampoline_buffer_error, "No errors reported");
 
+  init_trace_ring ();
+
   initialize_low_tracepoint ();
 #endif
 }
@@ -19,10 +19,14 @@
 #ifndef TRACEPOINT_H
 #define TRACEPOINT_H
 
+#include <vector>
+
 /* Size for a small buffer to report problems from the in-process
    agent back to GDBserver.  */
 #define IPA_BUFSIZ 100
 
+struct agent_expr;
+
 void initialize_tracepoint (void);
 
 #if defined(__GNUC__)
@@ -75,6 +79,14 @@ void tracepoint_look_up_symbols (void);
 
 void stop_tracing (void);
 
+/* Move the traceframes the in-process agent has finished collecting
+   in its trace ring, if it uses one, to GDBserver's trace buffer.
+   This doesn't need the inferior to be stopped.  The target's wait
+   loop calls this before blocking, and the agent's notifications
+   interrupt that wait with SIGIO, so that the ring is drained in
+   all-stop mode too.  */
+void drain_trace_ring (void);
+
 int handle_tracepoint_general_set (char *own_buf);
 int handle_tracepoint_query (char *own_buf);
 
@@ -158,6 +170,23 @@ void stop_tracing (void);
 int claim_trampoline_space (ULONGEST used, CORE_ADDR *trampoline);
 int have_fast_tracepoint_trampoline_buffer (char *msgbuf);
 void gdb_agent_about_to_close (int pid);
+
+/* Return the jump to a jump pad that evaluates CONDS, the conditions
+   of a breakpoint at ADDRESS, in the inferior, and only traps if one
+   of them is true, and store its length in *JUMP_SIZE.  INSN_LEN is
+   the length of the instruction at ADDRESS, which the jump replaces.
+   Returns NULL if there can't be such a jump pad.  */
+const unsigned char *get_breakpoint_jump_pad
+  (CORE_ADDR address, int insn_len,
+   const std::vector<struct agent_expr *> &conds, int *jump_size);
+
+/* Forget the breakpoint jump pads of process PID, because it went
+   away, or exec'd, or its agent was closed.  */
+void free_breakpoint_jump_pads (int pid);
+
+/* If PC is the address of the trap of a breakpoint jump pad, return
+   the address of the breakpoint.  Otherwise, return 0.  */
+CORE_ADDR breakpoint_from_jump_pad_trap (CORE_ADDR pc);
 #endif
 
 struct traceframe;
@@ -215,7 +215,10 @@ public:
     return (refcount () == 0 && !ptid_equal (ptid, inferior_ptid));
   }
 
+  /* The next and previous threads in the thread list.  */
   struct thread_info *next = NULL;
+  struct thread_info *prev = NULL;
+
   ptid_t ptid;			/* "Actual process id";
 				    In fact, this may be overloaded with 
 				    kernel thread id, etc.  */
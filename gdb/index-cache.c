@@ -0,0 +1,558 @@
+/* Caching of GDB/DWARF index files.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "index-cache.h"
+
+#include "build-id.h"
+#include "cli/cli-setshow.h"
+#include "command.h"
+#include "gdbcmd.h"
+#include "objfiles.h"
+#include "symfile.h"
+#include "filestuff.h"
+#include "common/gdb_unlinker.h"
+#include "rsp-low.h"
+#include "common/byte-vector.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void *) -1)
+#endif
+#endif
+
+/* The suffix of the files stored in the cache.  */
+#define INDEX_CACHE_FILE_SUFFIX ".gdb-index"
+
+/* When set to 1, show debug messages about the index cache.  */
+static int debug_index_cache = 0;
+
+/* The index cache directory, used for "set/show index-cache directory".  */
+static char *index_cache_directory = NULL;
+
+/* See index-cache.h.  */
+index_cache global_index_cache;
+
+/* set index-cache on/off commands.  */
+static cmd_list_element *set_index_cache_prefix_list;
+static cmd_list_element *show_index_cache_prefix_list;
+
+#ifdef HAVE_MMAP
+
+/* A cache resource holding a cache file mapped in memory.  The
+   mapping is read-only and file-backed, so its pages are shared with
+   any other GDB using the same file, and can be dropped by the kernel
+   under memory pressure.  */
+
+struct index_cache_resource_mmap final : public index_cache_resource
+{
+  index_cache_resource_mmap (void *addr, size_t length)
+    : m_addr (addr), m_length (length)
+  {
+  }
+
+  ~index_cache_resource_mmap () override
+  {
+    munmap (m_addr, m_length);
+  }
+
+  DISABLE_COPY_AND_ASSIGN (index_cache_resource_mmap);
+
+private:
+  void *m_addr;
+  size_t m_length;
+};
+
+#else
+
+/* A cache resource holding a cache file read into memory.  */
+
+struct index_cache_resource_buffer final : public index_cache_resource
+{
+  gdb::byte_vector contents;
+};
+
+#endif /* HAVE_MMAP */
+
+/* See index-cache.h.  */
+
+index_cache_resource::~index_cache_resource () = default;
+
+/* See index-cache.h.  */
+
+void
+index_cache::set_directory (std::string dir)
+{
+  gdb_assert (!dir.empty ());
+
+  m_dir = std::move (dir);
+
+  if (debug_index_cache)
+    printf_unfiltered ("index cache: now using directory %s\n",
+		       m_dir.c_str ());
+}
+
+/* See index-cache.h.  */
+
+void
+index_cache::enable ()
+{
+  if (debug_index_cache)
+    printf_unfiltered ("index cache: enabling (%s)\n", m_dir.c_str ());
+
+  m_enabled = true;
+}
+
+/* See index-cache.h.  */
+
+void
+index_cache::disable ()
+{
+  if (debug_index_cache)
+    printf_unfiltered ("index cache: disabling\n");
+
+  m_enabled = false;
+}
+
+/* Create the directory DIR and any missing parent.  Return true on
+   success, false otherwise; errno is set in that case.  */
+
+static bool
+mkdir_recursive (const char *dir)
+{
+  std::string path (dir);
+  size_t pos = 0;
+
+  while (pos != std::string::npos)
+    {
+      pos = path.find ('/', pos + 1);
+
+      std::string component = path.substr (0, pos);
+      if (component.empty ())
+	continue;
+
+      struct stat st;
+      if (stat (component.c_str (), &st) == 0)
+	{
+	  if (!S_ISDIR (st.st_mode))
+	    {
+	      errno = ENOTDIR;
+	      return false;
+	    }
+	  continue;
+	}
+
+#ifdef USE_WIN32API
+      if (mkdir (component.c_str ()) != 0 && errno != EEXIST)
+#else
+      if (mkdir (component.c_str (), S_IRWXU) != 0 && errno != EEXIST)
+#endif
+	return false;
+    }
+
+  return true;
+}
+
+/* See index-cache.h.  */
+
+void
+index_cache::store (struct objfile *objfile)
+{
+  if (!enabled ())
+    return;
+
+  /* Get build id of objfile.  */
+  const bfd_build_id *build_id = build_id_bfd_get (objfile->obfd);
+  if (build_id == NULL)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: objfile %s has no build id\n",
+			   objfile_name (objfile));
+      return;
+    }
+
+  if (m_dir.empty ())
+    return;
+
+  std::string build_id_str = bin2hex (build_id->data, build_id->size);
+
+  TRY
+    {
+      /* Try to create the containing directory.  */
+      if (!mkdir_recursive (m_dir.c_str ()))
+	error (_("Unable to create cache directory %s: %s"),
+	       m_dir.c_str (), safe_strerror (errno));
+
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: writing index cache for objfile %s\n",
+			   objfile_name (objfile));
+
+      /* Write the index under a temporary name first and rename it
+	 once complete, so that another GDB reading the same binary
+	 never sees a partially written file.  */
+      std::string tmp_basename
+	= string_printf ("%s.%ld.tmp", build_id_str.c_str (),
+			 (long) getpid ());
+      dwarf2_write_index (objfile, m_dir.c_str (), tmp_basename.c_str ());
+
+      std::string tmp_filename = (m_dir + SLASH_STRING + tmp_basename
+				  + INDEX_CACHE_FILE_SUFFIX);
+      std::string filename = make_filename (build_id,
+					    INDEX_CACHE_FILE_SUFFIX);
+      if (rename (tmp_filename.c_str (), filename.c_str ()) != 0)
+	{
+	  int save_errno = errno;
+
+	  unlink (tmp_filename.c_str ());
+	  error (_("Unable to rename %s to %s: %s"), tmp_filename.c_str (),
+		 filename.c_str (), safe_strerror (save_errno));
+	}
+    }
+  CATCH (except, RETURN_MASK_ERROR)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: couldn't store index cache for "
+			   "objfile %s: %s\n",
+			   objfile_name (objfile), except.message);
+    }
+  END_CATCH
+}
+
+/* Map the cache file FILENAME in memory, storing the mapping in
+   RESOURCE, and return its contents.  If SIZE is not zero, the file
+   must be SIZE bytes long.  Return an empty array_view if the file
+   does not exist or can't be used.  */
+
+static gdb::array_view<const gdb_byte>
+read_cache_file (const std::string &filename, size_t size,
+		 std::unique_ptr<index_cache_resource> *resource)
+{
+  if (debug_index_cache)
+    printf_unfiltered ("index cache: trying to read %s\n",
+		       filename.c_str ());
+
+  gdb_file_up file = gdb_fopen_cloexec (filename.c_str (), "rb");
+  if (file == NULL)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: couldn't open %s: %s\n",
+			   filename.c_str (), safe_strerror (errno));
+      return {};
+    }
+
+  int fd = fileno (file.get ());
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size == 0
+      || (size != 0 && (size_t) st.st_size != size))
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: ignoring %s, which has an "
+			   "unexpected size\n", filename.c_str ());
+      return {};
+    }
+
+#ifdef HAVE_MMAP
+  void *addr = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: couldn't mmap %s: %s\n",
+			   filename.c_str (), safe_strerror (errno));
+      return {};
+    }
+
+  resource->reset (new index_cache_resource_mmap (addr, st.st_size));
+  return gdb::array_view<const gdb_byte> ((const gdb_byte *) addr,
+					  st.st_size);
+#else
+  std::unique_ptr<index_cache_resource_buffer> buffer
+    (new index_cache_resource_buffer);
+  buffer->contents.resize (st.st_size);
+  if (fread (buffer->contents.data (), 1, st.st_size, file.get ())
+      != (size_t) st.st_size)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: couldn't read %s\n",
+			   filename.c_str ());
+      return {};
+    }
+
+  gdb::array_view<const gdb_byte> result (buffer->contents.data (),
+					  buffer->contents.size ());
+  *resource = std::move (buffer);
+  return result;
+#endif
+}
+
+/* See index-cache.h.  */
+
+gdb::array_view<const gdb_byte>
+index_cache::lookup_gdb_index (const bfd_build_id *build_id,
+			       std::unique_ptr<index_cache_resource> *resource)
+{
+  if (!enabled () || m_dir.empty ())
+    return {};
+
+  return read_cache_file (make_filename (build_id, INDEX_CACHE_FILE_SUFFIX),
+			  0, resource);
+}
+
+/* See index-cache.h.  */
+
+gdb::array_view<const gdb_byte>
+index_cache::lookup_section (const bfd_build_id *build_id,
+			     const char *section_name, size_t size,
+			     std::unique_ptr<index_cache_resource> *resource)
+{
+  if (!enabled () || m_dir.empty ())
+    return {};
+
+  return read_cache_file (make_filename (build_id, section_name), size,
+			  resource);
+}
+
+/* See index-cache.h.  */
+
+void
+index_cache::store_section (const bfd_build_id *build_id,
+			    const char *section_name,
+			    gdb::array_view<const gdb_byte> contents)
+{
+  if (!enabled () || m_dir.empty ())
+    return;
+
+  std::string filename = make_filename (build_id, section_name);
+  std::string tmp_filename = string_printf ("%s.%ld.tmp", filename.c_str (),
+					    (long) getpid ());
+
+  TRY
+    {
+      if (!mkdir_recursive (m_dir.c_str ()))
+	error (_("Unable to create cache directory %s: %s"),
+	       m_dir.c_str (), safe_strerror (errno));
+
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: writing %s\n", filename.c_str ());
+
+      gdb::unlinker unlink_file (tmp_filename.c_str ());
+      {
+	gdb_file_up file = gdb_fopen_cloexec (tmp_filename.c_str (), "wb");
+	if (file == NULL)
+	  error (_("Can't open `%s' for writing"), tmp_filename.c_str ());
+
+	if (fwrite (contents.data (), 1, contents.size (), file.get ())
+	    != contents.size ()
+	    || fclose (file.release ()) != 0)
+	  error (_("Couldn't write `%s': %s"), tmp_filename.c_str (),
+		 safe_strerror (errno));
+      }
+
+      if (rename (tmp_filename.c_str (), filename.c_str ()) != 0)
+	error (_("Unable to rename %s to %s: %s"), tmp_filename.c_str (),
+	       filename.c_str (), safe_strerror (errno));
+      unlink_file.keep ();
+    }
+  CATCH (except, RETURN_MASK_ERROR)
+    {
+      if (debug_index_cache)
+	printf_unfiltered ("index cache: couldn't store %s: %s\n",
+			   filename.c_str (), except.message);
+    }
+  END_CATCH
+}
+
+/* See index-cache.h.  */
+
+std::string
+index_cache::make_filename (const bfd_build_id *build_id,
+			    const char *suffix) const
+{
+  std::string build_id_str = bin2hex (build_id->data, build_id->size);
+
+  return m_dir + SLASH_STRING + build_id_str + suffix;
+}
+
+/* Return the default index cache directory: $XDG_CACHE_HOME/gdb if
+   XDG_CACHE_HOME is set, $HOME/.cache/gdb otherwise.  Return an
+   empty string if neither is set.  */
+
+static std::string
+get_default_index_cache_dir ()
+{
+  const char *xdg_cache_home = getenv ("XDG_CACHE_HOME");
+  if (xdg_cache_home != NULL && xdg_cache_home[0] != '\0')
+    return std::string (xdg_cache_home) + SLASH_STRING + "gdb";
+
+  const char *home = getenv ("HOME");
+  if (home != NULL && home[0] != '\0')
+    return (std::string (home) + SLASH_STRING + ".cache" + SLASH_STRING
+	    + "gdb");
+
+  return {};
+}
+
+/* "set index-cache" handler.  */
+
+static void
+set_index_cache_command (const char *arg, int from_tty)
+{
+  printf_unfiltered (_("\
+Missing arguments.  See \"help set index-cache\" for help.\n"));
+}
+
+/* Whether we are in the context of showing the index cache settings;
+   used to tell "show index-cache stats" it is being called as part of
+   "show index-cache".  */
+static bool in_show_index_cache_command = false;
+
+/* "show index-cache" handler.  */
+
+static void
+show_index_cache_command (const char *arg, int from_tty)
+{
+  /* Note that we are running "show index-cache".  */
+  scoped_restore restore_flag
+    = make_scoped_restore (&in_show_index_cache_command, true);
+
+  /* Call all "show index-cache" subcommands.  */
+  cmd_show_list (show_index_cache_prefix_list, from_tty, "");
+
+  printf_unfiltered ("\n");
+  printf_unfiltered
+    (_("The index cache is currently %s.\n"),
+     global_index_cache.enabled () ? _("enabled") : _("disabled"));
+}
+
+/* "set index-cache on" handler.  */
+
+static void
+set_index_cache_on_command (const char *arg, int from_tty)
+{
+  if (arg != NULL && *arg != '\0')
+    error (_("Garbage after \"set index-cache on\" command: `%s'"), arg);
+
+  global_index_cache.enable ();
+}
+
+/* "set index-cache off" handler.  */
+
+static void
+set_index_cache_off_command (const char *arg, int from_tty)
+{
+  if (arg != NULL && *arg != '\0')
+    error (_("Garbage after \"set index-cache off\" command: `%s'"), arg);
+
+  global_index_cache.disable ();
+}
+
+/* "set index-cache directory" handler.  */
+
+static void
+set_index_cache_directory_command (const char *arg, int from_tty,
+				   cmd_list_element *element)
+{
+  /* Make sure the index cache directory is absolute and tilde-expanded.  */
+  gdb::unique_xmalloc_ptr<char> abs (gdb_abspath (index_cache_directory));
+  xfree (index_cache_directory);
+  index_cache_directory = abs.release ();
+  global_index_cache.set_directory (index_cache_directory);
+}
+
+/* "show index-cache stats" handler.  */
+
+static void
+show_index_cache_stats_command (const char *arg, int from_tty)
+{
+  const char *indent = "";
+
+  /* If this command is invoked through "show index-cache", make the
+     display a bit nicer.  */
+  if (in_show_index_cache_command)
+    {
+      indent = "  ";
+      printf_unfiltered ("\n");
+    }
+
+  printf_unfiltered (_("%s  Cache hits (this session): %u\n"),
+		     indent, global_index_cache.n_hits ());
+  printf_unfiltered (_("%sCache misses (this session): %u\n"),
+		     indent, global_index_cache.n_misses ());
+}
+
+void
+_initialize_index_cache ()
+{
+  /* Set the default index cache directory.  */
+  std::string cache_dir = get_default_index_cache_dir ();
+  if (!cache_dir.empty ())
+    {
+      index_cache_directory = xstrdup (cache_dir.c_str ());
+      global_index_cache.set_directory (std::move (cache_dir));
+    }
+  else
+    warning (_("Couldn't determine a path for the index cache directory."));
+
+  /* set index-cache */
+  add_prefix_cmd ("index-cache", class_files, set_index_cache_command,
+		  _("Set index-cache options"), &set_index_cache_prefix_list,
+		  "set index-cache ", 0, &setlist);
+
+  /* show index-cache */
+  add_prefix_cmd ("index-cache", class_files, show_index_cache_command,
+		  _("Show index-cache options"), &show_index_cache_prefix_list,
+		  "show index-cache ", 0, &showlist);
+
+  /* set index-cache on */
+  add_cmd ("on", class_files, set_index_cache_on_command,
+	   _("Enable the index cache.\n\
+When on, enable the use of the index cache."),
+	   &set_index_cache_prefix_list);
+
+  /* set index-cache off */
+  add_cmd ("off", class_files, set_index_cache_off_command,
+	   _("Disable the index cache.\n\
+When off, disable the use of the index cache."),
+	   &set_index_cache_prefix_list);
+
+  /* set index-cache directory */
+  add_setshow_filename_cmd ("directory", class_files, &index_cache_directory,
+			    _("Set the directory of the index cache."),
+			    _("Show the directory of the index cache."),
+			    NULL,
+			    set_index_cache_directory_command, NULL,
+			    &set_index_cache_prefix_list,
+			    &show_index_cache_prefix_list);
+
+  /* show index-cache stats */
+  add_cmd ("stats", class_files, show_index_cache_stats_command,
+	   _("Show some stats about the index cache."),
+	   &show_index_cache_prefix_list);
+
+  /* set debug index-cache */
+  add_setshow_boolean_cmd ("index-cache", class_maintenance,
+			   &debug_index_cache,
+			   _("Set display of index-cache debug messages."),
+			   _("Show display of index-cache debug messages."),
+			   _("\
+When non-zero, debugging output for the index cache is displayed."),
+			    NULL, NULL,
+			    &setdebuglist, &showdebuglist);
+}
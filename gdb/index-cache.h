@@ -0,0 +1,144 @@
+/* Caching of GDB/DWARF index files.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef INDEX_CACHE_H
+#define INDEX_CACHE_H
+
+#include "common/array-view.h"
+
+struct objfile;
+struct bfd_build_id;
+
+/* Base of the classes used to keep the contents of an index read from
+   the cache alive for as long as the objfile uses it.  */
+
+struct index_cache_resource
+{
+  virtual ~index_cache_resource () = 0;
+};
+
+/* The index cache.
+
+   When enabled, an index is written to the cache directory for every
+   objfile whose DWARF had to be read into partial symbol tables, and
+   is looked up there the next time an objfile with the same build-id
+   is read, as if it had a .gdb_index section.  */
+
+class index_cache
+{
+public:
+  /* Change the directory used to save/load index files.  */
+  void set_directory (std::string dir);
+
+  /* Enable/disable the index cache.  */
+  void enable ();
+  void disable ();
+
+  /* Return true if the index cache is enabled.  */
+  bool enabled () const
+  {
+    return m_enabled;
+  }
+
+  /* Store an index for OBJFILE, whose partial symbol tables have just
+     been built, in the cache.  Errors are not reported, except with
+     "set debug index-cache".  */
+  void store (struct objfile *objfile);
+
+  /* Look for an index file matching BUILD_ID.  If found, return the
+     contents as an array_view and store the underlying resources
+     (allocated memory, mapped file, etc) in RESOURCE.  The returned
+     array_view is valid as long as RESOURCE is not destroyed.
+
+     If no matching index file is found, return an empty
+     array_view.  */
+  gdb::array_view<const gdb_byte>
+    lookup_gdb_index (const bfd_build_id *build_id,
+		      std::unique_ptr<index_cache_resource> *resource);
+
+  /* The cache also keeps the decompressed contents of compressed
+     debug sections, so that they can be mapped from a file instead of
+     being decompressed into memory by every GDB reading them.
+
+     Look for the contents of the section named SECTION_NAME, SIZE
+     bytes long once decompressed, of the BFD with build id BUILD_ID.
+     Works like lookup_gdb_index.  */
+  gdb::array_view<const gdb_byte>
+    lookup_section (const bfd_build_id *build_id, const char *section_name,
+		    size_t size,
+		    std::unique_ptr<index_cache_resource> *resource);
+
+  /* Store CONTENTS, the decompressed contents of the section named
+     SECTION_NAME of the BFD with build id BUILD_ID, in the cache.
+     Errors are not reported, except with "set debug index-cache".  */
+  void store_section (const bfd_build_id *build_id, const char *section_name,
+		      gdb::array_view<const gdb_byte> contents);
+
+  /* Return the number of cache hits.  */
+  unsigned int n_hits () const
+  {
+    return m_n_hits;
+  }
+
+  /* Record a cache hit.  */
+  void hit ()
+  {
+    if (enabled ())
+      m_n_hits++;
+  }
+
+  /* Return the number of cache misses.  */
+  unsigned int n_misses () const
+  {
+    return m_n_misses;
+  }
+
+  /* Record a cache miss.  */
+  void miss ()
+  {
+    if (enabled ())
+      m_n_misses++;
+  }
+
+private:
+  /* Compute the absolute name of the cache file for build id
+     BUILD_ID with SUFFIX appended.  */
+  std::string make_filename (const bfd_build_id *build_id,
+			     const char *suffix) const;
+
+  /* The base directory where we are storing and looking up index
+     files.  */
+  std::string m_dir;
+
+  /* Whether the cache is enabled.  */
+  bool m_enabled = false;
+
+  /* Number of times we found an index in the cache.  */
+  unsigned int m_n_hits = 0;
+
+  /* Number of times we looked for an index in the cache and did not
+     find it.  */
+  unsigned int m_n_misses = 0;
+};
+
+/* The global instance of the index cache.  */
+
+extern index_cache global_index_cache;
+
+#endif /* INDEX_CACHE_H */
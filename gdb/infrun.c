@@ -67,6 +67,7 @@
 #include "progspace-and-thread.h"
 #include "common/gdb_optional.h"
 #include "arch-utils.h"
+#include "common/byte-vector.h"
 
 /* Prototypes for local functions */
 
@@ -1424,9 +1425,10 @@ step_over_info_valid_p (void)
 
    This approach depends on the following gdbarch methods:
 
-   - gdbarch_max_insn_length and gdbarch_displaced_step_location
-     indicate where to copy the instruction, and how much space must
-     be reserved there.  We use these in step n1.
+   - gdbarch_displaced_step_buffer_length and
+     gdbarch_displaced_step_location indicate where to copy the
+     instruction, and how much space must be reserved there.  We use
+     these in step n1.
 
    - gdbarch_displaced_step_copy_insn copies a instruction to a new
      address, and makes any necessary adjustments to the instruction,
@@ -1464,51 +1466,66 @@ step_over_info_valid_p (void)
 
    In non-stop mode, we can have independent and simultaneous step
    requests, so more than one thread may need to simultaneously step
-   over a breakpoint.  The current implementation assumes there is
-   only one scratch space per process.  In this case, we have to
-   serialize access to the scratch space.  If thread A wants to step
-   over a breakpoint, but we are currently waiting for some other
-   thread to complete a displaced step, we leave thread A stopped and
-   place it in the displaced_step_request_queue.  Whenever a displaced
-   step finishes, we pick the next thread in the queue and start a new
-   displaced step operation on it.  See displaced_step_prepare and
-   displaced_step_fixup for details.  */
+   over a breakpoint.  Each process has a small pool of scratch
+   spaces, laid out back to back from the address returned by
+   gdbarch_displaced_step_location, as far as the function containing
+   it extends; see displaced_step_init_buffers.  As many threads as
+   there are buffers can be displaced stepping at once.  If thread A
+   wants to step over a breakpoint, but all the buffers are in use by
+   other threads, we leave thread A stopped and place it in the
+   step-over queue.  Whenever a displaced step finishes, we pick the
+   next thread in the queue and start a new displaced step operation
+   on it.  See displaced_step_prepare and displaced_step_fixup for
+   details.  */
 
 /* Default destructor for displaced_step_closure.  */
 
 displaced_step_closure::~displaced_step_closure () = default;
 
-/* Per-inferior displaced stepping state.  */
-struct displaced_step_inferior_state
-{
-  /* Pointer to next in linked list.  */
-  struct displaced_step_inferior_state *next;
-
-  /* The process this displaced step state refers to.  */
-  int pid;
-
-  /* True if preparing a displaced step ever failed.  If so, we won't
-     try displaced stepping for this inferior again.  */
-  int failed_before;
+/* The maximum number of displaced stepping buffers of a process.  */
+#define MAX_DISPLACED_STEP_BUFFERS 8
 
+/* A displaced stepping buffer: a scratch space the instruction a
+   thread steps over is copied to.  */
+struct displaced_step_buffer
+{
   /* If this is not null_ptid, this is the thread carrying out a
-     displaced single-step in process PID.  This thread's state will
+     displaced single-step in this buffer.  This thread's state will
      require fixing up once it has completed its step.  */
-  ptid_t step_ptid;
+  ptid_t step_ptid = null_ptid;
 
   /* The architecture the thread had when we stepped it.  */
-  struct gdbarch *step_gdbarch;
+  struct gdbarch *step_gdbarch = NULL;
 
   /* The closure provided gdbarch_displaced_step_copy_insn, to be used
      for post-step cleanup.  */
-  struct displaced_step_closure *step_closure;
+  struct displaced_step_closure *step_closure = NULL;
 
   /* The address of the original instruction, and the copy we
-     made.  */
-  CORE_ADDR step_original, step_copy;
+     made.  STEP_COPY is the address of the buffer.  */
+  CORE_ADDR step_original = 0, step_copy = 0;
 
   /* Saved contents of copy area.  */
-  gdb_byte *step_saved_copy;
+  gdb::byte_vector step_saved_copy;
+};
+
+/* Per-inferior displaced stepping state.  */
+struct displaced_step_inferior_state
+{
+  /* Pointer to next in linked list.  */
+  struct displaced_step_inferior_state *next = NULL;
+
+  /* The process this displaced step state refers to.  */
+  int pid = 0;
+
+  /* True if preparing a displaced step ever failed.  If so, we won't
+     try displaced stepping for this inferior again.  */
+  int failed_before = 0;
+
+  /* The displaced stepping buffers of the process.  Empty until a
+     thread of the process is displaced stepped for the first
+     time.  */
+  std::vector<displaced_step_buffer> buffers;
 };
 
 /* The list of states of processes involved in displaced stepping
@@ -1531,6 +1548,39 @@ get_displaced_stepping_state (int pid)
   return NULL;
 }
 
+/* Return the displaced stepping buffer thread PTID is doing a
+   displaced step in, or NULL if it isn't doing a displaced step.  */
+
+static struct displaced_step_buffer *
+displaced_step_buffer_of_thread (ptid_t ptid)
+{
+  struct displaced_step_inferior_state *displaced;
+
+  gdb_assert (!ptid_equal (ptid, null_ptid));
+
+  displaced = get_displaced_stepping_state (ptid_get_pid (ptid));
+  if (displaced == NULL)
+    return NULL;
+
+  for (displaced_step_buffer &buffer : displaced->buffers)
+    if (ptid_equal (buffer.step_ptid, ptid))
+      return &buffer;
+
+  return NULL;
+}
+
+/* Return true if DISPLACED has a thread doing a displaced step.  */
+
+static int
+displaced_step_in_progress_1 (struct displaced_step_inferior_state *displaced)
+{
+  for (const displaced_step_buffer &buffer : displaced->buffers)
+    if (!ptid_equal (buffer.step_ptid, null_ptid))
+      return 1;
+
+  return 0;
+}
+
 /* Returns true if any inferior has a thread doing a displaced
    step.  */
 
@@ -1542,7 +1592,7 @@ displaced_step_in_progress_any_inferior (void)
   for (state = displaced_step_inferior_states;
        state != NULL;
        state = state->next)
-    if (!ptid_equal (state->step_ptid, null_ptid))
+    if (displaced_step_in_progress_1 (state))
       return 1;
 
   return 0;
@@ -1554,26 +1604,37 @@ displaced_step_in_progress_any_inferior (void)
 static int
 displaced_step_in_progress_thread (ptid_t ptid)
 {
-  struct displaced_step_inferior_state *displaced;
+  return displaced_step_buffer_of_thread (ptid) != NULL;
+}
 
-  gdb_assert (!ptid_equal (ptid, null_ptid));
+/* Return true if process PID has a thread doing a displaced step.  */
 
-  displaced = get_displaced_stepping_state (ptid_get_pid (ptid));
+static int
+displaced_step_in_progress (int pid)
+{
+  struct displaced_step_inferior_state *displaced;
 
-  return (displaced != NULL && ptid_equal (displaced->step_ptid, ptid));
+  displaced = get_displaced_stepping_state (pid);
+  return displaced != NULL && displaced_step_in_progress_1 (displaced);
 }
 
-/* Return true if process PID has a thread doing a displaced step.  */
+/* Return true if a thread of process PID could start a displaced step
+   now, i.e., if not all the displaced stepping buffers of the process
+   are in use.  */
 
 static int
-displaced_step_in_progress (int pid)
+displaced_step_buffer_available (int pid)
 {
   struct displaced_step_inferior_state *displaced;
 
   displaced = get_displaced_stepping_state (pid);
-  if (displaced != NULL && !ptid_equal (displaced->step_ptid, null_ptid))
+  if (displaced == NULL || displaced->buffers.empty ())
     return 1;
 
+  for (const displaced_step_buffer &buffer : displaced->buffers)
+    if (ptid_equal (buffer.step_ptid, null_ptid))
+      return 1;
+
   return 0;
 }
 
@@ -1592,7 +1653,7 @@ add_displaced_stepping_state (int pid)
     if (state->pid == pid)
       return state;
 
-  state = XCNEW (struct displaced_step_inferior_state);
+  state = new displaced_step_inferior_state ();
   state->pid = pid;
   state->next = displaced_step_inferior_states;
   displaced_step_inferior_states = state;
@@ -1610,10 +1671,14 @@ get_displaced_step_closure_by_addr (CORE_ADDR addr)
   struct displaced_step_inferior_state *displaced
     = get_displaced_stepping_state (ptid_get_pid (inferior_ptid));
 
+  if (displaced == NULL)
+    return NULL;
+
   /* If checking the mode of displaced instruction in copy area.  */
-  if (displaced && !ptid_equal (displaced->step_ptid, null_ptid)
-     && (displaced->step_copy == addr))
-    return displaced->step_closure;
+  for (const displaced_step_buffer &buffer : displaced->buffers)
+    if (!ptid_equal (buffer.step_ptid, null_ptid)
+	&& buffer.step_copy == addr)
+      return buffer.step_closure;
 
   return NULL;
 }
@@ -1634,7 +1699,9 @@ remove_displaced_stepping_state (int pid)
       if (it->pid == pid)
 	{
 	  *prev_next_p = it->next;
-	  xfree (it);
+	  for (displaced_step_buffer &buffer : it->buffers)
+	    delete buffer.step_closure;
+	  delete it;
 	  return;
 	}
 
@@ -1698,22 +1765,56 @@ use_displaced_stepping (struct thread_info *tp)
 
 /* Clean out any stray displaced stepping state.  */
 static void
-displaced_step_clear (struct displaced_step_inferior_state *displaced)
+displaced_step_clear (struct displaced_step_buffer *buffer)
 {
   /* Indicate that there is no cleanup pending.  */
-  displaced->step_ptid = null_ptid;
+  buffer->step_ptid = null_ptid;
 
-  delete displaced->step_closure;
-  displaced->step_closure = NULL;
+  delete buffer->step_closure;
+  buffer->step_closure = NULL;
 }
 
 static void
 displaced_step_clear_cleanup (void *arg)
 {
-  struct displaced_step_inferior_state *state
-    = (struct displaced_step_inferior_state *) arg;
+  struct displaced_step_buffer *buffer
+    = (struct displaced_step_buffer *) arg;
 
-  displaced_step_clear (state);
+  displaced_step_clear (buffer);
+}
+
+/* Set up the displaced stepping buffers of DISPLACED, for threads of
+   architecture GDBARCH.  The scratch space is usually at the entry
+   point, in code that only runs when the program starts, so we can
+   lay out as many buffers as fit in the function starting there, up
+   to MAX_DISPLACED_STEP_BUFFERS.  If no known function starts at the
+   scratch space, e.g. in a stripped program where the closest symbol
+   before it belongs to other code, we only use one buffer.  */
+
+static void
+displaced_step_init_buffers (struct displaced_step_inferior_state *displaced,
+			     struct gdbarch *gdbarch)
+{
+  CORE_ADDR addr = gdbarch_displaced_step_location (gdbarch);
+  ULONGEST len = gdbarch_displaced_step_buffer_length (gdbarch);
+  CORE_ADDR func_start, func_end;
+  int count = 1;
+
+  if (find_pc_partial_function (addr, NULL, &func_start, &func_end)
+      && func_start == addr
+      && func_end > addr)
+    count = std::min<ULONGEST> ((func_end - addr) / len,
+				MAX_DISPLACED_STEP_BUFFERS);
+  count = std::max (count, 1);
+
+  displaced->buffers.resize (count);
+  for (int i = 0; i < count; i++)
+    displaced->buffers[i].step_copy = addr + i * len;
+
+  if (debug_displaced)
+    fprintf_unfiltered (gdb_stdlog,
+			"displaced: %d buffer(s) of %s bytes at %s\n",
+			count, pulongest (len), paddress (gdbarch, addr));
 }
 
 /* Dump LEN bytes at BUF in hex to FILE, followed by a newline.  */
@@ -1757,6 +1858,7 @@ displaced_step_prepare_throw (ptid_t ptid)
   ULONGEST len;
   struct displaced_step_closure *closure;
   struct displaced_step_inferior_state *displaced;
+  struct displaced_step_buffer *buffer = NULL;
   int status;
 
   /* We should never reach this function if the architecture does not
@@ -1772,15 +1874,25 @@ displaced_step_prepare_throw (ptid_t ptid)
      jump/branch).  */
   tp->control.may_range_step = 0;
 
-  /* We have to displaced step one thread at a time, as we only have
-     access to a single scratch space per inferior.  */
+  /* We can displaced step as many threads at a time as there are
+     scratch spaces in the inferior.  */
 
   displaced = add_displaced_stepping_state (ptid_get_pid (ptid));
 
-  if (!ptid_equal (displaced->step_ptid, null_ptid))
+  if (displaced->buffers.empty ())
+    displaced_step_init_buffers (displaced, gdbarch);
+
+  for (displaced_step_buffer &candidate : displaced->buffers)
+    if (ptid_equal (candidate.step_ptid, null_ptid))
+      {
+	buffer = &candidate;
+	break;
+      }
+
+  if (buffer == NULL)
     {
-      /* Already waiting for a displaced step to finish.  Defer this
-	 request and place in queue.  */
+      /* Already waiting for displaced steps to finish in all the
+	 buffers.  Defer this request and place in queue.  */
 
       if (debug_displaced)
 	fprintf_unfiltered (gdb_stdlog,
@@ -1798,15 +1910,15 @@ displaced_step_prepare_throw (ptid_t ptid)
 			    target_pid_to_str (ptid));
     }
 
-  displaced_step_clear (displaced);
+  displaced_step_clear (buffer);
 
   scoped_restore save_inferior_ptid = make_scoped_restore (&inferior_ptid);
   inferior_ptid = ptid;
 
   original = regcache_read_pc (regcache);
 
-  copy = gdbarch_displaced_step_location (gdbarch);
-  len = gdbarch_max_insn_length (gdbarch);
+  copy = buffer->step_copy;
+  len = gdbarch_displaced_step_buffer_length (gdbarch);
 
   if (breakpoint_in_range_p (aspace, copy, len))
     {
@@ -1830,10 +1942,9 @@ displaced_step_prepare_throw (ptid_t ptid)
     }
 
   /* Save the original contents of the copy area.  */
-  displaced->step_saved_copy = (gdb_byte *) xmalloc (len);
-  ignore_cleanups = make_cleanup (free_current_contents,
-				  &displaced->step_saved_copy);
-  status = target_read_memory (copy, displaced->step_saved_copy, len);
+  buffer->step_saved_copy.resize (len);
+  ignore_cleanups = make_cleanup (null_cleanup, NULL);
+  status = target_read_memory (copy, buffer->step_saved_copy.data (), len);
   if (status != 0)
     throw_error (MEMORY_ERROR,
 		 _("Error accessing memory address %s (%s) for "
@@ -1844,7 +1955,7 @@ displaced_step_prepare_throw (ptid_t ptid)
       fprintf_unfiltered (gdb_stdlog, "displaced: saved %s: ",
 			  paddress (gdbarch, copy));
       displaced_step_dump_bytes (gdb_stdlog,
-				 displaced->step_saved_copy,
+				 buffer->step_saved_copy.data (),
 				 len);
     };
 
@@ -1861,13 +1972,12 @@ displaced_step_prepare_throw (ptid_t ptid)
 
   /* Save the information we need to fix things up if the step
      succeeds.  */
-  displaced->step_ptid = ptid;
-  displaced->step_gdbarch = gdbarch;
-  displaced->step_closure = closure;
-  displaced->step_original = original;
-  displaced->step_copy = copy;
+  buffer->step_ptid = ptid;
+  buffer->step_gdbarch = gdbarch;
+  buffer->step_closure = closure;
+  buffer->step_original = original;
 
-  make_cleanup (displaced_step_clear_cleanup, displaced);
+  make_cleanup (displaced_step_clear_cleanup, buffer);
 
   /* Resume execution at the copy.  */
   regcache_write_pc (regcache, copy);
@@ -1936,21 +2046,21 @@ write_memory_ptid (ptid_t ptid, CORE_ADDR memaddr,
   write_memory (memaddr, myaddr, len);
 }
 
-/* Restore the contents of the copy area for thread PTID.  */
+/* Restore the contents of the copy area BUFFER for thread PTID.  */
 
 static void
-displaced_step_restore (struct displaced_step_inferior_state *displaced,
-			ptid_t ptid)
+displaced_step_restore (struct displaced_step_buffer *buffer, ptid_t ptid)
 {
-  ULONGEST len = gdbarch_max_insn_length (displaced->step_gdbarch);
+  ULONGEST len
+    = gdbarch_displaced_step_buffer_length (buffer->step_gdbarch);
 
-  write_memory_ptid (ptid, displaced->step_copy,
-		     displaced->step_saved_copy, len);
+  write_memory_ptid (ptid, buffer->step_copy,
+		     buffer->step_saved_copy.data (), len);
   if (debug_displaced)
     fprintf_unfiltered (gdb_stdlog, "displaced: restored %s %s\n",
 			target_pid_to_str (ptid),
-			paddress (displaced->step_gdbarch,
-				  displaced->step_copy));
+			paddress (buffer->step_gdbarch,
+				  buffer->step_copy));
 }
 
 /* If we displaced stepped an instruction successfully, adjust
@@ -1963,19 +2073,14 @@ static int
 displaced_step_fixup (ptid_t event_ptid, enum gdb_signal signal)
 {
   struct cleanup *old_cleanups;
-  struct displaced_step_inferior_state *displaced
-    = get_displaced_stepping_state (ptid_get_pid (event_ptid));
+  struct displaced_step_buffer *displaced
+    = displaced_step_buffer_of_thread (event_ptid);
   int ret;
 
-  /* Was any thread of this process doing a displaced step?  */
+  /* Was this event for a thread we displaced?  */
   if (displaced == NULL)
     return 0;
 
-  /* Was this event for the pid we displaced?  */
-  if (ptid_equal (displaced->step_ptid, null_ptid)
-      || ! ptid_equal (displaced->step_ptid, event_ptid))
-    return 0;
-
   old_cleanups = make_cleanup (displaced_step_clear_cleanup, displaced);
 
   displaced_step_restore (displaced, displaced->step_ptid);
@@ -2080,9 +2185,9 @@ start_step_over (void)
 
       next = thread_step_over_chain_next (tp);
 
-      /* If this inferior already has a displaced step in process,
-	 don't start a new one.  */
-      if (displaced_step_in_progress (ptid_get_pid (tp->ptid)))
+      /* If all the displaced stepping buffers of this inferior are in
+	 use, don't start a new displaced step.  */
+      if (!displaced_step_buffer_available (ptid_get_pid (tp->ptid)))
 	continue;
 
       step_what = thread_still_needs_step_over (tp);
@@ -2184,8 +2289,9 @@ infrun_thread_ptid_changed (ptid_t old_ptid, ptid_t new_ptid)
        displaced;
        displaced = displaced->next)
     {
-      if (ptid_equal (displaced->step_ptid, old_ptid))
-	displaced->step_ptid = new_ptid;
+      for (displaced_step_buffer &buffer : displaced->buffers)
+	if (ptid_equal (buffer.step_ptid, old_ptid))
+	  buffer.step_ptid = new_ptid;
     }
 }
 
@@ -2571,13 +2677,13 @@ resume (enum gdb_signal sig)
 	}
       else if (prepared > 0)
 	{
-	  struct displaced_step_inferior_state *displaced;
+	  struct displaced_step_buffer *displaced;
 
 	  /* Update pc to reflect the new address from which we will
 	     execute instructions due to displaced stepping.  */
 	  pc = regcache_read_pc (get_thread_regcache (inferior_ptid));
 
-	  displaced = get_displaced_stepping_state (ptid_get_pid (inferior_ptid));
+	  displaced = displaced_step_buffer_of_thread (inferior_ptid);
 	  step = gdbarch_displaced_step_hw_singlestep (gdbarch,
 						       displaced->step_closure);
 	}
@@ -3601,13 +3707,10 @@ prepare_for_detach (void)
 {
   struct inferior *inf = current_inferior ();
   ptid_t pid_ptid = pid_to_ptid (inf->pid);
-  struct displaced_step_inferior_state *displaced;
-
-  displaced = get_displaced_stepping_state (inf->pid);
 
   /* Is any thread of this process displaced stepping?  If not,
      there's nothing else to do.  */
-  if (displaced == NULL || ptid_equal (displaced->step_ptid, null_ptid))
+  if (!displaced_step_in_progress (inf->pid))
     return;
 
   if (debug_infrun)
@@ -3616,7 +3719,7 @@ prepare_for_detach (void)
 
   scoped_restore restore_detaching = make_scoped_restore (&inf->detaching, true);
 
-  while (!ptid_equal (displaced->step_ptid, null_ptid))
+  while (displaced_step_in_progress (inf->pid))
     {
       struct cleanup *old_chain_2;
       struct execution_control_state ecss;
@@ -4435,6 +4538,129 @@ disable_thread_events (void *arg)
   target_thread_events (0);
 }
 
+/* Handle EVENT_PTID and WS, an event collected by stop_all_threads.
+   Return non-zero if no resumed threads are left.  */
+
+static int
+stop_all_threads_handle_event (ptid_t event_ptid,
+			       struct target_waitstatus *ws)
+{
+  struct thread_info *t;
+
+  if (ws->kind == TARGET_WAITKIND_NO_RESUMED)
+    {
+      /* All resumed threads exited.  */
+      return 1;
+    }
+  else if (ws->kind == TARGET_WAITKIND_THREAD_EXITED
+	   || ws->kind == TARGET_WAITKIND_EXITED
+	   || ws->kind == TARGET_WAITKIND_SIGNALLED)
+    {
+      if (debug_infrun)
+	{
+	  ptid_t ptid = pid_to_ptid (ws->value.integer);
+
+	  fprintf_unfiltered (gdb_stdlog,
+			      "infrun: %s exited while "
+			      "stopping threads\n",
+			      target_pid_to_str (ptid));
+	}
+    }
+  else
+    {
+      struct inferior *inf;
+
+      t = find_thread_ptid (event_ptid);
+      if (t == NULL)
+	t = add_thread (event_ptid);
+
+      t->stop_requested = 0;
+      t->executing = 0;
+      t->resumed = 0;
+      t->control.may_range_step = 0;
+
+      /* This may be the first time we see the inferior report
+	 a stop.  */
+      inf = find_inferior_ptid (event_ptid);
+      if (inf->needs_setup)
+	{
+	  switch_to_thread_no_regs (t);
+	  setup_inferior (0);
+	}
+
+      if (ws->kind == TARGET_WAITKIND_STOPPED
+	  && ws->value.sig == GDB_SIGNAL_0)
+	{
+	  /* We caught the event that we intended to catch, so
+	     there's no event pending.  */
+	  t->suspend.waitstatus.kind = TARGET_WAITKIND_IGNORE;
+	  t->suspend.waitstatus_pending_p = 0;
+
+	  if (displaced_step_fixup (t->ptid, GDB_SIGNAL_0) < 0)
+	    {
+	      /* Add it back to the step-over queue.  */
+	      if (debug_infrun)
+		{
+		  fprintf_unfiltered (gdb_stdlog,
+				      "infrun: displaced-step of %s "
+				      "canceled: adding back to the "
+				      "step-over queue\n",
+				      target_pid_to_str (t->ptid));
+		}
+	      t->control.trap_expected = 0;
+	      thread_step_over_chain_enqueue (t);
+	    }
+	}
+      else
+	{
+	  enum gdb_signal sig;
+	  struct regcache *regcache;
+
+	  if (debug_infrun)
+	    {
+	      std::string statstr = target_waitstatus_to_string (ws);
+
+	      fprintf_unfiltered (gdb_stdlog,
+				  "infrun: target_wait %s, saving "
+				  "status for %d.%ld.%ld\n",
+				  statstr.c_str (),
+				  ptid_get_pid (t->ptid),
+				  ptid_get_lwp (t->ptid),
+				  ptid_get_tid (t->ptid));
+	    }
+
+	  /* Record for later.  */
+	  save_waitstatus (t, ws);
+
+	  sig = (ws->kind == TARGET_WAITKIND_STOPPED
+		 ? ws->value.sig : GDB_SIGNAL_0);
+
+	  if (displaced_step_fixup (t->ptid, sig) < 0)
+	    {
+	      /* Add it back to the step-over queue.  */
+	      t->control.trap_expected = 0;
+	      thread_step_over_chain_enqueue (t);
+	    }
+
+	  regcache = get_thread_regcache (t->ptid);
+	  t->suspend.stop_pc = regcache_read_pc (regcache);
+
+	  if (debug_infrun)
+	    {
+	      fprintf_unfiltered (gdb_stdlog,
+				  "infrun: saved stop_pc=%s for %s "
+				  "(currently_stepping=%d)\n",
+				  paddress (target_gdbarch (),
+					    t->suspend.stop_pc),
+				  target_pid_to_str (t->ptid),
+				  currently_stepping (t));
+	    }
+	}
+    }
+
+  return 0;
+}
+
 /* See infrun.h.  */
 
 void
@@ -4468,15 +4694,20 @@ stop_all_threads (void)
 	fprintf_unfiltered (gdb_stdlog,
 			    "infrun: stop_all_threads, pass=%d, "
 			    "iterations=%d\n", pass, iterations);
+
+      /* Refresh the thread list once per pass, not after each stop
+	 collected below.  Doing so would walk the whole thread list
+	 (and, with remote targets, talk to the target) once per
+	 thread, for every stop of the world.  Threads that appear
+	 while we collect the stops are reported by events, and
+	 anything else is caught by the update of the next pass.  */
+      update_thread_list ();
+
       while (1)
 	{
-	  ptid_t event_ptid;
-	  struct target_waitstatus ws;
-	  int need_wait = 0;
+	  int waits_needed = 0;
 	  struct thread_info *t;
 
-	  update_thread_list ();
-
 	  /* Go through all threads looking for threads that we need
 	     to tell the target to stop.  */
 	  ALL_NON_EXITED_THREADS (t)
@@ -4505,7 +4736,7 @@ stop_all_threads (void)
 		    }
 
 		  if (t->stop_requested)
-		    need_wait = 1;
+		    waits_needed++;
 		}
 	      else
 		{
@@ -4520,7 +4751,7 @@ stop_all_threads (void)
 		}
 	    }
 
-	  if (!need_wait)
+	  if (waits_needed == 0)
 	    break;
 
 	  /* If we find new threads on the second iteration, restart
@@ -4529,115 +4760,20 @@ stop_all_threads (void)
 	  if (pass > 0)
 	    pass = -1;
 
-	  event_ptid = wait_one (&ws);
-	  if (ws.kind == TARGET_WAITKIND_NO_RESUMED)
-	    {
-	      /* All resumed threads exited.  */
-	    }
-	  else if (ws.kind == TARGET_WAITKIND_THREAD_EXITED
-		   || ws.kind == TARGET_WAITKIND_EXITED
-		   || ws.kind == TARGET_WAITKIND_SIGNALLED)
-	    {
-	      if (debug_infrun)
-		{
-		  ptid_t ptid = pid_to_ptid (ws.value.integer);
-
-		  fprintf_unfiltered (gdb_stdlog,
-				      "infrun: %s exited while "
-				      "stopping threads\n",
-				      target_pid_to_str (ptid));
-		}
-	    }
-	  else
+	  /* Collect as many events as there are stops pending before
+	     walking the thread list again, rather than walking it after
+	     each event, which with thousands of threads would make
+	     stopping them all quadratic.  Events of threads we didn't
+	     ask to stop count too; the next walk finds whatever is
+	     still executing.  */
+	  for (; waits_needed > 0; waits_needed--)
 	    {
-	      struct inferior *inf;
-
-	      t = find_thread_ptid (event_ptid);
-	      if (t == NULL)
-		t = add_thread (event_ptid);
-
-	      t->stop_requested = 0;
-	      t->executing = 0;
-	      t->resumed = 0;
-	      t->control.may_range_step = 0;
-
-	      /* This may be the first time we see the inferior report
-		 a stop.  */
-	      inf = find_inferior_ptid (event_ptid);
-	      if (inf->needs_setup)
-		{
-		  switch_to_thread_no_regs (t);
-		  setup_inferior (0);
-		}
-
-	      if (ws.kind == TARGET_WAITKIND_STOPPED
-		  && ws.value.sig == GDB_SIGNAL_0)
-		{
-		  /* We caught the event that we intended to catch, so
-		     there's no event pending.  */
-		  t->suspend.waitstatus.kind = TARGET_WAITKIND_IGNORE;
-		  t->suspend.waitstatus_pending_p = 0;
-
-		  if (displaced_step_fixup (t->ptid, GDB_SIGNAL_0) < 0)
-		    {
-		      /* Add it back to the step-over queue.  */
-		      if (debug_infrun)
-			{
-			  fprintf_unfiltered (gdb_stdlog,
-					      "infrun: displaced-step of %s "
-					      "canceled: adding back to the "
-					      "step-over queue\n",
-					      target_pid_to_str (t->ptid));
-			}
-		      t->control.trap_expected = 0;
-		      thread_step_over_chain_enqueue (t);
-		    }
-		}
-	      else
-		{
-		  enum gdb_signal sig;
-		  struct regcache *regcache;
-
-		  if (debug_infrun)
-		    {
-		      std::string statstr = target_waitstatus_to_string (&ws);
-
-		      fprintf_unfiltered (gdb_stdlog,
-					  "infrun: target_wait %s, saving "
-					  "status for %d.%ld.%ld\n",
-					  statstr.c_str (),
-					  ptid_get_pid (t->ptid),
-					  ptid_get_lwp (t->ptid),
-					  ptid_get_tid (t->ptid));
-		    }
+	      ptid_t event_ptid;
+	      struct target_waitstatus ws;
 
-		  /* Record for later.  */
-		  save_waitstatus (t, &ws);
-
-		  sig = (ws.kind == TARGET_WAITKIND_STOPPED
-			 ? ws.value.sig : GDB_SIGNAL_0);
-
-		  if (displaced_step_fixup (t->ptid, sig) < 0)
-		    {
-		      /* Add it back to the step-over queue.  */
-		      t->control.trap_expected = 0;
-		      thread_step_over_chain_enqueue (t);
-		    }
-
-		  regcache = get_thread_regcache (t->ptid);
-		  t->suspend.stop_pc = regcache_read_pc (regcache);
-
-		  if (debug_infrun)
-		    {
-		      fprintf_unfiltered (gdb_stdlog,
-					  "infrun: saved stop_pc=%s for %s "
-					  "(currently_stepping=%d)\n",
-					  paddress (target_gdbarch (),
-						    t->suspend.stop_pc),
-					  target_pid_to_str (t->ptid),
-					  currently_stepping (t));
-		    }
-		}
+	      event_ptid = wait_one (&ws);
+	      if (stop_all_threads_handle_event (event_ptid, &ws))
+		break;
 	    }
 	}
     }
@@ -5110,6 +5246,20 @@ Cannot fill $_exitsignal with the correct signal number.\n"));
 	    struct regcache *child_regcache;
 	    CORE_ADDR parent_pc;
 
+	    if (ecs->ws.kind == TARGET_WAITKIND_FORKED)
+	      {
+		struct displaced_step_inferior_state *displaced
+		  = get_displaced_stepping_state (ptid_get_pid (ecs->ptid));
+
+		/* Restore scratch pads for child process.  The child got
+		   a copy of all the buffers in use at the time of the
+		   fork, not just the one of the forking thread.  */
+		for (displaced_step_buffer &buffer : displaced->buffers)
+		  if (!ptid_equal (buffer.step_ptid, null_ptid))
+		    displaced_step_restore (&buffer,
+					    ecs->ws.value.related_pid);
+	      }
+
 	    /* GDB has got TARGET_WAITKIND_FORKED or TARGET_WAITKIND_VFORKED,
 	       indicating that the displaced stepping of syscall instruction
 	       has been done.  Perform cleanup for parent process here.  Note
@@ -5120,15 +5270,6 @@ Cannot fill $_exitsignal with the correct signal number.\n"));
 	       that needs it.  */
 	    start_step_over ();
 
-	    if (ecs->ws.kind == TARGET_WAITKIND_FORKED)
-	      {
-		struct displaced_step_inferior_state *displaced
-		  = get_displaced_stepping_state (ptid_get_pid (ecs->ptid));
-
-		/* Restore scratch pad for child process.  */
-		displaced_step_restore (displaced, ecs->ws.value.related_pid);
-	      }
-
 	    /* Since the vfork/fork syscall instruction was executed in the scratchpad,
 	       the child's PC is also within the scratchpad.  Set the child's PC
 	       to the parent's PC value, which has already been fixed up.
@@ -41,6 +41,7 @@
 #include "gdb_bfd.h"
 #include "readline/tilde.h"
 #include "completer.h"
+#include <unordered_map>
 
 static const char *jit_reader_dir = NULL;
 
@@ -249,18 +250,24 @@ struct jit_program_space_data
   /* The objfile.  This is NULL if no objfile holds the JIT
      symbols.  */
 
-  struct objfile *objfile;
+  struct objfile *objfile = NULL;
 
   /* If this program space has __jit_debug_register_code, this is the
      cached address from the minimal symbol.  This is used to detect
      relocations requiring the breakpoint to be re-created.  */
 
-  CORE_ADDR cached_code_address;
+  CORE_ADDR cached_code_address = 0;
 
   /* This is the JIT event breakpoint, or NULL if it has not been
      set.  */
 
-  struct breakpoint *jit_breakpoint;
+  struct breakpoint *jit_breakpoint = NULL;
+
+  /* The objfiles created for JITed code, indexed by the address of
+     their struct jit_code_entry.  A JIT may register a very large
+     number of entries, so don't search the objfile list for them.  */
+
+  std::unordered_map<CORE_ADDR, struct objfile *> entry_objfiles;
 };
 
 /* Per-objfile structure recording the addresses in the program space.
@@ -300,18 +307,6 @@ get_jit_objfile_data (struct objfile *objf)
   return objf_data;
 }
 
-/* Remember OBJFILE has been created for struct jit_code_entry located
-   at inferior address ENTRY.  */
-
-static void
-add_objfile_entry (struct objfile *objfile, CORE_ADDR entry)
-{
-  struct jit_objfile_data *objf_data;
-
-  objf_data = get_jit_objfile_data (objfile);
-  objf_data->addr = entry;
-}
-
 /* Return jit_program_space_data for current program space.  Allocate
    if not already present.  */
 
@@ -325,7 +320,7 @@ get_jit_program_space_data (void)
        program_space_data (current_program_space, jit_program_space_data));
   if (ps_data == NULL)
     {
-      ps_data = XCNEW (struct jit_program_space_data);
+      ps_data = new struct jit_program_space_data;
       set_program_space_data (current_program_space, jit_program_space_data,
 			      ps_data);
     }
@@ -336,7 +331,23 @@ get_jit_program_space_data (void)
 static void
 jit_program_space_data_cleanup (struct program_space *ps, void *arg)
 {
-  xfree (arg);
+  delete (struct jit_program_space_data *) arg;
+}
+
+/* Remember OBJFILE has been created for struct jit_code_entry located
+   at inferior address ENTRY.  */
+
+static void
+add_objfile_entry (struct objfile *objfile, CORE_ADDR entry)
+{
+  struct jit_objfile_data *objf_data;
+
+  gdb_assert (objfile->pspace == current_program_space);
+
+  objf_data = get_jit_objfile_data (objfile);
+  objf_data->addr = entry;
+
+  get_jit_program_space_data ()->entry_objfiles[entry] = objfile;
 }
 
 /* Helper function for reading the global JIT descriptor from remote
@@ -804,7 +815,7 @@ jit_object_close_impl (struct gdb_symbol_callbacks *cb,
   priv_data = (jit_dbg_reader_data *) cb->priv_data;
 
   objfile = new struct objfile (NULL, "<< JIT compiled code >>",
-				OBJF_NOT_FILENAME);
+				OBJF_NOT_FILENAME | OBJF_JIT);
   objfile->per_bfd->gdbarch = target_gdbarch ();
 
   terminate_minimal_symbol_table (objfile);
@@ -881,9 +892,11 @@ jit_reader_try_read_symtab (struct jit_code_entry *code_entry,
 }
 
 /* Try to read CODE_ENTRY using BFD.  ENTRY_ADDR is the address of the
-   struct jit_code_entry in the inferior address space.  */
+   struct jit_code_entry in the inferior address space.  Return the
+   objfile created, or NULL.  The breakpoints are not re-set; that is
+   left to the caller, see jit_breakpoints_changed.  */
 
-static void
+static struct objfile *
 jit_bfd_try_read_symtab (struct jit_code_entry *code_entry,
                          CORE_ADDR entry_addr,
                          struct gdbarch *gdbarch)
@@ -908,7 +921,7 @@ jit_bfd_try_read_symtab (struct jit_code_entry *code_entry,
   if (nbfd == NULL)
     {
       puts_unfiltered (_("Error opening JITed symbol file, ignoring it.\n"));
-      return;
+      return NULL;
     }
 
   /* Check the format.  NOTE: This initializes important data that GDB uses!
@@ -917,7 +930,7 @@ jit_bfd_try_read_symtab (struct jit_code_entry *code_entry,
     {
       printf_unfiltered (_("\
 JITed symbol file is not an object file, ignoring it.\n"));
-      return;
+      return NULL;
     }
 
   /* Check bfd arch.  */
@@ -948,19 +961,25 @@ JITed symbol file is not an object file, ignoring it.\n"));
 
   /* This call does not take ownership of SAI.  */
   objfile = symbol_file_add_from_bfd (nbfd.get (),
-				      bfd_get_filename (nbfd.get ()), 0, sai,
-				      OBJF_SHARED | OBJF_NOT_FILENAME, NULL);
+				      bfd_get_filename (nbfd.get ()),
+				      SYMFILE_DEFER_BP_RESET, sai,
+				      (OBJF_SHARED | OBJF_NOT_FILENAME
+				       | OBJF_JIT),
+				      NULL);
 
   do_cleanups (old_cleanups);
   add_objfile_entry (objfile, entry_addr);
+  return objfile;
 }
 
 /* This function registers code associated with a JIT code entry.  It uses the
    pointer and size pair in the entry to read the symbol file from the remote
    and then calls symbol_file_add_from_local_memory to add it as though it were
-   a symbol file added by the user.  */
+   a symbol file added by the user.  Return the objfile for which the
+   breakpoints need to be re-set, see jit_breakpoints_changed, or
+   NULL.  */
 
-static void
+static struct objfile *
 jit_register_code (struct gdbarch *gdbarch,
                    CORE_ADDR entry_addr, struct jit_code_entry *code_entry)
 {
@@ -976,7 +995,32 @@ jit_register_code (struct gdbarch *gdbarch,
   success = jit_reader_try_read_symtab (code_entry, entry_addr);
 
   if (!success)
-    jit_bfd_try_read_symtab (code_entry, entry_addr, gdbarch);
+    return jit_bfd_try_read_symtab (code_entry, entry_addr, gdbarch);
+  return NULL;
+}
+
+/* Callback for iterate_over_breakpoints.  */
+
+static int
+jit_user_breakpoint_p (struct breakpoint *b, void *data)
+{
+  return user_breakpoint_p (b);
+}
+
+/* Re-set the breakpoints after the JITed code of OBJFILES has been
+   registered.  Only user breakpoints may have locations in JITed code,
+   so if there are none, there is nothing to do.  Otherwise only the
+   breakpoints that may have locations in OBJFILES are re-set.  This
+   matters because a JIT may register many thousands of functions, and
+   re-setting all the breakpoints for each of them costs time
+   proportional to the number of objfiles already registered.  */
+
+static void
+jit_breakpoints_changed (const std::vector<struct objfile *> &objfiles)
+{
+  if (!objfiles.empty ()
+      && iterate_over_breakpoints (jit_user_breakpoint_p, NULL) != NULL)
+    breakpoint_re_set_objfiles (objfiles);
 }
 
 /* This function unregisters JITed code and frees the corresponding
@@ -988,23 +1032,18 @@ jit_unregister_code (struct objfile *objfile)
   delete objfile;
 }
 
-/* Look up the objfile with this code entry address.  */
+/* Look up the objfile with this code entry address in the program
+   space described by PS_DATA.  */
 
 static struct objfile *
-jit_find_objf_with_entry_addr (CORE_ADDR entry_addr)
+jit_find_objf_with_entry_addr (struct jit_program_space_data *ps_data,
+			       CORE_ADDR entry_addr)
 {
-  struct objfile *objf;
+  auto iter = ps_data->entry_objfiles.find (entry_addr);
 
-  ALL_OBJFILES (objf)
-    {
-      struct jit_objfile_data *objf_data;
-
-      objf_data
-	= (struct jit_objfile_data *) objfile_data (objf, jit_objfile_data);
-      if (objf_data != NULL && objf_data->addr == entry_addr)
-        return objf;
-    }
-  return NULL;
+  if (iter == ps_data->entry_objfiles.end ())
+    return NULL;
+  return iter->second;
 }
 
 /* This is called when a breakpoint is deleted.  It updates the
@@ -1335,6 +1374,7 @@ jit_inferior_init (struct gdbarch *gdbarch)
   struct jit_code_entry cur_entry;
   struct jit_program_space_data *ps_data;
   CORE_ADDR cur_entry_addr;
+  std::vector<struct objfile *> new_objfiles;
 
   if (jit_debug)
     fprintf_unfiltered (gdb_stdlog, "jit_inferior_init\n");
@@ -1360,7 +1400,8 @@ jit_inferior_init (struct gdbarch *gdbarch)
     }
 
   /* If we've attached to a running program, we need to check the descriptor
-     to register any functions that were already generated.  */
+     to register any functions that were already generated.  Re-set the
+     breakpoints once for all of them, rather than once per entry.  */
   for (cur_entry_addr = descriptor.first_entry;
        cur_entry_addr != 0;
        cur_entry_addr = cur_entry.next_entry)
@@ -1369,11 +1410,16 @@ jit_inferior_init (struct gdbarch *gdbarch)
 
       /* This hook may be called many times during setup, so make sure we don't
          add the same symbol file twice.  */
-      if (jit_find_objf_with_entry_addr (cur_entry_addr) != NULL)
+      if (jit_find_objf_with_entry_addr (ps_data, cur_entry_addr) != NULL)
         continue;
 
-      jit_register_code (gdbarch, cur_entry_addr, &cur_entry);
+      struct objfile *objfile
+	= jit_register_code (gdbarch, cur_entry_addr, &cur_entry);
+      if (objfile != NULL)
+	new_objfiles.push_back (objfile);
     }
+
+  jit_breakpoints_changed (new_objfiles);
 }
 
 /* inferior_created observer.  */
@@ -1427,12 +1473,13 @@ jit_event_handler (struct gdbarch *gdbarch)
 {
   struct jit_descriptor descriptor;
   struct jit_code_entry code_entry;
+  struct jit_program_space_data *ps_data;
   CORE_ADDR entry_addr;
   struct objfile *objf;
 
   /* Read the descriptor from remote memory.  */
-  if (!jit_read_descriptor (gdbarch, &descriptor,
-			    get_jit_program_space_data ()))
+  ps_data = get_jit_program_space_data ();
+  if (!jit_read_descriptor (gdbarch, &descriptor, ps_data))
     return;
   entry_addr = descriptor.relevant_entry;
 
@@ -1443,10 +1490,12 @@ jit_event_handler (struct gdbarch *gdbarch)
       break;
     case JIT_REGISTER:
       jit_read_code_entry (gdbarch, entry_addr, &code_entry);
-      jit_register_code (gdbarch, entry_addr, &code_entry);
+      objf = jit_register_code (gdbarch, entry_addr, &code_entry);
+      if (objf != NULL)
+	jit_breakpoints_changed (std::vector<struct objfile *> (1, objf));
       break;
     case JIT_UNREGISTER:
-      objf = jit_find_objf_with_entry_addr (entry_addr);
+      objf = jit_find_objf_with_entry_addr (ps_data, entry_addr);
       if (objf == NULL)
 	printf_unfiltered (_("Unable to find JITed code "
 			     "entry at address: %s\n"),
@@ -1468,6 +1517,23 @@ free_objfile_data (struct objfile *objfile, void *data)
 {
   struct jit_objfile_data *objf_data = (struct jit_objfile_data *) data;
 
+  if (objf_data->addr != 0)
+    {
+      struct jit_program_space_data *ps_data;
+
+      ps_data
+	= ((struct jit_program_space_data *)
+	   program_space_data (objfile->pspace, jit_program_space_data));
+      if (ps_data != NULL)
+	{
+	  auto iter = ps_data->entry_objfiles.find (objf_data->addr);
+
+	  if (iter != ps_data->entry_objfiles.end ()
+	      && iter->second == objfile)
+	    ps_data->entry_objfiles.erase (iter);
+	}
+    }
+
   if (objf_data->register_code != NULL)
     {
       struct jit_program_space_data *ps_data;
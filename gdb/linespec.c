@@ -1103,6 +1103,51 @@ maybe_add_address (htab_t set, struct program_space *pspace, CORE_ADDR addr)
   return 1;
 }
 
+/* A helper that walks over the compunits of OBJFILE that were
+   already expanded, and calls CALLBACK for each symbol matching
+   LOOKUP_NAME.  LANGUAGE is used to iterate over the symbols of
+   local blocks.  If INCLUDE_INLINE is true then symbols representing
+   inlined instances of functions will be included in the result.  */
+
+static void
+iterate_over_objfile_compunits
+  (const struct language_defn *language, struct objfile *objfile,
+   const lookup_name_info &lookup_name,
+   const domain_enum name_domain, bool include_inline,
+   gdb::function_view<symbol_found_callback_ftype> callback)
+{
+  struct compunit_symtab *cu;
+
+  ALL_OBJFILE_COMPUNITS (objfile, cu)
+    {
+      struct symtab *symtab = COMPUNIT_FILETABS (cu);
+
+      iterate_over_file_blocks (symtab, lookup_name, name_domain, callback);
+
+      if (include_inline)
+	{
+	  struct block *block;
+	  int i;
+
+	  for (i = FIRST_LOCAL_BLOCK;
+	       i < BLOCKVECTOR_NBLOCKS (SYMTAB_BLOCKVECTOR (symtab));
+	       i++)
+	    {
+	      block = BLOCKVECTOR_BLOCK (SYMTAB_BLOCKVECTOR (symtab), i);
+	      language->la_iterate_over_symbols
+		(block, lookup_name, name_domain, [&] (symbol *sym)
+		 {
+		   /* Restrict calls to CALLBACK to symbols
+		      representing inline symbols only.  */
+		   if (SYMBOL_INLINED (sym))
+		     return callback (sym);
+		   return true;
+		 });
+	    }
+	}
+    }
+}
+
 /* A helper that walks over all matching symtabs in all objfiles and
    calls CALLBACK for each symbol matching NAME.  If SEARCH_PSPACE is
    not NULL, then the search is restricted to just that program
@@ -1132,8 +1177,6 @@ iterate_over_all_matching_symtabs
 
     ALL_OBJFILES (objfile)
     {
-      struct compunit_symtab *cu;
-
       if (objfile->sf)
 	objfile->sf->qf->expand_symtabs_matching (objfile,
 						  NULL,
@@ -1141,34 +1184,9 @@ iterate_over_all_matching_symtabs
 						  NULL, NULL,
 						  search_domain);
 
-      ALL_OBJFILE_COMPUNITS (objfile, cu)
-	{
-	  struct symtab *symtab = COMPUNIT_FILETABS (cu);
-
-	  iterate_over_file_blocks (symtab, lookup_name, name_domain, callback);
-
-	  if (include_inline)
-	    {
-	      struct block *block;
-	      int i;
-
-	      for (i = FIRST_LOCAL_BLOCK;
-		   i < BLOCKVECTOR_NBLOCKS (SYMTAB_BLOCKVECTOR (symtab));
-		   i++)
-		{
-		  block = BLOCKVECTOR_BLOCK (SYMTAB_BLOCKVECTOR (symtab), i);
-		  state->language->la_iterate_over_symbols
-		    (block, lookup_name, name_domain, [&] (symbol *sym)
-		     {
-		       /* Restrict calls to CALLBACK to symbols
-			  representing inline symbols only.  */
-		       if (SYMBOL_INLINED (sym))
-			 return callback (sym);
-		       return true;
-		     });
-		}
-	    }
-	}
+      iterate_over_objfile_compunits (state->language, objfile,
+				      lookup_name, name_domain,
+				      include_inline, callback);
     }
   }
 }
@@ -4643,6 +4661,158 @@ symbol_to_sal (struct symtab_and_line *result,
   return 0;
 }
 
+/* Return true if NAME is a plain, possibly scope-qualified,
+   identifier.  */
+
+static bool
+linespec_simple_name_p (const char *name)
+{
+  if (*name == '\0')
+    return false;
+
+  for (const char *p = name; *p != '\0'; p++)
+    {
+      if (p[0] == ':' && p[1] == ':')
+	p++;
+      else if (!isalnum (*p) && *p != '_' && *p != '$')
+	return false;
+    }
+
+  return true;
+}
+
+/* Collect in NAMES the names of the functions the linespec SPEC may
+   refer to.  Return false if SPEC is anything but FUNCTION,
+   FILE:FUNCTION or FUNCTION:LABEL, or if its function part is not a
+   plain identifier.  */
+
+static bool
+linespec_function_names (const char *spec, std::vector<std::string> *names)
+{
+  std::vector<std::string> parts;
+  const char *start = spec;
+  const char *p;
+
+  /* Split SPEC at each single colon, leaving scope operators
+     alone.  */
+  for (p = spec; ; p++)
+    {
+      if (p[0] == ':' && p[1] == ':')
+	p++;
+      else if (p[0] == ':' || p[0] == '\0')
+	{
+	  parts.emplace_back (start, p - start);
+	  if (p[0] == '\0')
+	    break;
+	  start = p + 1;
+	}
+    }
+
+  if (parts.size () > 2)
+    return false;
+
+  for (size_t i = 0; i < parts.size (); i++)
+    {
+      if (linespec_simple_name_p (parts[i].c_str ()))
+	{
+	  /* A line number.  */
+	  if (isdigit (parts[i][0]))
+	    return false;
+	  names->push_back (parts[i]);
+	}
+      else if (i > 0 || parts.size () == 1)
+	return false;
+      /* Otherwise, the first of two parts is a file name.  */
+    }
+
+  return !names->empty ();
+}
+
+/* See linespec.h.  */
+
+bool
+linespec_location_may_match_objfile (const struct event_location *location,
+				     struct objfile *objfile)
+{
+  std::vector<std::string> names;
+  symbol_name_match_type match_type;
+
+  switch (event_location_type (location))
+    {
+    case LINESPEC_LOCATION:
+      {
+	const linespec_location *ls = get_linespec_location (location);
+
+	if (ls->spec_string == NULL
+	    || !linespec_function_names (ls->spec_string, &names))
+	  return true;
+	match_type = ls->match_type;
+      }
+      break;
+
+    case EXPLICIT_LOCATION:
+      {
+	const explicit_location *explicit_loc
+	  = get_explicit_location_const (location);
+
+	if (explicit_loc->function_name == NULL
+	    || !linespec_simple_name_p (explicit_loc->function_name))
+	  return true;
+	names.push_back (explicit_loc->function_name);
+	match_type = explicit_loc->func_name_match_type;
+      }
+      break;
+
+    default:
+      return true;
+    }
+
+  for (const std::string &name : names)
+    {
+      lookup_name_info lookup_name (name, match_type);
+      bool found = false;
+
+      for (struct objfile *iter = objfile;
+	   iter != NULL && !found;
+	   iter = objfile_separate_debug_iterate (objfile, iter))
+	{
+	  iterate_over_minimal_symbols (iter, lookup_name,
+					[] (minimal_symbol *, void *data)
+					{
+					  *(bool *) data = true;
+					},
+					&found);
+
+	  /* Look in the symbols that weren't read in yet, without
+	     reading them in: that is left to the actual decoding of
+	     the location, should it be needed.  */
+	  if (!found && iter->sf != NULL)
+	    iter->sf->qf->expand_symtabs_matching
+	      (iter, NULL, lookup_name,
+	       [&] (const char *)
+	       {
+		 found = true;
+		 return false;
+	       },
+	       NULL, ALL_DOMAIN);
+
+	  if (!found)
+	    iterate_over_objfile_compunits (current_language, iter,
+					    lookup_name, VAR_DOMAIN, true,
+					    [&] (symbol *)
+					    {
+					      found = true;
+					      return false;
+					    });
+	}
+
+      if (found)
+	return true;
+    }
+
+  return false;
+}
+
 linespec_result::~linespec_result ()
 {
   for (linespec_sals &lsal : lsals)
@@ -18,6 +18,7 @@
 #define LINESPEC_H 1
 
 struct symtab;
+struct objfile;
 
 #include "location.h"
 #include "vec.h"
@@ -132,6 +133,15 @@ extern void decode_line_full (const struct event_location *location, int flags,
 			      const char *select_mode,
 			      const char *filter);
 
+/* Return true if decoding LOCATION may find locations in OBJFILE or
+   in its separate debug objfiles.  This errs on the side of returning
+   true: only locations naming a function are looked into, by looking
+   the function name up in OBJFILE's symbols, without reading in
+   symbol tables.  */
+
+extern bool linespec_location_may_match_objfile
+  (const struct event_location *location, struct objfile *objfile);
+
 /* Given a string, return the line specified by it, using the current
    source symtab and line as defaults.
    This is for commands like "list" and "breakpoint".  */
@@ -66,6 +66,7 @@
 #include "objfiles.h"
 #include "nat/linux-namespaces.h"
 #include "fileio.h"
+#include <unordered_set>
 
 #ifndef SPUFS_MAGIC
 #define SPUFS_MAGIC 0x23c9b64e
@@ -830,7 +831,8 @@ linux_nat_pass_signals (struct target_ops *self,
 
 
 /* Prototypes for local functions.  */
-static int stop_wait_callback (struct lwp_info *lp, void *data);
+static void stop_wait_lwps (ptid_t filter);
+static struct lwp_info *linux_nat_filter_event (int lwpid, int status);
 static char *linux_child_pid_to_exec_file (struct target_ops *self, int pid);
 static int resume_stopped_resumed_lwps (struct lwp_info *lp, void *data);
 static int check_ptrace_stopped_lwp_gone (struct lwp_info *lp);
@@ -993,6 +995,18 @@ iterate_over_lwps (ptid_t filter,
 {
   struct lwp_info *lp, *lpnext;
 
+  /* A filter naming a single LWP can only match that LWP, look it up
+     in the hash table rather than walking the list.  */
+  if (ptid_lwp_p (filter))
+    {
+      lp = find_lwp_pid (filter);
+      if (lp != NULL
+	  && ptid_match (lp->ptid, filter)
+	  && (*callback) (lp, data) != 0)
+	return lp;
+      return NULL;
+    }
+
   for (lp = lwp_list; lp; lp = lpnext)
     {
       lpnext = lp->next;
@@ -1323,7 +1337,7 @@ get_detach_signal (struct lwp_info *lp)
   enum gdb_signal signo = GDB_SIGNAL_0;
 
   /* If we paused threads momentarily, we may have stored pending
-     events in lp->status or lp->waitstatus (see stop_wait_callback),
+     events in lp->status or lp->waitstatus (see stop_wait_lwp),
      and GDB core hasn't seen any signal for those threads.
      Otherwise, the last signal reported to the core is found in the
      thread object's stop_signal.
@@ -1522,7 +1536,7 @@ linux_nat_detach (struct target_ops *ops, const char *args, int from_tty)
   iterate_over_lwps (pid_to_ptid (pid), stop_callback, NULL);
   /* ... and wait until all of them have reported back that
      they're no longer running.  */
-  iterate_over_lwps (pid_to_ptid (pid), stop_wait_callback, NULL);
+  stop_wait_lwps (pid_to_ptid (pid));
 
   iterate_over_lwps (pid_to_ptid (pid), detach_callback, NULL);
 
@@ -1869,7 +1883,7 @@ linux_handle_syscall_trap (struct lwp_info *lp, int stopping)
       /* If we're stopping threads, there's a SIGSTOP pending, which
 	 makes it so that the LWP reports an immediate syscall return,
 	 followed by the SIGSTOP.  Skip seeing that "return" using
-	 PTRACE_CONT directly, and let stop_wait_callback collect the
+	 PTRACE_CONT directly, and let stop_wait_lwp collect the
 	 SIGSTOP.  Later when the thread is resumed, a new syscall
 	 entry event.  If we didn't do this (and returned 0), we'd
 	 leave a syscall entry pending, and our caller, by using
@@ -1877,7 +1891,7 @@ linux_handle_syscall_trap (struct lwp_info *lp, int stopping)
 	 itself.  Later, when the user re-resumes this LWP, we'd see
 	 another syscall entry event and we'd mistake it for a return.
 
-	 If stop_wait_callback didn't force the SIGSTOP out of the LWP
+	 If stop_wait_lwp didn't force the SIGSTOP out of the LWP
 	 (leaving immediately with LWP->signalled set, without issuing
 	 a PTRACE_CONT), it would still be problematic to leave this
 	 syscall enter pending, as later when the thread is resumed,
@@ -2171,114 +2185,49 @@ linux_handle_extended_wait (struct lwp_info *lp, int status)
 		  _("unknown ptrace event %d"), event);
 }
 
-/* Wait for LP to stop.  Returns the wait status, or 0 if the LWP has
-   exited.  */
+/* Handle STATUS, which waitpid returned for LP while LP was being
+   stopped.  Returns the wait status, 0 if the LWP has exited or has
+   nothing else to report, or -1 if LP was resumed and still has to
+   be waited for.  */
 
 static int
-wait_lwp (struct lwp_info *lp)
+stopping_lwp_status (struct lwp_info *lp, int status)
 {
-  pid_t pid;
-  int status = 0;
   int thread_dead = 0;
-  sigset_t prev_mask;
 
   gdb_assert (!lp->stopped);
   gdb_assert (lp->status == 0);
 
-  /* Make sure SIGCHLD is blocked for sigsuspend avoiding a race below.  */
-  block_child_signals (&prev_mask);
-
-  for (;;)
+  if (debug_linux_nat)
     {
-      pid = my_waitpid (ptid_get_lwp (lp->ptid), &status, __WALL | WNOHANG);
-      if (pid == -1 && errno == ECHILD)
-	{
-	  /* The thread has previously exited.  We need to delete it
-	     now because if this was a non-leader thread execing, we
-	     won't get an exit event.  See comments on exec events at
-	     the top of the file.  */
-	  thread_dead = 1;
-	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog, "WL: %s vanished.\n",
-				target_pid_to_str (lp->ptid));
-	}
-      if (pid != 0)
-	break;
-
-      /* Bugs 10970, 12702.
-	 Thread group leader may have exited in which case we'll lock up in
-	 waitpid if there are other threads, even if they are all zombies too.
-	 Basically, we're not supposed to use waitpid this way.
-	  tkill(pid,0) cannot be used here as it gets ESRCH for both
-	 for zombie and running processes.
-
-	 As a workaround, check if we're waiting for the thread group leader and
-	 if it's a zombie, and avoid calling waitpid if it is.
-
-	 This is racy, what if the tgl becomes a zombie right after we check?
-	 Therefore always use WNOHANG with sigsuspend - it is equivalent to
-	 waiting waitpid but linux_proc_pid_is_zombie is safe this way.  */
-
-      if (ptid_get_pid (lp->ptid) == ptid_get_lwp (lp->ptid)
-	  && linux_proc_pid_is_zombie (ptid_get_lwp (lp->ptid)))
-	{
-	  thread_dead = 1;
-	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog,
-				"WL: Thread group leader %s vanished.\n",
-				target_pid_to_str (lp->ptid));
-	  break;
-	}
-
-      /* Wait for next SIGCHLD and try again.  This may let SIGCHLD handlers
-	 get invoked despite our caller had them intentionally blocked by
-	 block_child_signals.  This is sensitive only to the loop of
-	 linux_nat_wait_1 and there if we get called my_waitpid gets called
-	 again before it gets to sigsuspend so we can safely let the handlers
-	 get executed here.  */
-
-      if (debug_linux_nat)
-	fprintf_unfiltered (gdb_stdlog, "WL: about to sigsuspend\n");
-      sigsuspend (&suspend_mask);
+      fprintf_unfiltered (gdb_stdlog,
+			  "WL: waitpid %s received %s\n",
+			  target_pid_to_str (lp->ptid),
+			  status_to_str (status));
     }
 
-  restore_child_signals_mask (&prev_mask);
-
-  if (!thread_dead)
+  /* Check if the thread has exited.  */
+  if (WIFEXITED (status) || WIFSIGNALED (status))
     {
-      gdb_assert (pid == ptid_get_lwp (lp->ptid));
-
-      if (debug_linux_nat)
+      if (report_thread_events
+	  || ptid_get_pid (lp->ptid) == ptid_get_lwp (lp->ptid))
 	{
-	  fprintf_unfiltered (gdb_stdlog,
-			      "WL: waitpid %s received %s\n",
-			      target_pid_to_str (lp->ptid),
-			      status_to_str (status));
-	}
-
-      /* Check if the thread has exited.  */
-      if (WIFEXITED (status) || WIFSIGNALED (status))
-	{
-	  if (report_thread_events
-	      || ptid_get_pid (lp->ptid) == ptid_get_lwp (lp->ptid))
-	    {
-	      if (debug_linux_nat)
-		fprintf_unfiltered (gdb_stdlog, "WL: LWP %d exited.\n",
-				    ptid_get_pid (lp->ptid));
-
-	      /* If this is the leader exiting, it means the whole
-		 process is gone.  Store the status to report to the
-		 core.  Store it in lp->waitstatus, because lp->status
-		 would be ambiguous (W_EXITCODE(0,0) == 0).  */
-	      store_waitstatus (&lp->waitstatus, status);
-	      return 0;
-	    }
-
-	  thread_dead = 1;
 	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog, "WL: %s exited.\n",
-				target_pid_to_str (lp->ptid));
+	    fprintf_unfiltered (gdb_stdlog, "WL: LWP %d exited.\n",
+				ptid_get_pid (lp->ptid));
+
+	  /* If this is the leader exiting, it means the whole
+	     process is gone.  Store the status to report to the
+	     core.  Store it in lp->waitstatus, because lp->status
+	     would be ambiguous (W_EXITCODE(0,0) == 0).  */
+	  store_waitstatus (&lp->waitstatus, status);
+	  return 0;
 	}
+
+      thread_dead = 1;
+      if (debug_linux_nat)
+	fprintf_unfiltered (gdb_stdlog, "WL: %s exited.\n",
+			    target_pid_to_str (lp->ptid));
     }
 
   if (thread_dead)
@@ -2308,7 +2257,7 @@ wait_lwp (struct lwp_info *lp)
 	 on.  */
       status = W_STOPCODE (SIGTRAP);
       if (linux_handle_syscall_trap (lp, 1))
-	return wait_lwp (lp);
+	return -1;
     }
   else
     {
@@ -2382,7 +2331,7 @@ linux_stop_and_wait_all_lwps (void)
 
   /* ... and wait until all of them have reported back that
      they're no longer running.  */
-  iterate_over_lwps (minus_one_ptid, stop_wait_callback, NULL);
+  stop_wait_lwps (minus_one_ptid);
 }
 
 /* See linux-nat.h  */
@@ -2530,78 +2479,224 @@ linux_nat_set_status_is_event (struct target_ops *t,
   linux_nat_status_is_event = status_is_event;
 }
 
-/* Wait until LP is stopped.  */
+/* Handle STATUS, which waitpid returned for LP while LP was being
+   stopped.  Return non-zero if LP still has to be waited for.  */
 
 static int
-stop_wait_callback (struct lwp_info *lp, void *data)
+stop_wait_lwp (struct lwp_info *lp, int status)
 {
-  struct inferior *inf = find_inferior_ptid (lp->ptid);
-
-  /* If this is a vfork parent, bail out, it is not going to report
-     any SIGSTOP until the vfork is done with.  */
-  if (inf->vfork_child != NULL)
+  status = stopping_lwp_status (lp, status);
+  if (status == -1)
+    return 1;
+  if (status == 0)
     return 0;
 
-  if (!lp->stopped)
+  if (lp->ignore_sigint && WIFSTOPPED (status)
+      && WSTOPSIG (status) == SIGINT)
     {
-      int status;
+      lp->ignore_sigint = 0;
 
-      status = wait_lwp (lp);
-      if (status == 0)
-	return 0;
+      errno = 0;
+      ptrace (PTRACE_CONT, ptid_get_lwp (lp->ptid), 0, 0);
+      lp->stopped = 0;
+      if (debug_linux_nat)
+	fprintf_unfiltered (gdb_stdlog,
+			    "PTRACE_CONT %s, 0, 0 (%s) "
+			    "(discarding SIGINT)\n",
+			    target_pid_to_str (lp->ptid),
+			    errno ? safe_strerror (errno) : "OK");
 
-      if (lp->ignore_sigint && WIFSTOPPED (status)
-	  && WSTOPSIG (status) == SIGINT)
-	{
-	  lp->ignore_sigint = 0;
+      return 1;
+    }
 
-	  errno = 0;
-	  ptrace (PTRACE_CONT, ptid_get_lwp (lp->ptid), 0, 0);
-	  lp->stopped = 0;
-	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog,
-				"PTRACE_CONT %s, 0, 0 (%s) "
-				"(discarding SIGINT)\n",
-				target_pid_to_str (lp->ptid),
-				errno ? safe_strerror (errno) : "OK");
+  maybe_clear_ignore_sigint (lp);
 
-	  return stop_wait_callback (lp, NULL);
-	}
+  if (WSTOPSIG (status) != SIGSTOP)
+    {
+      /* The thread was stopped with a signal other than SIGSTOP.  */
+
+      if (debug_linux_nat)
+	fprintf_unfiltered (gdb_stdlog,
+			    "SWC: Pending event %s in %s\n",
+			    status_to_str ((int) status),
+			    target_pid_to_str (lp->ptid));
+
+      /* Save the sigtrap event.  */
+      lp->status = status;
+      gdb_assert (lp->signalled);
+      save_stop_reason (lp);
+    }
+  else
+    {
+      /* We caught the SIGSTOP that we intended to catch, so there's
+	 no SIGSTOP pending.  */
+
+      if (debug_linux_nat)
+	fprintf_unfiltered (gdb_stdlog,
+			    "SWC: Expected SIGSTOP caught for %s.\n",
+			    target_pid_to_str (lp->ptid));
 
-      maybe_clear_ignore_sigint (lp);
+      /* Reset SIGNALLED only after the stopping_lwp_status call
+	 above as it does gdb_assert on SIGNALLED.  */
+      lp->signalled = 0;
+    }
+
+  return 0;
+}
+
+/* Stop waiting for the LWP LWPID, which is in WAITING, and delete
+   it, as it is gone without reporting an exit.  */
+
+static void
+stop_wait_lwp_vanished (std::unordered_set<long> *waiting, long lwpid)
+{
+  struct lwp_info *lp = find_lwp_pid (pid_to_ptid (lwpid));
+
+  if (debug_linux_nat)
+    fprintf_unfiltered (gdb_stdlog, "SWL: LWP %ld vanished.\n", lwpid);
 
-      if (WSTOPSIG (status) != SIGSTOP)
+  waiting->erase (lwpid);
+  if (lp != NULL)
+    exit_lwp (lp);
+}
+
+/* Wait until all the LWPs matching FILTER are stopped.  All the
+   events are pulled out of the kernel with a single waitpid (-1)
+   loop, in whatever order the LWPs report them, rather than by
+   waiting for each LWP in turn, which with thousands of LWPs would
+   mean a waitpid call per LWP still running, for each event.  Events
+   of the other LWPs, and of new LWPs, are filtered and left pending
+   for linux_nat_wait, like it would have done itself.  */
+
+static void
+stop_wait_lwps (ptid_t filter)
+{
+  std::unordered_set<long> waiting;
+  std::vector<long> leaders;
+  struct lwp_info *lp;
+  sigset_t prev_mask;
+
+  ALL_LWPS (lp)
+    {
+      struct inferior *inf;
+
+      if (lp->stopped || !ptid_match (lp->ptid, filter))
+	continue;
+
+      /* If this is a vfork parent, don't wait for it, it is not going
+	 to report any SIGSTOP until the vfork is done with.  */
+      inf = find_inferior_ptid (lp->ptid);
+      if (inf->vfork_child != NULL)
+	continue;
+
+      waiting.insert (ptid_get_lwp (lp->ptid));
+      if (ptid_get_lwp (lp->ptid) == ptid_get_pid (lp->ptid))
+	leaders.push_back (ptid_get_lwp (lp->ptid));
+    }
+
+  /* Keep SIGCHLD blocked until sigsuspend, so that we don't miss the
+     one of an LWP stopping after the last waitpid call.  */
+  block_child_signals (&prev_mask);
+
+  while (!waiting.empty ())
+    {
+      pid_t lwpid;
+      int status;
+
+      /* Always use -1, for the reasons given in linux_nat_wait_1.  */
+      errno = 0;
+      lwpid = my_waitpid (-1, &status, __WALL | WNOHANG);
+
+      if (lwpid > 0)
 	{
-	  /* The thread was stopped with a signal other than SIGSTOP.  */
+	  if (waiting.count (lwpid) != 0
+	      && (lp = find_lwp_pid (pid_to_ptid (lwpid))) != NULL)
+	    {
+	      if (!stop_wait_lwp (lp, status))
+		waiting.erase (lwpid);
+	    }
+	  else
+	    {
+	      waiting.erase (lwpid);
 
-	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog,
-				"SWC: Pending event %s in %s\n",
-				status_to_str ((int) status),
-				target_pid_to_str (lp->ptid));
+	      if (debug_linux_nat)
+		fprintf_unfiltered (gdb_stdlog,
+				    "SWL: waitpid %ld received %s\n",
+				    (long) lwpid, status_to_str (status));
+
+	      linux_nat_filter_event (lwpid, status);
+	    }
+
+	  /* When a thread other than the leader execs, it vanishes
+	     without reporting an exit, and the exec is reported by the
+	     leader once all the other threads are reaped.  See
+	     comments on exec events at the top of the file.  Whatever
+	     else of this process we're still waiting for is that
+	     thread.  */
+	  if (WIFSTOPPED (status) && WSTOPSIG (status) == SIGTRAP
+	      && linux_ptrace_get_extended_event (status) == PTRACE_EVENT_EXEC)
+	    {
+	      std::vector<long> gone;
 
-	  /* Save the sigtrap event.  */
-	  lp->status = status;
-	  gdb_assert (lp->signalled);
-	  save_stop_reason (lp);
+	      for (long other : waiting)
+		{
+		  lp = find_lwp_pid (pid_to_ptid (other));
+		  if (lp == NULL || ptid_get_pid (lp->ptid) == lwpid)
+		    gone.push_back (other);
+		}
+	      for (long other : gone)
+		stop_wait_lwp_vanished (&waiting, other);
+	    }
+
+	  /* Retry until nothing comes out of waitpid.  A single
+	     SIGCHLD can indicate more than one child stopped.  */
+	  continue;
 	}
-      else
-	{
-	  /* We caught the SIGSTOP that we intended to catch, so
-	     there's no SIGSTOP pending.  */
 
-	  if (debug_linux_nat)
-	    fprintf_unfiltered (gdb_stdlog,
-				"SWC: Expected SIGSTOP caught for %s.\n",
-				target_pid_to_str (lp->ptid));
+      if (lwpid == -1 && errno == ECHILD)
+	{
+	  /* There are no children left at all, so the LWPs have all
+	     exited.  */
+	  std::vector<long> gone (waiting.begin (), waiting.end ());
 
-	  /* Reset SIGNALLED only after the stop_wait_callback call
-	     above as it does gdb_assert on SIGNALLED.  */
-	  lp->signalled = 0;
+	  for (long other : gone)
+	    stop_wait_lwp_vanished (&waiting, other);
+	  break;
 	}
+
+      /* Bugs 10970, 12702.
+	 A thread group leader may have exited, in which case we'll
+	 never see it stop with waitpid if there are other threads,
+	 even if they are all zombies too.  tkill(pid,0) cannot be used
+	 here as it gets ESRCH for both for zombie and running
+	 processes.
+
+	 As a workaround, check if we're waiting for a thread group
+	 leader and if it's a zombie, and stop waiting for it if it
+	 is.  */
+      for (long leader : leaders)
+	if (waiting.count (leader) != 0
+	    && linux_proc_pid_is_zombie (leader))
+	  stop_wait_lwp_vanished (&waiting, leader);
+
+      if (waiting.empty ())
+	break;
+
+      /* Nothing came out of waitpid; wait for the next SIGCHLD.  This
+	 may let SIGCHLD handlers get invoked despite our caller had
+	 them intentionally blocked by block_child_signals.  This is
+	 sensitive only to the loop of linux_nat_wait_1 and there if we
+	 get called my_waitpid gets called again before it gets to
+	 sigsuspend so we can safely let the handlers get executed
+	 here.  */
+      if (debug_linux_nat)
+	fprintf_unfiltered (gdb_stdlog,
+			    "SWL: %d LWPs still running, about to "
+			    "sigsuspend\n", (int) waiting.size ());
+      sigsuspend (&suspend_mask);
     }
 
-  return 0;
+  restore_child_signals_mask (&prev_mask);
 }
 
 /* Return non-zero if LP has a wait status pending.  Discard the
@@ -3440,7 +3535,7 @@ linux_nat_wait_1 (struct target_ops *ops,
 
       /* ... and wait until all of them have reported back that
 	 they're no longer running.  */
-      iterate_over_lwps (minus_one_ptid, stop_wait_callback, NULL);
+      stop_wait_lwps (minus_one_ptid);
     }
 
   /* If we're not waiting for a specific LWP, choose an event LWP from
@@ -3778,7 +3873,7 @@ linux_nat_kill (struct target_ops *ops)
       iterate_over_lwps (ptid, stop_callback, NULL);
       /* ... and wait until all of them have reported back that
 	 they're no longer running.  */
-      iterate_over_lwps (ptid, stop_wait_callback, NULL);
+      stop_wait_lwps (ptid);
 
       /* Kill all LWP's ...  */
       iterate_over_lwps (ptid, kill_callback, NULL);
@@ -3924,23 +4019,10 @@ linux_nat_thread_alive (struct target_ops *ops, ptid_t ptid)
 static void
 linux_nat_update_thread_list (struct target_ops *ops)
 {
-  struct lwp_info *lwp;
-
   /* We add/delete threads from the list as clone/exit events are
      processed, so just try deleting exited threads still in the
      thread list.  */
   delete_exited_threads ();
-
-  /* Update the processor core that each lwp/thread was last seen
-     running on.  */
-  ALL_LWPS (lwp)
-    {
-      /* Avoid accessing /proc if the thread hasn't run since we last
-	 time we fetched the thread's core.  Accessing /proc becomes
-	 noticeably expensive when we have thousands of LWPs.  */
-      if (lwp->core == -1)
-	lwp->core = linux_common_core_of_thread (lwp->ptid);
-    }
 }
 
 static const char *
@@ -4688,9 +4770,17 @@ linux_nat_core_of_thread (struct target_ops *ops, ptid_t ptid)
 {
   struct lwp_info *info = find_lwp_pid (ptid);
 
-  if (info)
-    return info->core;
-  return -1;
+  if (info == NULL)
+    return -1;
+
+  /* Look up the processor core that the thread was last seen running
+     on only when asked, and not whenever the thread list is updated,
+     as accessing /proc for thousands of LWPs is expensive.  Avoid
+     accessing /proc if the thread hasn't run since we last fetched
+     the thread's core.  */
+  if (info->core == -1)
+    info->core = linux_common_core_of_thread (info->ptid);
+  return info->core;
 }
 
 /* Implementation of to_filesystem_is_local.  */
@@ -39,6 +39,7 @@
 #include "top.h"
 #include "maint.h"
 #include "selftest.h"
+#include "thread-pool.h"
 
 #include "cli/cli-decode.h"
 #include "cli/cli-utils.h"
@@ -952,6 +953,55 @@ maintenance_info_selftests (const char *arg, int from_tty)
 }
 
 
+/* The number of worker threads to use, as set by "maint set
+   worker-threads".  -1 means use one thread per available
+   processor.  */
+
+static int n_worker_threads = -1;
+
+/* Update the thread pool to reflect the "maint set worker-threads"
+   setting.  */
+
+static void
+update_thread_pool_size ()
+{
+#if CXX_STD_THREAD
+  int n_threads = n_worker_threads;
+
+  if (n_threads < 0)
+    n_threads = std::thread::hardware_concurrency ();
+
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+#endif
+}
+
+static void
+maintenance_set_worker_threads (const char *args, int from_tty,
+				struct cmd_list_element *c)
+{
+  update_thread_pool_size ();
+}
+
+static void
+maintenance_show_worker_threads (struct ui_file *file, int from_tty,
+				 struct cmd_list_element *c,
+				 const char *value)
+{
+#if CXX_STD_THREAD
+  if (n_worker_threads == -1)
+    fprintf_filtered (file, _("The number of worker threads GDB "
+			      "can use is unlimited (currently %s).\n"),
+		      pulongest (gdb::thread_pool::g_thread_pool
+				 ->thread_count ()));
+  else
+    fprintf_filtered (file, _("The number of worker threads GDB "
+			      "can use is %s.\n"), value);
+#else
+  fprintf_filtered (file, _("GDB was built without support for "
+			    "worker threads.\n"));
+#endif
+}
+
 void
 _initialize_maint_cmds (void)
 {
@@ -1158,4 +1208,23 @@ When enabled GDB is profiled."),
 			   show_maintenance_profile_p,
 			   &maintenance_set_cmdlist,
 			   &maintenance_show_cmdlist);
+
+  add_setshow_zuinteger_unlimited_cmd ("worker-threads",
+				       class_maintenance,
+				       &n_worker_threads, _("\
+Set the number of worker threads GDB can use."), _("\
+Show the number of worker threads GDB can use."), _("\
+GDB may use multiple threads to speed up certain CPU-intensive operations:\n\
+reading the DWARF debug info that partial symbol tables are built from, and\n\
+demangling and hashing minimal symbols.  The threads are only started when\n\
+one of these operations first runs.  \"unlimited\" means to use one thread\n\
+per available processor; 0 disables the worker threads."),
+				       maintenance_set_worker_threads,
+				       maintenance_show_worker_threads,
+				       &maintenance_set_cmdlist,
+				       &maintenance_show_cmdlist);
+
+  /* This only records the size; no thread is started until the pool
+     is first given work.  */
+  update_thread_pool_size ();
 }
@@ -52,7 +52,11 @@
 #include "cli/cli-utils.h"
 #include "symbol.h"
 #include <algorithm>
+#include <map>
 #include "safe-ctype.h"
+#include "observer.h"
+#include "progspace.h"
+#include "common/parallel-for.h"
 
 /* See minsyms.h.  */
 
@@ -132,31 +136,30 @@ msymbol_hash (const char *string)
   return hash;
 }
 
-/* Add the minimal symbol SYM to an objfile's minsym hash table, TABLE.  */
+/* Add the minimal symbol SYM, whose linkage name hashes to HASH, to
+   an objfile's minsym hash table, TABLE.  */
 static void
-add_minsym_to_hash_table (struct minimal_symbol *sym,
+add_minsym_to_hash_table (struct minimal_symbol *sym, unsigned int hash,
 			  struct minimal_symbol **table)
 {
   if (sym->hash_next == NULL)
     {
-      unsigned int hash
-	= msymbol_hash (MSYMBOL_LINKAGE_NAME (sym)) % MINIMAL_SYMBOL_HASH_SIZE;
+      hash %= MINIMAL_SYMBOL_HASH_SIZE;
 
       sym->hash_next = table[hash];
       table[hash] = sym;
     }
 }
 
-/* Add the minimal symbol SYM to an objfile's minsym demangled hash table,
-   TABLE.  */
+/* Add the minimal symbol SYM, whose search name hashes to HASH, to
+   an objfile's minsym demangled hash table, TABLE.  */
 static void
 add_minsym_to_demangled_hash_table (struct minimal_symbol *sym,
+				    unsigned int hash,
 				    struct objfile *objfile)
 {
   if (sym->demangled_hash_next == NULL)
     {
-      unsigned int hash = search_name_hash (MSYMBOL_LANGUAGE (sym),
-					    MSYMBOL_SEARCH_NAME (sym));
 
       auto &vec = objfile->per_bfd->demangled_hash_languages;
       auto it = std::lower_bound (vec.begin (), vec.end (),
@@ -614,19 +617,56 @@ lookup_minimal_symbol_solib_trampoline (const char *name,
   return found_symbol;
 }
 
+/* The range of addresses around the PC being looked up for which a
+   minimal symbol lookup is known to give the same result.  It starts
+   as the whole address space and is narrowed by every comparison of
+   the PC against another address made during the lookup.  */
+
+struct pc_lookup_range
+{
+  /* The lowest address of the range.  */
+  CORE_ADDR low;
+
+  /* One past the highest address of the range.  */
+  CORE_ADDR high;
+};
+
+/* Return non-zero if PC is greater than or equal to ADDR.  PC and
+   ADDR are offset by BIAS from the addresses in RANGE; if RANGE is
+   not NULL, narrow it so that the result of the comparison is the
+   same for every address in it.  */
+
+static int
+pc_at_or_above (CORE_ADDR pc, CORE_ADDR addr, CORE_ADDR bias,
+		struct pc_lookup_range *range)
+{
+  if (pc >= addr)
+    {
+      if (range != NULL && addr + bias > range->low)
+	range->low = addr + bias;
+      return 1;
+    }
+
+  if (range != NULL && addr + bias < range->high)
+    range->high = addr + bias;
+  return 0;
+}
+
 /* A helper function that makes *PC section-relative.  This searches
    the sections of OBJFILE and if *PC is in a section, it subtracts
    the section offset and returns true.  Otherwise it returns
-   false.  */
+   false.  RANGE is as for pc_at_or_above.  */
 
 static int
-frob_address (struct objfile *objfile, CORE_ADDR *pc)
+frob_address (struct objfile *objfile, CORE_ADDR *pc,
+	      struct pc_lookup_range *range)
 {
   struct obj_section *iter;
 
   ALL_OBJFILE_OSECTIONS (objfile, iter)
     {
-      if (*pc >= obj_section_addr (iter) && *pc < obj_section_endaddr (iter))
+      if (pc_at_or_above (*pc, obj_section_addr (iter), 0, range)
+	  && !pc_at_or_above (*pc, obj_section_endaddr (iter), 0, range))
 	{
 	  *pc -= obj_section_offset (iter);
 	  return 1;
@@ -649,12 +689,16 @@ frob_address (struct objfile *objfile, CORE_ADDR *pc)
 
    If WANT_TRAMPOLINE is set, prefer mst_solib_trampoline symbols when
    there are text and trampoline symbols at the same address.
-   Otherwise prefer mst_text symbols.  */
+   Otherwise prefer mst_text symbols.
+
+   If RANGE is not NULL, it is narrowed to a range of addresses
+   around PC_IN for which the result is the same.  */
 
 static struct bound_minimal_symbol
-lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
-				       struct obj_section *section,
-				       int want_trampoline)
+search_minimal_symbols_by_pc_section (CORE_ADDR pc_in,
+				      struct obj_section *section,
+				      int want_trampoline,
+				      struct pc_lookup_range *range)
 {
   int lo;
   int hi;
@@ -718,9 +762,12 @@ lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
 
 	     Warning: this code is trickier than it would appear at first.  */
 
-	  if (frob_address (objfile, &pc)
-	      && pc >= MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[lo]))
+	  if (frob_address (objfile, &pc, range)
+	      && pc_at_or_above (pc, MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[lo]),
+				 pc_in - pc, range))
 	    {
+	      CORE_ADDR bias = pc_in - pc;
+
 	      while (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi]) > pc)
 		{
 		  /* pc is still strictly less than highest address.  */
@@ -745,6 +792,15 @@ lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
 			 == MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi + 1])))
 		hi++;
 
+	      /* The search above gives the same HI for every address
+		 up to the next symbol's.  */
+	      pc_at_or_above (pc, MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi]),
+			      bias, range);
+	      if (hi < objfile->per_bfd->minimal_symbol_count - 1)
+		pc_at_or_above (pc,
+				MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi + 1]),
+				bias, range);
+
 	      /* Skip various undesirable symbols.  */
 	      while (hi >= 0)
 		{
@@ -820,10 +876,15 @@ lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
 		     the cancellable variants, but both have sizes.  */
 		  if (hi > 0
 		      && MSYMBOL_SIZE (&msymbol[hi]) != 0
-		      && pc >= (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi])
-				+ MSYMBOL_SIZE (&msymbol[hi]))
-		      && pc < (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi - 1])
-			       + MSYMBOL_SIZE (&msymbol[hi - 1])))
+		      && pc_at_or_above (pc,
+					 (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi])
+					  + MSYMBOL_SIZE (&msymbol[hi])),
+					 bias, range)
+		      && !pc_at_or_above (pc,
+					  (MSYMBOL_VALUE_RAW_ADDRESS
+					   (&msymbol[hi - 1])
+					   + MSYMBOL_SIZE (&msymbol[hi - 1])),
+					  bias, range))
 		    {
 		      hi--;
 		      continue;
@@ -852,8 +913,10 @@ lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
 
 	      if (hi >= 0
 		  && MSYMBOL_SIZE (&msymbol[hi]) != 0
-		  && pc >= (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi])
-			    + MSYMBOL_SIZE (&msymbol[hi])))
+		  && pc_at_or_above (pc,
+				     (MSYMBOL_VALUE_RAW_ADDRESS (&msymbol[hi])
+				      + MSYMBOL_SIZE (&msymbol[hi])),
+				     bias, range))
 		{
 		  if (best_zero_sized != -1)
 		    hi = best_zero_sized;
@@ -883,6 +946,182 @@ lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc_in,
   return result;
 }
 
+/* An entry of the PC index: the result of looking up any address
+   from the key of the entry up to HIGH in SECTION.  */
+
+struct minsym_pc_range
+{
+  /* One past the highest address of the range.  */
+  CORE_ADDR high;
+
+  /* The section the lookups were done in.  */
+  struct obj_section *section;
+
+  /* The result of the lookups.  */
+  struct bound_minimal_symbol result;
+};
+
+/* The PC index of a program space.  Looking up an address in the
+   minimal symbols means searching those of the objfile it belongs
+   to, and then skipping over unsuitable symbols; when unwinding many
+   threads the same addresses are looked up over and over.  The index
+   records, for each address looked up, the whole range of addresses
+   around it that give the same result, so that later lookups in the
+   range are a single search of the index.
+
+   Ranges are keyed by their lowest address and don't overlap.
+   Lookups preferring trampolines are kept apart from the others.
+   Ranges are removed when the objfiles they were found in come and
+   go.  */
+
+struct minsym_pc_index
+{
+  std::map<CORE_ADDR, minsym_pc_range> ranges[2];
+};
+
+/* Per-program-space data key.  */
+static const struct program_space_data *minsym_pc_index_key;
+
+/* Return the PC index of PSPACE, creating it if CREATE is true.  */
+
+static struct minsym_pc_index *
+get_minsym_pc_index (struct program_space *pspace, bool create)
+{
+  struct minsym_pc_index *index
+    = ((struct minsym_pc_index *)
+       program_space_data (pspace, minsym_pc_index_key));
+
+  if (index == NULL && create)
+    {
+      index = new minsym_pc_index;
+      set_program_space_data (pspace, minsym_pc_index_key, index);
+    }
+
+  return index;
+}
+
+/* Free the PC index of PSPACE.  Called when PSPACE is destroyed.  */
+
+static void
+minsym_pc_index_cleanup (struct program_space *pspace, void *data)
+{
+  delete (struct minsym_pc_index *) data;
+}
+
+/* Return the objfile OBJFILE is a separate debug objfile of, if any,
+   else OBJFILE itself.  Lookups involve all the objfiles of such a
+   family, so that is what ranges are tracked by.  */
+
+static struct objfile *
+minsym_pc_index_family (struct objfile *objfile)
+{
+  while (objfile->separate_debug_objfile_backlink != NULL)
+    objfile = objfile->separate_debug_objfile_backlink;
+  return objfile;
+}
+
+/* Remove from the PC index of PSPACE the ranges found in the family
+   of objfiles of OBJFILE, or all the ranges if OBJFILE is NULL.  */
+
+static void
+minsym_pc_index_remove (struct program_space *pspace,
+			struct objfile *objfile)
+{
+  struct minsym_pc_index *index = get_minsym_pc_index (pspace, false);
+
+  if (index == NULL)
+    return;
+
+  struct objfile *family
+    = objfile != NULL ? minsym_pc_index_family (objfile) : NULL;
+
+  for (auto &ranges : index->ranges)
+    {
+      if (family == NULL)
+	{
+	  ranges.clear ();
+	  continue;
+	}
+
+      for (auto iter = ranges.begin (); iter != ranges.end (); )
+	{
+	  struct objfile *objf = iter->second.section->objfile;
+
+	  if (minsym_pc_index_family (objf) == family)
+	    iter = ranges.erase (iter);
+	  else
+	    ++iter;
+	}
+    }
+}
+
+/* See minsyms.h.  */
+
+void
+clear_minimal_symbol_pc_index (struct program_space *pspace)
+{
+  minsym_pc_index_remove (pspace, NULL);
+}
+
+/* Look up PC like search_minimal_symbols_by_pc_section, using the PC
+   index of the program space of SECTION.  */
+
+static struct bound_minimal_symbol
+lookup_minimal_symbol_by_pc_section_1 (CORE_ADDR pc,
+				       struct obj_section *section,
+				       int want_trampoline)
+{
+  /* Mapped overlay sections share addresses, and the section that
+     covers an address changes as overlays are mapped.  Also don't
+     bother with lookups outside SECTION.  */
+  if (overlay_debugging
+      || pc < obj_section_addr (section)
+      || pc >= obj_section_endaddr (section))
+    return search_minimal_symbols_by_pc_section (pc, section,
+						 want_trampoline, NULL);
+
+  struct minsym_pc_index *index
+    = get_minsym_pc_index (section->objfile->pspace, true);
+  std::map<CORE_ADDR, minsym_pc_range> &ranges
+    = index->ranges[want_trampoline != 0];
+  struct pc_lookup_range range;
+
+  range.low = obj_section_addr (section);
+  range.high = obj_section_endaddr (section);
+
+  /* Find the range containing PC, if any, and otherwise the ranges
+     on either side of it, which the new range must not overlap.  */
+  auto next = ranges.upper_bound (pc);
+  if (next != ranges.end () && next->first < range.high)
+    range.high = next->first;
+  if (next != ranges.begin ())
+    {
+      auto prev = std::prev (next);
+
+      if (pc < prev->second.high)
+	{
+	  if (prev->second.section == section)
+	    return prev->second.result;
+	  return search_minimal_symbols_by_pc_section (pc, section,
+						       want_trampoline, NULL);
+	}
+      if (prev->second.high > range.low)
+	range.low = prev->second.high;
+    }
+
+  struct bound_minimal_symbol result
+    = search_minimal_symbols_by_pc_section (pc, section, want_trampoline,
+					    &range);
+
+  gdb_assert (range.low <= pc && pc < range.high);
+  minsym_pc_range &entry = ranges[range.low];
+  entry.high = range.high;
+  entry.section = section;
+  entry.result = result;
+
+  return result;
+}
+
 struct bound_minimal_symbol
 lookup_minimal_symbol_by_pc_section (CORE_ADDR pc, struct obj_section *section)
 {
@@ -1133,7 +1372,19 @@ minimal_symbol_reader::record_full (const char *name, int name_len,
   msymbol = &m_msym_bunch->contents[m_msym_bunch_index];
   MSYMBOL_SET_LANGUAGE (msymbol, language_auto,
 			&m_objfile->per_bfd->storage_obstack);
-  MSYMBOL_SET_NAMES (msymbol, name, name_len, copy_name, m_objfile);
+  if (!m_batch_names || m_objfile->per_bfd->minsyms_read)
+    MSYMBOL_SET_NAMES (msymbol, name, name_len, copy_name, m_objfile);
+  else
+    {
+      /* The rest is done by set_names.  Until then, keep a
+	 NUL-terminated copy of NAME if it is needed.  */
+      bool copy = copy_name || name[name_len] != '\0';
+
+      if (copy)
+	name = (const char *) obstack_copy0 (&m_name_obstack, name, name_len);
+      msymbol->mginfo.name = name;
+      m_msym_copy_name.push_back (copy);
+    }
 
   SET_MSYMBOL_VALUE_ADDRESS (msymbol, address);
   MSYMBOL_SECTION (msymbol) = section;
@@ -1268,9 +1519,24 @@ compact_minimal_symbols (struct minimal_symbol *msymbol, int mcount,
   return (mcount);
 }
 
+/* The hash values of a minimal symbol, computed ahead of inserting it
+   in the hash tables.  */
+
+struct minsym_hash_values
+{
+  /* The hash of the linkage name.  */
+  unsigned int name_hash;
+
+  /* The hash of the search name, if it is not the linkage name.  */
+  unsigned int search_name_hash;
+};
+
 /* Build (or rebuild) the minimal symbol hash tables.  This is necessary
    after compacting or sorting the table since the entries move around
-   thus causing the internal minimal_symbol pointers to become jumbled.  */
+   thus causing the internal minimal_symbol pointers to become jumbled.
+   The hash values are computed in parallel, but the symbols are
+   inserted in the same order as always, so the tables don't depend on
+   the number of threads.  */
   
 static void
 build_minimal_symbol_hash_tables (struct objfile *objfile)
@@ -1285,21 +1551,104 @@ build_minimal_symbol_hash_tables (struct objfile *objfile)
       objfile->per_bfd->msymbol_demangled_hash[i] = 0;
     }
 
+  struct minimal_symbol *msymbols = objfile->per_bfd->msymbols;
+  int count = objfile->per_bfd->minimal_symbol_count;
+  std::vector<minsym_hash_values> hash_values (count);
+
+  gdb::parallel_for_each
+    (msymbols, msymbols + count,
+     [&] (struct minimal_symbol *start, struct minimal_symbol *end)
+     {
+       for (msym = start; msym < end; ++msym)
+	 {
+	   minsym_hash_values &values = hash_values[msym - msymbols];
+
+	   values.name_hash = msymbol_hash (MSYMBOL_LINKAGE_NAME (msym));
+	   if (MSYMBOL_SEARCH_NAME (msym) != MSYMBOL_LINKAGE_NAME (msym))
+	     values.search_name_hash
+	       = search_name_hash (MSYMBOL_LANGUAGE (msym),
+				   MSYMBOL_SEARCH_NAME (msym));
+	 }
+     });
+
   /* Now, (re)insert the actual entries.  */
-  for ((i = objfile->per_bfd->minimal_symbol_count,
-	msym = objfile->per_bfd->msymbols);
-       i > 0;
-       i--, msym++)
+  for (i = 0, msym = msymbols; i < count; i++, msym++)
     {
       msym->hash_next = 0;
-      add_minsym_to_hash_table (msym, objfile->per_bfd->msymbol_hash);
+      add_minsym_to_hash_table (msym, hash_values[i].name_hash,
+				objfile->per_bfd->msymbol_hash);
 
       msym->demangled_hash_next = 0;
       if (MSYMBOL_SEARCH_NAME (msym) != MSYMBOL_LINKAGE_NAME (msym))
-	add_minsym_to_demangled_hash_table (msym, objfile);
+	add_minsym_to_demangled_hash_table (msym,
+					    hash_values[i].search_name_hash,
+					    objfile);
     }
 }
 
+/* The number of symbols set_names demangles at once.  This bounds the
+   memory used to hold the demangled names before they are copied to
+   the objfile.  */
+
+#define MSYMBOL_NAMES_BATCH_SIZE 16384
+
+/* See minsyms.h.  */
+
+void
+minimal_symbol_reader::set_names ()
+{
+  /* List the new symbols in the order they were recorded, which is
+     the order in which they would have been named without batching.
+     The newest bunch is first, and is the only one that may not be
+     full.  */
+  std::vector<struct msym_bunch *> bunches;
+  std::vector<struct minimal_symbol *> msymbols;
+
+  for (struct msym_bunch *bunch = m_msym_bunch;
+       bunch != NULL;
+       bunch = bunch->next)
+    bunches.push_back (bunch);
+
+  msymbols.reserve (m_msym_copy_name.size ());
+  for (auto iter = bunches.rbegin (); iter != bunches.rend (); ++iter)
+    {
+      int count = *iter == m_msym_bunch ? m_msym_bunch_index : BUNCH_SIZE;
+
+      for (int i = 0; i < count; ++i)
+	msymbols.push_back (&(*iter)->contents[i]);
+    }
+  gdb_assert (msymbols.size () == m_msym_copy_name.size ());
+
+  std::vector<const char *> names;
+
+  for (size_t start = 0;
+       start < msymbols.size ();
+       start += MSYMBOL_NAMES_BATCH_SIZE)
+    {
+      size_t end = std::min (start + MSYMBOL_NAMES_BATCH_SIZE,
+			     msymbols.size ());
+
+      names.clear ();
+      for (size_t i = start; i < end; ++i)
+	names.push_back (MSYMBOL_LINKAGE_NAME (msymbols[i]));
+
+      /* This is what the C++ language's sniffer does.  */
+      std::vector<gdb::unique_xmalloc_ptr<char>> demangled
+	= gdb_demangle_parallel (names, DMGL_PARAMS | DMGL_ANSI);
+
+      for (size_t i = start; i < end; ++i)
+	{
+	  const char *name = names[i - start];
+
+	  symbol_set_names (&msymbols[i]->mginfo, name, strlen (name),
+			    m_msym_copy_name[i], m_objfile,
+			    &demangled[i - start]);
+	}
+    }
+
+  m_msym_copy_name.clear ();
+}
+
 /* Add the minimal symbols in the existing bunches to the objfile's official
    minimal symbol table.  In most cases there is no minimal symbol table yet
    for this objfile, and the existing bunches are used to create one.  Once
@@ -1313,15 +1662,9 @@ build_minimal_symbol_hash_tables (struct objfile *objfile)
    demangled C++ names, we have no choice but to try and demangle each new one
    that comes in.  If the demangling succeeds, then we assume it is a C++
    symbol and set the symbol's language and demangled name fields
-   appropriately.  Note that in order to avoid unnecessary demanglings, and
-   allocating obstack space that subsequently can't be freed for the demangled
-   names, we mark all newly added symbols with language_auto.  After
-   compaction of the minimal symbols, we go back and scan the entire minimal
-   symbol table looking for these new symbols.  For each new symbol we attempt
-   to demangle it, and if successful, record it as a language_cplus symbol
-   and cache the demangled form on the symbol obstack.  Symbols which don't
-   demangle are marked as language_unknown symbols, which inhibits future
-   attempts to demangle them if we later add more minimal symbols.  */
+   appropriately.  This is done as the symbols are recorded or, if
+   batch_names was called, by set_names before the new symbols are
+   sorted.  */
 
 void
 minimal_symbol_reader::install ()
@@ -1344,6 +1687,9 @@ minimal_symbol_reader::install ()
 			      m_msym_count, objfile_name (m_objfile));
 	}
 
+      if (m_batch_names)
+	set_names ();
+
       /* Allocate enough space in the obstack, into which we will gather the
          bunches of new and existing minimal symbols, sort them, and then
          compact out the duplicate entries.  Once we have a final table,
@@ -1413,6 +1759,9 @@ minimal_symbol_reader::install ()
 	 yet.  (And if the msymbol obstack gets moved, all the internal
 	 pointers to other msymbols need to be adjusted.)  */
       build_minimal_symbol_hash_tables (m_objfile);
+
+      /* Lookups in this objfile may now give different results.  */
+      minsym_pc_index_remove (m_objfile->pspace, m_objfile);
     }
 }
 
@@ -1553,3 +1902,35 @@ minimal_symbol_upper_bound (struct bound_minimal_symbol minsym)
 
   return result;
 }
+
+/* This module's 'new_objfile' observer.  */
+
+static void
+minsyms_new_objfile_observer (struct objfile *objfile)
+{
+  /* A NULL OBJFILE means all the symbols of the current program space
+     were discarded.  */
+  if (objfile == NULL)
+    clear_minimal_symbol_pc_index (current_program_space);
+  else
+    minsym_pc_index_remove (objfile->pspace, objfile);
+}
+
+/* This module's 'free_objfile' observer.  */
+
+static void
+minsyms_free_objfile_observer (struct objfile *objfile)
+{
+  minsym_pc_index_remove (objfile->pspace, objfile);
+}
+
+void
+_initialize_minsyms (void)
+{
+  minsym_pc_index_key
+    = register_program_space_data_with_cleanup (NULL,
+						minsym_pc_index_cleanup);
+
+  observer_attach_new_objfile (minsyms_new_objfile_observer);
+  observer_attach_free_objfile (minsyms_free_objfile_observer);
+}
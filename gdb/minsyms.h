@@ -20,6 +20,8 @@
 #ifndef MINSYMS_H
 #define MINSYMS_H
 
+#include "gdb_obstack.h"
+
 struct type;
 
 /* Several lookup functions return both a minimal symbol and the
@@ -76,6 +78,20 @@ class minimal_symbol_reader
 
   void install ();
 
+  /* Demangle the names of the symbols in batches, in parallel, when
+     they are installed, instead of one at a time as they are
+     recorded.  Until then, only their linkage names are set.
+
+     The language of a symbol is only deduced the first time its name
+     is seen in the objfile, so this must only be used by readers which
+     do not give names to other symbols of the objfile between
+     recording minimal symbols and installing them.  */
+
+  void batch_names ()
+  {
+    m_batch_names = true;
+  }
+
   /* Record a new minimal symbol.  This is the "full" entry point;
      simpler convenience entry points are also provided below.
    
@@ -133,6 +149,10 @@ class minimal_symbol_reader
     (const minimal_symbol_reader &);
   minimal_symbol_reader (const minimal_symbol_reader &);
 
+  /* Set the names of the symbols recorded since the last call to
+     install, when batch_names was called.  */
+  void set_names ();
+
   struct objfile *m_objfile;
 
   /* Bunch currently being filled up.
@@ -148,6 +168,20 @@ class minimal_symbol_reader
      objfile.  */
 
   int m_msym_count;
+
+  /* Whether batch_names was called.  */
+
+  bool m_batch_names = false;
+
+  /* When batching names, whether the linkage names of the symbols
+     must be copied to the objfile, in the order the symbols were
+     recorded.  */
+
+  std::vector<bool> m_msym_copy_name;
+
+  /* Where the linkage names that must be copied are kept until then.  */
+
+  auto_obstack m_name_obstack;
 };
 
 /* Create the terminating entry of OBJFILE's minimal symbol table.
@@ -252,6 +286,12 @@ struct bound_minimal_symbol lookup_minimal_symbol_by_pc_section
     (CORE_ADDR,
      struct obj_section *);
 
+/* Forget the results of the lookups of minimal symbols by address
+   done in PSPACE, e.g. because its objfiles were relocated.  Objfiles
+   being added or removed are already taken care of.  */
+
+void clear_minimal_symbol_pc_index (struct program_space *pspace);
+
 /* Backward compatibility: search through the minimal symbol table 
    for a matching PC (no section given).
    
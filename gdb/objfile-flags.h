@@ -68,6 +68,11 @@ enum objfile_flag
     /* User requested that we do not read this objfile's symbolic
        information.  */
     OBJF_READNEVER = 1 << 7,
+
+    /* This objfile was created for code registered through the JIT
+       interface.  A JIT puts its code in memory that no other
+       objfile covers, and the objfile is never re-read.  */
+    OBJF_JIT = 1 << 8,
   };
 
 DEF_ENUM_FLAGS_TYPE (enum objfile_flag, objfile_flags);
@@ -72,9 +72,16 @@ struct objfile_pspace_info
      was last updated.  */
   int new_objfiles_available;
 
+  /* Nonzero if some of those object files are not for JITed code.  */
+  int new_non_jit_objfiles;
+
   /* Nonzero if the section map MUST be updated before use.  */
   int section_map_dirty;
 
+  /* Nonzero if the section map was built leaving out sections that
+     overlapped others.  */
+  int sections_overlap;
+
   /* Nonzero if section map updates should be inhibited if possible.  */
   int inhibit_updates;
 };
@@ -110,6 +117,34 @@ get_objfile_pspace_data (struct program_space *pspace)
   return info;
 }
 
+/* Remove the sections of OBJFILE from the section map of PSPACE_INFO,
+   keeping the map sorted.  Return zero if the map must be rebuilt
+   instead: either it is already out of date, or some section was left
+   out of it for overlapping a section of OBJFILE.  */
+
+static int
+remove_section_map_objfile (struct objfile_pspace_info *pspace_info,
+			    struct objfile *objfile)
+{
+  int i, j;
+
+  if (pspace_info->section_map_dirty || pspace_info->sections_overlap)
+    return 0;
+
+  for (i = 0, j = 0; i < pspace_info->num_sections; i++)
+    if (pspace_info->sections[i]->objfile != objfile)
+      pspace_info->sections[j++] = pspace_info->sections[i];
+  pspace_info->num_sections = j;
+
+  if (j == 0)
+    {
+      xfree (pspace_info->sections);
+      pspace_info->sections = NULL;
+    }
+
+  return 1;
+}
+
 
 
 /* Per-BFD data key.  */
@@ -437,6 +472,8 @@ objfile::objfile (bfd *abfd, const char *name, objfile_flags flags_)
 
   /* Rebuild section map next time we need it.  */
   get_objfile_pspace_data (pspace)->new_objfiles_available = 1;
+  if ((flags & OBJF_JIT) == 0)
+    get_objfile_pspace_data (pspace)->new_non_jit_objfiles = 1;
 }
 
 /* Retrieve the gdbarch associated with OBJFILE.  */
@@ -716,13 +753,18 @@ objfile::~objfile ()
       clear_current_source_symtab_and_line ();
   }
 
+  /* Rebuild section map next time we need it.  The sections of a JIT
+     objfile can instead be dropped from the map as it is, unless some
+     section it hid must now take their place.  */
+  if ((flags & OBJF_JIT) == 0
+      || !remove_section_map_objfile (get_objfile_pspace_data (pspace),
+				      this))
+    get_objfile_pspace_data (pspace)->section_map_dirty = 1;
+
   /* Free the obstacks for non-reusable objfiles.  */
   psymbol_bcache_free (psymbol_cache);
   obstack_free (&objfile_obstack, 0);
 
-  /* Rebuild section map next time we need it.  */
-  get_objfile_pspace_data (pspace)->section_map_dirty = 1;
-
   /* Free the map for static links.  There's no need to free static link
      themselves since they were allocated on the objstack.  */
   if (static_links != NULL)
@@ -869,6 +911,7 @@ objfile_relocate1 (struct objfile *objfile,
 
   /* Rebuild section map next time we need it.  */
   get_objfile_pspace_data (objfile->pspace)->section_map_dirty = 1;
+  clear_minimal_symbol_pc_index (objfile->pspace);
 
   /* Update the table in exec_ops, used to read memory.  */
   ALL_OBJFILE_OSECTIONS (objfile, s)
@@ -1344,6 +1387,8 @@ update_section_map (struct program_space *pspace,
       if (insert_section_p (objfile->obfd, s->the_bfd_section))
 	alloc_size += 1;
 
+  pspace_info->sections_overlap = 0;
+
   /* This happens on detach/attach (e.g. in gdb.base/attach.exp).  */
   if (alloc_size == 0)
     {
@@ -1362,7 +1407,10 @@ update_section_map (struct program_space *pspace,
 
   qsort (map, alloc_size, sizeof (*map), qsort_cmp);
   map_size = filter_debuginfo_sections(map, alloc_size);
+  i = map_size;
   map_size = filter_overlapping_sections(map, map_size);
+  if (map_size < i)
+    pspace_info->sections_overlap = 1;
 
   if (map_size < alloc_size)
     /* Some sections were eliminated.  Trim excess space.  */
@@ -1389,13 +1437,38 @@ bsearch_cmp (const void *key, const void *elt)
   return 1;
 }
 
+/* Look up PC in the section map of PSPACE_INFO, as it is.  */
+
+static struct obj_section *
+search_section_map (struct objfile_pspace_info *pspace_info, CORE_ADDR pc)
+{
+  struct obj_section **sp;
+
+  /* The C standard (ISO/IEC 9899:TC2) requires the BASE argument to
+     bsearch be non-NULL.  */
+  if (pspace_info->sections == NULL)
+    {
+      gdb_assert (pspace_info->num_sections == 0);
+      return NULL;
+    }
+
+  sp = (struct obj_section **) bsearch (&pc,
+					pspace_info->sections,
+					pspace_info->num_sections,
+					sizeof (*pspace_info->sections),
+					bsearch_cmp);
+  if (sp != NULL)
+    return *sp;
+  return NULL;
+}
+
 /* Returns a section whose range includes PC or NULL if none found.   */
 
 struct obj_section *
 find_pc_section (CORE_ADDR pc)
 {
   struct objfile_pspace_info *pspace_info;
-  struct obj_section *s, **sp;
+  struct obj_section *s;
 
   /* Check for mapped overlay section first.  */
   s = find_pc_mapped_section (pc);
@@ -1407,6 +1480,20 @@ find_pc_section (CORE_ADDR pc)
       || (pspace_info->new_objfiles_available
 	  && !pspace_info->inhibit_updates))
     {
+      /* The sections of JIT objfiles don't overlap those of other
+	 objfiles, so if only JIT objfiles were added, a PC the map
+	 already covers is still in the same section.  A JIT may
+	 register thousands of functions, stopping at each; this way
+	 the map is only rebuilt when a PC in new code is looked up,
+	 not at every stop.  */
+      if (!pspace_info->section_map_dirty
+	  && !pspace_info->new_non_jit_objfiles)
+	{
+	  s = search_section_map (pspace_info, pc);
+	  if (s != NULL)
+	    return s;
+	}
+
       update_section_map (current_program_space,
 			  &pspace_info->sections,
 			  &pspace_info->num_sections);
@@ -1414,25 +1501,11 @@ find_pc_section (CORE_ADDR pc)
       /* Don't need updates to section map until objfiles are added,
          removed or relocated.  */
       pspace_info->new_objfiles_available = 0;
+      pspace_info->new_non_jit_objfiles = 0;
       pspace_info->section_map_dirty = 0;
     }
 
-  /* The C standard (ISO/IEC 9899:TC2) requires the BASE argument to
-     bsearch be non-NULL.  */
-  if (pspace_info->sections == NULL)
-    {
-      gdb_assert (pspace_info->num_sections == 0);
-      return NULL;
-    }
-
-  sp = (struct obj_section **) bsearch (&pc,
-					pspace_info->sections,
-					pspace_info->num_sections,
-					sizeof (*pspace_info->sections),
-					bsearch_cmp);
-  if (sp != NULL)
-    return *sp;
-  return NULL;
+  return search_section_map (pspace_info, pc);
 }
 
 
@@ -1461,6 +1534,7 @@ objfiles_changed (void)
 {
   /* Rebuild section map next time we need it.  */
   get_objfile_pspace_data (current_program_space)->section_map_dirty = 1;
+  clear_minimal_symbol_pc_index (current_program_space);
 }
 
 /* See comments in objfiles.h.  */
@@ -376,7 +376,7 @@ recpy_bt_func_instructions (PyObject *self, void *closure)
   if (func == NULL)
     return NULL;
 
-  len = func->insn.size ();
+  len = func->ninsn;
 
   /* Gaps count as one instruction.  */
   if (len == 0)
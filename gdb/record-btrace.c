@@ -894,7 +894,7 @@ btrace_call_history_insn_range (struct ui_out *uiout,
 {
   unsigned int begin, end, size;
 
-  size = bfun->insn.size ();
+  size = bfun->ninsn;
   gdb_assert (size > 0);
 
   begin = bfun->insn_offset;
@@ -906,12 +906,13 @@ btrace_call_history_insn_range (struct ui_out *uiout,
 }
 
 /* Compute the lowest and highest source line for the instructions in BFUN
-   and return them in PBEGIN and PEND.
+   of BTINFO and return them in PBEGIN and PEND.
    Ignore instructions that can't be mapped to BFUN, e.g. instructions that
    result from inlining or macro expansion.  */
 
 static void
-btrace_compute_src_line_range (const struct btrace_function *bfun,
+btrace_compute_src_line_range (const struct btrace_thread_info *btinfo,
+			       const struct btrace_function *bfun,
 			       int *pbegin, int *pend)
 {
   struct symtab *symtab;
@@ -927,8 +928,9 @@ btrace_compute_src_line_range (const struct btrace_function *bfun,
 
   symtab = symbol_symtab (sym);
 
-  for (const btrace_insn &insn : bfun->insn)
+  for (unsigned int i = 0; i < bfun->ninsn; ++i)
     {
+      const btrace_insn &insn = btrace_function_insn (btinfo, bfun, i);
       struct symtab_and_line sal;
 
       sal = find_pc_line (insn.pc, 0);
@@ -948,6 +950,7 @@ btrace_compute_src_line_range (const struct btrace_function *bfun,
 
 static void
 btrace_call_history_src_line (struct ui_out *uiout,
+			      const struct btrace_thread_info *btinfo,
 			      const struct btrace_function *bfun)
 {
   struct symbol *sym;
@@ -960,7 +963,7 @@ btrace_call_history_src_line (struct ui_out *uiout,
   uiout->field_string ("file",
 		       symtab_to_filename_for_display (symbol_symtab (sym)));
 
-  btrace_compute_src_line_range (bfun, &begin, &end);
+  btrace_compute_src_line_range (btinfo, bfun, &begin, &end);
   if (end < begin)
     return;
 
@@ -1064,7 +1067,7 @@ btrace_call_history (struct ui_out *uiout,
       if ((flags & RECORD_PRINT_SRC_LINE) != 0)
 	{
 	  uiout->text (_("\tat "));
-	  btrace_call_history_src_line (uiout, bfun);
+	  btrace_call_history_src_line (uiout, btinfo, bfun);
 	}
 
       uiout->text ("\n");
@@ -1633,10 +1636,11 @@ record_btrace_frame_prev_register (struct frame_info *this_frame,
   caller = btrace_call_get (&it);
 
   if ((bfun->flags & BFUN_UP_LINKS_TO_RET) != 0)
-    pc = caller->insn.front ().pc;
+    pc = btrace_function_insn (&cache->tp->btrace, caller, 0).pc;
   else
     {
-      pc = caller->insn.back ().pc;
+      pc = btrace_function_insn (&cache->tp->btrace, caller,
+				 caller->ninsn - 1).pc;
       pc += gdb_insn_length (gdbarch, pc);
     }
 
@@ -37,6 +37,9 @@
 #include "infrun.h"
 #include "common/gdb_unlinker.h"
 #include "common/byte-vector.h"
+#if GDB_SELF_TEST
+#include "selftest.h"
+#endif
 
 #include <signal.h>
 
@@ -63,7 +66,8 @@
 #define DEFAULT_RECORD_FULL_INSN_MAX_NUM	200000
 
 #define RECORD_FULL_IS_REPLAY \
-     (record_full_list->next || execution_direction == EXEC_REVERSE)
+     (record_full_entry_next (record_full_list) != NULL \
+      || execution_direction == EXEC_REVERSE)
 
 #define RECORD_FULL_FILE_MAGIC	netorder32(0x20091016)
 
@@ -75,8 +79,8 @@
    that indicates that this is the last struct record_full_entry of this
    instruction.
 
-   Each struct record_full_entry is linked to "record_full_list" by "prev"
-   and "next" pointers.  */
+   The entries are stored one after the other in large chunks of
+   memory, see struct record_full_entry and struct record_full_chunk.  */
 
 struct record_full_mem_entry
 {
@@ -85,22 +89,12 @@ struct record_full_mem_entry
   /* Set this flag if target memory for this entry
      can no longer be accessed.  */
   int mem_entry_not_accessible;
-  union
-  {
-    gdb_byte *ptr;
-    gdb_byte buf[sizeof (gdb_byte *)];
-  } u;
 };
 
 struct record_full_reg_entry
 {
   unsigned short num;
   unsigned short len;
-  union 
-  {
-    gdb_byte *ptr;
-    gdb_byte buf[2 * sizeof (gdb_byte *)];
-  } u;
 };
 
 struct record_full_end_entry
@@ -118,32 +112,43 @@ enum record_full_type
 
 /* This is the data structure that makes up the execution log.
 
-   The execution log consists of a single linked list of entries
-   of type "struct record_full_entry".  It is doubly linked so that it
-   can be traversed in either direction.
-
-   The start of the list is anchored by a struct called
-   "record_full_first".  The pointer "record_full_list" either points
-   to the last entry that was added to the list (in record mode), or to
-   the next entry in the list that will be executed (in replay mode).
-
-   Each list element (struct record_full_entry), in addition to next
-   and prev pointers, consists of a union of three entry types: mem,
-   reg, and end.  A field called "type" determines which entry type is
-   represented by a given list element.
+   The execution log consists of a sequence of entries of type "struct
+   record_full_entry".  The entries are not allocated separately:
+   they are stored one after the other in a list of chunks (see struct
+   record_full_chunk), and each entry is immediately followed by the
+   value of the register or memory it records.  An entry records its
+   offset in its chunk and the size of the entry before it, so the log
+   can be traversed in either direction without storing any pointers.
+   See record_full_entry_next and record_full_entry_prev.
+
+   The start of the log is anchored by an entry called
+   "record_full_first", which is not stored in any chunk.  The pointer
+   "record_full_list" either points to the last entry that was added to
+   the log (in record mode), or to the next entry in the log that will
+   be executed (in replay mode).
+
+   Each entry, in addition to its position, consists of a union of
+   three entry types: mem, reg, and end.  A field called "type"
+   determines which entry type is represented by a given entry.
 
    Each instruction that is added to the execution log is represented
-   by a variable number of list elements ('entries').  The instruction
-   will have one "reg" entry for each register that is changed by 
-   executing the instruction (including the PC in every case).  It 
-   will also have one "mem" entry for each memory change.  Finally,
-   each instruction will have an "end" entry that separates it from
-   the changes associated with the next instruction.  */
+   by a variable number of entries.  The instruction will have one
+   "reg" entry for each register that is changed by executing the
+   instruction (including the PC in every case).  It will also have
+   one "mem" entry for each memory change; changes to adjacent memory
+   by the same instruction share a single entry.  Finally, each
+   instruction will have an "end" entry that separates it from the
+   changes associated with the next instruction.  */
 
 struct record_full_entry
 {
-  struct record_full_entry *prev;
-  struct record_full_entry *next;
+  /* The offset of this entry in its chunk.  */
+  unsigned int offset;
+
+  /* The size of the previous entry in the same chunk, or zero if this
+     is the first entry of its chunk.  */
+  unsigned int prev_size;
+
   enum record_full_type type;
   union
   {
@@ -154,8 +159,41 @@ struct record_full_entry
     /* end */
     struct record_full_end_entry end;
   } u;
+
+  /* For reg and mem entries, the value follows; see
+     record_full_get_loc.  */
+};
+
+/* A chunk of the execution log.  The entries follow the chunk
+   structure, starting RECORD_FULL_CHUNK_DATA_OFFSET bytes after it.  */
+
+struct record_full_chunk
+{
+  /* The previous and next chunks in the log.  */
+  struct record_full_chunk *prev;
+  struct record_full_chunk *next;
+
+  /* The number of bytes available for entries, and the number of
+     bytes used.  */
+  size_t size;
+  size_t used;
+
+  /* The offset of the last entry in the chunk.  */
+  size_t last;
 };
 
+/* The usual size of a chunk.  Entries that do not fit in it get a
+   chunk of their own.  */
+#define RECORD_FULL_CHUNK_SIZE	(64 * 1024)
+
+/* Entries are aligned on this boundary.  */
+#define RECORD_FULL_ENTRY_ALIGN	alignof (struct record_full_entry)
+
+/* Offset of the first entry of a chunk from the chunk structure.  */
+#define RECORD_FULL_CHUNK_DATA_OFFSET \
+  ((sizeof (struct record_full_chunk) + RECORD_FULL_ENTRY_ALIGN - 1) \
+   & ~(RECORD_FULL_ENTRY_ALIGN - 1))
+
 /* If true, query if PREC cannot record memory
    change of next instruction.  */
 int record_full_memory_query = 0;
@@ -173,27 +211,43 @@ static struct target_section *record_full_core_start;
 static struct target_section *record_full_core_end;
 static struct record_full_core_buf_entry *record_full_core_buf_list = NULL;
 
-/* The following variables are used for managing the linked list that
-   represents the execution log.
+/* The following variables are used for managing the execution log.
 
    record_full_first is the anchor that holds down the beginning of
-   the list.
+   the log.
 
    record_full_list serves two functions:
-     1) In record mode, it anchors the end of the list.
-     2) In replay mode, it traverses the list and points to
+     1) In record mode, it anchors the end of the log.
+     2) In replay mode, it traverses the log and points to
         the next instruction that must be emulated.
 
    record_full_arch_list_head and record_full_arch_list_tail are used
-   to manage a separate list, which is used to build up the change
-   elements of the currently executing instruction during record mode.
-   When this instruction has been completely annotated in the "arch
-   list", it will be appended to the main execution log.  */
+   to manage the change elements of the currently executing
+   instruction during record mode.  They are stored after the end of
+   the log.  When this instruction has been completely annotated in
+   the "arch list", it will be appended to the execution log, see
+   record_full_arch_list_commit.
+
+   record_full_log_head and record_full_log_tail are the first and
+   last entries of the log, not counting record_full_first and the
+   arch list.  They are NULL if the log is empty.
+
+   record_full_chunk_head and record_full_chunk_tail are the first and
+   last chunks holding the entries.  */
 
 static struct record_full_entry record_full_first;
 static struct record_full_entry *record_full_list = &record_full_first;
 static struct record_full_entry *record_full_arch_list_head = NULL;
 static struct record_full_entry *record_full_arch_list_tail = NULL;
+static struct record_full_entry *record_full_log_head = NULL;
+static struct record_full_entry *record_full_log_tail = NULL;
+static struct record_full_chunk *record_full_chunk_head = NULL;
+static struct record_full_chunk *record_full_chunk_tail = NULL;
+
+/* A chunk of RECORD_FULL_CHUNK_SIZE bytes kept for reuse, or NULL.
+   When the log is full, a chunk is freed at the start of the log
+   about as often as one is needed at its end.  */
+static struct record_full_chunk *record_full_chunk_spare = NULL;
 
 /* 1 ask user. 0 auto delete the last struct record_full_entry.  */
 static int record_full_stop_at_limit = 1;
@@ -235,153 +289,322 @@ static void record_full_goto_insn (struct record_full_entry *entry,
 static void record_full_save (struct target_ops *self,
 			      const char *recfilename);
 
-/* Alloc and free functions for record_full_reg, record_full_mem, and
-   record_full_end entries.  */
+/* Functions to manage the chunks of the execution log.  */
 
-/* Alloc a record_full_reg record entry.  */
+/* Return the entry at OFFSET in CHUNK.  */
 
 static inline struct record_full_entry *
-record_full_reg_alloc (struct regcache *regcache, int regnum)
+record_full_chunk_entry (struct record_full_chunk *chunk, size_t offset)
 {
-  struct record_full_entry *rec;
-  struct gdbarch *gdbarch = regcache->arch ();
+  return (struct record_full_entry *) ((gdb_byte *) chunk
+				       + RECORD_FULL_CHUNK_DATA_OFFSET
+				       + offset);
+}
 
-  rec = XCNEW (struct record_full_entry);
-  rec->type = record_full_reg;
-  rec->u.reg.num = regnum;
-  rec->u.reg.len = register_size (gdbarch, regnum);
-  if (rec->u.reg.len > sizeof (rec->u.reg.u.buf))
-    rec->u.reg.u.ptr = (gdb_byte *) xmalloc (rec->u.reg.len);
+/* Return the chunk holding REC.  */
 
-  return rec;
+static inline struct record_full_chunk *
+record_full_entry_chunk (struct record_full_entry *rec)
+{
+  gdb_assert (rec != &record_full_first);
+
+  return (struct record_full_chunk *) ((gdb_byte *) rec - rec->offset
+				       - RECORD_FULL_CHUNK_DATA_OFFSET);
 }
 
-/* Free a record_full_reg record entry.  */
+/* Add a chunk with room for at least SIZE bytes of entries at the end
+   of the list of chunks, and return it.  */
 
-static inline void
-record_full_reg_release (struct record_full_entry *rec)
+static struct record_full_chunk *
+record_full_chunk_new (size_t size)
 {
-  gdb_assert (rec->type == record_full_reg);
-  if (rec->u.reg.len > sizeof (rec->u.reg.u.buf))
-    xfree (rec->u.reg.u.ptr);
-  xfree (rec);
+  struct record_full_chunk *chunk;
+
+  if (size <= RECORD_FULL_CHUNK_SIZE && record_full_chunk_spare != NULL)
+    {
+      chunk = record_full_chunk_spare;
+      record_full_chunk_spare = NULL;
+    }
+  else
+    {
+      size = std::max (size, (size_t) RECORD_FULL_CHUNK_SIZE);
+      chunk = ((struct record_full_chunk *)
+	       xmalloc (RECORD_FULL_CHUNK_DATA_OFFSET + size));
+      chunk->size = size;
+    }
+
+  chunk->used = 0;
+  chunk->last = 0;
+  chunk->next = NULL;
+  chunk->prev = record_full_chunk_tail;
+  if (record_full_chunk_tail != NULL)
+    record_full_chunk_tail->next = chunk;
+  else
+    record_full_chunk_head = chunk;
+  record_full_chunk_tail = chunk;
+
+  return chunk;
 }
 
-/* Alloc a record_full_mem record entry.  */
+/* Remove CHUNK from the list of chunks and free it.  */
 
-static inline struct record_full_entry *
-record_full_mem_alloc (CORE_ADDR addr, int len)
+static void
+record_full_chunk_free (struct record_full_chunk *chunk)
 {
+  if (chunk->prev != NULL)
+    chunk->prev->next = chunk->next;
+  else
+    record_full_chunk_head = chunk->next;
+  if (chunk->next != NULL)
+    chunk->next->prev = chunk->prev;
+  else
+    record_full_chunk_tail = chunk->prev;
+
+  if (chunk->size == RECORD_FULL_CHUNK_SIZE
+      && record_full_chunk_spare == NULL)
+    record_full_chunk_spare = chunk;
+  else
+    xfree (chunk);
+}
+
+/* Return the size of the fixed part of an entry of type TYPE.  */
+
+static inline size_t
+record_full_header_size (enum record_full_type type)
+{
+  switch (type)
+    {
+    case record_full_reg:
+      return (offsetof (struct record_full_entry, u)
+	      + sizeof (struct record_full_reg_entry));
+    case record_full_mem:
+      return (offsetof (struct record_full_entry, u)
+	      + sizeof (struct record_full_mem_entry));
+    case record_full_end:
+    default:
+      return sizeof (struct record_full_entry);
+    }
+}
+
+/* Return the size taken by an entry of type TYPE recording a value of
+   LEN bytes.  */
+
+static inline size_t
+record_full_size (enum record_full_type type, size_t len)
+{
+  return ((record_full_header_size (type) + len + RECORD_FULL_ENTRY_ALIGN - 1)
+	  & ~(RECORD_FULL_ENTRY_ALIGN - 1));
+}
+
+/* Return the size taken by REC.  */
+
+static inline size_t
+record_full_entry_size (struct record_full_entry *rec)
+{
+  switch (rec->type)
+    {
+    case record_full_reg:
+      return record_full_size (record_full_reg, rec->u.reg.len);
+    case record_full_mem:
+      return record_full_size (record_full_mem, rec->u.mem.len);
+    case record_full_end:
+    default:
+      return record_full_size (record_full_end, 0);
+    }
+}
+
+/* Return the entry following REC in the execution log, or NULL if REC
+   is the last one.  */
+
+static struct record_full_entry *
+record_full_entry_next (struct record_full_entry *rec)
+{
+  struct record_full_chunk *chunk;
+  size_t offset;
+
+  if (rec == &record_full_first)
+    return record_full_log_head;
+  if (rec == record_full_log_tail)
+    return NULL;
+
+  chunk = record_full_entry_chunk (rec);
+  offset = rec->offset + record_full_entry_size (rec);
+  if (offset < chunk->used)
+    return record_full_chunk_entry (chunk, offset);
+  return record_full_chunk_entry (chunk->next, 0);
+}
+
+/* Return the entry preceding REC in the execution log, or NULL if REC
+   is record_full_first.  */
+
+static struct record_full_entry *
+record_full_entry_prev (struct record_full_entry *rec)
+{
+  struct record_full_chunk *chunk;
+
+  if (rec == &record_full_first)
+    return NULL;
+  if (rec == record_full_log_head)
+    return &record_full_first;
+
+  if (rec->prev_size != 0)
+    return (struct record_full_entry *) ((gdb_byte *) rec - rec->prev_size);
+  chunk = record_full_entry_chunk (rec)->prev;
+  return record_full_chunk_entry (chunk, chunk->last);
+}
+
+/* Free the entries stored after REC, which may be record_full_first to
+   free all entries.  This does not update record_full_log_head and
+   record_full_log_tail.  */
+
+static void
+record_full_truncate (struct record_full_entry *rec)
+{
+  struct record_full_chunk *chunk;
+
+  if (rec == &record_full_first)
+    {
+      while (record_full_chunk_tail != NULL)
+	record_full_chunk_free (record_full_chunk_tail);
+      return;
+    }
+
+  chunk = record_full_entry_chunk (rec);
+  chunk->used = rec->offset + record_full_entry_size (rec);
+  chunk->last = rec->offset;
+  while (record_full_chunk_tail != chunk)
+    record_full_chunk_free (record_full_chunk_tail);
+}
+
+/* Alloc a new entry of type TYPE, with room for a value of LEN bytes,
+   after the last entry.  It is not part of the log until it is added
+   to record_full_arch_list and the arch list is committed.  */
+
+static struct record_full_entry *
+record_full_entry_alloc (enum record_full_type type, size_t len)
+{
+  size_t size = record_full_size (type, len);
+  struct record_full_chunk *chunk = record_full_chunk_tail;
   struct record_full_entry *rec;
 
-  rec = XCNEW (struct record_full_entry);
-  rec->type = record_full_mem;
-  rec->u.mem.addr = addr;
-  rec->u.mem.len = len;
-  if (rec->u.mem.len > sizeof (rec->u.mem.u.buf))
-    rec->u.mem.u.ptr = (gdb_byte *) xmalloc (len);
+  if (chunk == NULL || chunk->size - chunk->used < size)
+    chunk = record_full_chunk_new (size);
+
+  rec = record_full_chunk_entry (chunk, chunk->used);
+  memset (rec, 0, record_full_header_size (type));
+  rec->offset = chunk->used;
+  rec->prev_size = chunk->used == 0 ? 0 : chunk->used - chunk->last;
+  rec->type = type;
+
+  chunk->last = chunk->used;
+  chunk->used += size;
 
   return rec;
 }
 
-/* Free a record_full_mem record entry.  */
+/* Alloc functions for record_full_reg, record_full_mem, and
+   record_full_end entries.  */
 
-static inline void
-record_full_mem_release (struct record_full_entry *rec)
+/* Alloc a record_full_reg record entry.  */
+
+static inline struct record_full_entry *
+record_full_reg_alloc (struct regcache *regcache, int regnum)
 {
-  gdb_assert (rec->type == record_full_mem);
-  if (rec->u.mem.len > sizeof (rec->u.mem.u.buf))
-    xfree (rec->u.mem.u.ptr);
-  xfree (rec);
+  struct record_full_entry *rec;
+  struct gdbarch *gdbarch = regcache->arch ();
+  int len = register_size (gdbarch, regnum);
+
+  rec = record_full_entry_alloc (record_full_reg, len);
+  rec->u.reg.num = regnum;
+  rec->u.reg.len = len;
+
+  return rec;
 }
 
-/* Alloc a record_full_end record entry.  */
+/* Alloc a record_full_mem record entry.  */
 
 static inline struct record_full_entry *
-record_full_end_alloc (void)
+record_full_mem_alloc (CORE_ADDR addr, int len)
 {
   struct record_full_entry *rec;
 
-  rec = XCNEW (struct record_full_entry);
-  rec->type = record_full_end;
+  rec = record_full_entry_alloc (record_full_mem, len);
+  rec->u.mem.addr = addr;
+  rec->u.mem.len = len;
 
   return rec;
 }
 
-/* Free a record_full_end record entry.  */
+/* Alloc a record_full_end record entry.  */
 
-static inline void
-record_full_end_release (struct record_full_entry *rec)
+static inline struct record_full_entry *
+record_full_end_alloc (void)
 {
-  xfree (rec);
+  return record_full_entry_alloc (record_full_end, 0);
 }
 
-/* Free one record entry, any type.
-   Return entry->type, in case caller wants to know.  */
+/* Try to make the record_full_mem entry REC, which must be the last
+   entry, LEN bytes longer.  Return 1 if successful, 0 if there is no
+   room for it in its chunk.  */
 
-static inline enum record_full_type
-record_full_entry_release (struct record_full_entry *rec)
+static int
+record_full_mem_extend (struct record_full_entry *rec, int len)
 {
-  enum record_full_type type = rec->type;
+  struct record_full_chunk *chunk = record_full_entry_chunk (rec);
+  size_t size;
 
-  switch (type) {
-  case record_full_reg:
-    record_full_reg_release (rec);
-    break;
-  case record_full_mem:
-    record_full_mem_release (rec);
-    break;
-  case record_full_end:
-    record_full_end_release (rec);
-    break;
-  }
-  return type;
-}
+  gdb_assert (rec->type == record_full_mem);
 
-/* Free all record entries in list pointed to by REC.  */
+  if (chunk != record_full_chunk_tail || rec->offset != chunk->last
+      || len > INT_MAX - rec->u.mem.len)
+    return 0;
 
-static void
-record_full_list_release (struct record_full_entry *rec)
-{
-  if (!rec)
-    return;
+  size = record_full_size (record_full_mem, rec->u.mem.len + len);
+  if (chunk->size - rec->offset < size)
+    return 0;
 
-  while (rec->next)
-    rec = rec->next;
+  rec->u.mem.len += len;
+  chunk->used = rec->offset + size;
+  return 1;
+}
 
-  while (rec->prev)
-    {
-      rec = rec->prev;
-      record_full_entry_release (rec->next);
-    }
+/* Free all record entries, and the arch list.  */
 
-  if (rec == &record_full_first)
-    {
-      record_full_insn_num = 0;
-      record_full_first.next = NULL;
-    }
-  else
-    record_full_entry_release (rec);
+static void
+record_full_list_release (void)
+{
+  record_full_truncate (&record_full_first);
+  record_full_log_head = NULL;
+  record_full_log_tail = NULL;
+  record_full_arch_list_head = NULL;
+  record_full_arch_list_tail = NULL;
+  record_full_insn_num = 0;
 }
 
-/* Free all record entries forward of the given list position.  */
+/* Free all record entries forward of the given log position.  */
 
 static void
 record_full_list_release_following (struct record_full_entry *rec)
 {
-  struct record_full_entry *tmp = rec->next;
+  struct record_full_entry *tmp;
+
+  for (tmp = record_full_entry_next (rec);
+       tmp != NULL;
+       tmp = record_full_entry_next (tmp))
+    if (tmp->type == record_full_end)
+      {
+	record_full_insn_num--;
+	record_full_insn_count--;
+      }
 
-  rec->next = NULL;
-  while (tmp)
+  record_full_truncate (rec);
+  if (rec == &record_full_first)
     {
-      rec = tmp->next;
-      if (record_full_entry_release (tmp) == record_full_end)
-	{
-	  record_full_insn_num--;
-	  record_full_insn_count--;
-	}
-      tmp = rec;
+      record_full_log_head = NULL;
+      record_full_log_tail = NULL;
     }
+  else
+    record_full_log_tail = rec;
 }
 
 /* Delete the first instruction from the beginning of the log, to make
@@ -392,32 +615,40 @@ record_full_list_release_following (struct record_full_entry *rec)
 static void
 record_full_list_release_first (void)
 {
-  struct record_full_entry *tmp;
+  struct record_full_chunk *chunk;
 
-  if (!record_full_first.next)
+  if (record_full_log_head == NULL)
     return;
 
   /* Loop until a record_full_end.  */
   while (1)
     {
-      /* Cut record_full_first.next out of the linked list.  */
-      tmp = record_full_first.next;
-      record_full_first.next = tmp->next;
-      tmp->next->prev = &record_full_first;
+      struct record_full_entry *tmp = record_full_log_head;
 
-      /* tmp is now isolated, and can be deleted.  */
-      if (record_full_entry_release (tmp) == record_full_end)
-	break;	/* End loop at first record_full_end.  */
-
-      if (!record_full_first.next)
+      if (tmp == record_full_log_tail)
 	{
-	  gdb_assert (record_full_insn_num == 1);
-	  break;	/* End loop when list is empty.  */
+	  /* The log is now empty.  */
+	  if (tmp->type != record_full_end)
+	    gdb_assert (record_full_insn_num == 1);
+	  record_full_truncate (&record_full_first);
+	  record_full_log_head = NULL;
+	  record_full_log_tail = NULL;
+	  return;
 	}
+
+      record_full_log_head = record_full_entry_next (tmp);
+      if (tmp->type == record_full_end)
+	break;	/* End loop at first record_full_end.  */
     }
+
+  /* Free the chunks which no longer hold any entry of the log.  */
+  chunk = record_full_entry_chunk (record_full_log_head);
+  while (record_full_chunk_head != chunk)
+    record_full_chunk_free (record_full_chunk_head);
 }
 
-/* Add a struct record_full_entry to record_full_arch_list.  */
+/* Add a struct record_full_entry to record_full_arch_list.  REC must
+   be the last entry allocated.  */
 
 static void
 record_full_arch_list_add (struct record_full_entry *rec)
@@ -427,17 +658,55 @@ record_full_arch_list_add (struct record_full_entry *rec)
 			"Process record: record_full_arch_list_add %s.\n",
 			host_address_to_string (rec));
 
-  if (record_full_arch_list_tail)
-    {
-      record_full_arch_list_tail->next = rec;
-      rec->prev = record_full_arch_list_tail;
-      record_full_arch_list_tail = rec;
-    }
-  else
-    {
-      record_full_arch_list_head = rec;
-      record_full_arch_list_tail = rec;
-    }
+  if (record_full_arch_list_tail == NULL)
+    record_full_arch_list_head = rec;
+  record_full_arch_list_tail = rec;
+}
+
+/* Return the last entry of the log, or of the arch list if it is not
+   empty.  */
+
+static struct record_full_entry *
+record_full_arch_list_last (void)
+{
+  if (record_full_arch_list_tail != NULL)
+    return record_full_arch_list_tail;
+  if (record_full_log_tail != NULL)
+    return record_full_log_tail;
+  return &record_full_first;
+}
+
+/* Free the entries of record_full_arch_list, and any entry allocated
+   after them.  */
+
+static void
+record_full_arch_list_release (void)
+{
+  record_full_truncate (record_full_log_tail != NULL
+			? record_full_log_tail : &record_full_first);
+  record_full_arch_list_head = NULL;
+  record_full_arch_list_tail = NULL;
+}
+
+/* Append record_full_arch_list to the end of the execution log, which
+   record_full_list must point to, and make record_full_list point to
+   its last entry.  */
+
+static void
+record_full_arch_list_commit (void)
+{
+  gdb_assert (record_full_arch_list_head != NULL);
+  gdb_assert (record_full_list == (record_full_log_tail != NULL
+				   ? record_full_log_tail
+				   : &record_full_first));
+
+  if (record_full_log_head == NULL)
+    record_full_log_head = record_full_arch_list_head;
+  record_full_log_tail = record_full_arch_list_tail;
+  record_full_list = record_full_arch_list_tail;
+
+  record_full_arch_list_head = NULL;
+  record_full_arch_list_tail = NULL;
 }
 
 /* Return the value storage location of a record entry.  */
@@ -446,15 +715,8 @@ record_full_get_loc (struct record_full_entry *rec)
 {
   switch (rec->type) {
   case record_full_mem:
-    if (rec->u.mem.len > sizeof (rec->u.mem.u.buf))
-      return rec->u.mem.u.ptr;
-    else
-      return rec->u.mem.u.buf;
   case record_full_reg:
-    if (rec->u.reg.len > sizeof (rec->u.reg.u.buf))
-      return rec->u.reg.u.ptr;
-    else
-      return rec->u.reg.u.buf;
+    return (gdb_byte *) rec + record_full_header_size (rec->type);
   case record_full_end:
   default:
     gdb_assert_not_reached ("unexpected record_full_entry type");
@@ -485,7 +747,9 @@ record_full_arch_list_add_reg (struct regcache *regcache, int regnum)
 }
 
 /* Record the value of a region of memory whose address is ADDR and
-   length is LEN to record_full_arch_list.  */
+   length is LEN to record_full_arch_list.  If the previous entry of
+   the instruction records the memory right before ADDR, extend it
+   instead of adding a new entry.  */
 
 int
 record_full_arch_list_add_mem (CORE_ADDR addr, int len)
@@ -501,12 +765,30 @@ record_full_arch_list_add_mem (CORE_ADDR addr, int len)
   if (!addr)	/* FIXME: Why?  Some arch must permit it...  */
     return 0;
 
+  rec = record_full_arch_list_tail;
+  if (rec != NULL
+      && rec->type == record_full_mem
+      && rec->u.mem.addr + rec->u.mem.len == addr
+      && record_full_mem_extend (rec, len))
+    {
+      if (record_read_memory (target_gdbarch (), addr,
+			      record_full_get_loc (rec) + rec->u.mem.len - len,
+			      len))
+	{
+	  rec->u.mem.len -= len;
+	  record_full_truncate (rec);
+	  return -1;
+	}
+
+      return 0;
+    }
+
   rec = record_full_mem_alloc (addr, len);
 
   if (record_read_memory (target_gdbarch (), addr,
 			  record_full_get_loc (rec), len))
     {
-      record_full_mem_release (rec);
+      record_full_truncate (record_full_arch_list_last ());
       return -1;
     }
 
@@ -556,7 +838,7 @@ record_full_check_insn_num (void)
 static void
 record_full_arch_list_cleanups (void *ignore)
 {
-  record_full_list_release (record_full_arch_list_tail);
+  record_full_arch_list_release ();
 }
 
 /* Before inferior step (when GDB record the running message, inferior
@@ -573,8 +855,7 @@ record_full_message (struct regcache *regcache, enum gdb_signal signal)
   struct cleanup *old_cleanups
     = make_cleanup (record_full_arch_list_cleanups, 0);
 
-  record_full_arch_list_head = NULL;
-  record_full_arch_list_tail = NULL;
+  record_full_arch_list_release ();
 
   /* Check record_full_insn_num.  */
   record_full_check_insn_num ();
@@ -625,9 +906,7 @@ record_full_message (struct regcache *regcache, enum gdb_signal signal)
 
   discard_cleanups (old_cleanups);
 
-  record_full_list->next = record_full_arch_list_head;
-  record_full_arch_list_head->prev = record_full_list;
-  record_full_list = record_full_arch_list_tail;
+  record_full_arch_list_commit ();
 
   if (record_full_insn_num == record_full_insn_max_num)
     record_full_list_release_first ();
@@ -834,10 +1113,9 @@ record_full_open (const char *name, int from_tty)
   record_preopen ();
 
   /* Reset */
-  record_full_insn_num = 0;
+  record_full_list_release ();
   record_full_insn_count = 0;
   record_full_list = &record_full_first;
-  record_full_list->next = NULL;
 
   if (core_bfd)
     record_full_core_open_1 (name, from_tty);
@@ -864,7 +1142,7 @@ record_full_close (struct target_ops *self)
   if (record_debug)
     fprintf_unfiltered (gdb_stdlog, "Process record: record_full_close\n");
 
-  record_full_list_release (record_full_list);
+  record_full_list_release ();
 
   /* Release record_full_core_regbuf.  */
   if (record_full_core_regbuf)
@@ -1006,11 +1284,11 @@ record_full_wait_cleanups (void *ignore)
 {
   if (execution_direction == EXEC_REVERSE)
     {
-      if (record_full_list->next)
-	record_full_list = record_full_list->next;
+      if (record_full_entry_next (record_full_list) != NULL)
+	record_full_list = record_full_entry_next (record_full_list);
     }
   else
-    record_full_list = record_full_list->prev;
+    record_full_list = record_full_entry_prev (record_full_list);
 }
 
 /* "to_wait" target method for process record target.
@@ -1202,8 +1480,9 @@ record_full_wait_1 (struct target_ops *ops,
 
       /* In EXEC_FORWARD mode, record_full_list points to the tail of prev
          instruction.  */
-      if (execution_direction == EXEC_FORWARD && record_full_list->next)
-	record_full_list = record_full_list->next;
+      if (execution_direction == EXEC_FORWARD
+	  && record_full_entry_next (record_full_list) != NULL)
+	record_full_list = record_full_entry_next (record_full_list);
 
       /* Loop over the record_full_list, looking for the next place to
 	 stop.  */
@@ -1217,7 +1496,8 @@ record_full_wait_1 (struct target_ops *ops,
 	      status->kind = TARGET_WAITKIND_NO_HISTORY;
 	      break;
 	    }
-	  if (execution_direction != EXEC_REVERSE && !record_full_list->next)
+	  if (execution_direction != EXEC_REVERSE
+	      && record_full_entry_next (record_full_list) == NULL)
 	    {
 	      /* Hit end of record log going forward.  */
 	      status->kind = TARGET_WAITKIND_NO_HISTORY;
@@ -1286,16 +1566,14 @@ record_full_wait_1 (struct target_ops *ops,
 
 	  if (continue_flag)
 	    {
+	      struct record_full_entry *p;
+
 	      if (execution_direction == EXEC_REVERSE)
-		{
-		  if (record_full_list->prev)
-		    record_full_list = record_full_list->prev;
-		}
+		p = record_full_entry_prev (record_full_list);
 	      else
-		{
-		  if (record_full_list->next)
-		    record_full_list = record_full_list->next;
-		}
+		p = record_full_entry_next (record_full_list);
+	      if (p != NULL)
+		record_full_list = p;
 	    }
 	}
       while (continue_flag);
@@ -1395,8 +1673,7 @@ record_full_registers_change (struct regcache *regcache, int regnum)
   /* Check record_full_insn_num.  */
   record_full_check_insn_num ();
 
-  record_full_arch_list_head = NULL;
-  record_full_arch_list_tail = NULL;
+  record_full_arch_list_release ();
 
   if (regnum < 0)
     {
@@ -1406,7 +1683,7 @@ record_full_registers_change (struct regcache *regcache, int regnum)
 	{
 	  if (record_full_arch_list_add_reg (regcache, i))
 	    {
-	      record_full_list_release (record_full_arch_list_tail);
+	      record_full_arch_list_release ();
 	      error (_("Process record: failed to record execution log."));
 	    }
 	}
@@ -1415,18 +1692,16 @@ record_full_registers_change (struct regcache *regcache, int regnum)
     {
       if (record_full_arch_list_add_reg (regcache, regnum))
 	{
-	  record_full_list_release (record_full_arch_list_tail);
+	  record_full_arch_list_release ();
 	  error (_("Process record: failed to record execution log."));
 	}
     }
   if (record_full_arch_list_add_end ())
     {
-      record_full_list_release (record_full_arch_list_tail);
+      record_full_arch_list_release ();
       error (_("Process record: failed to record execution log."));
     }
-  record_full_list->next = record_full_arch_list_head;
-  record_full_arch_list_head->prev = record_full_list;
-  record_full_list = record_full_arch_list_tail;
+  record_full_arch_list_commit ();
 
   if (record_full_insn_num == record_full_insn_max_num)
     record_full_list_release_first ();
@@ -1522,11 +1797,10 @@ record_full_xfer_partial (struct target_ops *ops, enum target_object object,
       record_full_check_insn_num ();
 
       /* Record registers change to list as an instruction.  */
-      record_full_arch_list_head = NULL;
-      record_full_arch_list_tail = NULL;
+      record_full_arch_list_release ();
       if (record_full_arch_list_add_mem (offset, len))
 	{
-	  record_full_list_release (record_full_arch_list_tail);
+	  record_full_arch_list_release ();
 	  if (record_debug)
 	    fprintf_unfiltered (gdb_stdlog,
 				"Process record: failed to record "
@@ -1535,16 +1809,14 @@ record_full_xfer_partial (struct target_ops *ops, enum target_object object,
 	}
       if (record_full_arch_list_add_end ())
 	{
-	  record_full_list_release (record_full_arch_list_tail);
+	  record_full_arch_list_release ();
 	  if (record_debug)
 	    fprintf_unfiltered (gdb_stdlog,
 				"Process record: failed to record "
 				"execution log.");
 	  return TARGET_XFER_E_IO;
 	}
-      record_full_list->next = record_full_arch_list_head;
-      record_full_arch_list_head->prev = record_full_list;
-      record_full_list = record_full_arch_list_tail;
+      record_full_arch_list_commit ();
 
       if (record_full_insn_num == record_full_insn_max_num)
 	record_full_list_release_first ();
@@ -1799,9 +2071,9 @@ record_full_info (struct target_ops *self)
     printf_filtered (_("Record mode:\n"));
 
   /* Find entry for first actual instruction in the log.  */
-  for (p = record_full_first.next;
+  for (p = record_full_log_head;
        p != NULL && p->type != record_full_end;
-       p = p->next)
+       p = record_full_entry_next (p))
     ;
 
   /* Do we have a log at all?  */
@@ -1895,7 +2167,7 @@ record_full_goto_begin (struct target_ops *self)
 {
   struct record_full_entry *p = NULL;
 
-  for (p = &record_full_first; p != NULL; p = p->next)
+  for (p = &record_full_first; p != NULL; p = record_full_entry_next (p))
     if (p->type == record_full_end)
       break;
 
@@ -1909,9 +2181,7 @@ record_full_goto_end (struct target_ops *self)
 {
   struct record_full_entry *p = NULL;
 
-  for (p = record_full_list; p->next != NULL; p = p->next)
-    ;
-  for (; p!= NULL; p = p->prev)
+  for (p = record_full_log_tail; p != NULL; p = record_full_entry_prev (p))
     if (p->type == record_full_end)
       break;
 
@@ -1925,7 +2195,7 @@ record_full_goto (struct target_ops *self, ULONGEST target_insn)
 {
   struct record_full_entry *p = NULL;
 
-  for (p = &record_full_first; p != NULL; p = p->next)
+  for (p = &record_full_first; p != NULL; p = record_full_entry_next (p))
     if (p->type == record_full_end && p->u.end.insn_num == target_insn)
       break;
 
@@ -2334,7 +2604,7 @@ record_full_restore (void)
     return;
 
   /* "record_full_restore" can only be called when record list is empty.  */
-  gdb_assert (record_full_first.next == NULL);
+  gdb_assert (record_full_log_head == NULL);
  
   if (record_debug)
     fprintf_unfiltered (gdb_stdlog, "Restoring recording from core file.\n");
@@ -2363,8 +2633,7 @@ record_full_restore (void)
 
   /* Restore the entries in recfd into record_full_arch_list_head and
      record_full_arch_list_tail.  */
-  record_full_arch_list_head = NULL;
-  record_full_arch_list_tail = NULL;
+  record_full_arch_list_release ();
   record_full_insn_num = 0;
   old_cleanups = make_cleanup (record_full_arch_list_cleanups, 0);
   regcache = get_current_regcache ();
@@ -2470,9 +2739,8 @@ record_full_restore (void)
   discard_cleanups (old_cleanups);
 
   /* Add record_full_arch_list_head to the end of record list.  */
-  record_full_first.next = record_full_arch_list_head;
-  record_full_arch_list_head->prev = &record_full_first;
-  record_full_arch_list_tail->next = NULL;
+  if (record_full_arch_list_head != NULL)
+    record_full_arch_list_commit ();
   record_full_list = &record_full_first;
 
   /* Update record_full_insn_max_num.  */
@@ -2560,14 +2828,14 @@ record_full_save (struct target_ops *self, const char *recfilename)
 
       record_full_exec_insn (regcache, gdbarch, record_full_list);
 
-      if (record_full_list->prev)
-        record_full_list = record_full_list->prev;
+      if (record_full_entry_prev (record_full_list) != NULL)
+        record_full_list = record_full_entry_prev (record_full_list);
     }
 
   /* Compute the size needed for the extra bfd section.  */
   save_size = 4;	/* magic cookie */
-  for (record_full_list = record_full_first.next; record_full_list;
-       record_full_list = record_full_list->next)
+  for (record_full_list = record_full_log_head; record_full_list;
+       record_full_list = record_full_entry_next (record_full_list))
     switch (record_full_list->type)
       {
       case record_full_end:
@@ -2694,8 +2962,8 @@ record_full_save (struct target_ops *self, const char *recfilename)
       /* Execute entry.  */
       record_full_exec_insn (regcache, gdbarch, record_full_list);
 
-      if (record_full_list->next)
-        record_full_list = record_full_list->next;
+      if (record_full_entry_next (record_full_list) != NULL)
+        record_full_list = record_full_entry_next (record_full_list);
       else
         break;
     }
@@ -2709,8 +2977,8 @@ record_full_save (struct target_ops *self, const char *recfilename)
 
       record_full_exec_insn (regcache, gdbarch, record_full_list);
 
-      if (record_full_list->prev)
-        record_full_list = record_full_list->prev;
+      if (record_full_entry_prev (record_full_list) != NULL)
+        record_full_list = record_full_entry_prev (record_full_list);
     }
 
   unlink_file.keep ();
@@ -2737,18 +3005,135 @@ record_full_goto_insn (struct record_full_entry *entry,
      and we will not hit the end of the recording.  */
 
   if (dir == EXEC_FORWARD)
-    record_full_list = record_full_list->next;
+    record_full_list = record_full_entry_next (record_full_list);
 
   do
     {
       record_full_exec_insn (regcache, gdbarch, record_full_list);
       if (dir == EXEC_REVERSE)
-	record_full_list = record_full_list->prev;
+	record_full_list = record_full_entry_prev (record_full_list);
       else
-	record_full_list = record_full_list->next;
+	record_full_list = record_full_entry_next (record_full_list);
     } while (record_full_list != entry);
 }
 
+#if GDB_SELF_TEST
+
+namespace selftests {
+
+/* Unit test of the execution log: walking it in both directions
+   across chunks, and freeing entries at both of its ends.  */
+
+static void
+record_full_log_test ()
+{
+  /* Enough instructions to fill a few chunks.  */
+  const int count = 3 * RECORD_FULL_CHUNK_SIZE / 32;
+  struct record_full_entry *rec;
+  int i;
+
+  /* The test builds its own log; don't clobber one in use.  */
+  if (record_full_log_head != NULL || record_full_list != &record_full_first)
+    return;
+
+  for (i = 1; i <= count; i++)
+    {
+      /* One instruction has a value larger than a chunk.  */
+      int len = i == count / 2 ? RECORD_FULL_CHUNK_SIZE + 1 : i % 16 + 1;
+
+      record_full_arch_list_release ();
+      rec = record_full_mem_alloc (i, len);
+      memset (record_full_get_loc (rec), i & 0xff, len);
+      record_full_arch_list_add (rec);
+      rec = record_full_end_alloc ();
+      rec->u.end.insn_num = i;
+      record_full_arch_list_add (rec);
+      record_full_arch_list_commit ();
+    }
+  record_full_insn_num = count;
+  record_full_insn_count = count;
+  SELF_CHECK (record_full_list == record_full_log_tail);
+  SELF_CHECK (record_full_chunk_head != record_full_chunk_tail);
+
+  /* Walk forward.  */
+  rec = record_full_entry_next (&record_full_first);
+  for (i = 1; i <= count; i++)
+    {
+      SELF_CHECK (rec->type == record_full_mem);
+      SELF_CHECK (rec->u.mem.addr == i);
+      SELF_CHECK (record_full_get_loc (rec)[rec->u.mem.len - 1] == (i & 0xff));
+      rec = record_full_entry_next (rec);
+      SELF_CHECK (rec->type == record_full_end);
+      SELF_CHECK (rec->u.end.insn_num == i);
+      rec = record_full_entry_next (rec);
+    }
+  SELF_CHECK (rec == NULL);
+
+  /* Walk backward.  */
+  rec = record_full_log_tail;
+  for (i = count; i >= 1; i--)
+    {
+      SELF_CHECK (rec->type == record_full_end);
+      SELF_CHECK (rec->u.end.insn_num == i);
+      rec = record_full_entry_prev (rec);
+      SELF_CHECK (rec->type == record_full_mem);
+      SELF_CHECK (rec->u.mem.addr == i);
+      rec = record_full_entry_prev (rec);
+    }
+  SELF_CHECK (rec == &record_full_first);
+
+  /* Free instructions at the start of the log, until its first chunk
+     has been freed.  */
+  struct record_full_chunk *first_chunk = record_full_chunk_head;
+  for (i = 1; record_full_chunk_head == first_chunk; i++)
+    record_full_list_release_first ();
+  SELF_CHECK (record_full_log_head->u.mem.addr == i);
+  SELF_CHECK (record_full_entry_prev (record_full_log_head)
+	      == &record_full_first);
+
+  /* Free the last two instructions.  */
+  rec = record_full_log_tail;
+  for (i = 0; i < 4; i++)
+    rec = record_full_entry_prev (rec);
+  record_full_list_release_following (rec);
+  SELF_CHECK (record_full_insn_num == count - 2);
+  SELF_CHECK (record_full_log_tail == rec);
+  SELF_CHECK (record_full_entry_next (rec) == NULL);
+  SELF_CHECK (rec->u.end.insn_num == count - 2);
+
+  /* An instruction can be added after that.  */
+  record_full_list = rec;
+  record_full_arch_list_release ();
+  rec = record_full_end_alloc ();
+  rec->u.end.insn_num = count + 1;
+  record_full_arch_list_add (rec);
+  record_full_arch_list_commit ();
+  rec = record_full_entry_prev (record_full_log_tail);
+  SELF_CHECK (rec->u.end.insn_num == count - 2);
+
+  /* The last memory entry can be extended, but not once it is followed
+     by another entry.  */
+  record_full_arch_list_release ();
+  rec = record_full_mem_alloc (0x1000, 4);
+  record_full_arch_list_add (rec);
+  SELF_CHECK (record_full_mem_extend (rec, 8));
+  SELF_CHECK (rec->u.mem.len == 12);
+  record_full_arch_list_add (record_full_end_alloc ());
+  SELF_CHECK (!record_full_mem_extend (rec, 8));
+  record_full_arch_list_commit ();
+  SELF_CHECK (record_full_entry_next (rec) == record_full_log_tail);
+  SELF_CHECK (record_full_entry_prev (record_full_log_tail) == rec);
+
+  record_full_list_release ();
+  record_full_insn_count = 0;
+  record_full_list = &record_full_first;
+  SELF_CHECK (record_full_chunk_head == NULL);
+  SELF_CHECK (record_full_entry_next (&record_full_first) == NULL);
+}
+
+} // namespace selftests
+#endif /* GDB_SELF_TEST */
+
 /* Alias for "target record-full".  */
 
 static void
@@ -2797,8 +3182,6 @@ _initialize_record_full (void)
   struct cmd_list_element *c;
 
   /* Init record_full_first.  */
-  record_full_first.prev = NULL;
-  record_full_first.next = NULL;
   record_full_first.type = record_full_end;
 
   init_record_full_ops ();
@@ -2889,4 +3272,9 @@ When ON, query if PREC cannot record memory change of next instruction."),
   c = add_alias_cmd ("memory-query", "full memory-query", no_class, 1,
 		     &show_record_cmdlist);
   deprecate_cmd (c, "show record full memory-query");
+
+#if GDB_SELF_TEST
+  selftests::register_test ("record_full_log",
+			    selftests::record_full_log_test);
+#endif
 }
@@ -401,19 +401,22 @@ regcache::assert_regnum (int regnum) const
    recording if the register values have been changed (eg. by the
    user).  Therefore all registers must be written back to the
    target when appropriate.  */
-std::forward_list<regcache *> regcache::current_regcache;
+std::unordered_multimap<ptid_t, regcache *, hash_ptid>
+  regcache::current_regcache;
 
 struct regcache *
 get_thread_arch_aspace_regcache (ptid_t ptid, struct gdbarch *gdbarch,
 				 struct address_space *aspace)
 {
-  for (const auto &regcache : regcache::current_regcache)
-    if (ptid_equal (regcache->ptid (), ptid) && regcache->arch () == gdbarch)
-      return regcache;
+  auto range = regcache::current_regcache.equal_range (ptid);
+
+  for (auto it = range.first; it != range.second; ++it)
+    if (it->second->arch () == gdbarch)
+      return it->second;
 
   regcache *new_regcache = new regcache (gdbarch, aspace, false);
 
-  regcache::current_regcache.push_front (new_regcache);
+  regcache::current_regcache.emplace (ptid, new_regcache);
   new_regcache->set_ptid (ptid);
 
   return new_regcache;
@@ -469,10 +472,17 @@ regcache_observer_target_changed (struct target_ops *target)
 void
 regcache::regcache_thread_ptid_changed (ptid_t old_ptid, ptid_t new_ptid)
 {
-  for (auto &regcache : regcache::current_regcache)
+  auto range = regcache::current_regcache.equal_range (old_ptid);
+  std::vector<regcache *> moved;
+
+  for (auto it = range.first; it != range.second; ++it)
+    moved.push_back (it->second);
+  regcache::current_regcache.erase (range.first, range.second);
+
+  for (regcache *regcache : moved)
     {
-      if (ptid_equal (regcache->ptid (), old_ptid))
-	regcache->set_ptid (new_ptid);
+      regcache->set_ptid (new_ptid);
+      regcache::current_regcache.emplace (new_ptid, regcache);
     }
 }
 
@@ -490,18 +500,30 @@ regcache::regcache_thread_ptid_changed (ptid_t old_ptid, ptid_t new_ptid)
 void
 registers_changed_ptid (ptid_t ptid)
 {
-  for (auto oit = regcache::current_regcache.before_begin (),
-	 it = std::next (oit);
-       it != regcache::current_regcache.end ();
-       )
+  if (ptid == minus_one_ptid || ptid.is_pid ())
     {
-      if (ptid_match ((*it)->ptid (), ptid))
+      /* This matches several ptids, we have to look at all the
+	 regcaches.  */
+      for (auto it = regcache::current_regcache.begin ();
+	   it != regcache::current_regcache.end ();
+	   )
 	{
-	  delete *it;
-	  it = regcache::current_regcache.erase_after (oit);
+	  if (ptid_match (it->first, ptid))
+	    {
+	      delete it->second;
+	      it = regcache::current_regcache.erase (it);
+	    }
+	  else
+	    ++it;
 	}
-      else
-	oit = it++;
+    }
+  else
+    {
+      auto range = regcache::current_regcache.equal_range (ptid);
+
+      for (auto it = range.first; it != range.second; ++it)
+	delete it->second;
+      regcache::current_regcache.erase (range.first, range.second);
     }
 
   if (ptid_match (current_thread_ptid, ptid))
@@ -1621,8 +1643,7 @@ public:
   static size_t
   current_regcache_size ()
   {
-    return std::distance (regcache::current_regcache.begin (),
-			  regcache::current_regcache.end ());
+    return regcache::current_regcache.size ();
   }
 };
 
@@ -21,7 +21,7 @@
 #define REGCACHE_H
 
 #include "common-regcache.h"
-#include <forward_list>
+#include <unordered_map>
 
 struct regcache;
 struct regset;
@@ -342,7 +342,10 @@ protected:
 
   int num_raw_registers () const;
 
-  static std::forward_list<regcache *> current_regcache;
+  /* The regcaches of the threads, keyed by ptid.  A thread can have
+     one per architecture.  */
+  static std::unordered_multimap<ptid_t, regcache *, hash_ptid>
+    current_regcache;
 
 private:
   gdb_byte *register_buffer (int regnum) const;
@@ -563,6 +563,67 @@ trace_error (char *buf)
     }
 }
 
+/* Handle the qRelocInsn request BUF, which the stub sends while it
+   waits for the reply to a packet, e.g., while building a jump pad.
+   The reply is sent back to the stub.  */
+
+static void
+remote_relocate_insn_request (char *buf)
+{
+  struct remote_state *rs = get_remote_state ();
+  ULONGEST ul;
+  CORE_ADDR from, to, org_to;
+  const char *p, *pp;
+  int adjusted_size = 0;
+  int relocated = 0;
+
+  p = buf + strlen ("qRelocInsn:");
+  pp = unpack_varlen_hex (p, &ul);
+  if (*pp != ';')
+    error (_("invalid qRelocInsn packet: %s"), buf);
+  from = ul;
+
+  p = pp + 1;
+  unpack_varlen_hex (p, &ul);
+  to = ul;
+
+  org_to = to;
+
+  TRY
+    {
+      gdbarch_relocate_instruction (target_gdbarch (), &to, from);
+      relocated = 1;
+    }
+  CATCH (ex, RETURN_MASK_ALL)
+    {
+      if (ex.error == MEMORY_ERROR)
+	{
+	  /* Propagate memory errors silently back to the
+	     target.  The stub may have limited the range of
+	     addresses we can write to, for example.  */
+	}
+      else
+	{
+	  /* Something unexpectedly bad happened.  Be verbose
+	     so we can tell what, and propagate the error back
+	     to the stub, so it doesn't get stuck waiting for
+	     a response.  */
+	  exception_fprintf (gdb_stderr, ex,
+			     _("warning: relocating instruction: "));
+	}
+      putpkt ("E01");
+    }
+  END_CATCH
+
+  if (relocated)
+    {
+      adjusted_size = to - org_to;
+
+      xsnprintf (rs->buf, rs->buf_size, "qRelocInsn:%x", adjusted_size);
+      putpkt (rs->buf);
+    }
+}
+
 /* Utility: wait for reply from stub, while accepting "O" packets.  */
 
 static char *
@@ -580,59 +641,7 @@ remote_get_noisy_reply ()
       if (buf[0] == 'E')
 	trace_error (buf);
       else if (startswith (buf, "qRelocInsn:"))
-	{
-	  ULONGEST ul;
-	  CORE_ADDR from, to, org_to;
-	  const char *p, *pp;
-	  int adjusted_size = 0;
-	  int relocated = 0;
-
-	  p = buf + strlen ("qRelocInsn:");
-	  pp = unpack_varlen_hex (p, &ul);
-	  if (*pp != ';')
-	    error (_("invalid qRelocInsn packet: %s"), buf);
-	  from = ul;
-
-	  p = pp + 1;
-	  unpack_varlen_hex (p, &ul);
-	  to = ul;
-
-	  org_to = to;
-
-	  TRY
-	    {
-	      gdbarch_relocate_instruction (target_gdbarch (), &to, from);
-	      relocated = 1;
-	    }
-	  CATCH (ex, RETURN_MASK_ALL)
-	    {
-	      if (ex.error == MEMORY_ERROR)
-		{
-		  /* Propagate memory errors silently back to the
-		     target.  The stub may have limited the range of
-		     addresses we can write to, for example.  */
-		}
-	      else
-		{
-		  /* Something unexpectedly bad happened.  Be verbose
-		     so we can tell what, and propagate the error back
-		     to the stub, so it doesn't get stuck waiting for
-		     a response.  */
-		  exception_fprintf (gdb_stderr, ex,
-				     _("warning: relocating instruction: "));
-		}
-	      putpkt ("E01");
-	    }
-	  END_CATCH
-
-	  if (relocated)
-	    {
-	      adjusted_size = to - org_to;
-
-	      xsnprintf (buf, rs->buf_size, "qRelocInsn:%x", adjusted_size);
-	      putpkt (buf);
-	    }
-	}
+	remote_relocate_insn_request (buf);
       else if (buf[0] == 'O' && buf[1] != 'K')
 	remote_console_output (buf + 1);	/* 'O' message from stub */
       else
@@ -1436,6 +1445,10 @@ enum {
   /* Support for target-side breakpoint commands.  */
   PACKET_BreakpointCommands,
 
+  /* Support for evaluating target-side breakpoint conditions in jump
+     pads.  */
+  PACKET_BreakpointJumpPads,
+
   /* Support for fast tracepoints.  */
   PACKET_FastTracepoints,
 
@@ -1515,6 +1528,9 @@ enum {
   /* Support TARGET_WAITKIND_NO_RESUMED.  */
   PACKET_no_resumed,
 
+  /* Support for reading several memory regions at once.  */
+  PACKET_qMultiMemRead,
+
   PACKET_MAX
 };
 
@@ -4596,6 +4612,8 @@ static const struct protocol_feature remote_protocol_features[] = {
     PACKET_ConditionalBreakpoints },
   { "BreakpointCommands", PACKET_DISABLE, remote_supported_packet,
     PACKET_BreakpointCommands },
+  { "BreakpointJumpPads", PACKET_DISABLE, remote_supported_packet,
+    PACKET_BreakpointJumpPads },
   { "FastTracepoints", PACKET_DISABLE, remote_supported_packet,
     PACKET_FastTracepoints },
   { "StaticTracepoints", PACKET_DISABLE, remote_supported_packet,
@@ -4646,6 +4664,8 @@ static const struct protocol_feature remote_protocol_features[] = {
   { "vContSupported", PACKET_DISABLE, remote_supported_packet, PACKET_vContSupported },
   { "QThreadEvents", PACKET_DISABLE, remote_supported_packet, PACKET_QThreadEvents },
   { "no-resumed", PACKET_DISABLE, remote_supported_packet, PACKET_no_resumed },
+  { "qMultiMemRead", PACKET_DISABLE, remote_supported_packet,
+    PACKET_qMultiMemRead },
 };
 
 static char *remote_support_xml;
@@ -8411,6 +8431,102 @@ remote_read_bytes (struct target_ops *ops, CORE_ADDR memaddr,
   return remote_read_bytes_1 (memaddr, myaddr, len, unit_size, xfered_len);
 }
 
+/* Implementation of to_read_memory_multiple.  Read as many of the
+   regions as fit in each qMultiMemRead packet and its reply.
+
+   The request looks like "qMultiMemRead:ADDR,LENGTH;ADDR,LENGTH...",
+   and the reply like "XFERED,XFERED...;DATA", where each XFERED is
+   the number of bytes read for a region, and DATA the contents read
+   for all the regions, in order, encoded as hex.  */
+
+static int
+remote_read_memory_multiple (struct target_ops *ops,
+			     struct memory_read_request *requests, int count)
+{
+  struct remote_state *rs = get_remote_state ();
+  long buf_size;
+  int done = 0;
+
+  if (packet_support (PACKET_qMultiMemRead) == PACKET_DISABLE
+      || !target_has_execution
+      || get_traceframe_number () != -1
+      || gdbarch_addressable_memory_unit_size (target_gdbarch ()) != 1)
+    return 0;
+
+  set_general_thread (inferior_ptid);
+
+  buf_size = get_memory_read_packet_size ();
+
+  while (done < count)
+    {
+      char *p = rs->buf;
+      long reply_size = 0;
+      int first = done;
+      int last;
+
+      strcpy (p, "qMultiMemRead:");
+      p += strlen (p);
+
+      /* Leave room in the request for the separator, the address and
+	 the length, and in the reply for the length and the data.  */
+      for (last = first; last < count; last++)
+	{
+	  const struct memory_read_request *req = &requests[last];
+	  long request_size = 1 + 2 * (sizeof (CORE_ADDR) * 2);
+	  long region_reply_size = 1 + sizeof (ULONGEST) * 2 + req->len * 2;
+
+	  if (req->len > buf_size
+	      || (p - rs->buf) + request_size >= get_remote_packet_size ()
+	      || reply_size + region_reply_size >= buf_size)
+	    break;
+
+	  if (last != first)
+	    *p++ = ';';
+	  p += hexnumstr (p, (ULONGEST) remote_address_masked (req->addr));
+	  *p++ = ',';
+	  p += hexnumstr (p, req->len);
+	  reply_size += region_reply_size;
+	}
+      *p = '\0';
+
+      /* The next region is too large to be read this way.  */
+      if (last == first)
+	break;
+
+      putpkt (rs->buf);
+      getpkt (&rs->buf, &rs->buf_size, 0);
+      if (packet_ok (rs->buf, &remote_protocol_packets[PACKET_qMultiMemRead])
+	  != PACKET_OK)
+	break;
+
+      /* Parse the lengths, then the data.  */
+      const char *data = strchr (rs->buf, ';');
+      if (data == NULL)
+	error (_("Invalid qMultiMemRead reply: %s"), rs->buf);
+      data++;
+
+      const char *q = rs->buf;
+      for (int i = first; i < last; i++)
+	{
+	  struct memory_read_request *req = &requests[i];
+	  ULONGEST xfered;
+
+	  q = unpack_varlen_hex (q, &xfered);
+	  if (xfered > req->len
+	      || *q != (i + 1 < last ? ',' : ';')
+	      || hex2bin (data, req->buf, xfered) != xfered)
+	    error (_("Invalid qMultiMemRead reply: %s"), rs->buf);
+	  q++;
+	  data += 2 * xfered;
+	  req->xfered = xfered;
+	}
+
+      done = last;
+    }
+
+  return done;
+}
+
 
 
 /* Sends a packet with content determined by the printf format string
@@ -9743,6 +9859,39 @@ remote_add_target_side_commands (struct gdbarch *gdbarch,
     }
 }
 
+/* Return the length of the instruction at the address of BP_TGT if
+   the stub may evaluate BP_TGT's conditions in a jump pad, instead of
+   trapping every time the breakpoint is reached, or 0 otherwise.  The
+   stub needs GDB to relocate the instruction to the jump pad, with
+   qRelocInsn, while handling the Z0 packet.  */
+
+static int
+remote_breakpoint_jump_pad_insn_length (struct target_ops *ops,
+					struct gdbarch *gdbarch,
+					struct bp_target_info *bp_tgt)
+{
+  int len = 0;
+
+  if (packet_support (PACKET_BreakpointJumpPads) != PACKET_ENABLE
+      || !remote_supports_cond_breakpoints (ops)
+      || bp_tgt->conditions.empty ()
+      || !bp_tgt->tcommands.empty ()
+      || !gdbarch_relocate_instruction_p (target_gdbarch ()))
+    return 0;
+
+  TRY
+    {
+      len = gdb_insn_length (gdbarch, bp_tgt->reqstd_address);
+    }
+  CATCH (ex, RETURN_MASK_ERROR)
+    {
+      len = 0;
+    }
+  END_CATCH
+
+  return len;
+}
+
 /* Insert a breakpoint.  On targets that have software breakpoint
    support, we ask the remote target to do the work; on targets
    which don't, we insert a traditional memory breakpoint.  */
@@ -9762,12 +9911,17 @@ remote_insert_breakpoint (struct target_ops *ops,
       CORE_ADDR addr = bp_tgt->reqstd_address;
       struct remote_state *rs;
       char *p, *endbuf;
+      int insn_len;
 
       /* Make sure the remote is pointing at the right process, if
 	 necessary.  */
       if (!gdbarch_has_global_breakpoints (target_gdbarch ()))
 	set_general_process ();
 
+      /* This may read memory, so do it before building the packet in
+	 RS->BUF.  */
+      insn_len = remote_breakpoint_jump_pad_insn_length (ops, gdbarch, bp_tgt);
+
       rs = get_remote_state ();
       p = rs->buf;
       endbuf = rs->buf + get_remote_packet_size ();
@@ -9782,12 +9936,26 @@ remote_insert_breakpoint (struct target_ops *ops,
       if (remote_supports_cond_breakpoints (ops))
 	remote_add_target_side_condition (gdbarch, bp_tgt, p, endbuf);
 
+      if (insn_len > 0)
+	{
+	  p += strlen (p);
+	  xsnprintf (p, endbuf - p, ";ilen:%x", insn_len);
+	}
+
       if (remote_can_run_breakpoint_commands (ops))
 	remote_add_target_side_commands (gdbarch, bp_tgt, p);
 
       putpkt (rs->buf);
       getpkt (&rs->buf, &rs->buf_size, 0);
 
+      /* The stub asks us to relocate the instruction at ADDR while
+	 building a jump pad for the breakpoint's conditions.  */
+      while (startswith (rs->buf, "qRelocInsn:"))
+	{
+	  remote_relocate_insn_request (rs->buf);
+	  getpkt (&rs->buf, &rs->buf_size, 0);
+	}
+
       switch (packet_ok (rs->buf, &remote_protocol_packets[PACKET_Z0]))
 	{
 	case PACKET_ERROR:
@@ -13563,6 +13731,7 @@ Specify the serial device it is connected to\n\
   remote_ops.to_pass_ctrlc = remote_pass_ctrlc;
   remote_ops.to_xfer_partial = remote_xfer_partial;
   remote_ops.to_get_memory_xfer_limit = remote_get_memory_xfer_limit;
+  remote_ops.to_read_memory_multiple = remote_read_memory_multiple;
   remote_ops.to_rcmd = remote_rcmd;
   remote_ops.to_pid_to_exec_file = remote_pid_to_exec_file;
   remote_ops.to_log_command = serial_log_command;
@@ -14271,6 +14440,10 @@ Show the maximum size of the address (in bits) in a memory packet."), NULL,
 			 "BreakpointCommands",
 			 "breakpoint-commands", 0);
 
+  add_packet_config_cmd (&remote_protocol_packets[PACKET_BreakpointJumpPads],
+			 "BreakpointJumpPads",
+			 "breakpoint-jump-pads", 0);
+
   add_packet_config_cmd (&remote_protocol_packets[PACKET_FastTracepoints],
 			 "FastTracepoints", "fast-tracepoints", 0);
 
@@ -14352,6 +14525,9 @@ Show the maximum size of the address (in bits) in a memory packet."), NULL,
   add_packet_config_cmd (&remote_protocol_packets[PACKET_no_resumed],
 			 "N stop reply", "no-resumed-stop-reply", 0);
 
+  add_packet_config_cmd (&remote_protocol_packets[PACKET_qMultiMemRead],
+			 "qMultiMemRead", "multi-memory-read", 0);
+
   /* Assert that we've registered "set remote foo-packet" commands
      for all packet configs.  */
   {
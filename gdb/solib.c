@@ -991,6 +991,7 @@ solib_add (const char *pattern, int from_tty, int readsyms)
   {
     int any_matches = 0;
     int loaded_any_symbols = 0;
+    std::vector<objfile *> new_objfiles;
     symfile_add_flags add_flags = SYMFILE_DEFER_BP_RESET;
 
     if (from_tty)
@@ -1019,12 +1020,18 @@ solib_add (const char *pattern, int from_tty, int readsyms)
 				       gdb->so_name);
 		}
 	      else if (solib_read_symbols (gdb, add_flags))
-		loaded_any_symbols = 1;
+		{
+		  loaded_any_symbols = 1;
+		  if (gdb->objfile != NULL)
+		    new_objfiles.push_back (gdb->objfile);
+		}
 	    }
 	}
 
+    /* Only the breakpoints that may have locations in the libraries
+       just read in need to be re-set.  */
     if (loaded_any_symbols)
-      breakpoint_re_set ();
+      breakpoint_re_set_objfiles (new_objfiles);
 
     if (from_tty && pattern && ! any_matches)
       printf_unfiltered
@@ -603,6 +603,13 @@ extern void dwarf2_get_section_info (struct objfile *,
 
 extern int dwarf2_initialize_objfile (struct objfile *);
 extern void dwarf2_build_psymtabs (struct objfile *);
+
+/* Write a .gdb_index-format index for OBJFILE, whose DWARF has been
+   read into partial symbol tables, to DIR/BASENAME.gdb-index.  Throws
+   an error on failure.  */
+
+extern void dwarf2_write_index (struct objfile *objfile, const char *dir,
+				const char *basename);
 extern void dwarf2_build_frame_info (struct objfile *);
 
 void dwarf2_free_objfile (struct objfile *);
@@ -721,11 +721,16 @@ create_demangled_names_hash (struct objfile *objfile)
    language of that symbol.  If the language is set to language_auto,
    it will attempt to find any demangling algorithm that works and
    then set the language appropriately.  The returned name is allocated
-   by the demangler and should be xfree'd.  */
+   by the demangler and should be xfree'd.
+
+   If CPLUS_DEMANGLED is not NULL, it holds the result of demangling
+   MANGLED as C++ (see gdb_sniff_from_mangled_name), which is used
+   (and released) instead of demangling MANGLED again.  */
 
 static char *
 symbol_find_demangled_name (struct general_symbol_info *gsymbol,
-			    const char *mangled)
+			    const char *mangled,
+			    gdb::unique_xmalloc_ptr<char> *cplus_demangled)
 {
   char *demangled = NULL;
   int i;
@@ -733,6 +738,9 @@ symbol_find_demangled_name (struct general_symbol_info *gsymbol,
   if (gsymbol->language == language_unknown)
     gsymbol->language = language_auto;
 
+  if (gsymbol->language == language_cplus && cplus_demangled != NULL)
+    return cplus_demangled->release ();
+
   if (gsymbol->language != language_auto)
     {
       const struct language_defn *lang = language_def (gsymbol->language);
@@ -746,6 +754,14 @@ symbol_find_demangled_name (struct general_symbol_info *gsymbol,
       enum language l = (enum language) i;
       const struct language_defn *lang = language_def (l);
 
+      if (l == language_cplus && cplus_demangled != NULL)
+	{
+	  if (*cplus_demangled == NULL)
+	    continue;
+	  gsymbol->language = l;
+	  return cplus_demangled->release ();
+	}
+
       if (language_sniff_from_mangled_name (lang, mangled, &demangled))
 	{
 	  gsymbol->language = l;
@@ -770,7 +786,8 @@ symbol_find_demangled_name (struct general_symbol_info *gsymbol,
 void
 symbol_set_names (struct general_symbol_info *gsymbol,
 		  const char *linkage_name, int len, int copy_name,
-		  struct objfile *objfile)
+		  struct objfile *objfile,
+		  gdb::unique_xmalloc_ptr<char> *cplus_demangled)
 {
   struct demangled_name_entry **slot;
   /* A 0-terminated copy of the linkage name.  */
@@ -827,7 +844,8 @@ symbol_set_names (struct general_symbol_info *gsymbol,
 	  && (*slot)->demangled[0] == '\0'))
     {
       char *demangled_name = symbol_find_demangled_name (gsymbol,
-							 linkage_name_copy);
+							 linkage_name_copy,
+							 cplus_demangled);
       int demangled_len = demangled_name ? strlen (demangled_name) : 0;
 
       /* Suppose we have demangled_name==NULL, copy_name==0, and
@@ -476,12 +476,16 @@ extern void symbol_set_language (struct general_symbol_info *symbol,
   (symbol)->ginfo.name = (linkage_name)
 
 /* Set the linkage and natural names of a symbol, by demangling
-   the linkage name.  */
+   the linkage name.  If CPLUS_DEMANGLED is not NULL, it holds the
+   result of gdb_demangle (LINKAGE_NAME, DMGL_PARAMS | DMGL_ANSI),
+   computed ahead of time; it is released if used.  */
 #define SYMBOL_SET_NAMES(symbol,linkage_name,len,copy_name,objfile)	\
   symbol_set_names (&(symbol)->ginfo, linkage_name, len, copy_name, objfile)
 extern void symbol_set_names (struct general_symbol_info *symbol,
 			      const char *linkage_name, int len, int copy_name,
-			      struct objfile *objfile);
+			      struct objfile *objfile,
+			      gdb::unique_xmalloc_ptr<char> *cplus_demangled
+				= NULL);
 
 /* Now come lots of name accessor macros.  Short version as to when to
    use which: Use SYMBOL_NATURAL_NAME to refer to the name of the
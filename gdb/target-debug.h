@@ -96,6 +96,8 @@
   target_debug_do_print (core_addr_to_string ((X)->placed_address))
 #define target_debug_print_struct_expression_p(X)	\
   target_debug_do_print (host_address_to_string (X))
+#define target_debug_print_struct_memory_read_request_p(X)	\
+  target_debug_do_print (host_address_to_string (X))
 #define target_debug_print_CORE_ADDR_p(X)	\
   target_debug_do_print (core_addr_to_string (*(X)))
 #define target_debug_print_int_p(X)		\
@@ -2146,6 +2146,37 @@ debug_get_memory_xfer_limit (struct target_ops *self)
   return result;
 }
 
+static int
+delegate_read_memory_multiple (struct target_ops *self, struct memory_read_request *arg1, int arg2)
+{
+  self = self->beneath;
+  return self->to_read_memory_multiple (self, arg1, arg2);
+}
+
+static int
+tdefault_read_memory_multiple (struct target_ops *self, struct memory_read_request *arg1, int arg2)
+{
+  return 0;
+}
+
+static int
+debug_read_memory_multiple (struct target_ops *self, struct memory_read_request *arg1, int arg2)
+{
+  int result;
+  fprintf_unfiltered (gdb_stdlog, "-> %s->to_read_memory_multiple (...)\n", debug_target.to_shortname);
+  result = debug_target.to_read_memory_multiple (&debug_target, arg1, arg2);
+  fprintf_unfiltered (gdb_stdlog, "<- %s->to_read_memory_multiple (", debug_target.to_shortname);
+  target_debug_print_struct_target_ops_p (&debug_target);
+  fputs_unfiltered (", ", gdb_stdlog);
+  target_debug_print_struct_memory_read_request_p (arg1);
+  fputs_unfiltered (", ", gdb_stdlog);
+  target_debug_print_int (arg2);
+  fputs_unfiltered (") = ", gdb_stdlog);
+  target_debug_print_int (result);
+  fputs_unfiltered ("\n", gdb_stdlog);
+  return result;
+}
+
 static std::vector<mem_region>
 delegate_memory_map (struct target_ops *self)
 {
@@ -4340,6 +4371,8 @@ install_delegators (struct target_ops *ops)
     ops->to_xfer_partial = delegate_xfer_partial;
   if (ops->to_get_memory_xfer_limit == NULL)
     ops->to_get_memory_xfer_limit = delegate_get_memory_xfer_limit;
+  if (ops->to_read_memory_multiple == NULL)
+    ops->to_read_memory_multiple = delegate_read_memory_multiple;
   if (ops->to_memory_map == NULL)
     ops->to_memory_map = delegate_memory_map;
   if (ops->to_flash_erase == NULL)
@@ -4576,6 +4609,7 @@ install_dummy_methods (struct target_ops *ops)
   ops->to_get_thread_local_address = tdefault_get_thread_local_address;
   ops->to_xfer_partial = tdefault_xfer_partial;
   ops->to_get_memory_xfer_limit = tdefault_get_memory_xfer_limit;
+  ops->to_read_memory_multiple = tdefault_read_memory_multiple;
   ops->to_memory_map = tdefault_memory_map;
   ops->to_flash_erase = tdefault_flash_erase;
   ops->to_flash_done = tdefault_flash_done;
@@ -4736,6 +4770,7 @@ init_debug_target (struct target_ops *ops)
   ops->to_get_thread_local_address = debug_get_thread_local_address;
   ops->to_xfer_partial = debug_xfer_partial;
   ops->to_get_memory_xfer_limit = debug_get_memory_xfer_limit;
+  ops->to_read_memory_multiple = debug_read_memory_multiple;
   ops->to_memory_map = debug_memory_map;
   ops->to_flash_erase = debug_flash_erase;
   ops->to_flash_done = debug_flash_done;
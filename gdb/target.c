@@ -1409,6 +1409,29 @@ target_read_raw_memory (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len)
     return -1;
 }
 
+/* See target.h.  */
+
+int
+target_read_raw_memory_multiple (struct memory_read_request *requests,
+				 int count)
+{
+  struct target_ops *t;
+
+  if (count == 0)
+    return 0;
+
+  /* The method reads from the target implementing it, skipping the
+     to_xfer_partial methods of the targets above it.  Those may supply
+     or restrict memory themselves, e.g. a record target replaying an
+     execution log, so leave the reads to them.  */
+  for (t = current_target.beneath; t != NULL; t = t->beneath)
+    if (t->to_stratum > process_stratum)
+      return 0;
+
+  return current_target.to_read_memory_multiple (&current_target,
+						 requests, count);
+}
+
 /* Like target_read_memory, but specify explicitly that this is a read from
    the target's stack.  This may trigger different cache behavior.  */
 
@@ -302,6 +302,21 @@ struct memory_read_result
 extern std::vector<memory_read_result> read_memory_robust
     (struct target_ops *ops, const ULONGEST offset, const LONGEST len);
 
+/* A region of memory to read with target_read_raw_memory_multiple.  */
+
+struct memory_read_request
+{
+  /* The address of the region.  */
+  CORE_ADDR addr;
+  /* The length of the region, in bytes.  */
+  ULONGEST len;
+  /* Where to store the contents of the region.  */
+  gdb_byte *buf;
+  /* Set to the number of bytes read.  This is less than LEN if the
+     region could not be read in full.  */
+  ULONGEST xfered;
+};
+
 /* Request that OPS transfer up to LEN addressable units from BUF to the
    target's OBJECT.  When writing to a memory object, the addressable unit
    size is architecture dependent and can be found using
@@ -760,6 +775,18 @@ struct target_ops
     ULONGEST (*to_get_memory_xfer_limit) (struct target_ops *)
       TARGET_DEFAULT_RETURN (ULONGEST_MAX);
 
+    /* Read raw memory for the COUNT regions described by REQUESTS,
+       several of them per request to the target.  Return the number
+       of leading regions that were read; the other ones should be
+       read one at a time, using to_xfer_partial.  Targets that can't
+       read several regions at once return zero.  See
+       target_read_raw_memory_multiple.  */
+
+    int (*to_read_memory_multiple) (struct target_ops *,
+				    struct memory_read_request *requests,
+				    int count)
+      TARGET_DEFAULT_RETURN (0);
+
     /* Returns the memory map for the target.  A return value of NULL
        means that no memory map is available.  If a memory address
        does not fall within any returned regions, it's assumed to be
@@ -1450,6 +1477,16 @@ extern int target_read_string (CORE_ADDR, char **, int, int *);
 extern int target_read_raw_memory (CORE_ADDR memaddr, gdb_byte *myaddr,
 				   ssize_t len);
 
+/* Read the COUNT regions of raw memory described by REQUESTS, with as
+   few requests to the target as it allows.  Return the number of
+   leading regions that were read, which is zero if the target can't
+   read several regions at once, or if a target above process_stratum
+   is pushed.  The caller should read the remaining regions some other
+   way, e.g. with target_read_raw_memory.  */
+
+extern int target_read_raw_memory_multiple
+  (struct memory_read_request *requests, int count);
+
 extern int target_read_stack (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len);
 
 extern int target_read_code (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len);
@@ -0,0 +1,44 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2017 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#define N_NODES 256
+
+/* Each node is 128 bytes long, so walking the list touches every
+   other line of a 64-byte line dcache.  */
+
+struct node
+{
+  struct node *next;
+  int value;
+  char pad[128 - sizeof (struct node *) - sizeof (int)];
+};
+
+struct node nodes[N_NODES];
+
+int
+main (void)
+{
+  int i;
+
+  for (i = 0; i < N_NODES; i++)
+    {
+      nodes[i].next = i + 1 < N_NODES ? &nodes[i + 1] : 0;
+      nodes[i].value = i;
+    }
+
+  return 0; /* break here */
+}
@@ -0,0 +1,55 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include <limits.h>
+#include <unistd.h>
+
+static void *
+thread_function (void *arg)
+{
+  while (1)
+    sleep (1);
+
+  return NULL;
+}
+
+int
+main (void)
+{
+  pthread_attr_t attr;
+  int i;
+
+  /* Don't run forever if the testsuite doesn't kill us.  */
+  alarm (600);
+
+  /* Keep the memory footprint low with many threads.  */
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr, PTHREAD_STACK_MIN * 2);
+
+  for (i = 0; i < NUM_THREADS; i++)
+    {
+      pthread_t thread;
+
+      pthread_create (&thread, &attr, thread_function, NULL);
+    }
+
+  while (1)
+    sleep (1);
+
+  return 0;
+}
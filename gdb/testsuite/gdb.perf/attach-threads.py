@@ -0,0 +1,41 @@
+# Copyright (C) 2017 Free Software Foundation, Inc.
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# This test case is to test the speed of GDB when it attaches to, and
+# detaches from, a process with many threads.
+
+from perftest import perftest
+
+class AttachThreads(perftest.TestCaseWithBasicMeasurements):
+    def __init__(self, pid, thread_count):
+        super (AttachThreads, self).__init__ ("attach-threads")
+        self.pid = pid
+        self.thread_count = thread_count
+
+    def _attach_detach(self):
+        gdb.execute("attach %d" % self.pid, False, True)
+        # Wait for all the threads to be started, the first time.
+        while len(gdb.selected_inferior().threads()) < self.thread_count:
+            gdb.execute("detach", False, True)
+            gdb.execute("attach %d" % self.pid, False, True)
+        gdb.execute("info threads", False, True)
+        gdb.execute("detach", False, True)
+
+    def warm_up(self):
+        self._attach_detach()
+
+    def execute_test(self):
+        for i in range(1, 5):
+            self.measure.measure(self._attach_detach, i)
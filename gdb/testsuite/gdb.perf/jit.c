@@ -0,0 +1,209 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Register and unregister many copies of JIT_IMAGE through the JIT
+   interface, as a JIT compiling one function after the other does.  */
+
+#include <elf.h>
+#include <link.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef enum
+{
+  JIT_NOACTION = 0,
+  JIT_REGISTER_FN,
+  JIT_UNREGISTER_FN
+} jit_actions_t;
+
+struct jit_code_entry
+{
+  struct jit_code_entry *next_entry;
+  struct jit_code_entry *prev_entry;
+  const char *symfile_addr;
+  uint64_t symfile_size;
+};
+
+struct jit_descriptor
+{
+  uint32_t version;
+  uint32_t action_flag;
+  struct jit_code_entry *relevant_entry;
+  struct jit_code_entry *first_entry;
+};
+
+/* GDB puts a breakpoint in this function.  */
+void __attribute__((noinline)) __jit_debug_register_code () { }
+
+struct jit_descriptor __jit_debug_descriptor = { 1, 0, 0, 0 };
+
+/* The file holding the image, its size, and the size of the memory
+   its allocated sections span once loaded.  Each copy is mapped with
+   the latter size, so that the sections of two copies never
+   overlap.  */
+static int image_fd = -1;
+static size_t image_size;
+static size_t image_span;
+
+/* The number of copies registered so far.  */
+static int registered;
+
+static void
+open_image (void)
+{
+  const ElfW (Ehdr) *ehdr;
+  const ElfW (Shdr) *shdr;
+  struct stat st;
+  void *addr;
+  int i;
+
+  image_fd = open (JIT_IMAGE, O_RDONLY);
+  if (image_fd == -1 || fstat (image_fd, &st) != 0)
+    {
+      printf ("ERROR opening %s\n", JIT_IMAGE);
+      exit (-1);
+    }
+  image_size = st.st_size;
+  image_span = image_size;
+
+  addr = mmap (0, image_size, PROT_READ, MAP_PRIVATE, image_fd, 0);
+  if (addr == MAP_FAILED)
+    {
+      printf ("ERROR on mmap\n");
+      exit (-1);
+    }
+
+  ehdr = (const ElfW (Ehdr) *) addr;
+  shdr = (const ElfW (Shdr) *) ((char *) addr + ehdr->e_shoff);
+  for (i = 0; i < ehdr->e_shnum; ++i)
+    if ((shdr[i].sh_flags & SHF_ALLOC) != 0
+	&& shdr[i].sh_addr + shdr[i].sh_size > image_span)
+      image_span = shdr[i].sh_addr + shdr[i].sh_size;
+
+  munmap (addr, image_size);
+}
+
+/* Update .p_vaddr, .sh_addr and the name of the function as if the
+   code was JITted to ADDR.  */
+
+static void
+update_locations (char *addr, int idx)
+{
+  ElfW (Ehdr) *const ehdr = (ElfW (Ehdr) *) addr;
+  ElfW (Shdr) *const shdr = (ElfW (Shdr) *) (addr + ehdr->e_shoff);
+  ElfW (Phdr) *const phdr = (ElfW (Phdr) *) (addr + ehdr->e_phoff);
+  int i;
+
+  for (i = 0; i < ehdr->e_phnum; ++i)
+    if (phdr[i].p_type == PT_LOAD)
+      phdr[i].p_vaddr += (ElfW (Addr)) addr;
+
+  for (i = 0; i < ehdr->e_shnum; ++i)
+    {
+      if (shdr[i].sh_type == SHT_STRTAB)
+	{
+	  char *const strtab = addr + shdr[i].sh_offset;
+	  char *const strtab_end = strtab + shdr[i].sh_size;
+	  char *p;
+
+	  for (p = strtab; p < strtab_end; p += strlen (p) + 1)
+	    if (strcmp (p, "jit_function_XXXX") == 0)
+	      sprintf (p, "jit_function_%04d", idx % 10000);
+	}
+
+      if (shdr[i].sh_flags & SHF_ALLOC)
+	shdr[i].sh_addr += (ElfW (Addr)) addr;
+    }
+}
+
+/* Register NUMBER more copies of the image.  */
+
+void
+do_test_register (int number)
+{
+  int i;
+
+  if (image_fd == -1)
+    open_image ();
+
+  for (i = 0; i < number; i++)
+    {
+      char *addr = mmap (0, image_span, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE, image_fd, 0);
+      struct jit_code_entry *entry = calloc (1, sizeof (*entry));
+
+      if (addr == MAP_FAILED || entry == NULL)
+	{
+	  printf ("ERROR on mmap or calloc\n");
+	  exit (-1);
+	}
+
+      update_locations (addr, registered++);
+
+      entry->symfile_addr = addr;
+      entry->symfile_size = image_size;
+      entry->prev_entry = __jit_debug_descriptor.relevant_entry;
+      __jit_debug_descriptor.relevant_entry = entry;
+
+      if (entry->prev_entry != NULL)
+	entry->prev_entry->next_entry = entry;
+      else
+	__jit_debug_descriptor.first_entry = entry;
+
+      __jit_debug_descriptor.action_flag = JIT_REGISTER_FN;
+      __jit_debug_register_code ();
+    }
+}
+
+/* Unregister the NUMBER copies registered last.  */
+
+void
+do_test_unregister (int number)
+{
+  int i;
+
+  for (i = 0; i < number && __jit_debug_descriptor.relevant_entry; i++)
+    {
+      struct jit_code_entry *entry = __jit_debug_descriptor.relevant_entry;
+      struct jit_code_entry *prev_entry = entry->prev_entry;
+
+      if (prev_entry != NULL)
+	prev_entry->next_entry = NULL;
+      else
+	__jit_debug_descriptor.first_entry = NULL;
+
+      __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
+      __jit_debug_register_code ();
+
+      __jit_debug_descriptor.relevant_entry = prev_entry;
+      munmap ((void *) entry->symfile_addr, image_span);
+      free (entry);
+      registered--;
+    }
+}
+
+int
+main (void)
+{
+  return 0;
+}
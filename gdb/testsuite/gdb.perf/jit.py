@@ -0,0 +1,83 @@
+# Copyright (C) 2017 Free Software Foundation, Inc.
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# This test case is to test the speed of GDB when the inferior
+# registers and unregisters code through the JIT interface.
+
+import time
+
+from perftest import perftest
+from perftest import measure
+
+# Wall time per registered object, keyed by the number of objects
+# registered at once.
+register_time_per_object = {}
+
+class JitRegisterUnregister1(perftest.TestCaseWithBasicMeasurements):
+    def __init__(self, jit_count, measure_register):
+        if measure_register:
+            name = "jit_register"
+        else:
+            name = "jit_unregister"
+        # We want to measure time in this test.
+        super (JitRegisterUnregister1, self).__init__ (name)
+        self.jit_count = jit_count
+        self.measure_register = measure_register
+
+    def warm_up(self):
+        gdb.execute("call do_test_register (%d)" % self.jit_count)
+        gdb.execute("call do_test_unregister (%d)" % self.jit_count)
+
+    def execute_test(self):
+        num = self.jit_count
+        iteration = 5;
+
+        while num > 0 and iteration > 0:
+            do_test_register = "call do_test_register (%d)" % num
+            do_test_unregister = "call do_test_unregister (%d)" % num
+
+            if self.measure_register:
+                def func():
+                    start = time.time()
+                    gdb.execute (do_test_register)
+                    register_time_per_object[num] = (time.time() - start) / num
+
+                self.measure.measure(func, num)
+                gdb.execute (do_test_unregister)
+            else:
+                gdb.execute (do_test_register)
+                func = lambda: gdb.execute (do_test_unregister)
+                self.measure.measure(func, num)
+
+            num = num // 2
+            iteration -= 1
+
+class JitRegisterUnregister(object):
+    def __init__(self, jit_count):
+        self.jit_count = jit_count;
+
+    def run(self):
+        JitRegisterUnregister1(self.jit_count, True).run()
+        JitRegisterUnregister1(self.jit_count, False).run()
+
+def jit_register_trend_ok():
+    """Return True if registering the largest batch of objects did not
+    cost much more per object than registering the smallest one.  Work
+    that grows with the number of objects already registered makes the
+    time per object grow with the batch size."""
+    smallest = min(register_time_per_object)
+    largest = max(register_time_per_object)
+    return (register_time_per_object[largest]
+            <= 4 * register_time_per_object[smallest])
@@ -0,0 +1,50 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2017 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <stddef.h>
+
+#define ITERATIONS 10000
+
+volatile int counter;
+
+/* Set by the .exp file to the address of the breakpoint.  Halfway
+   through the loop, while the breakpoint is inserted, the program
+   saves the byte there, which shows how the breakpoint was
+   inserted.  */
+volatile unsigned char *volatile bp_addr;
+volatile unsigned char insn_byte;
+
+static void
+end (void)
+{
+}
+
+int
+main (void)
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      counter += i;	/* set breakpoint here */
+      if (i == ITERATIONS / 2 && bp_addr != NULL)
+	insn_byte = *bp_addr;
+    }
+
+  end ();
+  return 0;
+}
@@ -0,0 +1,103 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2017 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "trace-common.h"
+
+/* Enough iterations for the traceframes to wrap around the trace
+   ring at least once.  */
+#ifndef ITERATIONS
+#define ITERATIONS 220000
+#endif
+
+/* The file descriptor of the in-process agent's trace ring, or -1.
+   Weak, so that the program also links without the agent.  */
+extern int gdb_agent_trace_ring_fd __attribute__ ((weak));
+
+/* The control block at the start of the trace ring.  See
+   gdbserver/tracepoint.c.  */
+
+struct trace_ring_control
+{
+  uint32_t head;
+  uint32_t tail;
+  uint32_t size;
+  uint32_t data_offset;
+  uint32_t notify_pending;
+};
+
+/* Set by the .exp file to have the program corrupt the trace ring
+   after collecting a few traceframes.  */
+volatile int corrupt;
+
+/* Non-zero if the agent collects into a trace ring.  */
+int ring_available;
+
+volatile int counter;
+
+static void
+corrupt_ring (void)
+{
+  struct trace_ring_control *ctrl;
+  unsigned char *map, *frame;
+  size_t map_size = 2 * sysconf (_SC_PAGE_SIZE);
+  uint32_t data_size = 0x7fffffff;
+
+  map = (unsigned char *) mmap (NULL, map_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, gdb_agent_trace_ring_fd, 0);
+  if (map == MAP_FAILED)
+    return;
+
+  /* The data area follows the control page.  GDBserver hasn't read
+     any traceframe yet, so the first one is at its start.  Make its
+     data larger than the ring.  Traceframe headers are a 16-bit
+     tracepoint number followed by a 32-bit data size.  */
+  ctrl = (struct trace_ring_control *) map;
+  frame = map + ctrl->data_offset;
+  memcpy (frame + 2, &data_size, sizeof (data_size));
+  munmap (map, map_size);
+}
+
+static void
+end (void)
+{
+}
+
+int
+main (void)
+{
+  int i;
+
+  ring_available = (&gdb_agent_trace_ring_fd != NULL
+		    && gdb_agent_trace_ring_fd != -1);
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      counter = i;
+      FAST_TRACEPOINT_LABEL (set_point);
+
+      if (corrupt && i == 10 && ring_available)
+	corrupt_ring ();
+    }
+
+  end ();
+  return 0;
+}
@@ -44,6 +44,7 @@
 #include "thread-fsm.h"
 #include "tid-parse.h"
 #include <algorithm>
+#include <unordered_map>
 #include "common/gdb_optional.h"
 
 /* Definition of struct thread_info exported to gdbthread.h.  */
@@ -51,6 +52,24 @@
 /* Prototypes for local functions.  */
 
 struct thread_info *thread_list = NULL;
+
+/* The last thread of THREAD_LIST, so that new threads can be appended
+   in constant time.  */
+static struct thread_info *thread_list_tail;
+
+/* Index of the threads by ptid, so that looking up a thread doesn't
+   require walking THREAD_LIST, which can be very long.  Threads are
+   added when created and removed when destroyed or dropped from the
+   list.
+
+   Several threads can share a ptid: a thread that exited but couldn't
+   be deleted yet (see thread_info::deletable) stays listed when the
+   OS reuses its id for a new thread.  The lookup functions return the
+   first of them in THREAD_LIST, which is the one with the lowest
+   global number.  */
+static std::unordered_multimap<ptid_t, thread_info *, hash_ptid>
+  thread_ptid_index;
+
 static int highest_thread_num;
 
 /* True if any thread is, or may be executing.  We need to track this
@@ -237,6 +256,8 @@ init_thread_list (void)
     }
 
   thread_list = NULL;
+  thread_list_tail = NULL;
+  thread_ptid_index.clear ();
   threads_executing = 0;
 }
 
@@ -252,16 +273,41 @@ new_thread (struct inferior *inf, ptid_t ptid)
     thread_list = tp;
   else
     {
-      struct thread_info *last;
-
-      for (last = thread_list; last->next != NULL; last = last->next)
-	;
-      last->next = tp;
+      gdb_assert (thread_list_tail != NULL
+		  && thread_list_tail->next == NULL);
+      thread_list_tail->next = tp;
+      tp->prev = thread_list_tail;
     }
+  thread_list_tail = tp;
 
   return tp;
 }
 
+/* Remove TP from the ptid index, if it is there.  */
+
+static void
+thread_ptid_index_remove (thread_info *tp)
+{
+  auto range = thread_ptid_index.equal_range (tp->ptid);
+
+  for (auto it = range.first; it != range.second; ++it)
+    if (it->second == tp)
+      {
+	thread_ptid_index.erase (it);
+	return;
+      }
+}
+
+/* Change the ptid of TP to PTID, updating the ptid index.  */
+
+static void
+set_thread_ptid (thread_info *tp, ptid_t ptid)
+{
+  thread_ptid_index_remove (tp);
+  tp->ptid = ptid;
+  thread_ptid_index.emplace (ptid, tp);
+}
+
 struct thread_info *
 add_thread_silent (ptid_t ptid)
 {
@@ -295,7 +341,7 @@ add_thread_silent (ptid_t ptid)
 	  delete_thread (ptid);
 
 	  /* Now reset its ptid, and reswitch inferior_ptid to it.  */
-	  tp->ptid = ptid;
+	  set_thread_ptid (tp, ptid);
 	  tp->state = THREAD_STOPPED;
 	  switch_to_thread (ptid);
 
@@ -349,10 +395,13 @@ thread_info::thread_info (struct inferior *inf_, ptid_t ptid_)
   memset (&this->pending_follow, 0, sizeof (this->pending_follow));
   this->pending_follow.kind = TARGET_WAITKIND_SPURIOUS;
   this->suspend.waitstatus.kind = TARGET_WAITKIND_IGNORE;
+
+  thread_ptid_index.emplace (ptid_, this);
 }
 
 thread_info::~thread_info ()
 {
+  thread_ptid_index_remove (this);
   xfree (this->name);
 }
 
@@ -441,13 +490,7 @@ thread_step_over_chain_remove (struct thread_info *tp)
 static void
 delete_thread_1 (ptid_t ptid, int silent)
 {
-  struct thread_info *tp, *tpprev;
-
-  tpprev = NULL;
-
-  for (tp = thread_list; tp; tpprev = tp, tp = tp->next)
-    if (tp->ptid == ptid)
-      break;
+  struct thread_info *tp = find_thread_ptid (ptid);
 
   if (!tp)
     return;
@@ -460,10 +503,14 @@ delete_thread_1 (ptid_t ptid, int silent)
        return;
      }
 
-  if (tpprev)
-    tpprev->next = tp->next;
+  if (tp->prev != NULL)
+    tp->prev->next = tp->next;
   else
     thread_list = tp->next;
+  if (tp->next != NULL)
+    tp->next->prev = tp->prev;
+  else
+    thread_list_tail = tp->prev;
 
   delete tp;
 }
@@ -513,13 +560,14 @@ find_thread_id (struct inferior *inf, int thr_num)
 struct thread_info *
 find_thread_ptid (ptid_t ptid)
 {
-  struct thread_info *tp;
+  auto range = thread_ptid_index.equal_range (ptid);
+  struct thread_info *found = NULL;
 
-  for (tp = thread_list; tp; tp = tp->next)
-    if (tp->ptid == ptid)
-      return tp;
+  for (auto it = range.first; it != range.second; ++it)
+    if (found == NULL || it->second->global_num < found->global_num)
+      found = it->second;
 
-  return NULL;
+  return found;
 }
 
 /* See gdbthread.h.  */
@@ -604,11 +652,10 @@ valid_global_thread_id (int global_id)
 int
 ptid_to_global_thread_id (ptid_t ptid)
 {
-  struct thread_info *tp;
+  struct thread_info *tp = find_thread_ptid (ptid);
 
-  for (tp = thread_list; tp; tp = tp->next)
-    if (tp->ptid == ptid)
-      return tp->global_num;
+  if (tp != NULL)
+    return tp->global_num;
 
   return 0;
 }
@@ -627,13 +674,7 @@ global_thread_id_to_ptid (int global_id)
 int
 in_thread_list (ptid_t ptid)
 {
-  struct thread_info *tp;
-
-  for (tp = thread_list; tp; tp = tp->next)
-    if (tp->ptid == ptid)
-      return 1;
-
-  return 0;			/* Never heard of 'im.  */
+  return find_thread_ptid (ptid) != NULL;
 }
 
 /* Finds the first thread of the inferior given by PID.  If PID is -1,
@@ -864,7 +905,7 @@ thread_change_ptid (ptid_t old_ptid, ptid_t new_ptid)
   inf->pid = ptid_get_pid (new_ptid);
 
   tp = find_thread_ptid (old_ptid);
-  tp->ptid = new_ptid;
+  set_thread_ptid (tp, new_ptid);
 
   observer_notify_thread_ptid_changed (old_ptid, new_ptid);
 }
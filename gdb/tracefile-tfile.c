@@ -32,12 +32,108 @@
 #include "xml-tdesc.h"
 #include "target-descriptions.h"
 #include "buffer.h"
+#include "common/byte-vector.h"
 #include <algorithm>
+#include <map>
+#include <sys/stat.h>
+#include <zlib.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void *) -1)
+#endif
+#endif
 
 #ifndef O_LARGEFILE
 #define O_LARGEFILE 0
 #endif
 
+/* Indexed trace files (version 1 of the TFILE format) have the same
+   header and definition section as plain ones, but store the trace
+   frames in zlib-compressed chunks, followed by tables that locate
+   each frame by number, by PC and by tracepoint number, and a
+   fixed-size footer giving the position of the tables.  The frames
+   in a chunk have the same layout as in a plain trace file; the
+   tables and footer are little-endian.  */
+
+/* The frames of an indexed trace file are compressed in chunks of
+   about this many bytes.  A frame never straddles two chunks.  */
+#define TFILE_INDEX_CHUNK_SIZE (256 * 1024)
+
+/* The size of an entry of the chunk table: the 8-byte file offset of
+   the chunk, then its 4-byte compressed and uncompressed sizes.  */
+#define TFILE_INDEX_CHUNK_ENTRY_SIZE 16
+
+/* The size of an entry of the frame table, which is indexed by frame
+   number: the 8-byte PC of the frame, the 4-byte number of its
+   chunk, the 4-byte offset of the frame in the uncompressed chunk,
+   the 4-byte size of the frame's data, then its 2-byte tracepoint
+   number and 2 bytes of padding.  */
+#define TFILE_INDEX_FRAME_ENTRY_SIZE 24
+
+/* The size of an entry of the PC table, sorted by PC then frame
+   number: the 8-byte PC, then the 4-byte frame number.  */
+#define TFILE_INDEX_PC_ENTRY_SIZE 12
+
+/* The size of an entry of the tracepoint table, sorted by tracepoint
+   number then frame number: the 4-byte tracepoint number, then the
+   4-byte frame number.  */
+#define TFILE_INDEX_TP_ENTRY_SIZE 8
+
+/* The footer of an indexed trace file: the 8-byte file offsets of the
+   chunk, frame, PC and tracepoint tables, the 4-byte number of chunks
+   and of frames, then TFILE_INDEX_MAGIC.  */
+#define TFILE_INDEX_FOOTER_SIZE 48
+#define TFILE_INDEX_MAGIC "TFINDEX1"
+
+/* A frame being written into an indexed trace file.  */
+
+struct tfile_index_frame
+{
+  CORE_ADDR pc;
+  unsigned int chunk;
+  unsigned int offset;
+  unsigned int size;
+  uint16_t tpnum;
+};
+
+/* A chunk written into an indexed trace file.  */
+
+struct tfile_index_chunk
+{
+  ULONGEST offset;
+  unsigned int compressed_size;
+  unsigned int size;
+};
+
+/* The state of a writer of indexed trace files.  */
+
+struct tfile_index_writer
+{
+  /* The byte order of the frames' contents.  */
+  enum bfd_endian byte_order;
+
+  /* The offset in the file where the next chunk will be written.  */
+  ULONGEST offset = 0;
+
+  /* The uncompressed frames of the current chunk, followed by the
+     start of the next frame.  */
+  std::vector<gdb_byte> chunk;
+
+  /* The size of the whole frames at the start of CHUNK.  */
+  size_t parsed = 0;
+
+  /* Whether the end of the trace data was seen.  */
+  bool done = false;
+
+  /* The chunks and frames written so far.  */
+  std::vector<tfile_index_chunk> chunks;
+  std::vector<tfile_index_frame> frames;
+
+  /* The address of each tracepoint, used as the PC of its frames.  */
+  std::map<int, CORE_ADDR> tp_addrs;
+};
+
 /* TFILE trace writer.  */
 
 struct tfile_trace_file_writer
@@ -48,6 +144,9 @@ struct tfile_trace_file_writer
   FILE *fp;
   /* Path name of the tfile trace file.  */
   char *pathname;
+  /* The state of the indexed trace file being written, or NULL when
+     writing a plain one.  */
+  struct tfile_index_writer *index;
 };
 
 /* This is the implementation of trace_file_write_ops method
@@ -73,6 +172,7 @@ tfile_dtor (struct trace_file_writer *self)
     = (struct tfile_trace_file_writer *) self;
 
   xfree (writer->pathname);
+  delete writer->index;
 
   if (writer->fp != NULL)
     fclose (writer->fp);
@@ -108,7 +208,10 @@ tfile_write_header (struct trace_file_writer *self)
   /* Write a file header, with a high-bit-set char to indicate a
      binary file, plus a hint as what this file is, and a version
      number in case of future needs.  */
-  written = fwrite ("\x7fTRACE0\n", 8, 1, writer->fp);
+  if (writer->index != NULL)
+    written = fwrite ("\x7fTRACE1\n", 8, 1, writer->fp);
+  else
+    written = fwrite ("\x7fTRACE0\n", 8, 1, writer->fp);
   if (written < 1)
     perror_with_name (writer->pathname);
 }
@@ -265,6 +368,9 @@ tfile_write_uploaded_tp (struct trace_file_writer *self,
 	   utp->hit_count,
 	   phex_nz (utp->traceframe_usage,
 		    sizeof (utp->traceframe_usage)));
+
+  if (writer->index != NULL)
+    writer->index->tp_addrs.emplace (utp->number, utp->addr);
 }
 
 /* This is the implementation of trace_file_write_ops method
@@ -313,6 +419,15 @@ tfile_write_definition_end (struct trace_file_writer *self)
     = (struct tfile_trace_file_writer *) self;
 
   fprintf (writer->fp, "\n");
+
+  if (writer->index != NULL)
+    {
+      long offset = ftell (writer->fp);
+
+      if (offset < 0)
+	perror_with_name (writer->pathname);
+      writer->index->offset = offset;
+    }
 }
 
 /* This is the implementation of trace_file_write_ops method
@@ -374,6 +489,222 @@ tfile_trace_file_writer_new (void)
   writer->base.ops = &tfile_write_ops;
   writer->fp = NULL;
   writer->pathname = NULL;
+  writer->index = NULL;
+
+  return (struct trace_file_writer *) writer;
+}
+
+/* This is the implementation of trace_file_write_ops method
+   target_save for indexed trace files.  */
+
+static int
+tfile_index_target_save (struct trace_file_writer *self,
+			 const char *filename)
+{
+  /* Targets only save plain trace files.  */
+  return 0;
+}
+
+/* Write LEN bytes of BUF to the indexed trace file of WRITER.  */
+
+static void
+tfile_index_write (struct tfile_trace_file_writer *writer,
+		   const gdb_byte *buf, size_t len)
+{
+  if (len > 0 && fwrite (buf, len, 1, writer->fp) < 1)
+    perror_with_name (writer->pathname);
+  writer->index->offset += len;
+}
+
+/* Compress the first LEN bytes of the current chunk of WRITER, which
+   hold whole frames, and write them out.  */
+
+static void
+tfile_index_flush_chunk (struct tfile_trace_file_writer *writer,
+			 size_t len)
+{
+  struct tfile_index_writer *index = writer->index;
+  struct tfile_index_chunk chunk;
+
+  if (len == 0)
+    return;
+
+  uLongf compressed_size = compressBound (len);
+  gdb::byte_vector compressed (compressed_size);
+
+  if (compress2 (compressed.data (), &compressed_size,
+		 index->chunk.data (), len, Z_BEST_SPEED) != Z_OK)
+    error (_("Unable to compress trace frames"));
+
+  chunk.offset = index->offset;
+  chunk.compressed_size = compressed_size;
+  chunk.size = len;
+  index->chunks.push_back (chunk);
+
+  tfile_index_write (writer, compressed.data (), compressed_size);
+  index->chunk.erase (index->chunk.begin (), index->chunk.begin () + len);
+  index->parsed -= len;
+}
+
+/* This is the implementation of trace_file_write_ops method
+   write_raw_data for indexed trace files.  The trace buffer is
+   appended to the current chunk, and split into frames as they are
+   complete.  */
+
+static void
+tfile_index_write_raw_data (struct trace_file_writer *self, gdb_byte *buf,
+			    LONGEST len)
+{
+  struct tfile_trace_file_writer *writer
+    = (struct tfile_trace_file_writer *) self;
+  struct tfile_index_writer *index = writer->index;
+
+  if (index->done)
+    return;
+
+  index->chunk.insert (index->chunk.end (), buf, buf + len);
+
+  while (index->chunk.size () - index->parsed >= 6)
+    {
+      const gdb_byte *header = &index->chunk[index->parsed];
+      struct tfile_index_frame frame;
+
+      frame.tpnum = extract_unsigned_integer (header, 2, index->byte_order);
+      frame.size = extract_unsigned_integer (header + 2, 4,
+					     index->byte_order);
+
+      /* A zero tracepoint number marks the end of the trace data.  */
+      if (frame.tpnum == 0)
+	{
+	  index->chunk.resize (index->parsed);
+	  index->done = true;
+	  break;
+	}
+
+      if (index->chunk.size () - index->parsed - 6 < frame.size)
+	break;
+
+      /* Use the address of the tracepoint as the frame's PC, as the
+	 reader of plain trace files does.  */
+      auto it = index->tp_addrs.find (frame.tpnum);
+      frame.pc = it != index->tp_addrs.end () ? it->second : 0;
+      frame.chunk = index->chunks.size ();
+      frame.offset = index->parsed;
+      index->frames.push_back (frame);
+
+      index->parsed += 6 + frame.size;
+      if (index->parsed >= TFILE_INDEX_CHUNK_SIZE)
+	tfile_index_flush_chunk (writer, index->parsed);
+    }
+}
+
+/* This is the implementation of trace_file_write_ops method
+   end for indexed trace files.  Write the last chunk, then the
+   tables and the footer.  */
+
+static void
+tfile_index_end (struct trace_file_writer *self)
+{
+  struct tfile_trace_file_writer *writer
+    = (struct tfile_trace_file_writer *) self;
+  struct tfile_index_writer *index = writer->index;
+  const enum bfd_endian little = BFD_ENDIAN_LITTLE;
+  ULONGEST chunks_offset, frames_offset, pc_offset, tp_offset;
+  gdb_byte buf[TFILE_INDEX_FOOTER_SIZE];
+  std::vector<std::pair<CORE_ADDR, unsigned int>> by_pc;
+  std::vector<std::pair<unsigned int, unsigned int>> by_tp;
+
+  if (index->chunk.size () != index->parsed)
+    error (_("Trace data ends in the middle of a trace frame"));
+  tfile_index_flush_chunk (writer, index->parsed);
+
+  chunks_offset = index->offset;
+  for (const tfile_index_chunk &chunk : index->chunks)
+    {
+      store_unsigned_integer (buf, 8, little, chunk.offset);
+      store_unsigned_integer (buf + 8, 4, little, chunk.compressed_size);
+      store_unsigned_integer (buf + 12, 4, little, chunk.size);
+      tfile_index_write (writer, buf, TFILE_INDEX_CHUNK_ENTRY_SIZE);
+    }
+
+  frames_offset = index->offset;
+  for (const tfile_index_frame &frame : index->frames)
+    {
+      store_unsigned_integer (buf, 8, little, frame.pc);
+      store_unsigned_integer (buf + 8, 4, little, frame.chunk);
+      store_unsigned_integer (buf + 12, 4, little, frame.offset);
+      store_unsigned_integer (buf + 16, 4, little, frame.size);
+      store_unsigned_integer (buf + 20, 2, little, frame.tpnum);
+      store_unsigned_integer (buf + 22, 2, little, 0);
+      tfile_index_write (writer, buf, TFILE_INDEX_FRAME_ENTRY_SIZE);
+    }
+
+  by_pc.reserve (index->frames.size ());
+  by_tp.reserve (index->frames.size ());
+  for (unsigned int i = 0; i < index->frames.size (); i++)
+    {
+      by_pc.emplace_back (index->frames[i].pc, i);
+      by_tp.emplace_back (index->frames[i].tpnum, i);
+    }
+  std::sort (by_pc.begin (), by_pc.end ());
+  std::sort (by_tp.begin (), by_tp.end ());
+
+  pc_offset = index->offset;
+  for (const auto &entry : by_pc)
+    {
+      store_unsigned_integer (buf, 8, little, entry.first);
+      store_unsigned_integer (buf + 8, 4, little, entry.second);
+      tfile_index_write (writer, buf, TFILE_INDEX_PC_ENTRY_SIZE);
+    }
+
+  tp_offset = index->offset;
+  for (const auto &entry : by_tp)
+    {
+      store_unsigned_integer (buf, 4, little, entry.first);
+      store_unsigned_integer (buf + 4, 4, little, entry.second);
+      tfile_index_write (writer, buf, TFILE_INDEX_TP_ENTRY_SIZE);
+    }
+
+  store_unsigned_integer (buf, 8, little, chunks_offset);
+  store_unsigned_integer (buf + 8, 8, little, frames_offset);
+  store_unsigned_integer (buf + 16, 8, little, pc_offset);
+  store_unsigned_integer (buf + 24, 8, little, tp_offset);
+  store_unsigned_integer (buf + 32, 4, little, index->chunks.size ());
+  store_unsigned_integer (buf + 36, 4, little, index->frames.size ());
+  memcpy (buf + 40, TFILE_INDEX_MAGIC, 8);
+  tfile_index_write (writer, buf, TFILE_INDEX_FOOTER_SIZE);
+}
+
+/* Operations to write trace buffers into an indexed trace file.  */
+
+static const struct trace_file_write_ops tfile_index_write_ops =
+{
+  tfile_dtor,
+  tfile_index_target_save,
+  tfile_start,
+  tfile_write_header,
+  tfile_write_regblock_type,
+  tfile_write_status,
+  tfile_write_uploaded_tsv,
+  tfile_write_uploaded_tp,
+  tfile_write_tdesc,
+  tfile_write_definition_end,
+  tfile_index_write_raw_data,
+  NULL,
+  tfile_index_end,
+};
+
+/* Return a trace writer for indexed TFILE format.  */
+
+struct trace_file_writer *
+tfile_index_trace_file_writer_new (void)
+{
+  struct tfile_trace_file_writer *writer
+    = (struct tfile_trace_file_writer *) tfile_trace_file_writer_new ();
+
+  writer->base.ops = &tfile_index_write_ops;
+  writer->index = new tfile_index_writer;
+  writer->index->byte_order = gdbarch_byte_order (target_gdbarch ());
 
   return (struct trace_file_writer *) writer;
 }
@@ -396,6 +727,49 @@ static int cur_data_size;
 int trace_regblock_size;
 static struct buffer trace_tdesc;
 
+/* The index of an indexed trace file, and the frames of the chunk
+   last read from it.  */
+
+struct tfile_index
+{
+  ~tfile_index ()
+  {
+#ifdef HAVE_MMAP
+    if (map_addr != NULL)
+      munmap (map_addr, map_len);
+#endif
+  }
+
+  /* The whole trace file, if it could be mapped in memory.  */
+  gdb_byte *map_addr = NULL;
+  size_t map_len = 0;
+
+  /* The tables at the end of the trace file, if it could not be
+     mapped.  */
+  gdb::byte_vector tables;
+
+  /* The chunk, frame, PC and tracepoint tables.  */
+  const gdb_byte *chunks;
+  const gdb_byte *frames;
+  const gdb_byte *pcs;
+  const gdb_byte *tps;
+  unsigned int num_chunks;
+  unsigned int num_frames;
+
+  /* The number of the chunk in CHUNK_DATA, or -1.  */
+  int cur_chunk = -1;
+
+  /* The uncompressed frames of chunk CUR_CHUNK.  */
+  gdb::byte_vector chunk_data;
+
+  /* The read position in CHUNK_DATA, which replaces TRACE_FD's seek
+     position for reading frames.  */
+  ULONGEST chunk_pos = 0;
+};
+
+/* The index of the trace file, or NULL if it is a plain one.  */
+static struct tfile_index *trace_index;
+
 static void tfile_append_tdesc_line (const char *line);
 static void tfile_interp_line (char *line,
 			       struct uploaded_tp **utpp,
@@ -405,13 +779,27 @@ static void tfile_interp_line (char *line,
    TRACE_FD's current position.  Note that this call `read'
    underneath, hence it advances the file's seek position.  Throws an
    error if the `read' syscall fails, or less than SIZE bytes are
-   read.  */
+   read.  With an indexed trace file, read from the uncompressed
+   chunk instead.  */
 
 static void
 tfile_read (gdb_byte *readbuf, int size)
 {
   int gotten;
 
+  if (trace_index != NULL)
+    {
+      if (trace_index->chunk_pos > trace_index->chunk_data.size ()
+	  || (trace_index->chunk_data.size () - trace_index->chunk_pos
+	      < size))
+	error (_("Premature end of file while reading trace file"));
+      memcpy (readbuf,
+	      trace_index->chunk_data.data () + trace_index->chunk_pos,
+	      size);
+      trace_index->chunk_pos += size;
+      return;
+    }
+
   gotten = read (trace_fd, readbuf, size);
   if (gotten < 0)
     perror_with_name (trace_filename);
@@ -419,6 +807,225 @@ tfile_read (gdb_byte *readbuf, int size)
     error (_("Premature end of file while reading trace file"));
 }
 
+/* Set the position from which tfile_read reads, like `lseek'.  */
+
+static void
+tfile_seek (off_t offset, int whence)
+{
+  if (trace_index != NULL)
+    {
+      if (whence == SEEK_CUR)
+	offset += trace_index->chunk_pos;
+      trace_index->chunk_pos = offset;
+    }
+  else
+    lseek (trace_fd, offset, whence);
+}
+
+/* Read LEN bytes at OFFSET of the trace file into BUF, bypassing
+   the index.  */
+
+static void
+tfile_read_at (ULONGEST offset, gdb_byte *buf, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t gotten;
+
+      if (lseek (trace_fd, offset, SEEK_SET) < 0)
+	perror_with_name (trace_filename);
+      gotten = read (trace_fd, buf, len);
+      if (gotten < 0)
+	perror_with_name (trace_filename);
+      else if (gotten == 0)
+	error (_("Premature end of file while reading trace file"));
+      offset += gotten;
+      buf += gotten;
+      len -= gotten;
+    }
+}
+
+/* Read the tables of the indexed trace file open on TRACE_FD, and
+   install them as TRACE_INDEX.  Throws an error if they are
+   malformed.  */
+
+static void
+tfile_read_index (void)
+{
+  const enum bfd_endian little = BFD_ENDIAN_LITTLE;
+  gdb_byte footer[TFILE_INDEX_FOOTER_SIZE];
+  ULONGEST chunks_offset, frames_offset, pc_offset, tp_offset;
+  ULONGEST tables_offset, tables_end;
+  unsigned int num_chunks, num_frames;
+  struct stat st;
+
+  if (fstat (trace_fd, &st) < 0)
+    perror_with_name (trace_filename);
+  if (st.st_size < TRACE_HEADER_SIZE + TFILE_INDEX_FOOTER_SIZE)
+    error (_("Premature end of file while reading trace file"));
+
+  tables_end = st.st_size - TFILE_INDEX_FOOTER_SIZE;
+  tfile_read_at (tables_end, footer, TFILE_INDEX_FOOTER_SIZE);
+  if (memcmp (footer + 40, TFILE_INDEX_MAGIC, 8) != 0)
+    error (_("Missing index at the end of the trace file"));
+
+  chunks_offset = extract_unsigned_integer (footer, 8, little);
+  frames_offset = extract_unsigned_integer (footer + 8, 8, little);
+  pc_offset = extract_unsigned_integer (footer + 16, 8, little);
+  tp_offset = extract_unsigned_integer (footer + 24, 8, little);
+  num_chunks = extract_unsigned_integer (footer + 32, 4, little);
+  num_frames = extract_unsigned_integer (footer + 36, 4, little);
+
+  if (chunks_offset > tables_end
+      || (tables_end - chunks_offset
+	  < ((ULONGEST) num_chunks * TFILE_INDEX_CHUNK_ENTRY_SIZE
+	     + (ULONGEST) num_frames * (TFILE_INDEX_FRAME_ENTRY_SIZE
+					+ TFILE_INDEX_PC_ENTRY_SIZE
+					+ TFILE_INDEX_TP_ENTRY_SIZE)))
+      || frames_offset != (chunks_offset
+			   + ((ULONGEST) num_chunks
+			      * TFILE_INDEX_CHUNK_ENTRY_SIZE))
+      || pc_offset != (frames_offset
+		       + ((ULONGEST) num_frames
+			  * TFILE_INDEX_FRAME_ENTRY_SIZE))
+      || tp_offset != (pc_offset
+		       + (ULONGEST) num_frames * TFILE_INDEX_PC_ENTRY_SIZE))
+    error (_("Corrupted index in trace file"));
+
+  std::unique_ptr<tfile_index> index (new tfile_index);
+  const gdb_byte *tables = NULL;
+  tables_offset = chunks_offset;
+
+#ifdef HAVE_MMAP
+  if ((ULONGEST) st.st_size == (size_t) st.st_size)
+    {
+      void *addr = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+			 trace_fd, 0);
+
+      if (addr != MAP_FAILED)
+	{
+	  index->map_addr = (gdb_byte *) addr;
+	  index->map_len = st.st_size;
+	  tables = index->map_addr + tables_offset;
+	}
+    }
+#endif
+
+  if (tables == NULL)
+    {
+      index->tables.resize (tables_end - tables_offset);
+      tfile_read_at (tables_offset, index->tables.data (),
+		     index->tables.size ());
+      tables = index->tables.data ();
+    }
+
+  index->chunks = tables;
+  index->frames = tables + (frames_offset - tables_offset);
+  index->pcs = tables + (pc_offset - tables_offset);
+  index->tps = tables + (tp_offset - tables_offset);
+  index->num_chunks = num_chunks;
+  index->num_frames = num_frames;
+
+  trace_index = index.release ();
+}
+
+/* Uncompress chunk CHUNK of the indexed trace file into
+   TRACE_INDEX->chunk_data, unless it already is there.  */
+
+static void
+tfile_index_read_chunk (unsigned int chunk)
+{
+  const enum bfd_endian little = BFD_ENDIAN_LITTLE;
+  const gdb_byte *entry;
+  ULONGEST offset;
+  unsigned int compressed_size, size;
+  const gdb_byte *compressed;
+  gdb::byte_vector buf;
+
+  if (trace_index->cur_chunk == chunk)
+    return;
+
+  if (chunk >= trace_index->num_chunks)
+    error (_("Corrupted index in trace file"));
+
+  entry = trace_index->chunks + chunk * TFILE_INDEX_CHUNK_ENTRY_SIZE;
+  offset = extract_unsigned_integer (entry, 8, little);
+  compressed_size = extract_unsigned_integer (entry + 8, 4, little);
+  size = extract_unsigned_integer (entry + 12, 4, little);
+
+  if (trace_index->map_addr != NULL)
+    {
+      if (offset > trace_index->map_len
+	  || trace_index->map_len - offset < compressed_size)
+	error (_("Corrupted index in trace file"));
+      compressed = trace_index->map_addr + offset;
+    }
+  else
+    {
+      buf.resize (compressed_size);
+      tfile_read_at (offset, buf.data (), compressed_size);
+      compressed = buf.data ();
+    }
+
+  trace_index->cur_chunk = -1;
+  trace_index->chunk_data.resize (size);
+
+  uLongf uncompressed_size = size;
+  if (uncompress (trace_index->chunk_data.data (), &uncompressed_size,
+		  compressed, compressed_size) != Z_OK
+      || uncompressed_size != size)
+    error (_("Corrupted trace frames in trace file"));
+
+  trace_index->cur_chunk = chunk;
+}
+
+/* Return the entry of the frame table for frame FRAME.  */
+
+static const gdb_byte *
+tfile_index_frame_entry (unsigned int frame)
+{
+  return (trace_index->frames
+	  + (ULONGEST) frame * TFILE_INDEX_FRAME_ENTRY_SIZE);
+}
+
+/* Search TABLE, a table of the trace index sorted by a KEY_LEN-byte
+   key then by a 4-byte frame number, for the first frame numbered
+   FRAME or above whose key is KEY.  Return its number, or -1.  */
+
+static int
+tfile_index_search (const gdb_byte *table, int key_len,
+		    ULONGEST key, unsigned int frame)
+{
+  const enum bfd_endian little = BFD_ENDIAN_LITTLE;
+  const int entry_size = key_len + 4;
+  unsigned int lo = 0, hi = trace_index->num_frames;
+
+  while (lo < hi)
+    {
+      unsigned int mid = lo + (hi - lo) / 2;
+      const gdb_byte *entry = table + (ULONGEST) mid * entry_size;
+      ULONGEST entry_key = extract_unsigned_integer (entry, key_len, little);
+
+      if (entry_key < key
+	  || (entry_key == key
+	      && (extract_unsigned_integer (entry + key_len, 4, little)
+		  < frame)))
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  if (lo < trace_index->num_frames)
+    {
+      const gdb_byte *entry = table + (ULONGEST) lo * entry_size;
+
+      if (extract_unsigned_integer (entry, key_len, little) == key)
+	return extract_unsigned_integer (entry + key_len, 4, little);
+    }
+
+  return -1;
+}
+
 static void
 tfile_open (const char *arg, int from_tty)
 {
@@ -426,6 +1033,7 @@ tfile_open (const char *arg, int from_tty)
   int scratch_chan;
   char header[TRACE_HEADER_SIZE];
   char linebuf[1000]; /* Should be max remote packet size or so.  */
+  int indexed;
   gdb_byte byte;
   int bytes, i;
   struct trace_status *ts;
@@ -463,8 +1071,10 @@ tfile_open (const char *arg, int from_tty)
 
   bytes += TRACE_HEADER_SIZE;
   if (!(header[0] == 0x7f
-	&& (startswith (header + 1, "TRACE0\n"))))
+	&& (startswith (header + 1, "TRACE0\n")
+	    || startswith (header + 1, "TRACE1\n"))))
     error (_("File is not a valid trace file."));
+  indexed = header[6] == '1';
 
   push_target (&tfile_ops);
 
@@ -515,6 +1125,9 @@ tfile_open (const char *arg, int from_tty)
 	 traceframes.  */
       if (trace_regblock_size == 0)
 	error (_("No register block size recorded in trace file"));
+
+      if (indexed)
+	tfile_read_index ();
     }
   CATCH (ex, RETURN_MASK_ALL)
     {
@@ -592,8 +1205,12 @@ tfile_close (struct target_ops *self)
 
   pid = ptid_get_pid (inferior_ptid);
   inferior_ptid = null_ptid;	/* Avoid confusion from thread stuff.  */
-  exit_inferior_silent (pid);
+  /* There is no inferior yet if tfile_open failed.  */
+  if (pid != 0)
+    exit_inferior_silent (pid);
 
+  delete trace_index;
+  trace_index = NULL;
   close (trace_fd);
   trace_fd = -1;
   xfree (trace_filename);
@@ -628,7 +1245,7 @@ tfile_get_traceframe_address (off_t tframe_offset)
   CORE_ADDR addr = 0;
   short tpnum;
   struct tracepoint *tp;
-  off_t saved_offset = cur_offset;
+  off_t saved_offset = lseek (trace_fd, 0, SEEK_CUR);
 
   /* FIXME dig pc out of collected registers.  */
 
@@ -644,12 +1261,73 @@ tfile_get_traceframe_address (off_t tframe_offset)
   if (tp && tp->loc)
     addr = tp->loc->address;
 
-  /* Restore our seek position.  */
-  cur_offset = saved_offset;
-  lseek (trace_fd, cur_offset, SEEK_SET);
+  /* Restore our seek position, which tfile_trace_find is scanning
+     from.  */
+  lseek (trace_fd, saved_offset, SEEK_SET);
   return addr;
 }
 
+/* Implementation of tfile_trace_find for indexed trace files.  */
+
+static int
+tfile_index_trace_find (enum trace_find_type type, int num,
+			CORE_ADDR addr1, CORE_ADDR addr2, int *tpp)
+{
+  const enum bfd_endian little = BFD_ENDIAN_LITTLE;
+  /* Except for tfind_number, start from the _next_ trace frame.  */
+  unsigned int next = get_traceframe_number () + 1;
+  const gdb_byte *entry;
+  int tfnum = -1;
+
+  switch (type)
+    {
+    case tfind_number:
+      if (num >= 0 && num < trace_index->num_frames)
+	tfnum = num;
+      break;
+    case tfind_pc:
+      tfnum = tfile_index_search (trace_index->pcs, 8, addr1, next);
+      break;
+    case tfind_tp:
+      /* NUM is the tracepoint's number on the target.  */
+      tfnum = tfile_index_search (trace_index->tps, 4, num, next);
+      break;
+    case tfind_range:
+    case tfind_outside:
+      for (unsigned int i = next; i < trace_index->num_frames; i++)
+	{
+	  CORE_ADDR tfaddr;
+
+	  tfaddr = extract_unsigned_integer (tfile_index_frame_entry (i), 8,
+					     little);
+	  if ((addr1 <= tfaddr && tfaddr <= addr2) == (type == tfind_range))
+	    {
+	      tfnum = i;
+	      break;
+	    }
+	}
+      break;
+    default:
+      internal_error (__FILE__, __LINE__, _("unknown tfind type"));
+    }
+
+  if (tfnum < 0)
+    {
+      if (tpp)
+	*tpp = -1;
+      return -1;
+    }
+
+  entry = tfile_index_frame_entry (tfnum);
+  tfile_index_read_chunk (extract_unsigned_integer (entry + 8, 4, little));
+  cur_offset = extract_unsigned_integer (entry + 12, 4, little) + 6;
+  cur_data_size = extract_unsigned_integer (entry + 16, 4, little);
+  if (tpp)
+    *tpp = extract_unsigned_integer (entry + 20, 2, little);
+
+  return tfnum;
+}
+
 /* Given a type of search and some parameters, scan the collection of
    traceframes in the file looking for a match.  When found, return
    both the traceframe and tracepoint number, otherwise -1 for
@@ -662,7 +1340,6 @@ tfile_trace_find (struct target_ops *self, enum trace_find_type type, int num,
   short tpnum;
   int tfnum = 0, found = 0;
   unsigned int data_size;
-  struct tracepoint *tp;
   off_t offset, tframe_offset;
   CORE_ADDR tfaddr;
 
@@ -673,6 +1350,9 @@ tfile_trace_find (struct target_ops *self, enum trace_find_type type, int num,
       return -1;
     }
 
+  if (trace_index != NULL)
+    return tfile_index_trace_find (type, num, addr1, addr2, tpp);
+
   lseek (trace_fd, trace_frames_offset, SEEK_SET);
   offset = trace_frames_offset;
   while (1)
@@ -710,8 +1390,8 @@ tfile_trace_find (struct target_ops *self, enum trace_find_type type, int num,
 		    found = 1;
 		  break;
 		case tfind_tp:
-		  tp = get_tracepoint (num);
-		  if (tp && tpnum == tp->number_on_target)
+		  /* NUM is the tracepoint's number on the target.  */
+		  if (tpnum == num)
 		    found = 1;
 		  break;
 		case tfind_range:
@@ -782,7 +1462,7 @@ traceframe_walk_blocks (walk_blocks_callback_func callback,
   /* Iterate through a traceframe's blocks, looking for a block of the
      requested type.  */
 
-  lseek (trace_fd, cur_offset + pos, SEEK_SET);
+  tfile_seek (cur_offset + pos, SEEK_SET);
   while (pos < cur_data_size)
     {
       unsigned short mlen;
@@ -798,21 +1478,21 @@ traceframe_walk_blocks (walk_blocks_callback_func callback,
       switch (block_type)
 	{
 	case 'R':
-	  lseek (trace_fd, cur_offset + pos + trace_regblock_size, SEEK_SET);
+	  tfile_seek (cur_offset + pos + trace_regblock_size, SEEK_SET);
 	  pos += trace_regblock_size;
 	  break;
 	case 'M':
-	  lseek (trace_fd, cur_offset + pos + 8, SEEK_SET);
+	  tfile_seek (cur_offset + pos + 8, SEEK_SET);
 	  tfile_read ((gdb_byte *) &mlen, 2);
           mlen = (unsigned short)
                 extract_unsigned_integer ((gdb_byte *) &mlen, 2,
                                           gdbarch_byte_order
                                               (target_gdbarch ()));
-	  lseek (trace_fd, mlen, SEEK_CUR);
+	  tfile_seek (mlen, SEEK_CUR);
 	  pos += (8 + 2 + mlen);
 	  break;
 	case 'V':
-	  lseek (trace_fd, cur_offset + pos + 4 + 8, SEEK_SET);
+	  tfile_seek (cur_offset + pos + 4 + 8, SEEK_SET);
 	  pos += (4 + 8);
 	  break;
 	default:
@@ -961,7 +1641,7 @@ tfile_xfer_partial (struct target_ops *ops, enum target_object object,
 		amt = len;
 
 	      if (maddr != offset)
-	        lseek (trace_fd, offset - maddr, SEEK_CUR);
+	        tfile_seek (offset - maddr, SEEK_CUR);
 	      tfile_read (readbuf, amt);
 	      *xfered_len = amt;
 	      return TARGET_XFER_OK;
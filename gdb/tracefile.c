@@ -313,6 +313,7 @@ tsave_command (const char *args, int from_tty)
   char *filename = NULL;
   struct cleanup *back_to;
   int generate_ctf = 0;
+  int generate_index = 0;
   struct trace_file_writer *writer = NULL;
 
   if (args == NULL)
@@ -327,6 +328,8 @@ tsave_command (const char *args, int from_tty)
 	target_does_save = 1;
       else if (strcmp (*argv, "-ctf") == 0)
 	generate_ctf = 1;
+      else if (strcmp (*argv, "-index") == 0)
+	generate_index = 1;
       else if (**argv == '-')
 	error (_("unknown option `%s'"), *argv);
       else
@@ -336,8 +339,13 @@ tsave_command (const char *args, int from_tty)
   if (!filename)
     error_no_arg (_("file in which to save trace data"));
 
+  if (generate_ctf && generate_index)
+    error (_("Options -ctf and -index are mutually exclusive"));
+
   if (generate_ctf)
     writer = ctf_trace_file_writer_new ();
+  else if (generate_index)
+    writer = tfile_index_trace_file_writer_new ();
   else
     writer = tfile_trace_file_writer_new ();
 
@@ -501,6 +509,8 @@ _initialize_tracefile (void)
   add_com ("tsave", class_trace, tsave_command, _("\
 Save the trace data to a file.\n\
 Use the '-ctf' option to save the data to CTF format.\n\
+Use the '-index' option to save the data to an indexed and compressed\n\
+trace file, in which \"tfind\" does not need to scan the trace frames.\n\
 Use the '-r' option to direct the target to save directly to the file,\n\
 using its own filesystem."));
 }
@@ -113,6 +113,8 @@ struct trace_file_writer
 
 extern struct trace_file_writer *tfile_trace_file_writer_new (void);
 
+extern struct trace_file_writer *tfile_index_trace_file_writer_new (void);
+
 extern void init_tracefile_ops (struct target_ops *ops);
 
 extern void tracefile_fetch_registers (struct regcache *regcache, int regno);
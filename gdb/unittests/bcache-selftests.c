@@ -0,0 +1,105 @@
+/* Self tests for bcache for GDB, the GNU debugger.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "selftest.h"
+#include "bcache.h"
+#include "common/parallel-for.h"
+#include <atomic>
+
+namespace selftests {
+namespace bcache_tests {
+
+/* The number of distinct strings the tests add.  Enough for the hash
+   table to grow several times.  */
+
+static const int n_unique = 20000;
+
+/* Add the decimal representations of 0 to N_UNIQUE - 1, each COPIES
+   times, to a new bcache using N_THREADS worker threads, and check
+   that each string is added once and always gives the same copy.  */
+
+static void
+test_one (size_t n_threads, int copies)
+{
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+
+  struct bcache *cache = bcache_xmalloc (NULL, NULL);
+  std::vector<int> keys;
+
+  for (int i = 0; i < copies; ++i)
+    for (int j = 0; j < n_unique; ++j)
+      keys.push_back (j);
+
+  std::vector<std::atomic<const char *>> copy (n_unique);
+  std::atomic<int> n_added (0);
+  std::atomic<int> n_mismatches (0);
+
+  for (auto &c : copy)
+    c = NULL;
+
+  gdb::parallel_for_each (keys.begin (), keys.end (),
+			  [&] (std::vector<int>::iterator iter,
+			       std::vector<int>::iterator last)
+    {
+      for (; iter != last; ++iter)
+	{
+	  std::string str = std::to_string (*iter);
+	  int added;
+	  const char *result
+	    = (const char *) bcache_full (str.c_str (), str.size () + 1,
+					  cache, &added);
+	  const char *expected = NULL;
+
+	  if (added)
+	    ++n_added;
+	  if (strcmp (result, str.c_str ()) != 0)
+	    ++n_mismatches;
+	  if (!copy[*iter].compare_exchange_strong (expected, result)
+	      && expected != result)
+	    ++n_mismatches;
+	}
+    });
+
+  SELF_CHECK (n_added == n_unique);
+  SELF_CHECK (n_mismatches == 0);
+
+  bcache_xfree (cache);
+}
+
+static void
+test ()
+{
+  size_t n_threads = gdb::thread_pool::g_thread_pool->thread_count ();
+
+  for (size_t threads : { 0, 4 })
+    for (int copies : { 1, 3 })
+      test_one (threads, copies);
+
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+}
+
+} /* namespace bcache_tests */
+} /* namespace selftests */
+
+void
+_initialize_bcache_selftests ()
+{
+  selftests::register_test ("bcache", selftests::bcache_tests::test);
+}
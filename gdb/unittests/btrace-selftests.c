@@ -0,0 +1,140 @@
+/* Self tests for the btrace instruction store for GDB, the GNU debugger.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "selftest.h"
+#include "btrace.h"
+
+namespace selftests {
+namespace btrace_tests {
+
+/* Return the I'th instruction of a made-up trace.  Most instructions
+   follow their predecessor; every so often there is a jump forward or
+   backward, and the address space wraps around at the end.  */
+
+static btrace_insn
+make_insn (unsigned int i)
+{
+  btrace_insn insn;
+
+  if (i % 97 == 0)
+    insn.pc = (CORE_ADDR) 0x400000 + (i % 13) * 0x1000;
+  else if (i % 501 == 0)
+    insn.pc = (CORE_ADDR) -16;
+  else
+    insn.pc = 0;
+  insn.size = 1 + i % 15;
+  insn.iclass = (enum btrace_insn_class) (i % 4);
+  insn.flags = 0;
+  if (i % 7 == 0)
+    insn.flags |= BTRACE_INSN_FLAG_SPECULATIVE;
+
+  return insn;
+}
+
+/* Fill in the addresses of the instructions returned by make_insn, which
+   only gives explicit addresses for branch targets, and return them.  */
+
+static std::vector<btrace_insn>
+make_trace (unsigned int n)
+{
+  std::vector<btrace_insn> trace;
+  CORE_ADDR pc = 0x1000;
+
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      btrace_insn insn = make_insn (i);
+
+      if (insn.pc == 0)
+	insn.pc = pc;
+      pc = insn.pc + insn.size;
+      trace.push_back (insn);
+    }
+
+  return trace;
+}
+
+static bool
+insn_equal (const btrace_insn &lhs, const btrace_insn &rhs)
+{
+  return (lhs.pc == rhs.pc && lhs.size == rhs.size
+	  && lhs.iclass == rhs.iclass && lhs.flags == rhs.flags);
+}
+
+static void
+test ()
+{
+  const unsigned int n = 5 * BTRACE_INSN_CHUNK_SIZE + 123;
+  std::vector<btrace_insn> trace = make_trace (n);
+  btrace_insn_store store;
+
+  SELF_CHECK (store.empty ());
+
+  for (const btrace_insn &insn : trace)
+    store.push_back (insn);
+
+  SELF_CHECK (store.size () == n);
+  SELF_CHECK (insn_equal (store.back (), trace.back ()));
+
+  /* Sequential and random access, touching more chunks than are
+     cached.  */
+  for (unsigned int i = 0; i < n; ++i)
+    SELF_CHECK (insn_equal (store[i], trace[i]));
+
+  for (unsigned int i = 0; i < n; i += 1 + i % 3000)
+    {
+      unsigned int j = n - 1 - i;
+
+      SELF_CHECK (insn_equal (store[i], trace[i]));
+      SELF_CHECK (insn_equal (store[j], trace[j]));
+    }
+
+  /* Packing must actually save memory.  */
+  SELF_CHECK (store.memory_used () < n * sizeof (btrace_insn) / 2);
+
+  /* Pop back across a chunk boundary and append again.  */
+  while (store.size () > 2 * BTRACE_INSN_CHUNK_SIZE - 5)
+    store.pop_back ();
+  SELF_CHECK (store.size () == 2 * BTRACE_INSN_CHUNK_SIZE - 5);
+  SELF_CHECK (insn_equal (store.back (), trace[store.size () - 1]));
+
+  for (unsigned int i = store.size (); i < n; ++i)
+    store.push_back (trace[i]);
+
+  SELF_CHECK (store.size () == n);
+  for (unsigned int i = 0; i < n; ++i)
+    SELF_CHECK (insn_equal (store[i], trace[i]));
+
+  store.clear ();
+  SELF_CHECK (store.empty ());
+
+  store.push_back (trace[42]);
+  SELF_CHECK (store.size () == 1);
+  SELF_CHECK (insn_equal (store[0], trace[42]));
+}
+
+} /* namespace btrace_tests */
+} /* namespace selftests */
+
+void
+_initialize_btrace_selftests ()
+{
+  selftests::register_test ("btrace_insn_store",
+			    selftests::btrace_tests::test);
+}
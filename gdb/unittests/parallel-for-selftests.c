@@ -0,0 +1,96 @@
+/* Self tests for parallel_for_each for GDB, the GNU debugger.
+
+   Copyright (C) 2017 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "selftest.h"
+#include "common/parallel-for.h"
+#include <atomic>
+
+namespace selftests {
+namespace parallel_for {
+
+/* Restore the thread count of the global thread pool on scope
+   exit.  */
+
+struct save_restore_n_threads
+{
+  save_restore_n_threads ()
+    : n_threads (gdb::thread_pool::g_thread_pool->thread_count ())
+  {
+  }
+
+  ~save_restore_n_threads ()
+  {
+    gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+  }
+
+  size_t n_threads;
+};
+
+/* Check that every element of a range of NUMBER elements is visited
+   exactly once, using N_THREADS worker threads.  */
+
+static void
+test_one (size_t n_threads, int number)
+{
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+
+  std::vector<std::atomic<int>> counts (number);
+  std::atomic<int> n_calls (0);
+
+  std::vector<int> elements (number);
+  for (int i = 0; i < number; ++i)
+    elements[i] = i;
+
+  gdb::parallel_for_each (elements.begin (), elements.end (),
+			  [&] (std::vector<int>::iterator iter,
+			       std::vector<int>::iterator last)
+    {
+      ++n_calls;
+      for (; iter != last; ++iter)
+	++counts[*iter];
+    });
+
+  for (int i = 0; i < number; ++i)
+    SELF_CHECK (counts[i] == 1);
+
+  /* Ranges too small to be split are processed with a single call.  */
+  if (number < 10 * 2)
+    SELF_CHECK (n_calls == 1);
+}
+
+static void
+test ()
+{
+  save_restore_n_threads saver;
+
+  for (size_t n_threads : { 0, 1, 2, 4, 20 })
+    for (int number : { 0, 1, 7, 19, 100, 1000 })
+      test_one (n_threads, number);
+}
+
+} /* namespace parallel_for */
+} /* namespace selftests */
+
+void
+_initialize_parallel_for_selftests ()
+{
+  selftests::register_test ("parallel_for",
+			    selftests::parallel_for::test);
+}